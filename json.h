@@ -50,6 +50,17 @@
 #include <stddef.h>
 #include <string.h>
 
+#if defined(_MSC_VER) && (_MSC_VER < 1920)
+#define json_intmax_t __int64
+#define json_uintmax_t unsigned __int64
+#define json_uint32_t unsigned __int32
+#else
+#include <inttypes.h>
+#define json_intmax_t intmax_t
+#define json_uintmax_t uintmax_t
+#define json_uint32_t uint32_t
+#endif
+
 #if defined(__TINYC__)
 #define JSON_ATTRIBUTE(a) __attribute((a))
 #else
@@ -70,6 +81,15 @@ extern "C" {
 
 struct json_value_s;
 struct json_parse_result_s;
+struct json_parse_size_state_s;
+struct json_query_s;
+struct json_write_cache_s;
+struct json_builder_s;
+struct json_writer_s;
+struct json_write_slice_s;
+struct json_write_segment_s;
+struct json_reformat_s;
+struct json_template_s;
 
 enum json_parse_flags_e {
   json_parse_flags_default = 0,
@@ -145,6 +165,21 @@ enum json_parse_flags_e {
        json_parse_flags_allow_multi_line_strings)
 };
 
+enum json_write_flags_e {
+  json_write_flags_default = 0,
+
+  /* write arrays that contain no arrays or objects on one line when writing
+     pretty JSON. For example, [1, 2, 3] rather than an element per line. */
+  json_write_flags_inline_scalar_arrays = 0x1,
+
+  /* write every character of a string that is not ASCII as a \uXXXX escape
+     (or a surrogate pair of them for characters beyond U+FFFF), so that the
+     output is pure ASCII. Strings that are not valid utf-8 are then treated
+     as malformed JSON input. The strings inside raw values are escaped too,
+     and a raw value with non-ASCII outside of its strings is malformed. */
+  json_write_flags_ensure_ascii = 0x2
+};
+
 /* Parse a JSON text file, returning a pointer to the root of the JSON
  * structure. json_parse performs 1 call to malloc for the entire encoding.
  * Returns 0 if an error occurred (malformed JSON input, or malloc failed). */
@@ -161,6 +196,102 @@ json_parse_ex(const void *src, size_t src_size, size_t flags_bitset,
               void *(*alloc_func_ptr)(void *, size_t), void *user_data,
               struct json_parse_result_s *result);
 
+/* Validate a JSON text file and work out how much memory its DOM needs, without
+ * allocating anything. The DOM needs dom_size + data_size bytes, and both
+ * dom_size and data_size can be NULL. If state_out is not NULL it is filled in
+ * so that json_parse_into can build the DOM without repeating this pass - the
+ * src memory must outlive state_out. Returns 0 on success, or non-zero if an
+ * error occurred (malformed JSON input), in which case the result struct (if
+ * not NULL) will explain the type of error, and the location in the input it
+ * occurred. */
+json_weak int json_parse_size(const void *src, size_t src_size,
+                              size_t flags_bitset, size_t *dom_size,
+                              size_t *data_size,
+                              struct json_parse_size_state_s *state_out,
+                              struct json_parse_result_s *result);
+
+/* Size a JSON text file like json_parse_size, but also record where every key
+ * and value starts (and how long strings without escape sequences and numbers
+ * are) in tape, which can hold tape_capacity entries. json_parse_into then
+ * uses the tape to jump straight between tokens and copy strings and numbers
+ * without scanning them again. Keys, strings and numbers use two entries, and
+ * objects, arrays, true, false and null use one. If the tape fills up the
+ * remaining tokens are parsed as normal. The tape must outlive state_out, and
+ * is not used if json_parse_flags_allow_location_information is set or if
+ * src_size does not fit in 32 bits. */
+json_weak int json_parse_size_ex(const void *src, size_t src_size,
+                                 size_t flags_bitset, json_uint32_t *tape,
+                                 size_t tape_capacity, size_t *dom_size,
+                                 size_t *data_size,
+                                 struct json_parse_size_state_s *state_out,
+                                 struct json_parse_result_s *result);
+
+/* Parse a JSON text file that was already sized by json_parse_size into buffer,
+ * which must be suitably aligned for a pointer and at least
+ * state_in->dom_size + state_in->data_size bytes large. Returns a pointer to
+ * the root of the JSON structure (which is at the start of buffer), or 0 if
+ * buffer was too small. */
+json_weak struct json_value_s *
+json_parse_into(void *buffer, size_t buffer_size,
+                const struct json_parse_size_state_s *state_in);
+
+/* Parse a JSON text file, but only build the values addressed by one of the
+ * paths_size JSON Pointers (RFC 6901) in paths. The wanted values, and the
+ * objects and arrays that lead to them, are validated in full. Everything else
+ * is skipped without being allocated and is only checked for structure like
+ * json_skip_value does, so the time taken depends on what is wanted rather
+ * than on the size of the input. The returned root keeps only the object
+ * members and array elements that lie along one of the paths. If matches is
+ * not NULL it must point to paths_size values, and matches[i] is set to the
+ * value addressed by paths[i] (or NULL if there was none). At most 64 paths are
+ * supported. json_parse_selective performs 1 call to malloc for the entire
+ * encoding. Returns 0 if an error occurred (malformed JSON input, malformed
+ * JSON Pointer, or malloc failed). */
+json_weak struct json_value_s *
+json_parse_selective(const void *src, size_t src_size,
+                     const char *const *paths, size_t paths_size,
+                     struct json_value_s **matches);
+
+/* Parse a JSON text file like json_parse_selective, with the flags_bitset,
+ * alloc_func_ptr, user_data and result parameters behaving exactly as they do
+ * for json_parse_ex. */
+json_weak struct json_value_s *json_parse_selective_ex(
+    const void *src, size_t src_size, const char *const *paths,
+    size_t paths_size, struct json_value_s **matches, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *, size_t), void *user_data,
+    struct json_parse_result_s *result);
+
+/* Find the end of the JSON value that starts at offset in src, without parsing
+ * it. Whitespace (and comments if json_parse_flags_allow_c_style_comments is
+ * set in flags_bitset) before the value is skipped. Only the structure of the
+ * value is checked - strings must be terminated, and objects and arrays must
+ * each be closed by a matching '}' or ']' and nest no deeper than
+ * JSON_MAX_RECURSION - so the value is not validated. Returns the offset one
+ * past the end of the value, or 0 if there was no value or its end could not
+ * be found. */
+json_weak size_t json_skip_value(const void *src, size_t size, size_t offset,
+                                 size_t flags_bitset);
+
+/* Minify a JSON text file without parsing it into a DOM. src is copied into
+ * dst without any of the whitespace between tokens (or comments if
+ * json_parse_flags_allow_c_style_comments is set in flags_bitset) in a single
+ * pass, which checks the structure of src as json_skip_value does - strings
+ * and comments must be terminated, and objects and arrays must each be closed
+ * by a matching '}' or ']' and nest no deeper than JSON_MAX_RECURSION - and
+ * that there is exactly one value (unless json_parse_flags_allow_global_object
+ * is set), but does not otherwise validate it. dst must be at least src_size
+ * bytes large, and can be the same as src. The output is not null terminated.
+ * json_minify does not allocate any memory. Returns the number of bytes
+ * written to dst, or 0 if an error occurred (malformed JSON input), in which
+ * case what was in dst is lost. */
+json_weak size_t json_minify(const void *src, size_t src_size,
+                             size_t flags_bitset, void *dst);
+
+/* Minify a JSON text file like json_minify, overwriting src with the result.
+ */
+json_weak size_t json_minify_in_place(void *src, size_t src_size,
+                                      size_t flags_bitset);
+
 /* Extracts a value and all the data that makes it up into a newly created
  * value. json_extract_value performs 1 call to malloc for the entire encoding.
  */
@@ -174,6 +305,63 @@ json_weak struct json_value_s *
 json_extract_value_ex(const struct json_value_s *value,
                       void *(*alloc_func_ptr)(void *, size_t), void *user_data);
 
+/* Create a builder that makes a DOM from a sequence of calls, like
+ * json_builder_begin_object, json_builder_name, json_builder_integer and
+ * json_builder_end, rather than by parsing JSON text. The builder and the DOM
+ * are allocated from an arena of JSON_BUILDER_CHUNK_SIZE byte chunks, each one
+ * a call to alloc_func_ptr. If alloc_func_ptr is null then malloc is used.
+ * Returns 0 if an error occurred (malloc failed). */
+json_weak struct json_builder_s *
+json_builder_create(void *(*alloc_func_ptr)(void *, size_t), void *user_data);
+
+/* Begin an object or array. The values added until the matching
+ * json_builder_end are its elements. Every function that adds to a builder
+ * returns 0 on success, or non-zero if an error occurred (the call was out of
+ * order, or malloc failed), after which every call to the builder fails. */
+json_weak int json_builder_begin_object(struct json_builder_s *builder);
+json_weak int json_builder_begin_array(struct json_builder_s *builder);
+
+/* End the innermost object or array. */
+json_weak int json_builder_end(struct json_builder_s *builder);
+
+/* Add the name of the next value in an object. The name is copied. */
+json_weak int json_builder_name(struct json_builder_s *builder,
+                                const char *name, size_t name_size);
+
+/* Add a string. The string is copied. */
+json_weak int json_builder_string(struct json_builder_s *builder,
+                                  const char *string, size_t string_size);
+
+/* Add a number from an integer. */
+json_weak int json_builder_integer(struct json_builder_s *builder,
+                                   json_intmax_t value);
+
+/* Add a number from a double (which must be finite). */
+json_weak int json_builder_double(struct json_builder_s *builder,
+                                  double value);
+
+/* Add true (if value is non-zero) or false. */
+json_weak int json_builder_boolean(struct json_builder_s *builder, int value);
+
+/* Add null. */
+json_weak int json_builder_null(struct json_builder_s *builder);
+
+/* Add a json_type_raw value holding the already serialized JSON value in raw,
+ * which is checked to be a single valid JSON value and copied. */
+json_weak int json_builder_raw(struct json_builder_s *builder, const char *raw,
+                               size_t raw_size);
+
+/* Get the DOM that was built, which lives as long as the builder's arena does.
+ * Returns 0 if an error occurred, nothing was added, or an object or array
+ * wasn't ended. */
+json_weak struct json_value_s *
+json_builder_finish(struct json_builder_s *builder);
+
+/* Release the builder and the DOM it built. This does nothing if the builder
+ * used a user allocator, as the arena's memory is then the user's to release.
+ * json_extract_value can be used to keep a copy of the DOM. */
+json_weak void json_builder_destroy(struct json_builder_s *builder);
+
 /* Write out a minified JSON utf-8 string. This string is an encoding of the
  * minimal string characters required to still encode the same data.
  * json_write_minified performs 1 call to malloc for the entire encoding. Return
@@ -182,6 +370,99 @@ json_extract_value_ex(const struct json_value_s *value,
 json_weak void *json_write_minified(const struct json_value_s *value,
                                     size_t *out_size);
 
+/* Write out a minified JSON utf-8 string like json_write_minified.
+ * json_write_minified_ex performs 1 call to alloc_func_ptr for the entire
+ * encoding, plus calls for scratch memory if value nests more than
+ * JSON_WRITE_STACK_SIZE levels deep (which are not released, like the
+ * encoding). If alloc_func_ptr is null then malloc is used. */
+json_weak void *
+json_write_minified_ex(const struct json_value_s *value,
+                       void *(*alloc_func_ptr)(void *, size_t),
+                       void *user_data, size_t *out_size);
+
+/* Write out a minified JSON utf-8 string like json_write_minified_ex, but
+ * changing how strings are escaped with flags_bitset (a combination of
+ * json_write_flags_e values). */
+json_weak void *
+json_write_minified_flags(const struct json_value_s *value,
+                          size_t flags_bitset,
+                          void *(*alloc_func_ptr)(void *, size_t),
+                          void *user_data, size_t *out_size);
+
+/* Write out a minified JSON utf-8 string like json_write_minified, but into
+ * the capacity bytes of buffer instead of allocating any memory. needed (if not
+ * NULL) is set to the bytes the null terminated string needs, even if it did
+ * not fit, or 0 if the input was malformed. Returns 0 on success, or non-zero
+ * if an error occurred (malformed JSON input, value nests more than
+ * JSON_WRITE_STACK_SIZE levels deep, or buffer was too small). */
+json_weak int json_write_minified_into(const struct json_value_s *value,
+                                       void *buffer, size_t capacity,
+                                       size_t *needed);
+
+/* Split the minified output of value into up to slices_capacity slices that
+ * can be sized and written concurrently, each slice being a run of the
+ * elements of the array or object value. Returns the number of slices used, or
+ * 0 if an error occurred. Then:
+ * - call json_write_minified_slice_size for each slice.
+ * - call json_write_minified_slice_offsets to place the slices one after the
+ *   other, which returns the size of the output.
+ * - allocate the output, and call json_write_minified_slice for each slice.
+ * The output is the same as json_write_minified's. json.h starts no threads -
+ * the caller runs the size and write calls for each slice on threads of its
+ * own (the slices only read the DOM and write disjoint parts of the output).
+ * Only the direct elements of value are split, into runs with near-equal
+ * numbers of elements, so this suits big arrays of similar values; a value
+ * with a few huge elements is not balanced. */
+json_weak size_t json_write_minified_split(const struct json_value_s *value,
+                                           struct json_write_slice_s *slices,
+                                           size_t slices_capacity);
+
+/* Work out the size of a slice from json_write_minified_split. Returns 0 on
+ * success, or non-zero if an error occurred (malformed JSON input). */
+json_weak int json_write_minified_slice_size(const struct json_value_s *value,
+                                             struct json_write_slice_s *slice);
+
+/* Work out where each sized slice goes in the output, and return the size of
+ * the output (including the null terminating character). */
+json_weak size_t
+json_write_minified_slice_offsets(struct json_write_slice_s *slices,
+                                  size_t slices_size);
+
+/* Write a slice into its place in buffer, which must be as big as
+ * json_write_minified_slice_offsets said. Returns 0 on success, or non-zero if
+ * an error occurred (malformed JSON input). */
+json_weak int json_write_minified_slice(const struct json_value_s *value,
+                                        const struct json_write_slice_s *slice,
+                                        void *buffer);
+
+/* Write out a minified JSON utf-8 string like json_write_minified, but in a
+ * single pass over the DOM. Rather than working out the size of the output
+ * first, the output is written to a buffer that grows geometrically through
+ * calls to realloc_func_ptr (which is called with a size of 0 to release the
+ * buffer if an error occurs). If realloc_func_ptr is null then realloc is used,
+ * and the result should be released with free. The buffer can be larger than
+ * the out_size bytes used. Return 0 if an error occurred (malformed JSON input,
+ * or realloc failed). */
+json_weak void *
+json_write_minified_growable(const struct json_value_s *value,
+                             void *(*realloc_func_ptr)(void *, void *, size_t),
+                             void *user_data, size_t *out_size);
+
+/* Write value back out after changing parts of a DOM that json_parse_ex made
+ * from src with flags_bitset (which must include
+ * json_parse_flags_allow_location_information). dirty_func_ptr returns
+ * non-zero if a value, or any value within it, was changed or created since
+ * parsing - those values are written out minified, while the bytes of every
+ * other value are copied straight from src, keeping whatever formatting they
+ * had there. The output is written to a buffer that grows through calls to
+ * realloc, and should be released with free. Return 0 if an error occurred
+ * (malformed JSON input, or realloc failed). */
+json_weak void *
+json_write_patched(const struct json_value_s *value, const void *src,
+                   size_t src_size, size_t flags_bitset,
+                   int (*dirty_func_ptr)(void *, const struct json_value_s *),
+                   void *user_data, size_t *out_size);
+
 /* Write out a pretty JSON utf-8 string. This string is encoded such that the
  * resultant JSON is pretty in that it is easily human readable. The indent and
  * newline parameters allow a user to specify what kind of indentation and
@@ -195,6 +476,295 @@ json_weak void *json_write_pretty(const struct json_value_s *value,
                                   const char *indent, const char *newline,
                                   size_t *out_size);
 
+/* Write out a pretty JSON utf-8 string like json_write_pretty.
+ * json_write_pretty_ex performs 1 call to alloc_func_ptr for the entire
+ * encoding, plus calls for scratch memory like json_write_minified_ex. If
+ * alloc_func_ptr is null then malloc is used. */
+json_weak void *json_write_pretty_ex(const struct json_value_s *value,
+                                     const char *indent, const char *newline,
+                                     void *(*alloc_func_ptr)(void *, size_t),
+                                     void *user_data, size_t *out_size);
+
+/* Write out a pretty JSON utf-8 string like json_write_pretty_ex, but changing
+ * how it is laid out (and how strings are escaped) with flags_bitset (a
+ * combination of json_write_flags_e values). */
+json_weak void *json_write_pretty_flags(const struct json_value_s *value,
+                                        const char *indent,
+                                        const char *newline,
+                                        size_t flags_bitset,
+                                        void *(*alloc_func_ptr)(void *, size_t),
+                                        void *user_data, size_t *out_size);
+
+/* Write out a pretty JSON utf-8 string like json_write_pretty, but into the
+ * capacity bytes of buffer like json_write_minified_into. */
+json_weak int json_write_pretty_into(const struct json_value_s *value,
+                                     const char *indent, const char *newline,
+                                     void *buffer, size_t capacity,
+                                     size_t *needed);
+
+/* Write out a minified JSON utf-8 string like json_write_minified, but rather
+ * than returning it in one allocation, write it through a fixed size staging
+ * buffer of JSON_WRITE_STAGING_SIZE bytes that is handed to write_func_ptr
+ * whenever it fills up, so the memory used does not depend on the size of the
+ * output. write_func_ptr returns 0 on success, or non-zero to stop writing.
+ * json_write_file_callback and json_write_fd_callback can be used to write to
+ * a FILE* or a file descriptor (unless JSON_NO_WRITE_CALLBACKS is defined).
+ * json_write_minified_to performs 1 call to malloc for the staging buffer.
+ * The output is not null terminated. Returns 0 on success, or non-zero if an
+ * error occurred (malformed JSON input, malloc failed, or write_func_ptr
+ * failed). */
+json_weak int json_write_minified_to(const struct json_value_s *value,
+                                     int (*write_func_ptr)(void *, const void *,
+                                                           size_t),
+                                     void *user_data);
+
+/* Write out a pretty JSON utf-8 string like json_write_pretty, but through a
+ * staging buffer and write_func_ptr like json_write_minified_to. */
+json_weak int json_write_pretty_to(const struct json_value_s *value,
+                                   const char *indent, const char *newline,
+                                   int (*write_func_ptr)(void *, const void *,
+                                                         size_t),
+                                   void *user_data);
+
+/* Write out each element of the array value as newline delimited JSON - one
+ * minified JSON utf-8 string per line, each ended by a '\n' - through a
+ * staging buffer and write_func_ptr like json_write_minified_to. The staging
+ * buffer is reused for every line, so the memory used does not depend on the
+ * number of elements. Line breaks inside raw values are written as spaces so
+ * that each value stays on one line. json_write_ndjson_to performs 1 call to
+ * malloc for the staging buffer. Returns 0 on success, or non-zero if an error
+ * occurred (value was not an array, malformed JSON input, malloc failed, or
+ * write_func_ptr failed). */
+json_weak int json_write_ndjson_to(const struct json_value_s *value,
+                                   int (*write_func_ptr)(void *, const void *,
+                                                         size_t),
+                                   void *user_data);
+
+/* Write out the values_size values as newline delimited JSON like
+ * json_write_ndjson_to, one line per value. */
+json_weak int json_write_ndjson_values_to(
+    const struct json_value_s *const *values, size_t values_size,
+    int (*write_func_ptr)(void *, const void *, size_t), void *user_data);
+
+/* Define JSON_NO_WRITE_CALLBACKS to leave out the write callbacks below, along
+ * with the stdio and platform headers they need. */
+#ifndef JSON_NO_WRITE_CALLBACKS
+/* A write_func_ptr for json_write_minified_to and json_write_pretty_to that
+ * writes to the FILE* user_data. */
+json_weak int json_write_file_callback(void *user_data, const void *data,
+                                       size_t size);
+
+/* A write_func_ptr for json_write_minified_to and json_write_pretty_to that
+ * writes to the file descriptor user_data points to (an int). */
+json_weak int json_write_fd_callback(void *user_data, const void *data,
+                                     size_t size);
+#endif
+
+/* Write out a minified JSON utf-8 string like json_write_minified_to, but
+ * hand write_func_ptr an array of segments at a time rather than a run of
+ * bytes. Runs of at least JSON_WRITE_SEGMENT_REFERENCE_SIZE bytes of a string
+ * that need no escaping (and very long numbers) point straight at the bytes
+ * of the DOM, while everything else is staged in a JSON_WRITE_STAGING_SIZE
+ * byte buffer, so large strings reach writev or sendmsg without being copied.
+ * Each call hands on at most JSON_WRITE_SEGMENTS_SIZE segments, which only
+ * stay valid until write_func_ptr returns. json_write_minified_segments
+ * performs 1 call to malloc for the segments and the staging buffer. Returns 0
+ * on success, or non-zero if an error occurred (malformed JSON input, malloc
+ * failed, or write_func_ptr failed). */
+json_weak int json_write_minified_segments(
+    const struct json_value_s *value,
+    int (*write_func_ptr)(void *, const struct json_write_segment_s *, size_t),
+    void *user_data);
+
+/* Write out a pretty JSON utf-8 string like json_write_pretty, but as segments
+ * handed to write_func_ptr like json_write_minified_segments. */
+json_weak int json_write_pretty_segments(
+    const struct json_value_s *value, const char *indent, const char *newline,
+    int (*write_func_ptr)(void *, const struct json_write_segment_s *, size_t),
+    void *user_data);
+
+/* Work out the minified and pretty sizes of value, and of every value within
+ * it, once up front so that writing any of them again (with any indent and
+ * newline) can skip straight to writing the output. json_write_cache_create
+ * performs 1 call to alloc_func_ptr for the entire cache, which only stays
+ * valid until the DOM is next changed. If alloc_func_ptr is null then malloc is
+ * used, and the cache should be released with free. Returns 0 if an error
+ * occurred (malformed JSON input, or malloc failed). */
+json_weak struct json_write_cache_s *
+json_write_cache_create(const struct json_value_s *value,
+                        void *(*alloc_func_ptr)(void *, size_t),
+                        void *user_data);
+
+/* Write out a minified JSON utf-8 string like json_write_minified_ex, but
+ * taking the size of value from cache (which can be null). Values that are not
+ * in the cache are sized as normal. */
+json_weak void *
+json_write_minified_cached(const struct json_write_cache_s *cache,
+                           const struct json_value_s *value,
+                           void *(*alloc_func_ptr)(void *, size_t),
+                           void *user_data, size_t *out_size);
+
+/* Write out a pretty JSON utf-8 string like json_write_pretty_ex, but taking
+ * the size of value from cache like json_write_minified_cached. */
+json_weak void *json_write_pretty_cached(
+    const struct json_write_cache_s *cache, const struct json_value_s *value,
+    const char *indent, const char *newline,
+    void *(*alloc_func_ptr)(void *, size_t), void *user_data, size_t *out_size);
+
+/* Compile a JSON skeleton - JSON text with a '?' wherever a value should be
+ * filled in, like {"id" : ?, "tags" : [?, ?]} - into a template. All of the
+ * bytes around the placeholders are worked out (and minified) once up front,
+ * so that writing the template only has to copy them and write the values that
+ * fill in the blanks. json_template_compile performs 1 call to alloc_func_ptr
+ * for the entire template. If alloc_func_ptr is null then malloc is used, and
+ * the template should be released with free. Returns 0 if an error occurred
+ * (malformed skeleton, or malloc failed). */
+json_weak struct json_template_s *
+json_template_compile(const void *skeleton, size_t skeleton_size,
+                      void *(*alloc_func_ptr)(void *, size_t),
+                      void *user_data);
+
+/* The number of placeholders in tmpl, which is how many values
+ * json_template_write needs. */
+json_weak size_t json_template_placeholders(const struct json_template_s *tmpl);
+
+/* Write out tmpl as a minified JSON utf-8 string, with values[i] written like
+ * json_write_minified in place of the i'th placeholder. json_template_write
+ * performs 1 call to alloc_func_ptr for the entire encoding. If alloc_func_ptr
+ * is null then malloc is used. Returns 0 if an error occurred (malformed JSON
+ * input, or malloc failed). */
+json_weak void *json_template_write(const struct json_template_s *tmpl,
+                                    const struct json_value_s *const *values,
+                                    void *(*alloc_func_ptr)(void *, size_t),
+                                    void *user_data, size_t *out_size);
+
+/* Write out tmpl like json_template_write, but into the capacity bytes of
+ * buffer like json_write_minified_into. */
+json_weak int json_template_write_into(const struct json_template_s *tmpl,
+                                       const struct json_value_s *const *values,
+                                       void *buffer, size_t capacity,
+                                       size_t *needed);
+
+/* Create a writer that writes JSON from a sequence of calls, like
+ * json_writer_begin_object, json_writer_name, json_writer_integer and
+ * json_writer_end, without building a DOM. The output is pretty like
+ * json_write_pretty if either indent or newline is not NULL (and the other
+ * defaults like it does for json_write_pretty), and minified otherwise. If
+ * write_func_ptr is NULL the output goes into a buffer that grows with realloc,
+ * otherwise it is written through a staging buffer like json_write_minified_to.
+ * json_writer_create performs 1 call to malloc for the writer (and the staging
+ * buffer). Returns 0 if an error occurred (malloc failed). */
+json_weak struct json_writer_s *json_writer_create(
+    const char *indent, const char *newline,
+    int (*write_func_ptr)(void *, const void *, size_t), void *user_data);
+
+/* Begin an object or array. The values written until the matching
+ * json_writer_end are its elements. Every function that writes to a writer
+ * returns 0 on success, or non-zero if an error occurred (the call was out of
+ * order, the nesting went deeper than JSON_MAX_RECURSION, realloc failed, or
+ * write_func_ptr failed), after which every call to the writer fails until it
+ * is reset. */
+json_weak int json_writer_begin_object(struct json_writer_s *writer);
+json_weak int json_writer_begin_array(struct json_writer_s *writer);
+
+/* End the innermost object or array. */
+json_weak int json_writer_end(struct json_writer_s *writer);
+
+/* Write the name of the next value in an object. */
+json_weak int json_writer_name(struct json_writer_s *writer, const char *name,
+                               size_t name_size);
+
+/* Write a string, escaped like json_write_minified does. */
+json_weak int json_writer_string(struct json_writer_s *writer,
+                                 const char *string, size_t string_size);
+
+/* Write a number from an integer. */
+json_weak int json_writer_integer(struct json_writer_s *writer,
+                                  json_intmax_t value);
+
+/* Write a number from a double (which must be finite). */
+json_weak int json_writer_double(struct json_writer_s *writer, double value);
+
+/* Write true (if value is non-zero) or false. */
+json_weak int json_writer_boolean(struct json_writer_s *writer, int value);
+
+/* Write null. */
+json_weak int json_writer_null(struct json_writer_s *writer);
+
+/* Write a value that is already JSON text as is (it is not checked). */
+json_weak int json_writer_raw(struct json_writer_s *writer, const char *raw,
+                              size_t raw_size);
+
+/* Check that a whole value was written, and hand anything left in the staging
+ * buffer on to write_func_ptr. Returns 0 on success, or non-zero if an error
+ * occurred. */
+json_weak int json_writer_finish(struct json_writer_s *writer);
+
+/* Get the null terminated output of a writer without a write_func_ptr, which
+ * stays valid until the writer is next used. out_size (if not NULL) is set to
+ * the size of the output without the null terminator. Returns 0 if an error
+ * occurred, or a whole value was not written yet. */
+json_weak const char *json_writer_get_output(struct json_writer_s *writer,
+                                             size_t *out_size);
+
+/* Reset a writer to write another value, reusing its buffer. */
+json_weak void json_writer_reset(struct json_writer_s *writer);
+
+/* Release a writer (and its buffer). */
+json_weak void json_writer_destroy(struct json_writer_s *writer);
+
+/* Create a reformatter that pretty prints JSON text handed to it in chunks
+ * with json_reformat_write, without parsing it into a DOM. The output is laid
+ * out like json_write_pretty with the same indent and newline (which default
+ * the same way), and is written through a staging buffer to write_func_ptr
+ * like json_write_pretty_to, so the memory used does not depend on the size of
+ * the input. Strings and numbers are copied as they are. Only the structure of
+ * the input is checked - strings must be terminated, brackets, braces, ','s
+ * and ':'s must be where they belong, and values can't nest deeper than
+ * JSON_MAX_RECURSION - so the input is not validated. json_reformat_create
+ * performs 1 call to malloc for the reformatter and its staging buffer.
+ * Returns 0 if an error occurred (write_func_ptr was NULL, or malloc failed).
+ */
+json_weak struct json_reformat_s *json_reformat_create(
+    const char *indent, const char *newline,
+    int (*write_func_ptr)(void *, const void *, size_t), void *user_data);
+
+/* Reformat the next src_size bytes of the input, which can end part way
+ * through a token. Returns 0 on success, or non-zero if an error occurred
+ * (malformed JSON input, or write_func_ptr failed), after which every call to
+ * the reformatter fails. */
+json_weak int json_reformat_write(struct json_reformat_s *reformat,
+                                  const void *src, size_t src_size);
+
+/* Check that the input held one whole value, and hand anything left in the
+ * staging buffer on to write_func_ptr. Returns 0 on success, or non-zero if an
+ * error occurred. */
+json_weak int json_reformat_finish(struct json_reformat_s *reformat);
+
+/* Release a reformatter. */
+json_weak void json_reformat_destroy(struct json_reformat_s *reformat);
+
+/* Transcode a JSON text file that json_parse_ex accepts with flags_bitset
+ * (such as json_parse_flags_allow_json5) into strict minified JSON, without
+ * parsing it into a DOM. Unquoted and single quoted keys and strings are
+ * double quoted, numbers are written like json_write_minified writes them
+ * (hexadecimal numbers, leading '+'s, leading or trailing '.'s, Infinity and
+ * NaN are made valid JSON), and comments, trailing commas and whitespace are
+ * dropped. The input is validated as it goes, and the output is written
+ * through a staging buffer to write_func_ptr like json_write_minified_to.
+ * json_transcode_to performs 1 call to malloc for the staging buffer. Returns
+ * 0 on success, or non-zero if an error occurred (malformed JSON input, malloc
+ * failed, or write_func_ptr failed), in which case part of the output may
+ * already have been written. If the input was malformed, the result struct (if
+ * not NULL) will explain the type of error, and the location in the input it
+ * occurred. */
+json_weak int json_transcode_to(const void *src, size_t src_size,
+                                size_t flags_bitset,
+                                int (*write_func_ptr)(void *, const void *,
+                                                      size_t),
+                                void *user_data,
+                                struct json_parse_result_s *result);
+
 /* Reinterpret a JSON value as a string. Returns null is the value was not a
  * string. */
 json_weak struct json_string_s *
@@ -215,6 +785,11 @@ json_value_as_object(struct json_value_s *const value);
 json_weak struct json_array_s *
 json_value_as_array(struct json_value_s *const value);
 
+/* Reinterpret a JSON value as raw JSON text. Returns null is the value was not
+ * raw. */
+json_weak struct json_raw_s *
+json_value_as_raw(struct json_value_s *const value);
+
 /* Whether the value is true. */
 json_weak int json_value_is_true(const struct json_value_s *const value);
 
@@ -224,6 +799,35 @@ json_weak int json_value_is_false(const struct json_value_s *const value);
 /* Whether the value is null. */
 json_weak int json_value_is_null(const struct json_value_s *const value);
 
+/* Compile a query into a reusable program that can be evaluated against any
+ * number of DOMs. The query is either a JSON Pointer (RFC 6901) like
+ * "/foo/0/bar", or a JSONPath starting with '$' that supports child names
+ * (.foo or ['foo']), wildcards (.* or [*]), indices ([0], [-1] for the last
+ * element), slices ([start:end:step] with a positive step) and recursive
+ * descent (..foo, ..* or ..[0]). json_query_compile performs 1 call to malloc
+ * for the entire program, which is released with free. Returns 0 if an error
+ * occurred (malformed query, or malloc failed). */
+json_weak struct json_query_s *json_query_compile(const char *query,
+                                                  size_t query_size);
+
+/* Compile a query like json_query_compile, but performs 1 call to
+ * alloc_func_ptr for the entire program. If alloc_func_ptr is null then malloc
+ * is used. */
+json_weak struct json_query_s *
+json_query_compile_ex(const char *query, size_t query_size,
+                      void *(*alloc_func_ptr)(void *, size_t),
+                      void *user_data);
+
+/* Evaluate a compiled query against the DOM rooted at value. The first
+ * matches_capacity matching values are written to matches in document order
+ * (matches can be NULL if matches_capacity is 0). Returns the total number of
+ * matches, which can be larger than matches_capacity, or 0 if value nests
+ * deeper than JSON_MAX_RECURSION. json_query_evaluate does not allocate. */
+json_weak size_t json_query_evaluate(const struct json_query_s *query,
+                                     struct json_value_s *value,
+                                     struct json_value_s **matches,
+                                     size_t matches_capacity);
+
 /* The various types JSON values can be. Used to identify what a value is. */
 typedef enum json_type_e {
   json_type_string,
@@ -232,7 +836,8 @@ typedef enum json_type_e {
   json_type_array,
   json_type_true,
   json_type_false,
-  json_type_null
+  json_type_null,
+  json_type_raw
 
 } json_type_t;
 
@@ -270,6 +875,17 @@ typedef struct json_number_s {
 
 } json_number_t;
 
+/* A JSON value that was already serialized. The writers copy the bytes as they
+ * are without checking them, so use json_parse_size to validate them first if
+ * they can't be trusted. */
+typedef struct json_raw_s {
+  /* utf-8 JSON text of a single value. */
+  const char *raw;
+  /* the size (in bytes) of the JSON text. */
+  size_t raw_size;
+
+} json_raw_t;
+
 /* an element of a JSON object. */
 typedef struct json_object_element_s {
   /* the name of this element. */
@@ -317,7 +933,8 @@ typedef struct json_value_s {
   void *payload;
   /* must be one of json_type_e. If type is json_type_true, json_type_false, or.
    */
-  /* json_type_null, payload will be NULL. */
+  /* json_type_null, payload will be NULL. If type is json_type_raw, payload
+   * will be a json_raw_s. */
   size_t type;
 
 } json_value_t;
@@ -379,6 +996,10 @@ enum json_parse_error_e {
      overflow, the library only supports recursion up to JSON_MAX_RECURSION */
   json_parse_error_recursion,
 
+  /* a JSON Pointer given to json_parse_selective was malformed, or too many
+     pointers were given. */
+  json_parse_error_invalid_pointer,
+
   /* catch-all error for everything else that exploded (real bad chi!). */
   json_parse_error_unknown
 };
@@ -399,21 +1020,82 @@ typedef struct json_parse_result_s {
 
 } json_parse_result_t;
 
+/* the state json_parse_size() hands on to json_parse_into(). */
+typedef struct json_parse_size_state_s {
+  /* the JSON input that was sized. */
+  const void *src;
+
+  /* the size of the JSON input in bytes. */
+  size_t src_size;
+
+  /* the parsing flags the JSON input was sized with. */
+  size_t flags_bitset;
+
+  /* the bytes needed for the structure of the DOM. */
+  size_t dom_size;
+
+  /* the bytes needed for the strings and numbers the DOM references. */
+  size_t data_size;
+
+  /* the token positions recorded by json_parse_size_ex(), or null. */
+  json_uint32_t *tape;
+
+  /* the number of entries used in tape. */
+  size_t tape_size;
+
+} json_parse_size_state_t;
+
+/* a run of the elements of an array or object that json_write_minified_split()
+ * made. */
+typedef struct json_write_slice_s {
+  /* the first json_array_element_s or json_object_element_s in the run. */
+  const void *start;
+
+  /* the index of the first element in the array or object. */
+  size_t index;
+
+  /* the number of elements in the run. */
+  size_t length;
+
+  /* where the output of the run starts, in bytes. */
+  size_t offset;
+
+  /* the size of the output of the run, in bytes. */
+  size_t size;
+
+} json_write_slice_t;
+
+/* a run of output bytes that json_write_minified_segments() made, laid out like
+ * a POSIX struct iovec. */
+typedef struct json_write_segment_s {
+  /* a pointer to the bytes of the segment. */
+  const void *data;
+
+  /* the number of bytes in the segment. */
+  size_t size;
+
+} json_write_segment_t;
+
 #ifdef __cplusplus
 } /* extern "C". */
 #endif
 
+#include <float.h>
 #include <stdlib.h>
 
-#if defined(_MSC_VER)
-#pragma warning(pop)
-#endif
+#ifndef JSON_NO_WRITE_CALLBACKS
+#include <errno.h>
+#include <stdio.h>
 
-#if defined(_MSC_VER) && (_MSC_VER < 1920)
-#define json_uintmax_t unsigned __int64
+#if defined(_WIN32)
+#include <io.h>
 #else
-#include <inttypes.h>
-#define json_uintmax_t uintmax_t
+#include <unistd.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#pragma warning(pop)
 #endif
 
 #if defined(_MSC_VER)
@@ -473,6 +1155,43 @@ typedef struct json_parse_result_s {
 #define JSON_MAX_RECURSION 1000
 #endif
 
+/* set the size of the staging buffer json_write_minified_to() and
+ * json_write_pretty_to() write through */
+#ifndef JSON_WRITE_STAGING_SIZE
+#define JSON_WRITE_STAGING_SIZE 65536
+#endif
+
+/* set the most segments json_write_minified_segments() and
+ * json_write_pretty_segments() hand on at once (keep it at most IOV_MAX) */
+#ifndef JSON_WRITE_SEGMENTS_SIZE
+#define JSON_WRITE_SEGMENTS_SIZE 64
+#endif
+
+/* set the shortest run of a string json_write_minified_segments() and
+ * json_write_pretty_segments() point at rather than copy */
+#ifndef JSON_WRITE_SEGMENT_REFERENCE_SIZE
+#define JSON_WRITE_SEGMENT_REFERENCE_SIZE 256
+#endif
+
+/* set how deeply values can nest before the writers move the stack of arrays
+ * and objects they are part way through onto the heap (and how deeply they can
+ * nest at all for the writers that don't allocate, like
+ * json_write_minified_into()) */
+#ifndef JSON_WRITE_STACK_SIZE
+#define JSON_WRITE_STACK_SIZE 64
+#endif
+
+/* set how many bytes of indentation the pretty writers keep on the C stack to
+ * start each line with one copy (deeper lines are written in pieces) */
+#ifndef JSON_WRITE_INDENT_SIZE
+#define JSON_WRITE_INDENT_SIZE 256
+#endif
+
+/* set the size of each chunk of the arena a json_builder_s allocates from */
+#ifndef JSON_BUILDER_CHUNK_SIZE
+#define JSON_BUILDER_CHUNK_SIZE 4096
+#endif
+
 struct json_parse_state_s {
   const char *src;
   size_t size;
@@ -487,6 +1206,10 @@ struct json_parse_state_s {
                          bytes). */
   size_t error;
   size_t recursion;
+  json_uint32_t *tape;   /* token positions recorded by the sizing pass. */
+  size_t tape_capacity;  /* the number of entries tape can hold. */
+  size_t tape_size;      /* the number of entries used in tape. */
+  size_t tape_offset;    /* the next tape entry the parsing pass will use. */
 };
 
 json_weak int json_hexadecimal_digit(const char c);
@@ -690,2810 +1413,10441 @@ int json_skip_all_skippables(struct json_parse_state_s *state) {
   return 0;
 }
 
-json_weak int json_get_value_size(struct json_parse_state_s *state,
-                                  int is_global_object);
-
-json_weak int json_get_string_size(struct json_parse_state_s *state,
-                                   size_t is_key);
-int json_get_string_size(struct json_parse_state_s *state, size_t is_key) {
-  size_t offset = state->offset;
-  const size_t size = state->size;
-  size_t data_size = 0;
+/* the SWAR (SIMD within a register) helpers are macros rather than json_weak
+ * functions so that they are inlined into the loops that use them, as weak
+ * functions can't be. json_swar_ones is a word with 0x01 in each byte, so
+ * multiplying by a byte splats it into every byte of the word. */
+#define json_swar_ones (((size_t)-1) / 0xff)
+
+/* the high bit of a byte is set if the byte of x was zero (there can be false
+ * positives, but only in bytes that come after a true positive). */
+#define json_swar_has_zero(x)                                                  \
+  (((x) - json_swar_ones) & ~(x) & (json_swar_ones << 7))
+
+/* the high bit of a byte is set if the byte of word was c. */
+#define json_swar_has_byte(word, c)                                            \
+  json_swar_has_zero((word) ^ (json_swar_ones * (unsigned char)(c)))
+
+/* the high bit of a byte is set if the byte of word was less than c (which
+ * must be no more than 0x80), with false positives only in later bytes. */
+#define json_swar_has_less(word, c)                                            \
+  (((word) - json_swar_ones * (c)) & ~(word) & (json_swar_ones << 7))
+
+/* whether any byte in the word is a '"', '\\', or control character. */
+#define json_swar_needs_escape(word)                                           \
+  (json_swar_has_byte(word, '"') | json_swar_has_byte(word, '\\') |            \
+   json_swar_has_less(word, 0x20))
+
+json_weak int json_skip_raw_string(struct json_parse_state_s *state);
+int json_skip_raw_string(struct json_parse_state_s *state) {
   const char *const src = state->src;
-  const int is_single_quote = '\'' == src[offset];
-  const char quote_to_use = is_single_quote ? '\'' : '"';
-  const size_t flags_bitset = state->flags_bitset;
-  unsigned long codepoint;
-  unsigned long high_surrogate = 0;
+  const size_t size = state->size;
+  const char quote_to_use = src[state->offset];
+  size_t offset = state->offset + 1;
 
-  if ((json_parse_flags_allow_location_information & flags_bitset) != 0 &&
-      is_key != 0) {
-    state->dom_size += sizeof(struct json_string_ex_s);
-  } else {
-    state->dom_size += sizeof(struct json_string_s);
-  }
+  while (offset < size) {
+    /* skip a word at a time while there are no quotes or escapes in it. */
+    while (offset + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, src + offset, sizeof(size_t));
 
-  if ('"' != src[offset]) {
-    /* if we are allowed single quoted strings check for that too. */
-    if (!((json_parse_flags_allow_single_quoted_strings & flags_bitset) &&
-          is_single_quote)) {
-      state->error = json_parse_error_expected_opening_quote;
-      state->offset = offset;
-      return 1;
+      if (json_swar_has_byte(word, quote_to_use) |
+          json_swar_has_byte(word, '\\')) {
+        break;
+      }
+
+      offset += sizeof(size_t);
+    }
+
+    if (offset == size) {
+      break;
+    } else if ('\\' == src[offset]) {
+      /* skip the reverse solidus and the character it escapes. */
+      offset += 2;
+    } else if (quote_to_use == src[offset]) {
+      /* skip trailing '"' or '\''. */
+      state->offset = offset + 1;
+      return 0;
+    } else {
+      offset++;
     }
   }
 
-  /* skip leading '"' or '\''. */
-  offset++;
+  /* the string wasn't terminated. */
+  state->offset = size;
+  return 1;
+}
 
-  while ((offset < size) && (quote_to_use != src[offset])) {
-    /* add space for the character. */
-    data_size++;
+json_weak int json_skip_raw_comment(struct json_parse_state_s *state);
+int json_skip_raw_comment(struct json_parse_state_s *state) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t offset = state->offset + 2;
 
-    switch (src[offset]) {
-    default:
-      break;
-    case '\0':
-    case '\t':
-      state->error = json_parse_error_invalid_string;
-      state->offset = offset;
-      return 1;
-    }
+  if ((state->offset + 2) > size) {
+    return 1;
+  }
 
-    if ('\\' == src[offset]) {
-      /* skip reverse solidus character. */
+  if ('/' == src[state->offset + 1]) {
+    /* we had a comment of the form //, which ends at a newline. */
+    while ((offset < size) && ('\n' != src[offset])) {
       offset++;
+    }
 
-      if (offset == size) {
-        state->error = json_parse_error_premature_end_of_buffer;
-        state->offset = offset;
-        return 1;
-      }
+    if (offset < size) {
+      /* skip the newline. */
+      offset++;
 
-      switch (src[offset]) {
-      default:
-        state->error = json_parse_error_invalid_string_escape_sequence;
-        state->offset = offset;
-        return 1;
-      case '"':
-      case '\\':
-      case '/':
-      case 'b':
-      case 'f':
-      case 'n':
-      case 'r':
-      case 't':
-        /* all valid characters! */
-        offset++;
-        break;
-      case 'u':
-        if (!(offset + 5 < size)) {
-          /* invalid escaped unicode sequence! */
-          state->error = json_parse_error_invalid_string_escape_sequence;
-          state->offset = offset;
-          return 1;
-        }
+      state->line_no++;
+      state->line_offset = offset;
+    }
 
-        codepoint = 0;
-        if (!json_hexadecimal_value(&src[offset + 1], 4, &codepoint)) {
-          /* escaped unicode sequences must contain 4 hexadecimal digits! */
-          state->error = json_parse_error_invalid_string_escape_sequence;
-          state->offset = offset;
-          return 1;
-        }
+    state->offset = offset;
+    return 0;
+  } else if ('*' == src[state->offset + 1]) {
+    /* we had a comment in the C-style long form. */
+    for (; offset + 1 < size; offset++) {
+      if (('*' == src[offset]) && ('/' == src[offset + 1])) {
+        state->offset = offset + 2;
+        return 0;
+      } else if ('\n' == src[offset]) {
+        state->line_no++;
+        state->line_offset = offset;
+      }
+    }
+  }
 
-        /* Valid sequence!
-         * see: https://en.wikipedia.org/wiki/UTF-8#Invalid_code_points.
-         *      1       7       U + 0000        U + 007F        0xxxxxxx.
-         *      2       11      U + 0080        U + 07FF        110xxxxx
-         * 10xxxxxx.
-         *      3       16      U + 0800        U + FFFF        1110xxxx
-         * 10xxxxxx        10xxxxxx.
-         *      4       21      U + 10000       U + 10FFFF      11110xxx
-         * 10xxxxxx        10xxxxxx        10xxxxxx.
-         * Note: the high and low surrogate halves used by UTF-16 (U+D800
-         * through U+DFFF) and code points not encodable by UTF-16 (those after
-         * U+10FFFF) are not legal Unicode values, and their UTF-8 encoding must
-         * be treated as an invalid byte sequence. */
+  /* either a lone '/', or the comment wasn't ended correctly. */
+  return 1;
+}
 
-        if (high_surrogate != 0) {
-          /* we previously read the high half of the \uxxxx\uxxxx pair, so now
-           * we expect the low half. */
-          if (codepoint >= 0xdc00 &&
-              codepoint <= 0xdfff) { /* low surrogate range. */
-            data_size += 3;
-            high_surrogate = 0;
-          } else {
-            state->error = json_parse_error_invalid_string_escape_sequence;
-            state->offset = offset;
-            return 1;
-          }
-        } else if (codepoint <= 0x7f) {
-          data_size += 0;
-        } else if (codepoint <= 0x7ff) {
-          data_size += 1;
-        } else if (codepoint >= 0xd800 &&
-                   codepoint <= 0xdbff) { /* high surrogate range. */
-          /* The codepoint is the first half of a "utf-16 surrogate pair". so we
-           * need the other half for it to be valid: \uHHHH\uLLLL. */
-          if (offset + 11 > size || '\\' != src[offset + 5] ||
-              'u' != src[offset + 6]) {
-            state->error = json_parse_error_invalid_string_escape_sequence;
-            state->offset = offset;
-            return 1;
-          }
-          high_surrogate = codepoint;
-        } else if (codepoint >= 0xd800 &&
-                   codepoint <= 0xdfff) { /* low surrogate range. */
-          /* we did not read the other half before. */
-          state->error = json_parse_error_invalid_string_escape_sequence;
-          state->offset = offset;
-          return 1;
-        } else {
-          data_size += 2;
-        }
-        /* escaped codepoints after 0xffff are supported in json through utf-16
-         * surrogate pairs: \uD83D\uDD25 for U+1F525. */
+json_weak int json_skip_raw_value(struct json_parse_state_s *state);
+int json_skip_raw_value(struct json_parse_state_s *state) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  const size_t ones = ((size_t)-1) / 0xff;
+  const char single_quote =
+      (json_parse_flags_allow_single_quoted_strings & flags_bitset) ? '\''
+                                                                    : '"';
+  const char comment =
+      (json_parse_flags_allow_c_style_comments & flags_bitset) ? '/' : '"';
+  const char newline =
+      (json_parse_flags_allow_location_information & flags_bitset) ? '\n'
+                                                                   : '"';
+  /* a bit per open object or array (set for an object), so that each '}' or
+   * ']' can be checked against what it closes. */
+  unsigned char objects[(JSON_MAX_RECURSION + 7) / 8];
+  size_t depth = 0;
+
+  /* skip any whitespace and comments before the value. */
+  while (state->offset < size) {
+    const char c = src[state->offset];
 
-        offset += 5;
-        break;
-      }
-    } else if (('\r' == src[offset]) || ('\n' == src[offset])) {
-      if (!(json_parse_flags_allow_multi_line_strings & flags_bitset)) {
-        /* invalid escaped unicode sequence! */
-        state->error = json_parse_error_invalid_string_escape_sequence;
-        state->offset = offset;
+    if ((' ' == c) || ('\r' == c) || ('\t' == c)) {
+      state->offset++;
+    } else if ('\n' == c) {
+      state->line_no++;
+      state->line_offset = state->offset;
+      state->offset++;
+    } else if (('/' == c) && (json_parse_flags_allow_c_style_comments &
+                              flags_bitset)) {
+      if (json_skip_raw_comment(state)) {
         return 1;
       }
-
-      offset++;
     } else {
-      /* skip character (valid part of sequence). */
-      offset++;
+      break;
     }
   }
 
-  /* If the offset is equal to the size, we had a non-terminated string! */
-  if (offset == size) {
-    state->error = json_parse_error_premature_end_of_buffer;
-    state->offset = offset - 1;
+  if (state->offset == size) {
     return 1;
   }
 
-  /* skip trailing '"' or '\''. */
-  offset++;
+  switch (src[state->offset]) {
+  case '"':
+  case '\'':
+    return json_skip_raw_string(state);
+  case '{':
+  case '[':
+    break;
+  case '}':
+  case ']':
+  case ',':
+  case ':':
+  case '=':
+    /* there was no value to skip. */
+    return 1;
+  default:
+    /* numbers and literals end at the first character that could not be a
+     * part of them. */
+    do {
+      const char c = src[state->offset];
 
-  /* add enough space to store the string. */
-  state->data_size += data_size;
+      if ((' ' == c) || ('\r' == c) || ('\t' == c) || ('\n' == c) ||
+          (',' == c) || (']' == c) || ('}' == c) || (':' == c) || ('/' == c)) {
+        break;
+      }
 
-  /* one more byte for null terminator ending the string! */
-  state->data_size++;
+      state->offset++;
+    } while (state->offset < size);
 
-  /* update offset. */
-  state->offset = offset;
+    return 0;
+  }
 
-  return 0;
-}
+  while (state->offset < size) {
+    char c;
+
+    /* skip a word at a time while there are no quotes, brackets, or braces in
+     * it (or comments and newlines, when we care about those). Or'ing in 0x20
+     * turns '[' into '{' and ']' into '}', and no other characters into
+     * either. */
+    while (state->offset + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, src + state->offset, sizeof(size_t));
+
+      if (json_swar_has_byte(word, '"') |
+          json_swar_has_byte(word | (ones * 0x20), '{') |
+          json_swar_has_byte(word | (ones * 0x20), '}') |
+          json_swar_has_byte(word, single_quote) |
+          json_swar_has_byte(word, comment) |
+          json_swar_has_byte(word, newline)) {
+        break;
+      }
 
-json_weak int is_valid_unquoted_key_char(const char c);
-int is_valid_unquoted_key_char(const char c) {
-  return (('0' <= c && c <= '9') || ('a' <= c && c <= 'z') ||
-          ('A' <= c && c <= 'Z') || ('_' == c) || ('$' == c));
-}
+      state->offset += sizeof(size_t);
+    }
 
-json_weak int json_get_key_size(struct json_parse_state_s *state);
-int json_get_key_size(struct json_parse_state_s *state) {
-  const size_t flags_bitset = state->flags_bitset;
+    if (state->offset == size) {
+      break;
+    }
 
-  if (json_parse_flags_allow_unquoted_keys & flags_bitset) {
-    size_t offset = state->offset;
-    const size_t size = state->size;
-    const char *const src = state->src;
-    size_t data_size = state->data_size;
+    c = src[state->offset];
 
-    /* if we are allowing unquoted keys, first grok for a quote... */
-    if ('"' == src[offset]) {
-      /* ... if we got a comma, just parse the key as a string as normal. */
-      return json_get_string_size(state, 1);
-    } else if ((json_parse_flags_allow_single_quoted_strings & flags_bitset) &&
-               ('\'' == src[offset])) {
-      /* ... if we got a comma, just parse the key as a string as normal. */
-      return json_get_string_size(state, 1);
-    } else {
-      while ((offset < size) && is_valid_unquoted_key_char(src[offset])) {
-        offset++;
-        data_size++;
+    if (('"' == c) || (single_quote == c)) {
+      if (json_skip_raw_string(state)) {
+        return 1;
+      }
+    } else if (('{' == c) || ('[' == c)) {
+      if (JSON_MAX_RECURSION == depth) {
+        /* the value is nested too deeply! */
+        return 1;
       }
 
-      /* one more byte for null terminator ending the string! */
-      data_size++;
-
-      if (json_parse_flags_allow_location_information & flags_bitset) {
-        state->dom_size += sizeof(struct json_string_ex_s);
+      if ('{' == c) {
+        objects[depth / 8] |= (unsigned char)(1 << (depth % 8));
       } else {
-        state->dom_size += sizeof(struct json_string_s);
+        objects[depth / 8] &= (unsigned char)~(1 << (depth % 8));
       }
 
-      /* update offset. */
-      state->offset = offset;
+      depth++;
+      state->offset++;
+    } else if (('}' == c) || (']' == c)) {
+      depth--;
 
-      /* update data_size. */
-      state->data_size = data_size;
+      if (('}' == c) != (0 != (objects[depth / 8] & (1 << (depth % 8))))) {
+        /* a '}' closing an array, or a ']' closing an object! */
+        return 1;
+      }
 
-      return 0;
+      state->offset++;
+
+      if (0 == depth) {
+        /* we found the end of the object or array! */
+        return 0;
+      }
+    } else if (comment == c) {
+      if (json_skip_raw_comment(state)) {
+        return 1;
+      }
+    } else if (newline == c) {
+      state->line_no++;
+      state->line_offset = state->offset;
+      state->offset++;
+    } else {
+      state->offset++;
     }
-  } else {
-    /* we are only allowed to have quoted keys, so just parse a string! */
-    return json_get_string_size(state, 1);
   }
+
+  /* the object or array wasn't closed. */
+  return 1;
 }
 
-json_weak int json_get_object_size(struct json_parse_state_s *state,
-                                   int is_global_object);
-int json_get_object_size(struct json_parse_state_s *state,
-                         int is_global_object) {
-  const size_t flags_bitset = state->flags_bitset;
-  const char *const src = state->src;
-  const size_t size = state->size;
-  size_t elements = 0;
-  int allow_comma = 0;
-  int found_closing_brace = 0;
+size_t json_skip_value(const void *src, size_t size, size_t offset,
+                       size_t flags_bitset) {
+  struct json_parse_state_s state;
 
-  if (++state->recursion > JSON_MAX_RECURSION) {
-      /* recursion error */
-      state->error = json_parse_error_recursion;
-      return 1;
+  if ((json_null == src) || (offset >= size)) {
+    return 0;
   }
 
-  if (is_global_object) {
-    /* if we found an opening '{' of an object, we actually have a normal JSON
-     * object at the root of the DOM... */
-    if (!json_skip_all_skippables(state) && '{' == state->src[state->offset]) {
-      /* . and we don't actually have a global object after all! */
-      is_global_object = 0;
-    }
+  state.src = (const char *)src;
+  state.size = size;
+  state.offset = offset;
+  state.flags_bitset = flags_bitset &
+                       ~(size_t)json_parse_flags_allow_location_information;
+  state.line_no = 1;
+  state.line_offset = 0;
+
+  if (json_skip_raw_value(&state)) {
+    return 0;
   }
 
-  if (!is_global_object) {
-    if ('{' != src[state->offset]) {
-      state->error = json_parse_error_unknown;
-      --state->recursion;
-      return 1;
-    }
+  return state.offset;
+}
 
-    /* skip leading '{'. */
-    state->offset++;
+json_weak int json_minify_is_bare(char c);
+int json_minify_is_bare(char c) {
+  /* whether c could be part of a number, literal or unquoted key, which need
+   * whitespace to keep them apart when they follow one another. */
+  switch (c) {
+  case '{':
+  case '}':
+  case '[':
+  case ']':
+  case ',':
+  case ':':
+  case '=':
+  case '"':
+  case '\'':
+    return 0;
+  default:
+    return 1;
   }
+}
 
-  state->dom_size += sizeof(struct json_object_s);
+size_t json_minify(const void *src, size_t src_size, size_t flags_bitset,
+                   void *dst) {
+  struct json_parse_state_s state;
+  const char *const in = (const char *)src;
+  char *const out = (char *)dst;
+  const char single_quote =
+      (json_parse_flags_allow_single_quoted_strings & flags_bitset) ? '\''
+                                                                    : '"';
+  const int is_global_object =
+      (int)(json_parse_flags_allow_global_object & flags_bitset);
+  /* a bit per open object or array (set for an object), so that each '}' or
+   * ']' can be checked against what it closes like json_skip_raw_value does.
+   */
+  unsigned char objects[(JSON_MAX_RECURSION + 7) / 8];
+  size_t depth = 0;
+  size_t offset = 0;
+  size_t size = 0;
+  size_t next_word = 0;
+  int separated = 0;
+  int had_value = 0;
 
-  if ((state->offset == size) && !is_global_object) {
-    state->error = json_parse_error_premature_end_of_buffer;
-    --state->recursion;
-    return 1;
+  if ((json_null == src) || (json_null == dst)) {
+    return 0;
   }
 
-  do {
-    if (!is_global_object) {
-      if (json_skip_all_skippables(state)) {
-        state->error = json_parse_error_premature_end_of_buffer;
-        --state->recursion;
-        return 1;
-      }
+  state.src = in;
+  state.size = src_size;
+  state.flags_bitset = flags_bitset;
+  state.line_no = 1;
+  state.line_offset = 0;
 
-      if ('}' == src[state->offset]) {
-        /* skip trailing '}'. */
-        state->offset++;
+  /* drop the whitespace and comments outside of strings, checking the
+   * structure of the input as we go. Every word is read before it is written,
+   * and the output never gets ahead of the input, so dst can be src. */
+  while (offset < src_size) {
+    char c;
+
+    /* copy a word at a time while there is no whitespace, strings, comments,
+     * brackets or braces in it. Once a word has one we go a byte at a time
+     * until we are past it. Or'ing in 0x20 turns '[' into '{' and ']' into
+     * '}', and no other characters into either. */
+    if (!separated && (0 < depth) && (offset >= next_word)) {
+      while (offset + sizeof(size_t) <= src_size) {
+        size_t word;
+        memcpy(&word, in + offset, sizeof(size_t));
+
+        if (json_swar_has_less(word, ' ' + 1) | json_swar_has_byte(word, '"') |
+            json_swar_has_byte(word, single_quote) |
+            json_swar_has_byte(word, '/') |
+            json_swar_has_byte(word | (json_swar_ones * 0x20), '{') |
+            json_swar_has_byte(word | (json_swar_ones * 0x20), '}')) {
+          next_word = offset + sizeof(size_t);
+          break;
+        }
 
-        found_closing_brace = 1;
+        memcpy(out + size, &word, sizeof(size_t));
+        size += sizeof(size_t);
+        offset += sizeof(size_t);
+      }
 
-        /* finished the object! */
+      if (offset == src_size) {
         break;
       }
-    } else {
-      /* we don't require brackets, so that means the object ends when the input
-       * stream ends! */
-      if (json_skip_all_skippables(state)) {
+    }
+
+    c = in[offset];
+
+    if ((' ' == c) || ('\n' == c) || ('\r' == c) || ('\t' == c)) {
+      separated = 1;
+
+      /* skip the whole run of whitespace, with runs of indentation a word at
+       * a time. */
+      do {
+        offset++;
+
+        while ((offset + sizeof(size_t) <= src_size) &&
+               (0 == memcmp(in + offset, "        ", sizeof(size_t)))) {
+          offset += sizeof(size_t);
+        }
+      } while ((offset < src_size) &&
+               ((' ' == (c = in[offset])) || ('\n' == c) || ('\r' == c) ||
+                ('\t' == c)));
+
+      if (offset == src_size) {
         break;
       }
     }
 
-    /* if we parsed at least one element previously, grok for a comma. */
-    if (allow_comma) {
-      if (',' == src[state->offset]) {
-        /* skip comma. */
-        state->offset++;
-        allow_comma = 0;
-      } else if (json_parse_flags_allow_no_commas & flags_bitset) {
-        /* we don't require a comma, and we didn't find one, which is ok! */
-        allow_comma = 0;
-      } else {
-        /* otherwise we are required to have a comma, and we found none. */
-        state->error = json_parse_error_expected_comma_or_closing_bracket;
-        --state->recursion;
-        return 1;
+    if ('/' == c) {
+      /* outside of a string a '/' can only start a comment. */
+      if (!(json_parse_flags_allow_c_style_comments & flags_bitset)) {
+        return 0;
       }
 
-      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
-        continue;
-      } else {
-        if (json_skip_all_skippables(state)) {
-          state->error = json_parse_error_premature_end_of_buffer;
-          --state->recursion;
-          return 1;
-        }
+      state.offset = offset;
+
+      if (json_skip_raw_comment(&state)) {
+        /* the comment wasn't ended correctly! */
+        return 0;
       }
+
+      offset = state.offset;
+      separated = 1;
+      continue;
     }
 
-    if (json_get_key_size(state)) {
-      /* key parsing failed! */
-      state->error = json_parse_error_invalid_string;
-      --state->recursion;
-      return 1;
+    if ((0 == depth) && !is_global_object) {
+      /* there is only one value at the root, so once it has started anything
+       * but the rest of a number or literal is a trailing character. */
+      if ((',' == c) || (':' == c) || ('=' == c) || ('}' == c) ||
+          (']' == c) ||
+          (had_value && (separated || !json_minify_is_bare(c) ||
+                         !json_minify_is_bare(out[size - 1])))) {
+        return 0;
+      }
+
+      had_value = 1;
     }
 
-    if (json_skip_all_skippables(state)) {
-      state->error = json_parse_error_premature_end_of_buffer;
-      --state->recursion;
-      return 1;
+    if (separated && (0 < size) && json_minify_is_bare(out[size - 1]) &&
+        (',' != c) && (':' != c) && ('=' != c) && (']' != c) && ('}' != c)) {
+      /* keep one space after a number or literal, as without commas it could
+       * otherwise run into the token that follows. */
+      out[size++] = ' ';
     }
 
-    if (json_parse_flags_allow_equals_in_object & flags_bitset) {
-      const char current = src[state->offset];
-      if ((':' != current) && ('=' != current)) {
-        state->error = json_parse_error_expected_colon;
-        --state->recursion;
-        return 1;
+    separated = 0;
+    out[size++] = in[offset++];
+
+    if (('{' == c) || ('[' == c)) {
+      if (JSON_MAX_RECURSION == depth) {
+        /* the input is nested too deeply! */
+        return 0;
       }
-    } else {
-      if (':' != src[state->offset]) {
-        state->error = json_parse_error_expected_colon;
-        --state->recursion;
-        return 1;
+
+      if ('{' == c) {
+        objects[depth / 8] |= (unsigned char)(1 << (depth % 8));
+      } else {
+        objects[depth / 8] &= (unsigned char)~(1 << (depth % 8));
       }
-    }
 
-    /* skip colon. */
-    state->offset++;
+      depth++;
+      continue;
+    } else if (('}' == c) || (']' == c)) {
+      if (0 == depth) {
+        /* there was nothing to close! */
+        return 0;
+      }
 
-    if (json_skip_all_skippables(state)) {
-      state->error = json_parse_error_premature_end_of_buffer;
-      --state->recursion;
-      return 1;
-    }
+      depth--;
 
-    if (json_get_value_size(state, /* is_global_object = */ 0)) {
-      /* value parsing failed! */
-      --state->recursion;
-      return 1;
+      if (('}' == c) != (0 != (objects[depth / 8] & (1 << (depth % 8))))) {
+        /* a '}' closing an array, or a ']' closing an object! */
+        return 0;
+      }
+
+      continue;
+    } else if (('"' != c) && (single_quote != c)) {
+      continue;
     }
 
-    /* successfully parsed a name/value pair! */
-    elements++;
-    allow_comma = 1;
-  } while (state->offset < size);
+    for (;;) {
+      char d = c;
 
-  if ((state->offset == size) && !is_global_object && !found_closing_brace) {
-    state->error = json_parse_error_premature_end_of_buffer;
-    --state->recursion;
-    return 1;
-  }
+      /* copy a word at a time while there are no quotes or escapes in it. */
+      while (offset + sizeof(size_t) <= src_size) {
+        size_t word;
+        memcpy(&word, in + offset, sizeof(size_t));
 
-  state->dom_size += sizeof(struct json_object_element_s) * elements;
-  --state->recursion;
+        if (json_swar_has_byte(word, c) | json_swar_has_byte(word, '\\')) {
+          break;
+        }
 
-  return 0;
-}
+        memcpy(out + size, &word, sizeof(size_t));
+        size += sizeof(size_t);
+        offset += sizeof(size_t);
+      }
 
-json_weak int json_get_array_size(struct json_parse_state_s *state);
-int json_get_array_size(struct json_parse_state_s *state) {
-  const size_t flags_bitset = state->flags_bitset;
-  size_t elements = 0;
-  int allow_comma = 0;
-  const char *const src = state->src;
-  const size_t size = state->size;
+      /* then a byte at a time up to the quote or escape. */
+      while ((offset < src_size) && (c != (d = in[offset])) && ('\\' != d)) {
+        out[size++] = d;
+        offset++;
+      }
 
-  if (++state->recursion > JSON_MAX_RECURSION) {
-      /* recursion error */
-      state->error = json_parse_error_recursion;
-      return 1;
-  }
+      if (offset == src_size) {
+        /* the string wasn't terminated! */
+        return 0;
+      }
 
-  if ('[' != src[state->offset]) {
-    /* expected array to begin with leading '['. */
-    state->error = json_parse_error_unknown;
-    --state->recursion;
-    return 1;
-  }
+      out[size++] = d;
+      offset++;
 
-  /* skip leading '['. */
-  state->offset++;
+      if (c == d) {
+        break;
+      }
 
-  state->dom_size += sizeof(struct json_array_s);
+      if (offset == src_size) {
+        /* the string wasn't terminated! */
+        return 0;
+      }
 
-  while (state->offset < size) {
-    if (json_skip_all_skippables(state)) {
-      state->error = json_parse_error_premature_end_of_buffer;
-      --state->recursion;
-      return 1;
+      /* copy the character the reverse solidus escapes. */
+      out[size++] = in[offset++];
     }
 
-    if (']' == src[state->offset]) {
-      /* skip trailing ']'. */
-      state->offset++;
-
-      state->dom_size += sizeof(struct json_array_element_s) * elements;
-
-      /* finished the object! */
-      --state->recursion;
-      return 0;
-    }
+    next_word = offset;
+  }
 
-    /* if we parsed at least once element previously, grok for a comma. */
-    if (allow_comma) {
-      if (',' == src[state->offset]) {
-        /* skip comma. */
-        state->offset++;
-        allow_comma = 0;
-      } else if (!(json_parse_flags_allow_no_commas & flags_bitset)) {
-        state->error = json_parse_error_expected_comma_or_closing_bracket;
-        --state->recursion;
-        return 1;
-      }
+  if ((0 != depth) || !(had_value || is_global_object)) {
+    /* an object or array wasn't closed, or there was no value at all! */
+    return 0;
+  }
 
-      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
-        allow_comma = 0;
-        continue;
-      } else {
-        if (json_skip_all_skippables(state)) {
-          state->error = json_parse_error_premature_end_of_buffer;
-          --state->recursion;
-          return 1;
-        }
-      }
-    }
+  return size;
+}
 
-    if (json_get_value_size(state, /* is_global_object = */ 0)) {
-      /* value parsing failed! */
-      --state->recursion;
-      return 1;
-    }
+size_t json_minify_in_place(void *src, size_t src_size, size_t flags_bitset) {
+  return json_minify(src, src_size, flags_bitset, src);
+}
 
-    /* successfully parsed an array element! */
-    elements++;
-    allow_comma = 1;
+json_weak void json_tape_push(struct json_parse_state_s *state, size_t start,
+                              size_t end);
+void json_tape_push(struct json_parse_state_s *state, size_t start,
+                    size_t end) {
+  /* strings, numbers and keys record the offset they start at, and the length
+   * of the token if it is plain enough to be copied as is (or 0 if the token
+   * needs to be parsed normally). Once a token doesn't fit we stop recording,
+   * so the tape always covers a prefix of the tokens. */
+  if (state->tape_size + 2 <= state->tape_capacity) {
+    state->tape[state->tape_size++] = (json_uint32_t)start;
+    state->tape[state->tape_size++] =
+        (json_uint32_t)((0 == end) ? 0 : end - start);
+  } else {
+    /* stop the one-entry tokens after us being recorded too. */
+    state->tape_capacity = state->tape_size;
   }
-
-  /* we consumed the entire input before finding the closing ']' of the array!
-   */
-  state->error = json_parse_error_premature_end_of_buffer;
-  --state->recursion;
-  return 1;
 }
 
-json_weak int json_get_number_size(struct json_parse_state_s *state);
-int json_get_number_size(struct json_parse_state_s *state) {
-  const size_t flags_bitset = state->flags_bitset;
-  size_t offset = state->offset;
-  const size_t size = state->size;
-  int had_leading_digits = 0;
-  const char *const src = state->src;
+json_weak void json_tape_push_start(struct json_parse_state_s *state,
+                                    size_t start);
+void json_tape_push_start(struct json_parse_state_s *state, size_t start) {
+  /* objects, arrays, and true, false and null only record where they start. */
+  if (state->tape_size < state->tape_capacity) {
+    state->tape[state->tape_size++] = (json_uint32_t)start;
+  }
+}
 
-  state->dom_size += sizeof(struct json_number_s);
+json_weak size_t json_tape_next(struct json_parse_state_s *state,
+                                int is_key);
+size_t json_tape_next(struct json_parse_state_s *state, int is_key) {
+  const size_t start = state->tape[state->tape_offset++];
+  size_t length;
 
-  if ((json_parse_flags_allow_hexadecimal_numbers & flags_bitset) &&
-      (offset + 1 < size) && ('0' == src[offset]) &&
-      (('x' == src[offset + 1]) || ('X' == src[offset + 1]))) {
-    /* skip the leading 0x that identifies a hexadecimal number. */
-    offset += 2;
+  /* jump straight to where the next token starts. */
+  state->offset = start;
 
-    /* consume hexadecimal digits. */
-    while ((offset < size) && (('0' <= src[offset] && src[offset] <= '9') ||
-                               ('a' <= src[offset] && src[offset] <= 'f') ||
-                               ('A' <= src[offset] && src[offset] <= 'F'))) {
-      offset++;
+  if (!is_key) {
+    switch (state->src[start]) {
+    case '{':
+    case '[':
+    case 't':
+    case 'f':
+    case 'n':
+      /* there is no length recorded for these. */
+      return 0;
+    default:
+      break;
     }
-  } else {
-    int found_sign = 0;
-    int inf_or_nan = 0;
+  }
 
-    if ((offset < size) &&
-        (('-' == src[offset]) ||
-         ((json_parse_flags_allow_leading_plus_sign & flags_bitset) &&
-          ('+' == src[offset])))) {
-      /* skip valid leading '-' or '+'. */
-      offset++;
+  length = state->tape[state->tape_offset++];
 
-      found_sign = 1;
-    }
+  return (0 == length) ? 0 : start + length;
+}
 
-    if (json_parse_flags_allow_inf_and_nan & flags_bitset) {
-      const char inf[9] = "Infinity";
-      const size_t inf_strlen = sizeof(inf) - 1;
-      const char nan[4] = "NaN";
-      const size_t nan_strlen = sizeof(nan) - 1;
+json_weak char *json_parse_copy_span(struct json_parse_state_s *state,
+                                     size_t begin, size_t end);
+char *json_parse_copy_span(struct json_parse_state_s *state, size_t begin,
+                           size_t end) {
+  char *const data = state->data;
 
-      if (offset + inf_strlen < size) {
-        int found = 1;
-        size_t i;
-        for (i = 0; i < inf_strlen; i++) {
-          if (inf[i] != src[offset + i]) {
-            found = 0;
-            break;
-          }
-        }
+  memcpy(data, state->src + begin, end - begin);
 
-        if (found) {
-          /* We found our special 'Infinity' keyword! */
-          offset += inf_strlen;
+  /* add null terminator to the string. */
+  data[end - begin] = '\0';
 
-          inf_or_nan = 1;
-        }
-      }
+  /* move data along. */
+  state->data += end - begin + 1;
 
-      if (offset + nan_strlen < size) {
-        int found = 1;
-        size_t i;
-        for (i = 0; i < nan_strlen; i++) {
-          if (nan[i] != src[offset + i]) {
-            found = 0;
-            break;
-          }
-        }
+  return data;
+}
 
-        if (found) {
-          /* We found our special 'NaN' keyword! */
-          offset += nan_strlen;
+json_weak int json_get_value_size(struct json_parse_state_s *state,
+                                  int is_global_object);
 
-          inf_or_nan = 1;
-        }
-      }
+json_weak int json_get_string_size(struct json_parse_state_s *state,
+                                   size_t is_key);
+int json_get_string_size(struct json_parse_state_s *state, size_t is_key) {
+  size_t offset = state->offset;
+  const size_t size = state->size;
+  size_t data_size = 0;
+  const char *const src = state->src;
+  const int is_single_quote = '\'' == src[offset];
+  const char quote_to_use = is_single_quote ? '\'' : '"';
+  const size_t flags_bitset = state->flags_bitset;
+  unsigned long codepoint;
+  unsigned long high_surrogate = 0;
 
-      if (inf_or_nan) {
-        if (offset < size) {
-          switch (src[offset]) {
-          default:
-            break;
-          case '0':
-          case '1':
-          case '2':
-          case '3':
-          case '4':
-          case '5':
-          case '6':
-          case '7':
-          case '8':
-          case '9':
-          case 'e':
-          case 'E':
-            /* cannot follow an inf or nan with digits! */
-            state->error = json_parse_error_invalid_number_format;
-            state->offset = offset;
-            return 1;
-          }
-        }
-      }
+  if ((json_parse_flags_allow_location_information & flags_bitset) != 0 &&
+      is_key != 0) {
+    state->dom_size += sizeof(struct json_string_ex_s);
+  } else {
+    state->dom_size += sizeof(struct json_string_s);
+  }
+
+  if ('"' != src[offset]) {
+    /* if we are allowed single quoted strings check for that too. */
+    if (!((json_parse_flags_allow_single_quoted_strings & flags_bitset) &&
+          is_single_quote)) {
+      state->error = json_parse_error_expected_opening_quote;
+      state->offset = offset;
+      return 1;
     }
+  }
 
-    if (found_sign && !inf_or_nan && (offset < size) &&
-        !('0' <= src[offset] && src[offset] <= '9')) {
-      /* check if we are allowing leading '.'. */
-      if (!(json_parse_flags_allow_leading_or_trailing_decimal_point &
-            flags_bitset) ||
-          ('.' != src[offset])) {
-        /* a leading '-' must be immediately followed by any digit! */
-        state->error = json_parse_error_invalid_number_format;
-        state->offset = offset;
-        return 1;
-      }
+  /* skip leading '"' or '\''. */
+  offset++;
+
+  while ((offset < size) && (quote_to_use != src[offset])) {
+    /* add space for the character. */
+    data_size++;
+
+    switch (src[offset]) {
+    default:
+      break;
+    case '\0':
+    case '\t':
+      state->error = json_parse_error_invalid_string;
+      state->offset = offset;
+      return 1;
     }
 
-    if ((offset < size) && ('0' == src[offset])) {
-      /* skip valid '0'. */
+    if ('\\' == src[offset]) {
+      /* skip reverse solidus character. */
       offset++;
 
-      /* we need to record whether we had any leading digits for checks later.
-       */
-      had_leading_digits = 1;
-
-      if ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
-        /* a leading '0' must not be immediately followed by any digit! */
-        state->error = json_parse_error_invalid_number_format;
+      if (offset == size) {
+        state->error = json_parse_error_premature_end_of_buffer;
         state->offset = offset;
         return 1;
       }
-    }
 
-    /* the main digits of our number next. */
-    while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
+      switch (src[offset]) {
+      default:
+        state->error = json_parse_error_invalid_string_escape_sequence;
+        state->offset = offset;
+        return 1;
+      case '"':
+      case '\\':
+      case '/':
+      case 'b':
+      case 'f':
+      case 'n':
+      case 'r':
+      case 't':
+        /* all valid characters! */
+        offset++;
+        break;
+      case 'u':
+        if (!(offset + 5 < size)) {
+          /* invalid escaped unicode sequence! */
+          state->error = json_parse_error_invalid_string_escape_sequence;
+          state->offset = offset;
+          return 1;
+        }
+
+        codepoint = 0;
+        if (!json_hexadecimal_value(&src[offset + 1], 4, &codepoint)) {
+          /* escaped unicode sequences must contain 4 hexadecimal digits! */
+          state->error = json_parse_error_invalid_string_escape_sequence;
+          state->offset = offset;
+          return 1;
+        }
+
+        /* Valid sequence!
+         * see: https://en.wikipedia.org/wiki/UTF-8#Invalid_code_points.
+         *      1       7       U + 0000        U + 007F        0xxxxxxx.
+         *      2       11      U + 0080        U + 07FF        110xxxxx
+         * 10xxxxxx.
+         *      3       16      U + 0800        U + FFFF        1110xxxx
+         * 10xxxxxx        10xxxxxx.
+         *      4       21      U + 10000       U + 10FFFF      11110xxx
+         * 10xxxxxx        10xxxxxx        10xxxxxx.
+         * Note: the high and low surrogate halves used by UTF-16 (U+D800
+         * through U+DFFF) and code points not encodable by UTF-16 (those after
+         * U+10FFFF) are not legal Unicode values, and their UTF-8 encoding must
+         * be treated as an invalid byte sequence. */
+
+        if (high_surrogate != 0) {
+          /* we previously read the high half of the \uxxxx\uxxxx pair, so now
+           * we expect the low half. */
+          if (codepoint >= 0xdc00 &&
+              codepoint <= 0xdfff) { /* low surrogate range. */
+            data_size += 3;
+            high_surrogate = 0;
+          } else {
+            state->error = json_parse_error_invalid_string_escape_sequence;
+            state->offset = offset;
+            return 1;
+          }
+        } else if (codepoint <= 0x7f) {
+          data_size += 0;
+        } else if (codepoint <= 0x7ff) {
+          data_size += 1;
+        } else if (codepoint >= 0xd800 &&
+                   codepoint <= 0xdbff) { /* high surrogate range. */
+          /* The codepoint is the first half of a "utf-16 surrogate pair". so we
+           * need the other half for it to be valid: \uHHHH\uLLLL. */
+          if (offset + 11 > size || '\\' != src[offset + 5] ||
+              'u' != src[offset + 6]) {
+            state->error = json_parse_error_invalid_string_escape_sequence;
+            state->offset = offset;
+            return 1;
+          }
+          high_surrogate = codepoint;
+        } else if (codepoint >= 0xd800 &&
+                   codepoint <= 0xdfff) { /* low surrogate range. */
+          /* we did not read the other half before. */
+          state->error = json_parse_error_invalid_string_escape_sequence;
+          state->offset = offset;
+          return 1;
+        } else {
+          data_size += 2;
+        }
+        /* escaped codepoints after 0xffff are supported in json through utf-16
+         * surrogate pairs: \uD83D\uDD25 for U+1F525. */
+
+        offset += 5;
+        break;
+      }
+    } else if (('\r' == src[offset]) || ('\n' == src[offset])) {
+      if (!(json_parse_flags_allow_multi_line_strings & flags_bitset)) {
+        /* invalid escaped unicode sequence! */
+        state->error = json_parse_error_invalid_string_escape_sequence;
+        state->offset = offset;
+        return 1;
+      }
+
+      offset++;
+    } else {
+      /* skip character (valid part of sequence). */
       offset++;
+    }
+  }
+
+  /* If the offset is equal to the size, we had a non-terminated string! */
+  if (offset == size) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    state->offset = offset - 1;
+    return 1;
+  }
+
+  /* skip trailing '"' or '\''. */
+  offset++;
+
+  /* strings without escape sequences can be copied as is when parsing. */
+  json_tape_push(state, state->offset,
+                 (data_size == offset - state->offset - 2) ? offset : 0);
+
+  /* add enough space to store the string. */
+  state->data_size += data_size;
+
+  /* one more byte for null terminator ending the string! */
+  state->data_size++;
+
+  /* update offset. */
+  state->offset = offset;
+
+  return 0;
+}
+
+json_weak int is_valid_unquoted_key_char(const char c);
+int is_valid_unquoted_key_char(const char c) {
+  return (('0' <= c && c <= '9') || ('a' <= c && c <= 'z') ||
+          ('A' <= c && c <= 'Z') || ('_' == c) || ('$' == c));
+}
+
+json_weak int json_get_key_size(struct json_parse_state_s *state);
+int json_get_key_size(struct json_parse_state_s *state) {
+  const size_t flags_bitset = state->flags_bitset;
+
+  if (json_parse_flags_allow_unquoted_keys & flags_bitset) {
+    size_t offset = state->offset;
+    const size_t size = state->size;
+    const char *const src = state->src;
+    size_t data_size = state->data_size;
+
+    /* if we are allowing unquoted keys, first grok for a quote... */
+    if ('"' == src[offset]) {
+      /* ... if we got a comma, just parse the key as a string as normal. */
+      return json_get_string_size(state, 1);
+    } else if ((json_parse_flags_allow_single_quoted_strings & flags_bitset) &&
+               ('\'' == src[offset])) {
+      /* ... if we got a comma, just parse the key as a string as normal. */
+      return json_get_string_size(state, 1);
+    } else {
+      while ((offset < size) && is_valid_unquoted_key_char(src[offset])) {
+        offset++;
+        data_size++;
+      }
+
+      /* one more byte for null terminator ending the string! */
+      data_size++;
+
+      if (json_parse_flags_allow_location_information & flags_bitset) {
+        state->dom_size += sizeof(struct json_string_ex_s);
+      } else {
+        state->dom_size += sizeof(struct json_string_s);
+      }
+
+      json_tape_push(state, state->offset, offset);
+
+      /* update offset. */
+      state->offset = offset;
+
+      /* update data_size. */
+      state->data_size = data_size;
+
+      return 0;
+    }
+  } else {
+    /* we are only allowed to have quoted keys, so just parse a string! */
+    return json_get_string_size(state, 1);
+  }
+}
+
+json_weak int json_get_object_size(struct json_parse_state_s *state,
+                                   int is_global_object);
+int json_get_object_size(struct json_parse_state_s *state,
+                         int is_global_object) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  int allow_comma = 0;
+  int found_closing_brace = 0;
+
+  if (++state->recursion > JSON_MAX_RECURSION) {
+      /* recursion error */
+      state->error = json_parse_error_recursion;
+      return 1;
+  }
+
+  if (is_global_object) {
+    /* if we found an opening '{' of an object, we actually have a normal JSON
+     * object at the root of the DOM... */
+    if (!json_skip_all_skippables(state) && '{' == state->src[state->offset]) {
+      /* . and we don't actually have a global object after all! */
+      is_global_object = 0;
+    }
+  }
+
+  if (!is_global_object) {
+    if ('{' != src[state->offset]) {
+      state->error = json_parse_error_unknown;
+      --state->recursion;
+      return 1;
+    }
+
+    /* skip leading '{'. */
+    state->offset++;
+  }
+
+  state->dom_size += sizeof(struct json_object_s);
+
+  if ((state->offset == size) && !is_global_object) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    --state->recursion;
+    return 1;
+  }
+
+  do {
+    if (!is_global_object) {
+      if (json_skip_all_skippables(state)) {
+        state->error = json_parse_error_premature_end_of_buffer;
+        --state->recursion;
+        return 1;
+      }
+
+      if ('}' == src[state->offset]) {
+        /* skip trailing '}'. */
+        state->offset++;
+
+        found_closing_brace = 1;
+
+        /* finished the object! */
+        break;
+      }
+    } else {
+      /* we don't require brackets, so that means the object ends when the input
+       * stream ends! */
+      if (json_skip_all_skippables(state)) {
+        break;
+      }
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+      } else if (json_parse_flags_allow_no_commas & flags_bitset) {
+        /* we don't require a comma, and we didn't find one, which is ok! */
+        allow_comma = 0;
+      } else {
+        /* otherwise we are required to have a comma, and we found none. */
+        state->error = json_parse_error_expected_comma_or_closing_bracket;
+        --state->recursion;
+        return 1;
+      }
+
+      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
+        continue;
+      } else {
+        if (json_skip_all_skippables(state)) {
+          state->error = json_parse_error_premature_end_of_buffer;
+          --state->recursion;
+          return 1;
+        }
+      }
+    }
+
+    if (json_get_key_size(state)) {
+      /* key parsing failed! */
+      state->error = json_parse_error_invalid_string;
+      --state->recursion;
+      return 1;
+    }
+
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    if (json_parse_flags_allow_equals_in_object & flags_bitset) {
+      const char current = src[state->offset];
+      if ((':' != current) && ('=' != current)) {
+        state->error = json_parse_error_expected_colon;
+        --state->recursion;
+        return 1;
+      }
+    } else {
+      if (':' != src[state->offset]) {
+        state->error = json_parse_error_expected_colon;
+        --state->recursion;
+        return 1;
+      }
+    }
+
+    /* skip colon. */
+    state->offset++;
+
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    if (json_get_value_size(state, /* is_global_object = */ 0)) {
+      /* value parsing failed! */
+      --state->recursion;
+      return 1;
+    }
+
+    /* successfully parsed a name/value pair! */
+    elements++;
+    allow_comma = 1;
+  } while (state->offset < size);
+
+  if ((state->offset == size) && !is_global_object && !found_closing_brace) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    --state->recursion;
+    return 1;
+  }
+
+  state->dom_size += sizeof(struct json_object_element_s) * elements;
+  --state->recursion;
+
+  return 0;
+}
+
+json_weak int json_get_array_size(struct json_parse_state_s *state);
+int json_get_array_size(struct json_parse_state_s *state) {
+  const size_t flags_bitset = state->flags_bitset;
+  size_t elements = 0;
+  int allow_comma = 0;
+  const char *const src = state->src;
+  const size_t size = state->size;
+
+  if (++state->recursion > JSON_MAX_RECURSION) {
+      /* recursion error */
+      state->error = json_parse_error_recursion;
+      return 1;
+  }
+
+  if ('[' != src[state->offset]) {
+    /* expected array to begin with leading '['. */
+    state->error = json_parse_error_unknown;
+    --state->recursion;
+    return 1;
+  }
+
+  /* skip leading '['. */
+  state->offset++;
+
+  state->dom_size += sizeof(struct json_array_s);
+
+  while (state->offset < size) {
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    if (']' == src[state->offset]) {
+      /* skip trailing ']'. */
+      state->offset++;
+
+      state->dom_size += sizeof(struct json_array_element_s) * elements;
+
+      /* finished the object! */
+      --state->recursion;
+      return 0;
+    }
+
+    /* if we parsed at least once element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+      } else if (!(json_parse_flags_allow_no_commas & flags_bitset)) {
+        state->error = json_parse_error_expected_comma_or_closing_bracket;
+        --state->recursion;
+        return 1;
+      }
+
+      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
+        allow_comma = 0;
+        continue;
+      } else {
+        if (json_skip_all_skippables(state)) {
+          state->error = json_parse_error_premature_end_of_buffer;
+          --state->recursion;
+          return 1;
+        }
+      }
+    }
+
+    if (json_get_value_size(state, /* is_global_object = */ 0)) {
+      /* value parsing failed! */
+      --state->recursion;
+      return 1;
+    }
+
+    /* successfully parsed an array element! */
+    elements++;
+    allow_comma = 1;
+  }
+
+  /* we consumed the entire input before finding the closing ']' of the array!
+   */
+  state->error = json_parse_error_premature_end_of_buffer;
+  --state->recursion;
+  return 1;
+}
+
+json_weak int json_get_number_size(struct json_parse_state_s *state);
+int json_get_number_size(struct json_parse_state_s *state) {
+  const size_t flags_bitset = state->flags_bitset;
+  size_t offset = state->offset;
+  const size_t size = state->size;
+  int had_leading_digits = 0;
+  const char *const src = state->src;
+
+  state->dom_size += sizeof(struct json_number_s);
+
+  if ((json_parse_flags_allow_hexadecimal_numbers & flags_bitset) &&
+      (offset + 1 < size) && ('0' == src[offset]) &&
+      (('x' == src[offset + 1]) || ('X' == src[offset + 1]))) {
+    /* skip the leading 0x that identifies a hexadecimal number. */
+    offset += 2;
+
+    /* consume hexadecimal digits. */
+    while ((offset < size) && (('0' <= src[offset] && src[offset] <= '9') ||
+                               ('a' <= src[offset] && src[offset] <= 'f') ||
+                               ('A' <= src[offset] && src[offset] <= 'F'))) {
+      offset++;
+    }
+  } else {
+    int found_sign = 0;
+    int inf_or_nan = 0;
+
+    if ((offset < size) &&
+        (('-' == src[offset]) ||
+         ((json_parse_flags_allow_leading_plus_sign & flags_bitset) &&
+          ('+' == src[offset])))) {
+      /* skip valid leading '-' or '+'. */
+      offset++;
+
+      found_sign = 1;
+    }
+
+    if (json_parse_flags_allow_inf_and_nan & flags_bitset) {
+      const char inf[9] = "Infinity";
+      const size_t inf_strlen = sizeof(inf) - 1;
+      const char nan[4] = "NaN";
+      const size_t nan_strlen = sizeof(nan) - 1;
+
+      if (offset + inf_strlen < size) {
+        int found = 1;
+        size_t i;
+        for (i = 0; i < inf_strlen; i++) {
+          if (inf[i] != src[offset + i]) {
+            found = 0;
+            break;
+          }
+        }
+
+        if (found) {
+          /* We found our special 'Infinity' keyword! */
+          offset += inf_strlen;
+
+          inf_or_nan = 1;
+        }
+      }
+
+      if (offset + nan_strlen < size) {
+        int found = 1;
+        size_t i;
+        for (i = 0; i < nan_strlen; i++) {
+          if (nan[i] != src[offset + i]) {
+            found = 0;
+            break;
+          }
+        }
+
+        if (found) {
+          /* We found our special 'NaN' keyword! */
+          offset += nan_strlen;
+
+          inf_or_nan = 1;
+        }
+      }
+
+      if (inf_or_nan) {
+        if (offset < size) {
+          switch (src[offset]) {
+          default:
+            break;
+          case '0':
+          case '1':
+          case '2':
+          case '3':
+          case '4':
+          case '5':
+          case '6':
+          case '7':
+          case '8':
+          case '9':
+          case 'e':
+          case 'E':
+            /* cannot follow an inf or nan with digits! */
+            state->error = json_parse_error_invalid_number_format;
+            state->offset = offset;
+            return 1;
+          }
+        }
+      }
+    }
+
+    if (found_sign && !inf_or_nan && (offset < size) &&
+        !('0' <= src[offset] && src[offset] <= '9')) {
+      /* check if we are allowing leading '.'. */
+      if (!(json_parse_flags_allow_leading_or_trailing_decimal_point &
+            flags_bitset) ||
+          ('.' != src[offset])) {
+        /* a leading '-' must be immediately followed by any digit! */
+        state->error = json_parse_error_invalid_number_format;
+        state->offset = offset;
+        return 1;
+      }
+    }
+
+    if ((offset < size) && ('0' == src[offset])) {
+      /* skip valid '0'. */
+      offset++;
+
+      /* we need to record whether we had any leading digits for checks later.
+       */
+      had_leading_digits = 1;
+
+      if ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
+        /* a leading '0' must not be immediately followed by any digit! */
+        state->error = json_parse_error_invalid_number_format;
+        state->offset = offset;
+        return 1;
+      }
+    }
+
+    /* the main digits of our number next. */
+    while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
+      offset++;
+
+      /* we need to record whether we had any leading digits for checks later.
+       */
+      had_leading_digits = 1;
+    }
+
+    if ((offset < size) && ('.' == src[offset])) {
+      offset++;
+
+      if ((offset >= size) || !('0' <= src[offset] && src[offset] <= '9')) {
+        if (!(json_parse_flags_allow_leading_or_trailing_decimal_point &
+              flags_bitset) ||
+            !had_leading_digits) {
+          /* a decimal point must be followed by at least one digit. */
+          state->error = json_parse_error_invalid_number_format;
+          state->offset = offset;
+          return 1;
+        }
+      }
+
+      /* a decimal point can be followed by more digits of course! */
+      while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
+        offset++;
+      }
+    }
+
+    if ((offset < size) && ('e' == src[offset] || 'E' == src[offset])) {
+      /* our number has an exponent! Skip 'e' or 'E'. */
+      offset++;
+
+      if ((offset < size) && ('-' == src[offset] || '+' == src[offset])) {
+        /* skip optional '-' or '+'. */
+        offset++;
+      }
+
+      if ((offset < size) && !('0' <= src[offset] && src[offset] <= '9')) {
+        /* an exponent must have at least one digit! */
+        state->error = json_parse_error_invalid_number_format;
+        state->offset = offset;
+        return 1;
+      }
+
+      /* consume exponent digits. */
+      do {
+        offset++;
+      } while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9'));
+    }
+  }
+
+  if (offset < size) {
+    switch (src[offset]) {
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+    case '}':
+    case ',':
+    case ']':
+      /* all of the above are ok. */
+      break;
+    case '=':
+      if (json_parse_flags_allow_equals_in_object & flags_bitset) {
+        break;
+      }
+
+      state->error = json_parse_error_invalid_number_format;
+      state->offset = offset;
+      return 1;
+    default:
+      state->error = json_parse_error_invalid_number_format;
+      state->offset = offset;
+      return 1;
+    }
+  }
+
+  json_tape_push(state, state->offset, offset);
+
+  state->data_size += offset - state->offset;
+
+  /* one more byte for null terminator ending the number string! */
+  state->data_size++;
+
+  /* update offset. */
+  state->offset = offset;
+
+  return 0;
+}
+
+json_weak int json_get_value_size(struct json_parse_state_s *state,
+                                  int is_global_object);
+int json_get_value_size(struct json_parse_state_s *state,
+                        int is_global_object) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  size_t offset;
+  const size_t size = state->size;
+
+  if (json_parse_flags_allow_location_information & flags_bitset) {
+    state->dom_size += sizeof(struct json_value_ex_s);
+  } else {
+    state->dom_size += sizeof(struct json_value_s);
+  }
+
+  if (is_global_object) {
+    return json_get_object_size(state, /* is_global_object = */ 1);
+  } else {
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      return 1;
+    }
+
+    /* can cache offset now. */
+    offset = state->offset;
+
+    switch (src[offset]) {
+    case '"':
+      return json_get_string_size(state, 0);
+    case '\'':
+      if (json_parse_flags_allow_single_quoted_strings & flags_bitset) {
+        return json_get_string_size(state, 0);
+      } else {
+        /* invalid value! */
+        state->error = json_parse_error_invalid_value;
+        return 1;
+      }
+    case '{':
+      json_tape_push_start(state, offset);
+      return json_get_object_size(state, /* is_global_object = */ 0);
+    case '[':
+      json_tape_push_start(state, offset);
+      return json_get_array_size(state);
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      return json_get_number_size(state);
+    case '+':
+      if (json_parse_flags_allow_leading_plus_sign & flags_bitset) {
+        return json_get_number_size(state);
+      } else {
+        /* invalid value! */
+        state->error = json_parse_error_invalid_number_format;
+        return 1;
+      }
+    case '.':
+      if (json_parse_flags_allow_leading_or_trailing_decimal_point &
+          flags_bitset) {
+        return json_get_number_size(state);
+      } else {
+        /* invalid value! */
+        state->error = json_parse_error_invalid_number_format;
+        return 1;
+      }
+    default:
+      if ((offset + 4) <= size && 't' == src[offset + 0] &&
+          'r' == src[offset + 1] && 'u' == src[offset + 2] &&
+          'e' == src[offset + 3]) {
+        json_tape_push_start(state, offset);
+        state->offset += 4;
+        return 0;
+      } else if ((offset + 5) <= size && 'f' == src[offset + 0] &&
+                 'a' == src[offset + 1] && 'l' == src[offset + 2] &&
+                 's' == src[offset + 3] && 'e' == src[offset + 4]) {
+        json_tape_push_start(state, offset);
+        state->offset += 5;
+        return 0;
+      } else if ((offset + 4) <= size && 'n' == state->src[offset + 0] &&
+                 'u' == state->src[offset + 1] &&
+                 'l' == state->src[offset + 2] &&
+                 'l' == state->src[offset + 3]) {
+        json_tape_push_start(state, offset);
+        state->offset += 4;
+        return 0;
+      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
+                 (offset + 3) <= size && 'N' == src[offset + 0] &&
+                 'a' == src[offset + 1] && 'N' == src[offset + 2]) {
+        return json_get_number_size(state);
+      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
+                 (offset + 8) <= size && 'I' == src[offset + 0] &&
+                 'n' == src[offset + 1] && 'f' == src[offset + 2] &&
+                 'i' == src[offset + 3] && 'n' == src[offset + 4] &&
+                 'i' == src[offset + 5] && 't' == src[offset + 6] &&
+                 'y' == src[offset + 7]) {
+        return json_get_number_size(state);
+      }
+
+      /* invalid value! */
+      state->error = json_parse_error_invalid_value;
+      return 1;
+    }
+  }
+}
+
+json_weak void json_parse_value(struct json_parse_state_s *state,
+                                int is_global_object,
+                                struct json_value_s *value);
+
+json_weak void json_parse_string(struct json_parse_state_s *state,
+                                 struct json_string_s *string);
+void json_parse_string(struct json_parse_state_s *state,
+                       struct json_string_s *string) {
+  size_t offset = state->offset;
+  size_t bytes_written = 0;
+  const char *const src = state->src;
+  const char quote_to_use = '\'' == src[offset] ? '\'' : '"';
+  char *data = state->data;
+  unsigned long high_surrogate = 0;
+  unsigned long codepoint;
+
+  string->string = data;
+
+  /* skip leading '"' or '\''. */
+  offset++;
+
+  while (quote_to_use != src[offset]) {
+    if ('\\' == src[offset]) {
+      /* skip the reverse solidus. */
+      offset++;
+
+      switch (src[offset++]) {
+      default:
+        return; /* we cannot ever reach here. */
+      case 'u': {
+        codepoint = 0;
+        if (!json_hexadecimal_value(&src[offset], 4, &codepoint)) {
+          return; /* this shouldn't happen as the value was already validated.
+                   */
+        }
+
+        offset += 4;
+
+        if (codepoint <= 0x7fu) {
+          data[bytes_written++] = (char)codepoint; /* 0xxxxxxx. */
+        } else if (codepoint <= 0x7ffu) {
+          data[bytes_written++] =
+              (char)(0xc0u | (codepoint >> 6)); /* 110xxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        } else if (codepoint >= 0xd800 &&
+                   codepoint <= 0xdbff) { /* high surrogate. */
+          high_surrogate = codepoint;
+          continue; /* we need the low half to form a complete codepoint. */
+        } else if (codepoint >= 0xdc00 &&
+                   codepoint <= 0xdfff) { /* low surrogate. */
+          /* combine with the previously read half to obtain the complete
+           * codepoint. */
+          const unsigned long surrogate_offset =
+              0x10000u - (0xD800u << 10) - 0xDC00u;
+          codepoint = (high_surrogate << 10) + codepoint + surrogate_offset;
+          high_surrogate = 0;
+          data[bytes_written++] =
+              (char)(0xF0u | (codepoint >> 18)); /* 11110xxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 12) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        } else {
+          /* we assume the value was validated and thus is within the valid
+           * range. */
+          data[bytes_written++] =
+              (char)(0xe0u | (codepoint >> 12)); /* 1110xxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        }
+      } break;
+      case '"':
+        data[bytes_written++] = '"';
+        break;
+      case '\\':
+        data[bytes_written++] = '\\';
+        break;
+      case '/':
+        data[bytes_written++] = '/';
+        break;
+      case 'b':
+        data[bytes_written++] = '\b';
+        break;
+      case 'f':
+        data[bytes_written++] = '\f';
+        break;
+      case 'n':
+        data[bytes_written++] = '\n';
+        break;
+      case 'r':
+        data[bytes_written++] = '\r';
+        break;
+      case 't':
+        data[bytes_written++] = '\t';
+        break;
+      case '\r':
+        data[bytes_written++] = '\r';
+
+        /* check if we have a "\r\n" sequence. */
+        if ('\n' == src[offset]) {
+          data[bytes_written++] = '\n';
+          offset++;
+        }
+
+        break;
+      case '\n':
+        data[bytes_written++] = '\n';
+        break;
+      }
+    } else {
+      /* copy the character. */
+      data[bytes_written++] = src[offset++];
+    }
+  }
+
+  /* skip trailing '"' or '\''. */
+  offset++;
+
+  /* record the size of the string. */
+  string->string_size = bytes_written;
+
+  /* add null terminator to string. */
+  data[bytes_written++] = '\0';
+
+  /* move data along. */
+  state->data += bytes_written;
+
+  /* update offset. */
+  state->offset = offset;
+}
+
+json_weak void json_parse_key(struct json_parse_state_s *state,
+                              struct json_string_s *string);
+void json_parse_key(struct json_parse_state_s *state,
+                    struct json_string_s *string) {
+  if (state->tape_offset < state->tape_size) {
+    const size_t start = state->offset;
+    const size_t end = json_tape_next(state, /* is_key = */ 1);
+
+    if (0 != end) {
+      /* the sizing pass found this key doesn't need any processing. */
+      if (('"' == state->src[start]) || ('\'' == state->src[start])) {
+        string->string = json_parse_copy_span(state, start + 1, end - 1);
+        string->string_size = end - start - 2;
+      } else {
+        string->string = json_parse_copy_span(state, start, end);
+        string->string_size = end - start;
+      }
+
+      state->offset = end;
+      return;
+    }
+  }
+
+  if (json_parse_flags_allow_unquoted_keys & state->flags_bitset) {
+    const char *const src = state->src;
+    char *const data = state->data;
+    size_t offset = state->offset;
+
+    /* if we are allowing unquoted keys, check for quoted anyway... */
+    if (('"' == src[offset]) || ('\'' == src[offset])) {
+      /* ... if we got a quote, just parse the key as a string as normal. */
+      json_parse_string(state, string);
+    } else {
+      size_t size = 0;
+
+      string->string = state->data;
+
+      while (is_valid_unquoted_key_char(src[offset])) {
+        data[size++] = src[offset++];
+      }
+
+      /* add null terminator to string. */
+      data[size] = '\0';
+
+      /* record the size of the string. */
+      string->string_size = size++;
+
+      /* move data along. */
+      state->data += size;
+
+      /* update offset. */
+      state->offset = offset;
+    }
+  } else {
+    /* we are only allowed to have quoted keys, so just parse a string! */
+    json_parse_string(state, string);
+  }
+}
+
+json_weak void json_parse_object(struct json_parse_state_s *state,
+                                 int is_global_object,
+                                 struct json_object_s *object);
+void json_parse_object(struct json_parse_state_s *state, int is_global_object,
+                       struct json_object_s *object) {
+  const size_t flags_bitset = state->flags_bitset;
+  const size_t size = state->size;
+  const char *const src = state->src;
+  size_t elements = 0;
+  int allow_comma = 0;
+  struct json_object_element_s *previous = json_null;
+
+  if (is_global_object) {
+    /* if we skipped some whitespace, and then found an opening '{' of an. */
+    /* object, we actually have a normal JSON object at the root of the DOM...
+     */
+    if ('{' == src[state->offset]) {
+      /* . and we don't actually have a global object after all! */
+      is_global_object = 0;
+    }
+  }
+
+  if (!is_global_object) {
+    /* skip leading '{'. */
+    state->offset++;
+  }
+
+  (void)json_skip_all_skippables(state);
+
+  /* reset elements. */
+  elements = 0;
+
+  while (state->offset < size) {
+    struct json_object_element_s *element = json_null;
+    struct json_string_s *string = json_null;
+    struct json_value_s *value = json_null;
+
+    if (!is_global_object) {
+      (void)json_skip_all_skippables(state);
+
+      if ('}' == src[state->offset]) {
+        /* skip trailing '}'. */
+        state->offset++;
+
+        /* finished the object! */
+        break;
+      }
+    } else {
+      if (json_skip_all_skippables(state)) {
+        /* global object ends when the file ends! */
+        break;
+      }
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+        continue;
+      }
+    }
+
+    element = (struct json_object_element_s *)state->dom;
+
+    state->dom += sizeof(struct json_object_element_s);
+
+    if (json_null == previous) {
+      /* this is our first element, so record it in our object. */
+      object->start = element;
+    } else {
+      previous->next = element;
+    }
+
+    previous = element;
+
+    if (json_parse_flags_allow_location_information & flags_bitset) {
+      struct json_string_ex_s *string_ex =
+          (struct json_string_ex_s *)state->dom;
+      state->dom += sizeof(struct json_string_ex_s);
+
+      string_ex->offset = state->offset;
+      string_ex->line_no = state->line_no;
+      string_ex->row_no = state->offset - state->line_offset;
+
+      string = &(string_ex->string);
+    } else {
+      string = (struct json_string_s *)state->dom;
+      state->dom += sizeof(struct json_string_s);
+    }
+
+    element->name = string;
+
+    (void)json_parse_key(state, string);
+
+    (void)json_skip_all_skippables(state);
+
+    /* skip colon or equals. */
+    state->offset++;
+
+    (void)json_skip_all_skippables(state);
+
+    if (json_parse_flags_allow_location_information & flags_bitset) {
+      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
+      state->dom += sizeof(struct json_value_ex_s);
+
+      value_ex->offset = state->offset;
+      value_ex->line_no = state->line_no;
+      value_ex->row_no = state->offset - state->line_offset;
+
+      value = &(value_ex->value);
+    } else {
+      value = (struct json_value_s *)state->dom;
+      state->dom += sizeof(struct json_value_s);
+    }
+
+    element->value = value;
+
+    json_parse_value(state, /* is_global_object = */ 0, value);
+
+    /* successfully parsed a name/value pair! */
+    elements++;
+    allow_comma = 1;
+  }
+
+  /* if we had at least one element, end the linked list. */
+  if (previous) {
+    previous->next = json_null;
+  }
+
+  if (0 == elements) {
+    object->start = json_null;
+  }
+
+  object->length = elements;
+}
+
+json_weak void json_parse_array(struct json_parse_state_s *state,
+                                struct json_array_s *array);
+void json_parse_array(struct json_parse_state_s *state,
+                      struct json_array_s *array) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  int allow_comma = 0;
+  struct json_array_element_s *previous = json_null;
+
+  /* skip leading '['. */
+  state->offset++;
+
+  (void)json_skip_all_skippables(state);
+
+  /* reset elements. */
+  elements = 0;
+
+  do {
+    struct json_array_element_s *element = json_null;
+    struct json_value_s *value = json_null;
+
+    (void)json_skip_all_skippables(state);
+
+    if (']' == src[state->offset]) {
+      /* skip trailing ']'. */
+      state->offset++;
+
+      /* finished the array! */
+      break;
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+        continue;
+      }
+    }
+
+    element = (struct json_array_element_s *)state->dom;
+
+    state->dom += sizeof(struct json_array_element_s);
+
+    if (json_null == previous) {
+      /* this is our first element, so record it in our array. */
+      array->start = element;
+    } else {
+      previous->next = element;
+    }
+
+    previous = element;
+
+    if (json_parse_flags_allow_location_information & state->flags_bitset) {
+      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
+      state->dom += sizeof(struct json_value_ex_s);
+
+      value_ex->offset = state->offset;
+      value_ex->line_no = state->line_no;
+      value_ex->row_no = state->offset - state->line_offset;
+
+      value = &(value_ex->value);
+    } else {
+      value = (struct json_value_s *)state->dom;
+      state->dom += sizeof(struct json_value_s);
+    }
+
+    element->value = value;
+
+    json_parse_value(state, /* is_global_object = */ 0, value);
+
+    /* successfully parsed an array element! */
+    elements++;
+    allow_comma = 1;
+  } while (state->offset < size);
+
+  /* end the linked list. */
+  if (previous) {
+    previous->next = json_null;
+  }
+
+  if (0 == elements) {
+    array->start = json_null;
+  }
+
+  array->length = elements;
+}
+
+json_weak void json_parse_number(struct json_parse_state_s *state,
+                                 struct json_number_s *number);
+void json_parse_number(struct json_parse_state_s *state,
+                       struct json_number_s *number) {
+  const size_t flags_bitset = state->flags_bitset;
+  size_t offset = state->offset;
+  const size_t size = state->size;
+  size_t bytes_written = 0;
+  const char *const src = state->src;
+  char *data = state->data;
+
+  number->number = data;
+
+  if (json_parse_flags_allow_hexadecimal_numbers & flags_bitset) {
+    if (('0' == src[offset]) &&
+        (('x' == src[offset + 1]) || ('X' == src[offset + 1]))) {
+      /* consume hexadecimal digits. */
+      while ((offset < size) &&
+             (('0' <= src[offset] && src[offset] <= '9') ||
+              ('a' <= src[offset] && src[offset] <= 'f') ||
+              ('A' <= src[offset] && src[offset] <= 'F') ||
+              ('x' == src[offset]) || ('X' == src[offset]))) {
+        data[bytes_written++] = src[offset++];
+      }
+    }
+  }
+
+  while (offset < size) {
+    int end = 0;
+
+    switch (src[offset]) {
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    case '.':
+    case 'e':
+    case 'E':
+    case '+':
+    case '-':
+      data[bytes_written++] = src[offset++];
+      break;
+    default:
+      end = 1;
+      break;
+    }
+
+    if (0 != end) {
+      break;
+    }
+  }
+
+  if (json_parse_flags_allow_inf_and_nan & flags_bitset) {
+    const size_t inf_strlen = 8; /* = strlen("Infinity");. */
+    const size_t nan_strlen = 3; /* = strlen("NaN");. */
+
+    if (offset + inf_strlen < size) {
+      if ('I' == src[offset]) {
+        size_t i;
+        /* We found our special 'Infinity' keyword! */
+        for (i = 0; i < inf_strlen; i++) {
+          data[bytes_written++] = src[offset++];
+        }
+      }
+    }
+
+    if (offset + nan_strlen < size) {
+      if ('N' == src[offset]) {
+        size_t i;
+        /* We found our special 'NaN' keyword! */
+        for (i = 0; i < nan_strlen; i++) {
+          data[bytes_written++] = src[offset++];
+        }
+      }
+    }
+  }
+
+  /* record the size of the number. */
+  number->number_size = bytes_written;
+  /* add null terminator to number string. */
+  data[bytes_written++] = '\0';
+  /* move data along. */
+  state->data += bytes_written;
+  /* update offset. */
+  state->offset = offset;
+}
+
+json_weak void json_parse_value(struct json_parse_state_s *state,
+                                int is_global_object,
+                                struct json_value_s *value);
+void json_parse_value(struct json_parse_state_s *state, int is_global_object,
+                      struct json_value_s *value) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t offset;
+  size_t tape_end = 0;
+
+  if (!is_global_object && (state->tape_offset < state->tape_size)) {
+    tape_end = json_tape_next(state, /* is_key = */ 0);
+  } else {
+    (void)json_skip_all_skippables(state);
+  }
+
+  /* cache offset now. */
+  offset = state->offset;
+
+  if (0 != tape_end) {
+    /* the sizing pass found this string or number doesn't need any processing,
+     * so we can copy it as is. */
+    if (('"' == src[offset]) || ('\'' == src[offset])) {
+      struct json_string_s *const string = (struct json_string_s *)state->dom;
+      state->dom += sizeof(struct json_string_s);
+
+      string->string = json_parse_copy_span(state, offset + 1, tape_end - 1);
+      string->string_size = tape_end - offset - 2;
+
+      value->type = json_type_string;
+      value->payload = string;
+    } else {
+      struct json_number_s *const number = (struct json_number_s *)state->dom;
+      state->dom += sizeof(struct json_number_s);
+
+      number->number = json_parse_copy_span(state, offset, tape_end);
+      number->number_size = tape_end - offset;
+
+      value->type = json_type_number;
+      value->payload = number;
+    }
+
+    state->offset = tape_end;
+  } else if (is_global_object) {
+    value->type = json_type_object;
+    value->payload = state->dom;
+    state->dom += sizeof(struct json_object_s);
+    json_parse_object(state, /* is_global_object = */ 1,
+                      (struct json_object_s *)value->payload);
+  } else {
+    switch (src[offset]) {
+    case '"':
+    case '\'':
+      value->type = json_type_string;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_string_s);
+      json_parse_string(state, (struct json_string_s *)value->payload);
+      break;
+    case '{':
+      value->type = json_type_object;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_object_s);
+      json_parse_object(state, /* is_global_object = */ 0,
+                        (struct json_object_s *)value->payload);
+      break;
+    case '[':
+      value->type = json_type_array;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_array_s);
+      json_parse_array(state, (struct json_array_s *)value->payload);
+      break;
+    case '-':
+    case '+':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+    case '.':
+      value->type = json_type_number;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_number_s);
+      json_parse_number(state, (struct json_number_s *)value->payload);
+      break;
+    default:
+      if ((offset + 4) <= size && 't' == src[offset + 0] &&
+          'r' == src[offset + 1] && 'u' == src[offset + 2] &&
+          'e' == src[offset + 3]) {
+        value->type = json_type_true;
+        value->payload = json_null;
+        state->offset += 4;
+      } else if ((offset + 5) <= size && 'f' == src[offset + 0] &&
+                 'a' == src[offset + 1] && 'l' == src[offset + 2] &&
+                 's' == src[offset + 3] && 'e' == src[offset + 4]) {
+        value->type = json_type_false;
+        value->payload = json_null;
+        state->offset += 5;
+      } else if ((offset + 4) <= size && 'n' == src[offset + 0] &&
+                 'u' == src[offset + 1] && 'l' == src[offset + 2] &&
+                 'l' == src[offset + 3]) {
+        value->type = json_type_null;
+        value->payload = json_null;
+        state->offset += 4;
+      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
+                 (offset + 3) <= size && 'N' == src[offset + 0] &&
+                 'a' == src[offset + 1] && 'N' == src[offset + 2]) {
+        value->type = json_type_number;
+        value->payload = state->dom;
+        state->dom += sizeof(struct json_number_s);
+        json_parse_number(state, (struct json_number_s *)value->payload);
+      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
+                 (offset + 8) <= size && 'I' == src[offset + 0] &&
+                 'n' == src[offset + 1] && 'f' == src[offset + 2] &&
+                 'i' == src[offset + 3] && 'n' == src[offset + 4] &&
+                 'i' == src[offset + 5] && 't' == src[offset + 6] &&
+                 'y' == src[offset + 7]) {
+        value->type = json_type_number;
+        value->payload = state->dom;
+        state->dom += sizeof(struct json_number_s);
+        json_parse_number(state, (struct json_number_s *)value->payload);
+      }
+      break;
+    }
+  }
+}
+
+json_weak int json_get_root_size(struct json_parse_state_s *state,
+                                 const void *src, size_t src_size,
+                                 size_t flags_bitset, json_uint32_t *tape,
+                                 size_t tape_capacity,
+                                 struct json_parse_result_s *result);
+int json_get_root_size(struct json_parse_state_s *state, const void *src,
+                       size_t src_size, size_t flags_bitset,
+                       json_uint32_t *tape, size_t tape_capacity,
+                       struct json_parse_result_s *result) {
+  int input_error;
+
+  state->src = (const char *)src;
+  state->size = src_size;
+  state->offset = 0;
+  state->line_no = 1;
+  state->line_offset = 0;
+  state->error = json_parse_error_none;
+  state->dom_size = 0;
+  state->data_size = 0;
+  state->flags_bitset = flags_bitset;
+  state->recursion = 0;
+  state->tape = tape;
+  state->tape_capacity = tape_capacity;
+  state->tape_size = 0;
+  state->tape_offset = 0;
+
+  if (json_parse_flags_allow_location_information & flags_bitset) {
+    /* jumping between tokens would skip the newlines we need to count. */
+    state->tape_capacity = 0;
+  }
+
+  if (0 != ((src_size >> 16) >> 16)) {
+    /* the tape only holds 32-bit offsets. */
+    state->tape_capacity = 0;
+  }
+
+  input_error = json_get_value_size(
+      state, (int)(json_parse_flags_allow_global_object & state->flags_bitset));
+
+  if (0 == input_error) {
+    json_skip_all_skippables(state);
+
+    if (state->offset != state->size) {
+      /* our parsing didn't have an error, but there are characters remaining in
+       * the input that weren't part of the JSON! */
+
+      state->error = json_parse_error_unexpected_trailing_characters;
+      input_error = 1;
+    }
+  }
+
+  if (input_error) {
+    if (result) {
+      result->error = state->error;
+      result->error_offset = state->offset;
+      result->error_line_no = state->line_no;
+      result->error_row_no = state->offset - state->line_offset;
+    }
+    return 1;
+  }
+
+  return 0;
+}
+
+int json_parse_size(const void *src, size_t src_size, size_t flags_bitset,
+                    size_t *dom_size, size_t *data_size,
+                    struct json_parse_size_state_s *state_out,
+                    struct json_parse_result_s *result) {
+  return json_parse_size_ex(src, src_size, flags_bitset, json_null, 0,
+                            dom_size, data_size, state_out, result);
+}
+
+int json_parse_size_ex(const void *src, size_t src_size, size_t flags_bitset,
+                       json_uint32_t *tape, size_t tape_capacity,
+                       size_t *dom_size, size_t *data_size,
+                       struct json_parse_size_state_s *state_out,
+                       struct json_parse_result_s *result) {
+  struct json_parse_state_s state;
+
+  if (result) {
+    result->error = json_parse_error_none;
+    result->error_offset = 0;
+    result->error_line_no = 0;
+    result->error_row_no = 0;
+  }
+
+  if (json_null == src) {
+    /* invalid src pointer was null! */
+    return 1;
+  }
+
+  if (json_get_root_size(&state, src, src_size, flags_bitset, tape,
+                         tape_capacity, result)) {
+    /* parsing value's size failed (most likely an invalid JSON DOM!). */
+    return 1;
+  }
+
+  if (dom_size) {
+    *dom_size = state.dom_size;
+  }
+
+  if (data_size) {
+    *data_size = state.data_size;
+  }
+
+  if (state_out) {
+    state_out->src = src;
+    state_out->src_size = src_size;
+    state_out->flags_bitset = flags_bitset;
+    state_out->dom_size = state.dom_size;
+    state_out->data_size = state.data_size;
+    state_out->tape = tape;
+    state_out->tape_size = state.tape_size;
+  }
+
+  return 0;
+}
+
+struct json_value_s *
+json_parse_into(void *buffer, size_t buffer_size,
+                const struct json_parse_size_state_s *state_in) {
+  struct json_parse_state_s state;
+  struct json_value_s *value;
+
+  if ((json_null == buffer) || (json_null == state_in)) {
+    return json_null;
+  }
+
+  if (buffer_size < state_in->dom_size + state_in->data_size) {
+    /* the buffer is too small to hold the DOM! */
+    return json_null;
+  }
+
+  state.src = (const char *)state_in->src;
+  state.size = state_in->src_size;
+  state.offset = 0;
+  state.flags_bitset = state_in->flags_bitset;
+  state.line_no = 1;
+  state.line_offset = 0;
+  state.error = json_parse_error_none;
+  state.recursion = 0;
+  state.dom_size = state_in->dom_size;
+  state.data_size = state_in->data_size;
+  state.tape = state_in->tape;
+  state.tape_capacity = state_in->tape_size;
+  state.tape_size = state_in->tape_size;
+  state.tape_offset = 0;
+
+  /* we first encode the structure of the JSON, and then the data referenced by
+   * the JSON values. */
+  state.dom = (char *)buffer;
+  state.data = state.dom + state.dom_size;
+
+  if (json_parse_flags_allow_location_information & state.flags_bitset) {
+    struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state.dom;
+    state.dom += sizeof(struct json_value_ex_s);
+
+    value_ex->offset = state.offset;
+    value_ex->line_no = state.line_no;
+    value_ex->row_no = state.offset - state.line_offset;
+
+    value = &(value_ex->value);
+  } else {
+    value = (struct json_value_s *)state.dom;
+    state.dom += sizeof(struct json_value_s);
+  }
+
+  json_parse_value(
+      &state, (int)(json_parse_flags_allow_global_object & state.flags_bitset),
+      value);
+
+  return (struct json_value_s *)buffer;
+}
+
+struct json_value_s *
+json_parse_ex(const void *src, size_t src_size, size_t flags_bitset,
+              void *(*alloc_func_ptr)(void *user_data, size_t size),
+              void *user_data, struct json_parse_result_s *result) {
+  struct json_parse_size_state_s size_state;
+  void *allocation;
+  size_t total_size;
+
+  if (json_parse_size(src, src_size, flags_bitset, json_null, json_null,
+                      &size_state, result)) {
+    return json_null;
+  }
+
+  /* our total allocation is the combination of the dom and data sizes (we. */
+  /* first encode the structure of the JSON, and then the data referenced by. */
+  /* the JSON values). */
+  total_size = size_state.dom_size + size_state.data_size;
+
+  if (json_null == alloc_func_ptr) {
+    allocation = malloc(total_size);
+  } else {
+    allocation = alloc_func_ptr(user_data, total_size);
+  }
+
+  if (json_null == allocation) {
+    /* malloc failed! */
+    if (result) {
+      result->error = json_parse_error_allocator_failed;
+      result->error_offset = 0;
+      result->error_line_no = 0;
+      result->error_row_no = 0;
+    }
+
+    return json_null;
+  }
+
+  return json_parse_into(allocation, total_size, &size_state);
+}
+
+struct json_value_s *json_parse(const void *src, size_t src_size) {
+  return json_parse_ex(src, src_size, json_parse_flags_default, json_null,
+                       json_null, json_null);
+}
+
+struct json_selective_s {
+  const char *const *paths;
+  struct json_value_s **matches;
+  size_t paths_size;
+};
+
+json_weak int json_pointer_is_valid(const char *path);
+int json_pointer_is_valid(const char *path) {
+  /* the empty pointer refers to the whole document. */
+  if ('\0' == *path) {
+    return 1;
+  }
+
+  if ('/' != *path) {
+    return 0;
+  }
+
+  for (; '\0' != *path; path++) {
+    /* '~' is only valid as part of the '~0' and '~1' escape sequences. */
+    if ('~' == path[0] && '0' != path[1] && '1' != path[1]) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+json_weak size_t json_pointer_token_count(const char *path);
+size_t json_pointer_token_count(const char *path) {
+  size_t count = 0;
+
+  for (; '\0' != *path; path++) {
+    if ('/' == *path) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+json_weak void json_pointer_token(const char *path, size_t depth,
+                                  const char **token, size_t *token_size);
+void json_pointer_token(const char *path, size_t depth, const char **token,
+                        size_t *token_size) {
+  size_t size = 0;
+
+  /* skip to the '/' that begins the token we want. */
+  for (;; path++) {
+    if ('/' == *path) {
+      if (0 == depth) {
+        break;
+      }
+
+      depth--;
+    }
+  }
+
+  /* skip the leading '/'. */
+  path++;
+
+  while (('\0' != path[size]) && ('/' != path[size])) {
+    size++;
+  }
+
+  *token = path;
+  *token_size = size;
+}
+
+json_weak int json_pointer_token_equals(const char *token, size_t token_size,
+                                        const char *string,
+                                        size_t string_size);
+int json_pointer_token_equals(const char *token, size_t token_size,
+                              const char *string, size_t string_size) {
+  size_t i = 0;
+  size_t k = 0;
+
+  while ((i < token_size) && (k < string_size)) {
+    char c = token[i++];
+
+    if ('~' == c) {
+      /* '~0' is an escaped '~', and '~1' is an escaped '/'. */
+      c = ('0' == token[i++]) ? '~' : '/';
+    }
+
+    if (c != string[k++]) {
+      return 0;
+    }
+  }
+
+  return (i == token_size) && (k == string_size);
+}
+
+json_weak int json_pointer_token_index(const char *token, size_t token_size,
+                                       size_t *index);
+int json_pointer_token_index(const char *token, size_t token_size,
+                             size_t *index) {
+  size_t i;
+
+  /* an array index is either a single '0', or digits without a leading '0'. */
+  if ((0 == token_size) || (('0' == token[0]) && (1 < token_size))) {
+    return 0;
+  }
+
+  *index = 0;
+
+  for (i = 0; i < token_size; i++) {
+    const size_t previous = *index;
+
+    if (!('0' <= token[i] && token[i] <= '9')) {
+      return 0;
+    }
+
+    *index = (*index * 10) + (size_t)(token[i] - '0');
+
+    if (*index / 10 != previous) {
+      /* the index overflowed so it can't refer to any element. */
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+json_weak int json_selective_key_equals(const struct json_parse_state_s *state,
+                                        const char *token, size_t token_size);
+int json_selective_key_equals(const struct json_parse_state_s *state,
+                              const char *token, size_t token_size) {
+  const char *const src = state->src;
+  size_t offset = state->offset;
+  size_t i = 0;
+  char quote_to_use;
+
+  if (('"' != src[offset]) && ('\'' != src[offset])) {
+    /* an unquoted key has no escape sequences to decode. */
+    while (is_valid_unquoted_key_char(src[offset])) {
+      char c;
+
+      if (i == token_size) {
+        return 0;
+      }
+
+      c = token[i++];
+
+      if ('~' == c) {
+        c = ('0' == token[i++]) ? '~' : '/';
+      }
+
+      if (c != src[offset++]) {
+        return 0;
+      }
+    }
+
+    return i == token_size;
+  }
+
+  quote_to_use = src[offset];
+
+  /* skip leading '"' or '\''. */
+  offset++;
+
+  while (quote_to_use != src[offset]) {
+    char data[4];
+    size_t bytes_written = 0;
+    size_t k;
+
+    if ('\\' == src[offset]) {
+      /* skip the reverse solidus. */
+      offset++;
+
+      switch (src[offset++]) {
+      default:
+        data[bytes_written++] = src[offset - 1];
+        break;
+      case 'b':
+        data[bytes_written++] = '\b';
+        break;
+      case 'f':
+        data[bytes_written++] = '\f';
+        break;
+      case 'n':
+        data[bytes_written++] = '\n';
+        break;
+      case 'r':
+        data[bytes_written++] = '\r';
+        break;
+      case 't':
+        data[bytes_written++] = '\t';
+        break;
+      case 'u': {
+        unsigned long codepoint = 0;
+        unsigned long low_surrogate = 0;
+
+        (void)json_hexadecimal_value(&src[offset], 4, &codepoint);
+        offset += 4;
+
+        if (codepoint >= 0xd800 && codepoint <= 0xdbff) {
+          /* the input was validated, so the low half follows as \uxxxx. */
+          (void)json_hexadecimal_value(&src[offset + 2], 4, &low_surrogate);
+          offset += 6;
+
+          codepoint = 0x10000u + ((codepoint - 0xd800u) << 10) +
+                      (low_surrogate - 0xdc00u);
+        }
+
+        if (codepoint <= 0x7fu) {
+          data[bytes_written++] = (char)codepoint; /* 0xxxxxxx. */
+        } else if (codepoint <= 0x7ffu) {
+          data[bytes_written++] =
+              (char)(0xc0u | (codepoint >> 6)); /* 110xxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        } else if (codepoint <= 0xffffu) {
+          data[bytes_written++] =
+              (char)(0xe0u | (codepoint >> 12)); /* 1110xxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        } else {
+          data[bytes_written++] =
+              (char)(0xf0u | (codepoint >> 18)); /* 11110xxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 12) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
+          data[bytes_written++] =
+              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        }
+      } break;
+      }
+    } else {
+      data[bytes_written++] = src[offset++];
+    }
+
+    for (k = 0; k < bytes_written; k++) {
+      char c;
+
+      if (i == token_size) {
+        return 0;
+      }
+
+      c = token[i++];
+
+      if ('~' == c) {
+        c = ('0' == token[i++]) ? '~' : '/';
+      }
+
+      if (c != data[k]) {
+        return 0;
+      }
+    }
+  }
+
+  return i == token_size;
+}
+
+json_weak int json_selective_is_full(const struct json_selective_s *selective,
+                                     json_uintmax_t alive, size_t depth);
+int json_selective_is_full(const struct json_selective_s *selective,
+                           json_uintmax_t alive, size_t depth) {
+  size_t i;
+
+  for (i = 0; i < selective->paths_size; i++) {
+    if ((alive & ((json_uintmax_t)1 << i)) &&
+        (depth == json_pointer_token_count(selective->paths[i]))) {
+      /* a path ends at this value, so we need all of it. */
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+json_weak json_uintmax_t
+json_selective_key_mask(const struct json_parse_state_s *state,
+                        const struct json_selective_s *selective,
+                        json_uintmax_t alive, size_t depth);
+json_uintmax_t json_selective_key_mask(const struct json_parse_state_s *state,
+                                       const struct json_selective_s *selective,
+                                       json_uintmax_t alive, size_t depth) {
+  json_uintmax_t mask = 0;
+  size_t i;
+
+  for (i = 0; i < selective->paths_size; i++) {
+    const json_uintmax_t bit = (json_uintmax_t)1 << i;
+    const char *token;
+    size_t token_size;
+
+    if (0 == (alive & bit)) {
+      continue;
+    }
+
+    json_pointer_token(selective->paths[i], depth, &token, &token_size);
+
+    if (json_selective_key_equals(state, token, token_size)) {
+      mask |= bit;
+    }
+  }
+
+  return mask;
+}
+
+json_weak json_uintmax_t
+json_selective_index_mask(const struct json_selective_s *selective,
+                          json_uintmax_t alive, size_t depth, size_t index);
+json_uintmax_t
+json_selective_index_mask(const struct json_selective_s *selective,
+                          json_uintmax_t alive, size_t depth, size_t index) {
+  json_uintmax_t mask = 0;
+  size_t i;
+
+  for (i = 0; i < selective->paths_size; i++) {
+    const json_uintmax_t bit = (json_uintmax_t)1 << i;
+    const char *token;
+    size_t token_size;
+    size_t token_index;
+
+    if (0 == (alive & bit)) {
+      continue;
+    }
+
+    json_pointer_token(selective->paths[i], depth, &token, &token_size);
+
+    if (json_pointer_token_index(token, token_size, &token_index) &&
+        (token_index == index)) {
+      mask |= bit;
+    }
+  }
+
+  return mask;
+}
+
+json_weak int json_selective_is_selected(
+    const struct json_parse_state_s *state,
+    const struct json_selective_s *selective, json_uintmax_t mask,
+    size_t depth);
+int json_selective_is_selected(const struct json_parse_state_s *state,
+                               const struct json_selective_s *selective,
+                               json_uintmax_t mask, size_t depth) {
+  if (0 == mask) {
+    return 0;
+  }
+
+  if (json_selective_is_full(selective, mask, depth)) {
+    return 1;
+  }
+
+  /* the paths continue past this value, which only makes sense if it can
+   * contain other values. */
+  return ('{' == state->src[state->offset]) ||
+         ('[' == state->src[state->offset]);
+}
+
+json_weak void json_selective_skip_key(struct json_parse_state_s *state);
+void json_selective_skip_key(struct json_parse_state_s *state) {
+  const char *const src = state->src;
+
+  if (('"' == src[state->offset]) || ('\'' == src[state->offset])) {
+    (void)json_skip_raw_string(state);
+  } else {
+    while (is_valid_unquoted_key_char(src[state->offset])) {
+      state->offset++;
+    }
+  }
+}
+
+json_weak int json_selective_skip_value(struct json_parse_state_s *state);
+int json_selective_skip_value(struct json_parse_state_s *state) {
+  /* values that aren't wanted are only checked for structure as they are
+   * skipped, so that the time taken depends on what was asked for. */
+  if (json_skip_raw_value(state)) {
+    state->error = (state->offset >= state->size)
+                       ? json_parse_error_premature_end_of_buffer
+                       : json_parse_error_invalid_value;
+    return 1;
+  }
+
+  return 0;
+}
+
+json_weak int
+json_selective_get_value_size(struct json_parse_state_s *state,
+                              const struct json_selective_s *selective,
+                              json_uintmax_t alive, size_t depth,
+                              int is_global_object);
+
+json_weak int
+json_selective_get_object_size(struct json_parse_state_s *state,
+                               const struct json_selective_s *selective,
+                               json_uintmax_t alive, size_t depth,
+                               int is_global_object);
+int json_selective_get_object_size(struct json_parse_state_s *state,
+                                   const struct json_selective_s *selective,
+                                   json_uintmax_t alive, size_t depth,
+                                   int is_global_object) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  int allow_comma = 0;
+  int found_closing_brace = 0;
+
+  if (++state->recursion > JSON_MAX_RECURSION) {
+    /* recursion error */
+    state->error = json_parse_error_recursion;
+    return 1;
+  }
+
+  if (is_global_object) {
+    if (!json_skip_all_skippables(state) && ('{' == src[state->offset])) {
+      /* we don't actually have a global object after all! */
+      is_global_object = 0;
+    }
+  }
+
+  if (!is_global_object) {
+    if ('{' != src[state->offset]) {
+      state->error = json_parse_error_unknown;
+      --state->recursion;
+      return 1;
+    }
+
+    /* skip leading '{'. */
+    state->offset++;
+  }
+
+  state->dom_size += sizeof(struct json_object_s);
+
+  if ((state->offset == size) && !is_global_object) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    --state->recursion;
+    return 1;
+  }
+
+  do {
+    json_uintmax_t mask;
+    size_t key_offset, value_offset, dom_size, data_size;
+
+    if (!is_global_object) {
+      if (json_skip_all_skippables(state)) {
+        state->error = json_parse_error_premature_end_of_buffer;
+        --state->recursion;
+        return 1;
+      }
+
+      if ('}' == src[state->offset]) {
+        /* skip trailing '}'. */
+        state->offset++;
+
+        found_closing_brace = 1;
+
+        /* finished the object! */
+        break;
+      }
+    } else {
+      if (json_skip_all_skippables(state)) {
+        /* global object ends when the file ends! */
+        break;
+      }
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+      } else if (json_parse_flags_allow_no_commas & flags_bitset) {
+        /* we don't require a comma, and we didn't find one, which is ok! */
+        allow_comma = 0;
+      } else {
+        /* otherwise we are required to have a comma, and we found none. */
+        state->error = json_parse_error_expected_comma_or_closing_bracket;
+        --state->recursion;
+        return 1;
+      }
+
+      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
+        continue;
+      } else {
+        if (json_skip_all_skippables(state)) {
+          state->error = json_parse_error_premature_end_of_buffer;
+          --state->recursion;
+          return 1;
+        }
+      }
+    }
+
+    key_offset = state->offset;
+    dom_size = state->dom_size;
+    data_size = state->data_size;
+
+    if (json_get_key_size(state)) {
+      /* key parsing failed! */
+      state->error = json_parse_error_invalid_string;
+      --state->recursion;
+      return 1;
+    }
+
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    if ((':' != src[state->offset]) &&
+        (!(json_parse_flags_allow_equals_in_object & flags_bitset) ||
+         ('=' != src[state->offset]))) {
+      state->error = json_parse_error_expected_colon;
+      --state->recursion;
+      return 1;
+    }
+
+    /* skip colon or equals. */
+    state->offset++;
+
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    /* now that we know the key is valid, see which paths it is on. */
+    value_offset = state->offset;
+    state->offset = key_offset;
+    mask = json_selective_key_mask(state, selective, alive, depth);
+    state->offset = value_offset;
+
+    if (json_selective_is_selected(state, selective, mask, depth + 1)) {
+      if (json_selective_get_value_size(state, selective, mask, depth + 1,
+                                        /* is_global_object = */ 0)) {
+        --state->recursion;
+        return 1;
+      }
+
+      elements++;
+    } else {
+      /* the key isn't kept after all. */
+      state->dom_size = dom_size;
+      state->data_size = data_size;
+
+      if (json_selective_skip_value(state)) {
+        --state->recursion;
+        return 1;
+      }
+    }
+
+    allow_comma = 1;
+  } while (state->offset < size);
+
+  if ((state->offset == size) && !is_global_object && !found_closing_brace) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    --state->recursion;
+    return 1;
+  }
+
+  state->dom_size += sizeof(struct json_object_element_s) * elements;
+  --state->recursion;
+
+  return 0;
+}
+
+json_weak int
+json_selective_get_array_size(struct json_parse_state_s *state,
+                              const struct json_selective_s *selective,
+                              json_uintmax_t alive, size_t depth);
+int json_selective_get_array_size(struct json_parse_state_s *state,
+                                  const struct json_selective_s *selective,
+                                  json_uintmax_t alive, size_t depth) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  size_t index = 0;
+  int allow_comma = 0;
+
+  if (++state->recursion > JSON_MAX_RECURSION) {
+    /* recursion error */
+    state->error = json_parse_error_recursion;
+    return 1;
+  }
+
+  /* skip leading '['. */
+  state->offset++;
+
+  state->dom_size += sizeof(struct json_array_s);
+
+  while (state->offset < size) {
+    json_uintmax_t mask;
+
+    if (json_skip_all_skippables(state)) {
+      state->error = json_parse_error_premature_end_of_buffer;
+      --state->recursion;
+      return 1;
+    }
+
+    if (']' == src[state->offset]) {
+      /* skip trailing ']'. */
+      state->offset++;
+
+      state->dom_size += sizeof(struct json_array_element_s) * elements;
+
+      /* finished the array! */
+      --state->recursion;
+      return 0;
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+      } else if (!(json_parse_flags_allow_no_commas & flags_bitset)) {
+        state->error = json_parse_error_expected_comma_or_closing_bracket;
+        --state->recursion;
+        return 1;
+      }
+
+      if (json_parse_flags_allow_trailing_comma & flags_bitset) {
+        allow_comma = 0;
+        continue;
+      } else {
+        if (json_skip_all_skippables(state)) {
+          state->error = json_parse_error_premature_end_of_buffer;
+          --state->recursion;
+          return 1;
+        }
+      }
+    }
+
+    mask = json_selective_index_mask(selective, alive, depth, index++);
+
+    if (json_selective_is_selected(state, selective, mask, depth + 1)) {
+      if (json_selective_get_value_size(state, selective, mask, depth + 1,
+                                        /* is_global_object = */ 0)) {
+        --state->recursion;
+        return 1;
+      }
+
+      elements++;
+    } else if (json_selective_skip_value(state)) {
+      --state->recursion;
+      return 1;
+    }
+
+    allow_comma = 1;
+  }
+
+  /* we consumed the entire input before finding the closing ']' of the array!
+   */
+  state->error = json_parse_error_premature_end_of_buffer;
+  --state->recursion;
+  return 1;
+}
+
+int json_selective_get_value_size(struct json_parse_state_s *state,
+                                  const struct json_selective_s *selective,
+                                  json_uintmax_t alive, size_t depth,
+                                  int is_global_object) {
+  const char *const src = state->src;
+
+  if (json_skip_all_skippables(state) && !is_global_object) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    return 1;
+  }
+
+  if (!json_selective_is_full(selective, alive, depth)) {
+    if (is_global_object || ('{' == src[state->offset])) {
+      if (json_parse_flags_allow_location_information & state->flags_bitset) {
+        state->dom_size += sizeof(struct json_value_ex_s);
+      } else {
+        state->dom_size += sizeof(struct json_value_s);
+      }
+
+      return json_selective_get_object_size(state, selective, alive, depth,
+                                            is_global_object);
+    } else if ('[' == src[state->offset]) {
+      if (json_parse_flags_allow_location_information & state->flags_bitset) {
+        state->dom_size += sizeof(struct json_value_ex_s);
+      } else {
+        state->dom_size += sizeof(struct json_value_s);
+      }
+
+      return json_selective_get_array_size(state, selective, alive, depth);
+    }
+  }
+
+  /* the value is needed in full (a scalar root value is always kept too). */
+  return json_get_value_size(state, is_global_object);
+}
+
+json_weak struct json_value_s *
+json_selective_resolve(struct json_value_s *value, const char *path,
+                       size_t depth);
+struct json_value_s *json_selective_resolve(struct json_value_s *value,
+                                            const char *path, size_t depth) {
+  const size_t token_count = json_pointer_token_count(path);
+
+  for (; depth < token_count; depth++) {
+    const char *token;
+    size_t token_size;
+
+    json_pointer_token(path, depth, &token, &token_size);
+
+    if (json_type_object == value->type) {
+      const struct json_object_element_s *element =
+          ((struct json_object_s *)value->payload)->start;
+
+      while ((json_null != element) &&
+             !json_pointer_token_equals(token, token_size,
+                                        element->name->string,
+                                        element->name->string_size)) {
+        element = element->next;
+      }
+
+      if (json_null == element) {
+        return json_null;
+      }
+
+      value = element->value;
+    } else if (json_type_array == value->type) {
+      const struct json_array_element_s *element =
+          ((struct json_array_s *)value->payload)->start;
+      size_t index;
+
+      if (!json_pointer_token_index(token, token_size, &index)) {
+        return json_null;
+      }
+
+      while ((json_null != element) && (0 != index)) {
+        element = element->next;
+        index--;
+      }
+
+      if (json_null == element) {
+        return json_null;
+      }
+
+      value = element->value;
+    } else {
+      return json_null;
+    }
+  }
+
+  return value;
+}
+
+json_weak void json_selective_set_matches(
+    const struct json_selective_s *selective, json_uintmax_t alive,
+    size_t depth, struct json_value_s *value);
+void json_selective_set_matches(const struct json_selective_s *selective,
+                                json_uintmax_t alive, size_t depth,
+                                struct json_value_s *value) {
+  size_t i;
+
+  if (json_null == selective->matches) {
+    return;
+  }
+
+  for (i = 0; i < selective->paths_size; i++) {
+    if (alive & ((json_uintmax_t)1 << i)) {
+      /* paths that end deeper than this value were built along with it, so
+       * look them up in the DOM we just parsed. */
+      selective->matches[i] =
+          json_selective_resolve(value, selective->paths[i], depth);
+    }
+  }
+}
+
+json_weak void json_selective_parse_value(
+    struct json_parse_state_s *state, const struct json_selective_s *selective,
+    json_uintmax_t alive, size_t depth, int is_global_object,
+    struct json_value_s *value);
+
+json_weak void json_selective_parse_object(
+    struct json_parse_state_s *state, const struct json_selective_s *selective,
+    json_uintmax_t alive, size_t depth, int is_global_object,
+    struct json_object_s *object);
+void json_selective_parse_object(struct json_parse_state_s *state,
+                                 const struct json_selective_s *selective,
+                                 json_uintmax_t alive, size_t depth,
+                                 int is_global_object,
+                                 struct json_object_s *object) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  int allow_comma = 0;
+  struct json_object_element_s *previous = json_null;
+
+  if (is_global_object && (state->offset < size) &&
+      ('{' == src[state->offset])) {
+    /* we don't actually have a global object after all! */
+    is_global_object = 0;
+  }
+
+  if (!is_global_object) {
+    /* skip leading '{'. */
+    state->offset++;
+  }
+
+  object->start = json_null;
+
+  while (state->offset < size) {
+    struct json_object_element_s *element = json_null;
+    struct json_string_s *string = json_null;
+    struct json_value_s *value = json_null;
+    json_uintmax_t mask;
+    size_t key_offset, key_line_no, key_line_offset, value_offset;
+
+    if (!is_global_object) {
+      (void)json_skip_all_skippables(state);
+
+      if ('}' == src[state->offset]) {
+        /* skip trailing '}'. */
+        state->offset++;
+
+        /* finished the object! */
+        break;
+      }
+    } else {
+      if (json_skip_all_skippables(state)) {
+        /* global object ends when the file ends! */
+        break;
+      }
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+        continue;
+      }
+    }
+
+    key_offset = state->offset;
+    key_line_no = state->line_no;
+    key_line_offset = state->line_offset;
+    mask = json_selective_key_mask(state, selective, alive, depth);
+    json_selective_skip_key(state);
+
+    (void)json_skip_all_skippables(state);
+
+    /* skip colon or equals. */
+    state->offset++;
+
+    (void)json_skip_all_skippables(state);
+
+    allow_comma = 1;
+
+    if (!json_selective_is_selected(state, selective, mask, depth + 1)) {
+      (void)json_skip_raw_value(state);
+      continue;
+    }
+
+    element = (struct json_object_element_s *)state->dom;
+
+    state->dom += sizeof(struct json_object_element_s);
+
+    if (json_null == previous) {
+      /* this is our first element, so record it in our object. */
+      object->start = element;
+    } else {
+      previous->next = element;
+    }
+
+    previous = element;
+
+    if (json_parse_flags_allow_location_information & flags_bitset) {
+      struct json_string_ex_s *string_ex =
+          (struct json_string_ex_s *)state->dom;
+      state->dom += sizeof(struct json_string_ex_s);
+
+      string_ex->offset = key_offset;
+      string_ex->line_no = key_line_no;
+      string_ex->row_no = key_offset - key_line_offset;
+
+      string = &(string_ex->string);
+    } else {
+      string = (struct json_string_s *)state->dom;
+      state->dom += sizeof(struct json_string_s);
+    }
+
+    element->name = string;
+
+    /* go back and parse the key now we know we need it. */
+    value_offset = state->offset;
+    state->offset = key_offset;
+    json_parse_key(state, string);
+    state->offset = value_offset;
+
+    if (json_parse_flags_allow_location_information & flags_bitset) {
+      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
+      state->dom += sizeof(struct json_value_ex_s);
+
+      value_ex->offset = state->offset;
+      value_ex->line_no = state->line_no;
+      value_ex->row_no = state->offset - state->line_offset;
+
+      value = &(value_ex->value);
+    } else {
+      value = (struct json_value_s *)state->dom;
+      state->dom += sizeof(struct json_value_s);
+    }
+
+    element->value = value;
+
+    json_selective_parse_value(state, selective, mask, depth + 1,
+                               /* is_global_object = */ 0, value);
+
+    /* successfully parsed a name/value pair! */
+    elements++;
+  }
+
+  /* if we had at least one element, end the linked list. */
+  if (previous) {
+    previous->next = json_null;
+  }
+
+  object->length = elements;
+}
+
+json_weak void json_selective_parse_array(
+    struct json_parse_state_s *state, const struct json_selective_s *selective,
+    json_uintmax_t alive, size_t depth, struct json_array_s *array);
+void json_selective_parse_array(struct json_parse_state_s *state,
+                                const struct json_selective_s *selective,
+                                json_uintmax_t alive, size_t depth,
+                                struct json_array_s *array) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+  size_t elements = 0;
+  size_t index = 0;
+  int allow_comma = 0;
+  struct json_array_element_s *previous = json_null;
+
+  /* skip leading '['. */
+  state->offset++;
+
+  array->start = json_null;
+
+  do {
+    struct json_array_element_s *element = json_null;
+    struct json_value_s *value = json_null;
+    json_uintmax_t mask;
+
+    (void)json_skip_all_skippables(state);
+
+    if (']' == src[state->offset]) {
+      /* skip trailing ']'. */
+      state->offset++;
+
+      /* finished the array! */
+      break;
+    }
+
+    /* if we parsed at least one element previously, grok for a comma. */
+    if (allow_comma) {
+      if (',' == src[state->offset]) {
+        /* skip comma. */
+        state->offset++;
+        allow_comma = 0;
+        continue;
+      }
+    }
+
+    allow_comma = 1;
+
+    mask = json_selective_index_mask(selective, alive, depth, index++);
+
+    if (!json_selective_is_selected(state, selective, mask, depth + 1)) {
+      (void)json_skip_raw_value(state);
+      continue;
+    }
+
+    element = (struct json_array_element_s *)state->dom;
+
+    state->dom += sizeof(struct json_array_element_s);
+
+    if (json_null == previous) {
+      /* this is our first element, so record it in our array. */
+      array->start = element;
+    } else {
+      previous->next = element;
+    }
+
+    previous = element;
+
+    if (json_parse_flags_allow_location_information & state->flags_bitset) {
+      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
+      state->dom += sizeof(struct json_value_ex_s);
+
+      value_ex->offset = state->offset;
+      value_ex->line_no = state->line_no;
+      value_ex->row_no = state->offset - state->line_offset;
+
+      value = &(value_ex->value);
+    } else {
+      value = (struct json_value_s *)state->dom;
+      state->dom += sizeof(struct json_value_s);
+    }
+
+    element->value = value;
+
+    json_selective_parse_value(state, selective, mask, depth + 1,
+                               /* is_global_object = */ 0, value);
+
+    /* successfully parsed an array element! */
+    elements++;
+  } while (state->offset < size);
+
+  /* end the linked list. */
+  if (previous) {
+    previous->next = json_null;
+  }
+
+  array->length = elements;
+}
+
+void json_selective_parse_value(struct json_parse_state_s *state,
+                                const struct json_selective_s *selective,
+                                json_uintmax_t alive, size_t depth,
+                                int is_global_object,
+                                struct json_value_s *value) {
+  const char *const src = state->src;
+
+  (void)json_skip_all_skippables(state);
+
+  if (!json_selective_is_full(selective, alive, depth)) {
+    if (is_global_object || ('{' == src[state->offset])) {
+      value->type = json_type_object;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_object_s);
+      json_selective_parse_object(state, selective, alive, depth,
+                                  is_global_object,
+                                  (struct json_object_s *)value->payload);
+      return;
+    } else if ('[' == src[state->offset]) {
+      value->type = json_type_array;
+      value->payload = state->dom;
+      state->dom += sizeof(struct json_array_s);
+      json_selective_parse_array(state, selective, alive, depth,
+                                 (struct json_array_s *)value->payload);
+      return;
+    }
+  }
+
+  /* the value is needed in full (a scalar root value is always kept too). */
+  json_parse_value(state, is_global_object, value);
+  json_selective_set_matches(selective, alive, depth, value);
+}
+
+struct json_value_s *json_parse_selective_ex(
+    const void *src, size_t src_size, const char *const *paths,
+    size_t paths_size, struct json_value_s **matches, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *user_data, size_t size), void *user_data,
+    struct json_parse_result_s *result) {
+  struct json_parse_state_s state;
+  struct json_selective_s selective;
+  json_uintmax_t alive;
+  void *allocation;
+  struct json_value_s *value;
+  const int is_global_object =
+      (int)(json_parse_flags_allow_global_object & flags_bitset);
+  int input_error;
+  size_t i;
+
+  if (result) {
+    result->error = json_parse_error_none;
+    result->error_offset = 0;
+    result->error_line_no = 0;
+    result->error_row_no = 0;
+  }
+
+  if (json_null != matches) {
+    for (i = 0; i < paths_size; i++) {
+      matches[i] = json_null;
+    }
+  }
+
+  if (json_null == src) {
+    /* invalid src pointer was null! */
+    return json_null;
+  }
+
+  /* each path gets one bit in the masks we use to track which paths are still
+   * being matched against. */
+  if (paths_size > sizeof(json_uintmax_t) * 8) {
+    if (result) {
+      result->error = json_parse_error_invalid_pointer;
+    }
+
+    return json_null;
+  }
+
+  for (i = 0; i < paths_size; i++) {
+    if ((json_null == paths[i]) || !json_pointer_is_valid(paths[i])) {
+      if (result) {
+        result->error = json_parse_error_invalid_pointer;
+      }
+
+      return json_null;
+    }
+  }
+
+  selective.paths = paths;
+  selective.matches = matches;
+  selective.paths_size = paths_size;
+
+  if (paths_size == sizeof(json_uintmax_t) * 8) {
+    alive = ~(json_uintmax_t)0;
+  } else {
+    alive = ((json_uintmax_t)1 << paths_size) - 1;
+  }
+
+  state.src = (const char *)src;
+  state.size = src_size;
+  state.offset = 0;
+  state.line_no = 1;
+  state.line_offset = 0;
+  state.error = json_parse_error_none;
+  state.dom_size = 0;
+  state.data_size = 0;
+  state.flags_bitset = flags_bitset;
+  state.recursion = 0;
+  state.tape = json_null;
+  state.tape_capacity = 0;
+  state.tape_size = 0;
+  state.tape_offset = 0;
+
+  /* record the size of only what we want, validating it and the objects and
+   * arrays that lead to it as we go. */
+  input_error = json_selective_get_value_size(&state, &selective, alive, 0,
+                                              is_global_object);
+
+  if (0 == input_error) {
+    json_skip_all_skippables(&state);
+
+    if (state.offset != state.size) {
+      /* there are characters remaining in the input that weren't part of the
+       * JSON! */
+      state.error = json_parse_error_unexpected_trailing_characters;
+      input_error = 1;
+    }
+  }
+
+  if (input_error) {
+    if (result) {
+      result->error = state.error;
+      result->error_offset = state.offset;
+      result->error_line_no = state.line_no;
+      result->error_row_no = state.offset - state.line_offset;
+    }
+
+    return json_null;
+  }
+
+  if (json_null == alloc_func_ptr) {
+    allocation = malloc(state.dom_size + state.data_size);
+  } else {
+    allocation = alloc_func_ptr(user_data, state.dom_size + state.data_size);
+  }
+
+  if (json_null == allocation) {
+    /* malloc failed! */
+    if (result) {
+      result->error = json_parse_error_allocator_failed;
+    }
+
+    return json_null;
+  }
+
+  /* reset offset and line information so we can reuse them. */
+  state.offset = 0;
+  state.line_no = 1;
+  state.line_offset = 0;
+
+  state.dom = (char *)allocation;
+  state.data = state.dom + state.dom_size;
+
+  if (json_parse_flags_allow_location_information & state.flags_bitset) {
+    struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state.dom;
+    state.dom += sizeof(struct json_value_ex_s);
+
+    value_ex->offset = state.offset;
+    value_ex->line_no = state.line_no;
+    value_ex->row_no = state.offset - state.line_offset;
+
+    value = &(value_ex->value);
+  } else {
+    value = (struct json_value_s *)state.dom;
+    state.dom += sizeof(struct json_value_s);
+  }
+
+  json_selective_parse_value(&state, &selective, alive, 0, is_global_object,
+                             value);
+
+  return (struct json_value_s *)allocation;
+}
+
+struct json_value_s *json_parse_selective(const void *src, size_t src_size,
+                                          const char *const *paths,
+                                          size_t paths_size,
+                                          struct json_value_s **matches) {
+  return json_parse_selective_ex(src, src_size, paths, paths_size, matches,
+                                 json_parse_flags_default, json_null,
+                                 json_null, json_null);
+}
+
+struct json_extract_result_s {
+  size_t dom_size;
+  size_t data_size;
+};
+
+struct json_value_s *json_extract_value(const struct json_value_s *value) {
+  return json_extract_value_ex(value, json_null, json_null);
+}
+
+json_weak struct json_extract_result_s
+json_extract_get_number_size(const struct json_number_s *const number);
+json_weak struct json_extract_result_s
+json_extract_get_string_size(const struct json_string_s *const string);
+json_weak struct json_extract_result_s
+json_extract_get_object_size(const struct json_object_s *const object);
+json_weak struct json_extract_result_s
+json_extract_get_array_size(const struct json_array_s *const array);
+json_weak struct json_extract_result_s
+json_extract_get_value_size(const struct json_value_s *const value);
+
+struct json_extract_result_s
+json_extract_get_number_size(const struct json_number_s *const number) {
+  struct json_extract_result_s result;
+  result.dom_size = sizeof(struct json_number_s);
+  result.data_size = number->number_size;
+  return result;
+}
+
+struct json_extract_result_s
+json_extract_get_string_size(const struct json_string_s *const string) {
+  struct json_extract_result_s result;
+  result.dom_size = sizeof(struct json_string_s);
+  result.data_size = string->string_size + 1;
+  return result;
+}
+
+struct json_extract_result_s
+json_extract_get_object_size(const struct json_object_s *const object) {
+  struct json_extract_result_s result;
+  size_t i;
+  const struct json_object_element_s *element = object->start;
+
+  result.dom_size = sizeof(struct json_object_s) +
+                    (sizeof(struct json_object_element_s) * object->length);
+  result.data_size = 0;
+
+  for (i = 0; i < object->length; i++) {
+    const struct json_extract_result_s string_result =
+        json_extract_get_string_size(element->name);
+    const struct json_extract_result_s value_result =
+        json_extract_get_value_size(element->value);
+
+    result.dom_size += string_result.dom_size;
+    result.data_size += string_result.data_size;
+
+    result.dom_size += value_result.dom_size;
+    result.data_size += value_result.data_size;
+
+    element = element->next;
+  }
+
+  return result;
+}
+
+struct json_extract_result_s
+json_extract_get_array_size(const struct json_array_s *const array) {
+  struct json_extract_result_s result;
+  size_t i;
+  const struct json_array_element_s *element = array->start;
+
+  result.dom_size = sizeof(struct json_array_s) +
+                    (sizeof(struct json_array_element_s) * array->length);
+  result.data_size = 0;
+
+  for (i = 0; i < array->length; i++) {
+    const struct json_extract_result_s value_result =
+        json_extract_get_value_size(element->value);
+
+    result.dom_size += value_result.dom_size;
+    result.data_size += value_result.data_size;
+
+    element = element->next;
+  }
+
+  return result;
+}
+
+struct json_extract_result_s
+json_extract_get_value_size(const struct json_value_s *const value) {
+  struct json_extract_result_s result = {0, 0};
+
+  switch (value->type) {
+  default:
+    break;
+  case json_type_object:
+    result = json_extract_get_object_size(
+        (const struct json_object_s *)value->payload);
+    break;
+  case json_type_array:
+    result = json_extract_get_array_size(
+        (const struct json_array_s *)value->payload);
+    break;
+  case json_type_number:
+  case json_type_raw:
+    /* json_raw_s has the same layout as json_number_s. */
+    result = json_extract_get_number_size(
+        (const struct json_number_s *)value->payload);
+    break;
+  case json_type_string:
+    result = json_extract_get_string_size(
+        (const struct json_string_s *)value->payload);
+    break;
+  }
+
+  result.dom_size += sizeof(struct json_value_s);
+
+  return result;
+}
+
+struct json_extract_state_s {
+  char *dom;
+  char *data;
+};
+
+json_weak void json_extract_copy_value(struct json_extract_state_s *const state,
+                                       const struct json_value_s *const value);
+void json_extract_copy_value(struct json_extract_state_s *const state,
+                             const struct json_value_s *const value) {
+  struct json_string_s *string;
+  struct json_number_s *number;
+  struct json_object_s *object;
+  struct json_array_s *array;
+  struct json_value_s *new_value;
+
+  memcpy(state->dom, value, sizeof(struct json_value_s));
+  new_value = (struct json_value_s *)state->dom;
+  state->dom += sizeof(struct json_value_s);
+  new_value->payload = state->dom;
+
+  if (json_type_string == value->type) {
+    memcpy(state->dom, value->payload, sizeof(struct json_string_s));
+    string = (struct json_string_s *)state->dom;
+    state->dom += sizeof(struct json_string_s);
+
+    memcpy(state->data, string->string, string->string_size + 1);
+    string->string = state->data;
+    state->data += string->string_size + 1;
+  } else if ((json_type_number == value->type) ||
+             (json_type_raw == value->type)) {
+    /* json_raw_s has the same layout as json_number_s. */
+    memcpy(state->dom, value->payload, sizeof(struct json_number_s));
+    number = (struct json_number_s *)state->dom;
+    state->dom += sizeof(struct json_number_s);
+
+    memcpy(state->data, number->number, number->number_size);
+    number->number = state->data;
+    state->data += number->number_size;
+  } else if (json_type_object == value->type) {
+    struct json_object_element_s *element;
+    size_t i;
+
+    memcpy(state->dom, value->payload, sizeof(struct json_object_s));
+    object = (struct json_object_s *)state->dom;
+    state->dom += sizeof(struct json_object_s);
+
+    element = object->start;
+    object->start = (struct json_object_element_s *)state->dom;
+
+    for (i = 0; i < object->length; i++) {
+      struct json_value_s *previous_value;
+      struct json_object_element_s *previous_element;
+
+      memcpy(state->dom, element, sizeof(struct json_object_element_s));
+      element = (struct json_object_element_s *)state->dom;
+      state->dom += sizeof(struct json_object_element_s);
+
+      string = element->name;
+      memcpy(state->dom, string, sizeof(struct json_string_s));
+      string = (struct json_string_s *)state->dom;
+      state->dom += sizeof(struct json_string_s);
+      element->name = string;
+
+      memcpy(state->data, string->string, string->string_size + 1);
+      string->string = state->data;
+      state->data += string->string_size + 1;
+
+      previous_value = element->value;
+      element->value = (struct json_value_s *)state->dom;
+      json_extract_copy_value(state, previous_value);
+
+      previous_element = element;
+      element = element->next;
+
+      if (element) {
+        previous_element->next = (struct json_object_element_s *)state->dom;
+      }
+    }
+  } else if (json_type_array == value->type) {
+    struct json_array_element_s *element;
+    size_t i;
+
+    memcpy(state->dom, value->payload, sizeof(struct json_array_s));
+    array = (struct json_array_s *)state->dom;
+    state->dom += sizeof(struct json_array_s);
+
+    element = array->start;
+    array->start = (struct json_array_element_s *)state->dom;
+
+    for (i = 0; i < array->length; i++) {
+      struct json_value_s *previous_value;
+      struct json_array_element_s *previous_element;
+
+      memcpy(state->dom, element, sizeof(struct json_array_element_s));
+      element = (struct json_array_element_s *)state->dom;
+      state->dom += sizeof(struct json_array_element_s);
+
+      previous_value = element->value;
+      element->value = (struct json_value_s *)state->dom;
+      json_extract_copy_value(state, previous_value);
+
+      previous_element = element;
+      element = element->next;
+
+      if (element) {
+        previous_element->next = (struct json_array_element_s *)state->dom;
+      }
+    }
+  }
+}
+
+struct json_value_s *json_extract_value_ex(const struct json_value_s *value,
+                                           void *(*alloc_func_ptr)(void *,
+                                                                   size_t),
+                                           void *user_data) {
+  void *allocation;
+  struct json_extract_result_s result;
+  struct json_extract_state_s state;
+  size_t total_size;
+
+  if (json_null == value) {
+    /* invalid value was null! */
+    return json_null;
+  }
+
+  result = json_extract_get_value_size(value);
+  total_size = result.dom_size + result.data_size;
+
+  if (json_null == alloc_func_ptr) {
+    allocation = malloc(total_size);
+  } else {
+    allocation = alloc_func_ptr(user_data, total_size);
+  }
+
+  state.dom = (char *)allocation;
+  state.data = state.dom + result.dom_size;
+
+  json_extract_copy_value(&state, value);
+
+  return (struct json_value_s *)allocation;
+}
+
+struct json_string_s *json_value_as_string(struct json_value_s *const value) {
+  if (value->type != json_type_string) {
+    return json_null;
+  }
+
+  return (struct json_string_s *)value->payload;
+}
+
+struct json_number_s *json_value_as_number(struct json_value_s *const value) {
+  if (value->type != json_type_number) {
+    return json_null;
+  }
+
+  return (struct json_number_s *)value->payload;
+}
+
+struct json_object_s *json_value_as_object(struct json_value_s *const value) {
+  if (value->type != json_type_object) {
+    return json_null;
+  }
+
+  return (struct json_object_s *)value->payload;
+}
+
+struct json_array_s *json_value_as_array(struct json_value_s *const value) {
+  if (value->type != json_type_array) {
+    return json_null;
+  }
+
+  return (struct json_array_s *)value->payload;
+}
+
+struct json_raw_s *json_value_as_raw(struct json_value_s *const value) {
+  if (value->type != json_type_raw) {
+    return json_null;
+  }
+
+  return (struct json_raw_s *)value->payload;
+}
+
+int json_value_is_true(const struct json_value_s *const value) {
+  return value->type == json_type_true;
+}
+
+int json_value_is_false(const struct json_value_s *const value) {
+  return value->type == json_type_false;
+}
+
+int json_value_is_null(const struct json_value_s *const value) {
+  return value->type == json_type_null;
+}
+
+enum json_query_step_type_e {
+  /* select an object member by name (or an array element by index if the
+     name came from a JSON Pointer token that is a valid array index). */
+  json_query_step_type_name,
+
+  /* select an array element by index, negative indices count from the end. */
+  json_query_step_type_index,
+
+  /* select every object member or array element. */
+  json_query_step_type_wildcard,
+
+  /* select a range of array elements. */
+  json_query_step_type_slice
+};
+
+enum json_query_step_flags_e {
+  /* apply the step to the value and all of its descendants (..). */
+  json_query_step_flags_recursive = 0x1,
+
+  /* the start member holds an index (or the start of a slice). */
+  json_query_step_flags_has_start = 0x2,
+
+  /* the end member holds the end of a slice. */
+  json_query_step_flags_has_end = 0x4
+};
+
+struct json_query_step_s {
+  const char *name;
+  size_t name_size;
+  size_t type;
+  size_t flags;
+  ptrdiff_t start;
+  ptrdiff_t end;
+  ptrdiff_t step;
+};
+
+struct json_query_s {
+  struct json_query_step_s *steps;
+  size_t steps_size;
+};
+
+struct json_query_parse_state_s {
+  const char *src;
+  size_t size;
+  size_t offset;
+  struct json_query_step_s *steps;
+  char *data;
+  size_t steps_size;
+  size_t data_size;
+};
+
+json_weak void
+json_query_push_step(struct json_query_parse_state_s *state,
+                     const struct json_query_step_s *step);
+void json_query_push_step(struct json_query_parse_state_s *state,
+                          const struct json_query_step_s *step) {
+  /* when steps is null we are only counting how much memory we need. */
+  if (json_null != state->steps) {
+    state->steps[state->steps_size] = *step;
+  }
+
+  state->steps_size++;
+}
+
+json_weak void json_query_push_char(struct json_query_parse_state_s *state,
+                                    char c);
+void json_query_push_char(struct json_query_parse_state_s *state, char c) {
+  if (json_null != state->data) {
+    state->data[state->data_size] = c;
+  }
+
+  state->data_size++;
+}
+
+json_weak void json_query_name_step(struct json_query_parse_state_s *state,
+                                    size_t name_start,
+                                    struct json_query_step_s *step);
+void json_query_name_step(struct json_query_parse_state_s *state,
+                          size_t name_start, struct json_query_step_s *step) {
+  step->type = json_query_step_type_name;
+  step->name = json_null;
+  step->name_size = state->data_size - name_start;
+
+  if (json_null != state->data) {
+    step->name = state->data + name_start;
+  }
+}
+
+json_weak int json_query_parse_integer(struct json_query_parse_state_s *state,
+                                       ptrdiff_t *value, size_t *flags,
+                                       size_t flag);
+int json_query_parse_integer(struct json_query_parse_state_s *state,
+                             ptrdiff_t *value, size_t *flags, size_t flag) {
+  const char *const src = state->src;
+  const ptrdiff_t max = (ptrdiff_t)(((size_t)-1) >> 1);
+  int negative = 0;
+  size_t digits = 0;
+
+  *value = 0;
+
+  if ((state->offset < state->size) && ('-' == src[state->offset])) {
+    negative = 1;
+    state->offset++;
+  }
+
+  while ((state->offset < state->size) && ('0' <= src[state->offset]) &&
+         (src[state->offset] <= '9')) {
+    const ptrdiff_t digit = (ptrdiff_t)(src[state->offset] - '0');
+
+    if (*value > (max - digit) / 10) {
+      /* the integer is too large to be an index. */
+      return 1;
+    }
+
+    *value = (*value * 10) + digit;
+    state->offset++;
+    digits++;
+  }
+
+  if (0 == digits) {
+    /* a '-' on its own isn't an integer, but having no integer is fine. */
+    return negative;
+  }
+
+  if (negative) {
+    *value = -*value;
+  }
+
+  *flags |= flag;
+
+  return 0;
+}
+
+json_weak void json_query_skip_spaces(struct json_query_parse_state_s *state);
+void json_query_skip_spaces(struct json_query_parse_state_s *state) {
+  while ((state->offset < state->size) && (' ' == state->src[state->offset])) {
+    state->offset++;
+  }
+}
+
+json_weak int json_query_parse_bracket(struct json_query_parse_state_s *state,
+                                       struct json_query_step_s *step);
+int json_query_parse_bracket(struct json_query_parse_state_s *state,
+                             struct json_query_step_s *step) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+
+  /* skip leading '['. */
+  state->offset++;
+
+  json_query_skip_spaces(state);
+
+  if (state->offset == size) {
+    return 1;
+  }
+
+  if ('*' == src[state->offset]) {
+    step->type = json_query_step_type_wildcard;
+    state->offset++;
+  } else if (('\'' == src[state->offset]) || ('"' == src[state->offset])) {
+    const char quote_to_use = src[state->offset];
+    const size_t name_start = state->data_size;
+
+    /* skip leading quote. */
+    state->offset++;
+
+    while ((state->offset < size) && (quote_to_use != src[state->offset])) {
+      if ('\\' == src[state->offset]) {
+        /* the escaped character is used as is. */
+        state->offset++;
+
+        if (state->offset == size) {
+          return 1;
+        }
+      }
+
+      json_query_push_char(state, src[state->offset++]);
+    }
+
+    if (state->offset == size) {
+      /* the name wasn't terminated. */
+      return 1;
+    }
+
+    /* skip trailing quote. */
+    state->offset++;
+
+    json_query_name_step(state, name_start, step);
+  } else {
+    if (json_query_parse_integer(state, &step->start, &step->flags,
+                                 json_query_step_flags_has_start)) {
+      return 1;
+    }
+
+    if ((state->offset < size) && (':' == src[state->offset])) {
+      step->type = json_query_step_type_slice;
+      step->step = 1;
+
+      /* skip the ':'. */
+      state->offset++;
+
+      if (json_query_parse_integer(state, &step->end, &step->flags,
+                                   json_query_step_flags_has_end)) {
+        return 1;
+      }
+
+      if ((state->offset < size) && (':' == src[state->offset])) {
+        size_t step_flags = 0;
+
+        /* skip the ':'. */
+        state->offset++;
+
+        if (json_query_parse_integer(state, &step->step, &step_flags, 1)) {
+          return 1;
+        }
+
+        if (0 == step_flags) {
+          step->step = 1;
+        } else if (step->step <= 0) {
+          /* only forward slices are supported. */
+          return 1;
+        }
+      }
+    } else if (json_query_step_flags_has_start & step->flags) {
+      step->type = json_query_step_type_index;
+    } else {
+      return 1;
+    }
+  }
+
+  json_query_skip_spaces(state);
+
+  if ((state->offset == size) || (']' != src[state->offset])) {
+    return 1;
+  }
+
+  /* skip trailing ']'. */
+  state->offset++;
+
+  return 0;
+}
+
+json_weak int json_query_parse_path(struct json_query_parse_state_s *state);
+int json_query_parse_path(struct json_query_parse_state_s *state) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+
+  /* skip leading '$'. */
+  state->offset++;
+
+  while (state->offset < size) {
+    struct json_query_step_s step;
+
+    step.name = json_null;
+    step.name_size = 0;
+    step.type = json_query_step_type_wildcard;
+    step.flags = 0;
+    step.start = 0;
+    step.end = 0;
+    step.step = 1;
+
+    if ('.' == src[state->offset]) {
+      /* skip the '.'. */
+      state->offset++;
+
+      if ((state->offset < size) && ('.' == src[state->offset])) {
+        /* skip the second '.' of recursive descent. */
+        state->offset++;
+        step.flags |= json_query_step_flags_recursive;
+      }
+
+      if (state->offset == size) {
+        return 1;
+      }
+
+      if ('*' == src[state->offset]) {
+        state->offset++;
+      } else if ('[' == src[state->offset]) {
+        /* only recursive descent can be followed by a bracket (..[0]). */
+        if (!(json_query_step_flags_recursive & step.flags) ||
+            json_query_parse_bracket(state, &step)) {
+          return 1;
+        }
+      } else {
+        const size_t name_start = state->data_size;
+
+        while ((state->offset < size) && ('.' != src[state->offset]) &&
+               ('[' != src[state->offset])) {
+          json_query_push_char(state, src[state->offset++]);
+        }
+
+        if (name_start == state->data_size) {
+          return 1;
+        }
+
+        json_query_name_step(state, name_start, &step);
+      }
+    } else if ('[' == src[state->offset]) {
+      if (json_query_parse_bracket(state, &step)) {
+        return 1;
+      }
+    } else {
+      return 1;
+    }
+
+    json_query_push_step(state, &step);
+  }
+
+  return 0;
+}
+
+json_weak int json_query_parse_pointer(struct json_query_parse_state_s *state);
+int json_query_parse_pointer(struct json_query_parse_state_s *state) {
+  const char *const src = state->src;
+  const size_t size = state->size;
+
+  while (state->offset < size) {
+    struct json_query_step_s step;
+    const size_t name_start = state->data_size;
+    size_t token_start;
+    size_t index;
+
+    step.flags = 0;
+    step.start = 0;
+    step.end = 0;
+    step.step = 1;
+
+    /* skip the '/' that begins the token. */
+    state->offset++;
+
+    token_start = state->offset;
+
+    while ((state->offset < size) && ('/' != src[state->offset])) {
+      char c = src[state->offset++];
+
+      if ('~' == c) {
+        /* '~0' is an escaped '~', and '~1' is an escaped '/'. */
+        if (state->offset == size) {
+          return 1;
+        } else if ('0' == src[state->offset]) {
+          c = '~';
+        } else if ('1' == src[state->offset]) {
+          c = '/';
+        } else {
+          return 1;
+        }
+
+        state->offset++;
+      }
+
+      json_query_push_char(state, c);
+    }
+
+    json_query_name_step(state, name_start, &step);
+
+    /* tokens that look like an array index can refer to array elements too. */
+    if (json_pointer_token_index(src + token_start, state->offset - token_start,
+                                 &index) &&
+        (index <= (((size_t)-1) >> 1))) {
+      step.start = (ptrdiff_t)index;
+      step.flags |= json_query_step_flags_has_start;
+    }
+
+    json_query_push_step(state, &step);
+  }
+
+  return 0;
+}
+
+json_weak int json_query_parse(struct json_query_parse_state_s *state);
+int json_query_parse(struct json_query_parse_state_s *state) {
+  state->offset = 0;
+  state->steps_size = 0;
+  state->data_size = 0;
+
+  if (0 == state->size) {
+    /* the empty JSON Pointer refers to the whole document. */
+    return 0;
+  } else if ('/' == state->src[0]) {
+    return json_query_parse_pointer(state);
+  } else if ('$' == state->src[0]) {
+    return json_query_parse_path(state);
+  }
+
+  return 1;
+}
+
+struct json_query_s *json_query_compile(const char *query, size_t query_size) {
+  return json_query_compile_ex(query, query_size, json_null, json_null);
+}
+
+struct json_query_s *
+json_query_compile_ex(const char *query, size_t query_size,
+                      void *(*alloc_func_ptr)(void *user_data, size_t size),
+                      void *user_data) {
+  struct json_query_parse_state_s state;
+  struct json_query_s *compiled;
+  size_t total_size;
+  void *allocation;
+
+  if (json_null == query) {
+    return json_null;
+  }
+
+  state.src = query;
+  state.size = query_size;
+  state.steps = json_null;
+  state.data = json_null;
+
+  /* first work out how many steps and name bytes the query needs. */
+  if (json_query_parse(&state)) {
+    return json_null;
+  }
+
+  total_size = sizeof(struct json_query_s) +
+               (sizeof(struct json_query_step_s) * state.steps_size) +
+               state.data_size;
+
+  if (json_null == alloc_func_ptr) {
+    allocation = malloc(total_size);
+  } else {
+    allocation = alloc_func_ptr(user_data, total_size);
+  }
+
+  if (json_null == allocation) {
+    /* malloc failed! */
+    return json_null;
+  }
+
+  compiled = (struct json_query_s *)allocation;
+  state.steps = (struct json_query_step_s *)((char *)allocation +
+                                             sizeof(struct json_query_s));
+  state.data = (char *)(state.steps + state.steps_size);
+
+  /* then parse the query again, this time filling in the steps. */
+  (void)json_query_parse(&state);
+
+  compiled->steps = state.steps;
+  compiled->steps_size = state.steps_size;
+
+  return compiled;
+}
+
+struct json_query_evaluate_state_s {
+  const struct json_query_s *query;
+  struct json_value_s **matches;
+  size_t matches_capacity;
+  size_t matches_size;
+};
+
+json_weak int
+json_query_step_selects_member(const struct json_query_step_s *step,
+                               const struct json_string_s *name);
+int json_query_step_selects_member(const struct json_query_step_s *step,
+                                   const struct json_string_s *name) {
+  switch (step->type) {
+  default:
+    return 0;
+  case json_query_step_type_wildcard:
+    return 1;
+  case json_query_step_type_name:
+    return (step->name_size == name->string_size) &&
+           (0 == memcmp(step->name, name->string, step->name_size));
+  }
+}
+
+json_weak int
+json_query_step_selects_element(const struct json_query_step_s *step,
+                                size_t index, size_t length);
+int json_query_step_selects_element(const struct json_query_step_s *step,
+                                    size_t index, size_t length) {
+  const ptrdiff_t i = (ptrdiff_t)index;
+  const ptrdiff_t n = (ptrdiff_t)length;
+
+  switch (step->type) {
+  default:
+    return 0;
+  case json_query_step_type_wildcard:
+    return 1;
+  case json_query_step_type_name:
+    return (json_query_step_flags_has_start & step->flags) &&
+           (step->start == i);
+  case json_query_step_type_index:
+    return (step->start < 0) ? (step->start + n == i) : (step->start == i);
+  case json_query_step_type_slice: {
+    ptrdiff_t start = 0;
+    ptrdiff_t end = n;
+
+    if (json_query_step_flags_has_start & step->flags) {
+      start = (step->start < 0) ? (step->start + n) : step->start;
+      start = (start < 0) ? 0 : start;
+    }
+
+    if (json_query_step_flags_has_end & step->flags) {
+      end = (step->end < 0) ? (step->end + n) : step->end;
+    }
+
+    return (start <= i) && (i < end) && (0 == ((i - start) % step->step));
+  }
+  }
+}
+
+/* an array or object that json_query_evaluate is part way through. */
+struct json_query_frame_s {
+  /* the array or object. */
+  const struct json_value_s *value;
+  /* the json_array_element_s or json_object_element_s being visited. */
+  const void *element;
+  /* the step being applied to the elements. */
+  size_t step_index;
+  /* the index of element in an array. */
+  size_t index;
+  /* 0 if element hasn't been visited yet, 1 if the step has been applied to
+   * it, and 2 if the recursive descent into it has been done too. */
+  size_t phase;
+};
+
+json_weak int
+json_query_evaluate_push(struct json_query_evaluate_state_s *state,
+                         struct json_query_frame_s *frames, size_t *depth,
+                         size_t step_index, struct json_value_s *value);
+int json_query_evaluate_push(struct json_query_evaluate_state_s *state,
+                             struct json_query_frame_s *frames, size_t *depth,
+                             size_t step_index, struct json_value_s *value) {
+  const void *element;
+
+  if (step_index == state->query->steps_size) {
+    /* we've run out of steps, so this value is a match. */
+    if (state->matches_size < state->matches_capacity) {
+      state->matches[state->matches_size] = value;
+    }
+
+    state->matches_size++;
+    return 0;
+  }
+
+  if (json_type_object == value->type) {
+    element = ((const struct json_object_s *)value->payload)->start;
+  } else if (json_type_array == value->type) {
+    element = ((const struct json_array_s *)value->payload)->start;
+  } else {
+    /* only arrays and objects have anything for the step to select. */
+    return 0;
+  }
+
+  if (json_null == element) {
+    return 0;
+  }
+
+  if (JSON_MAX_RECURSION == *depth) {
+    /* the DOM is nested too deeply! */
+    return 1;
+  }
+
+  frames[*depth].value = value;
+  frames[*depth].element = element;
+  frames[*depth].step_index = step_index;
+  frames[*depth].index = 0;
+  frames[*depth].phase = 0;
+  (*depth)++;
+
+  return 0;
+}
+
+size_t json_query_evaluate(const struct json_query_s *query,
+                           struct json_value_s *value,
+                           struct json_value_s **matches,
+                           size_t matches_capacity) {
+  struct json_query_evaluate_state_s state;
+  struct json_query_frame_s frames[JSON_MAX_RECURSION];
+  size_t depth = 0;
+
+  if ((json_null == query) || (json_null == value)) {
+    return 0;
+  }
+
+  state.query = query;
+  state.matches = matches;
+  state.matches_capacity = matches_capacity;
+  state.matches_size = 0;
+
+  if (json_query_evaluate_push(&state, frames, &depth, 0, value)) {
+    return 0;
+  }
+
+  while (0 < depth) {
+    struct json_query_frame_s *const frame = &frames[depth - 1];
+    const struct json_query_step_s *const step =
+        &query->steps[frame->step_index];
+    struct json_value_s *child;
+    int selected;
+
+    if (json_null == frame->element) {
+      /* we've visited every element. */
+      depth--;
+      continue;
+    }
+
+    if (json_type_object == frame->value->type) {
+      const struct json_object_element_s *const element =
+          (const struct json_object_element_s *)frame->element;
+
+      child = element->value;
+
+      if (2 == frame->phase) {
+        frame->element = element->next;
+        frame->phase = 0;
+        continue;
+      }
+
+      selected = json_query_step_selects_member(step, element->name);
+    } else {
+      const struct json_array_element_s *const element =
+          (const struct json_array_element_s *)frame->element;
+
+      child = element->value;
+
+      if (2 == frame->phase) {
+        frame->element = element->next;
+        frame->index++;
+        frame->phase = 0;
+        continue;
+      }
+
+      selected = json_query_step_selects_element(
+          step, frame->index,
+          ((const struct json_array_s *)frame->value->payload)->length);
+    }
+
+    /* the rest of the query is applied to a selected element first, and then
+     * recursive descent applies the same step to every descendant too, all
+     * before moving on to the next element so that the matches come out in
+     * document order. */
+    if (0 == frame->phase) {
+      frame->phase = 1;
+
+      if (selected && json_query_evaluate_push(&state, frames, &depth,
+                                               frame->step_index + 1, child)) {
+        return 0;
+      }
+    } else {
+      frame->phase = 2;
+
+      if ((json_query_step_flags_recursive & step->flags) &&
+          json_query_evaluate_push(&state, frames, &depth, frame->step_index,
+                                   child)) {
+        return 0;
+      }
+    }
+  }
+
+  return state.matches_size;
+}
+
+json_weak size_t json_format_integer(json_intmax_t value, char *data);
+size_t json_format_integer(json_intmax_t value, char *data) {
+  static const char pairs[] = "00010203040506070809"
+                              "10111213141516171819"
+                              "20212223242526272829"
+                              "30313233343536373839"
+                              "40414243444546474849"
+                              "50515253545556575859"
+                              "60616263646566676869"
+                              "70717273747576777879"
+                              "80818283848586878889"
+                              "90919293949596979899";
+  char digits[32];
+  char *digit = digits + sizeof(digits);
+  json_uintmax_t magnitude = (json_uintmax_t)value;
+  size_t size;
+
+  if (0 > value) {
+    /* negate in unsigned arithmetic so that the smallest value works too. */
+    magnitude = (json_uintmax_t)0 - magnitude;
+  }
+
+  /* write two digits at a time to halve the number of divisions. */
+  while (100 <= magnitude) {
+    const size_t pair = (size_t)(magnitude % 100) * 2;
+    magnitude /= 100;
+    *--digit = pairs[pair + 1];
+    *--digit = pairs[pair];
+  }
+
+  if (10 <= magnitude) {
+    const size_t pair = (size_t)magnitude * 2;
+    *--digit = pairs[pair + 1];
+    *--digit = pairs[pair];
+  } else {
+    *--digit = '0' + (char)magnitude;
+  }
+
+  if (0 > value) {
+    *--digit = '-';
+  }
+
+  size = (size_t)((digits + sizeof(digits)) - digit);
+  memcpy(data, digit, size);
+
+  return size;
+}
+
+/* a floating point number f * 2^e with a 64 bit significand, as used by the
+ * Grisu algorithm from "Printing Floating-Point Numbers Quickly and
+ * Accurately with Integers" by Florian Loitsch. */
+struct json_diyfp_s {
+  json_uintmax_t f;
+  long e;
+};
+
+json_weak struct json_diyfp_s json_diyfp_multiply(struct json_diyfp_s x,
+                                                  struct json_diyfp_s y);
+struct json_diyfp_s json_diyfp_multiply(struct json_diyfp_s x,
+                                        struct json_diyfp_s y) {
+  /* the upper 64 bits of the 128 bit product (rounded), from 32 bit halves. */
+  const json_uintmax_t mask = 0xFFFFFFFFul;
+  const json_uintmax_t p0 = (x.f & mask) * (y.f & mask);
+  const json_uintmax_t p1 = (x.f & mask) * (y.f >> 32);
+  const json_uintmax_t p2 = (x.f >> 32) * (y.f & mask);
+  const json_uintmax_t p3 = (x.f >> 32) * (y.f >> 32);
+  const json_uintmax_t q =
+      (p0 >> 32) + (p1 & mask) + (p2 & mask) + ((json_uintmax_t)1 << 31);
+  struct json_diyfp_s result;
+
+  result.f = p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32);
+  result.e = x.e + y.e + 64;
+
+  return result;
+}
+
+json_weak struct json_diyfp_s json_diyfp_normalize(struct json_diyfp_s x,
+                                                   long e);
+struct json_diyfp_s json_diyfp_normalize(struct json_diyfp_s x, long e) {
+  if (0 == e) {
+    /* shift the highest set bit up to bit 63. */
+    while (0 == (x.f >> 63)) {
+      x.f <<= 1;
+      x.e--;
+    }
+  } else {
+    /* shift up to the (smaller) exponent e instead. */
+    x.f <<= x.e - e;
+    x.e = e;
+  }
+
+  return x;
+}
+
+json_weak void json_grisu2_round(char *digits, size_t size,
+                                 json_uintmax_t distance, json_uintmax_t delta,
+                                 json_uintmax_t rest, json_uintmax_t ten_k);
+void json_grisu2_round(char *digits, size_t size, json_uintmax_t distance,
+                       json_uintmax_t delta, json_uintmax_t rest,
+                       json_uintmax_t ten_k) {
+  /* step the last digit down while that moves us closer to the real value and
+   * stays within the rounding interval. */
+  while ((rest < distance) && (delta - rest >= ten_k) &&
+         ((rest + ten_k < distance) ||
+          (distance - rest > rest + ten_k - distance))) {
+    digits[size - 1]--;
+    rest += ten_k;
+  }
+}
+
+json_weak size_t json_grisu2(double value, char *digits, long *exponent);
+size_t json_grisu2(double value, char *digits, long *exponent) {
+  /* the cached powers of ten 10^k = (f_hi * 2^32 + f_lo) * 2^e, for every
+   * eighth k from -300 to 324. */
+  static const struct {
+    unsigned long f_hi;
+    unsigned long f_lo;
+    int e;
+    int k;
+  } powers[] = {
+      {0xAB70FE17ul, 0xC79AC6CAul, -1060, -300},
+      {0xFF77B1FCul, 0xBEBCDC4Ful, -1034, -292},
+      {0xBE5691EFul, 0x416BD60Cul, -1007, -284},
+      {0x8DD01FADul, 0x907FFC3Cul, -980, -276},
+      {0xD3515C28ul, 0x31559A83ul, -954, -268},
+      {0x9D71AC8Ful, 0xADA6C9B5ul, -927, -260},
+      {0xEA9C2277ul, 0x23EE8BCBul, -901, -252},
+      {0xAECC4991ul, 0x4078536Dul, -874, -244},
+      {0x823C1279ul, 0x5DB6CE57ul, -847, -236},
+      {0xC2109436ul, 0x4DFB5637ul, -821, -228},
+      {0x9096EA6Ful, 0x3848984Ful, -794, -220},
+      {0xD77485CBul, 0x25823AC7ul, -768, -212},
+      {0xA086CFCDul, 0x97BF97F4ul, -741, -204},
+      {0xEF340A98ul, 0x172AACE5ul, -715, -196},
+      {0xB23867FBul, 0x2A35B28Eul, -688, -188},
+      {0x84C8D4DFul, 0xD2C63F3Bul, -661, -180},
+      {0xC5DD4427ul, 0x1AD3CDBAul, -635, -172},
+      {0x936B9FCEul, 0xBB25C996ul, -608, -164},
+      {0xDBAC6C24ul, 0x7D62A584ul, -582, -156},
+      {0xA3AB6658ul, 0x0D5FDAF6ul, -555, -148},
+      {0xF3E2F893ul, 0xDEC3F126ul, -529, -140},
+      {0xB5B5ADA8ul, 0xAAFF80B8ul, -502, -132},
+      {0x87625F05ul, 0x6C7C4A8Bul, -475, -124},
+      {0xC9BCFF60ul, 0x34C13053ul, -449, -116},
+      {0x964E858Cul, 0x91BA2655ul, -422, -108},
+      {0xDFF97724ul, 0x70297EBDul, -396, -100},
+      {0xA6DFBD9Ful, 0xB8E5B88Ful, -369, -92},
+      {0xF8A95FCFul, 0x88747D94ul, -343, -84},
+      {0xB9447093ul, 0x8FA89BCFul, -316, -76},
+      {0x8A08F0F8ul, 0xBF0F156Bul, -289, -68},
+      {0xCDB02555ul, 0x653131B6ul, -263, -60},
+      {0x993FE2C6ul, 0xD07B7FACul, -236, -52},
+      {0xE45C10C4ul, 0x2A2B3B06ul, -210, -44},
+      {0xAA242499ul, 0x697392D3ul, -183, -36},
+      {0xFD87B5F2ul, 0x8300CA0Eul, -157, -28},
+      {0xBCE50864ul, 0x92111AEBul, -130, -20},
+      {0x8CBCCC09ul, 0x6F5088CCul, -103, -12},
+      {0xD1B71758ul, 0xE219652Cul, -77, -4},
+      {0x9C400000ul, 0x00000000ul, -50, 4},
+      {0xE8D4A510ul, 0x00000000ul, -24, 12},
+      {0xAD78EBC5ul, 0xAC620000ul, 3, 20},
+      {0x813F3978ul, 0xF8940984ul, 30, 28},
+      {0xC097CE7Bul, 0xC90715B3ul, 56, 36},
+      {0x8F7E32CEul, 0x7BEA5C70ul, 83, 44},
+      {0xD5D238A4ul, 0xABE98068ul, 109, 52},
+      {0x9F4F2726ul, 0x179A2245ul, 136, 60},
+      {0xED63A231ul, 0xD4C4FB27ul, 162, 68},
+      {0xB0DE6538ul, 0x8CC8ADA8ul, 189, 76},
+      {0x83C7088Eul, 0x1AAB65DBul, 216, 84},
+      {0xC45D1DF9ul, 0x42711D9Aul, 242, 92},
+      {0x924D692Cul, 0xA61BE758ul, 269, 100},
+      {0xDA01EE64ul, 0x1A708DEAul, 295, 108},
+      {0xA26DA399ul, 0x9AEF774Aul, 322, 116},
+      {0xF209787Bul, 0xB47D6B85ul, 348, 124},
+      {0xB454E4A1ul, 0x79DD1877ul, 375, 132},
+      {0x865B8692ul, 0x5B9BC5C2ul, 402, 140},
+      {0xC83553C5ul, 0xC8965D3Dul, 428, 148},
+      {0x952AB45Cul, 0xFA97A0B3ul, 455, 156},
+      {0xDE469FBDul, 0x99A05FE3ul, 481, 164},
+      {0xA59BC234ul, 0xDB398C25ul, 508, 172},
+      {0xF6C69A72ul, 0xA3989F5Cul, 534, 180},
+      {0xB7DCBF53ul, 0x54E9BECEul, 561, 188},
+      {0x88FCF317ul, 0xF22241E2ul, 588, 196},
+      {0xCC20CE9Bul, 0xD35C78A5ul, 614, 204},
+      {0x98165AF3ul, 0x7B2153DFul, 641, 212},
+      {0xE2A0B5DCul, 0x971F303Aul, 667, 220},
+      {0xA8D9D153ul, 0x5CE3B396ul, 694, 228},
+      {0xFB9B7CD9ul, 0xA4A7443Cul, 720, 236},
+      {0xBB764C4Cul, 0xA7A44410ul, 747, 244},
+      {0x8BAB8EEFul, 0xB6409C1Aul, 774, 252},
+      {0xD01FEF10ul, 0xA657842Cul, 800, 260},
+      {0x9B10A4E5ul, 0xE9913129ul, 827, 268},
+      {0xE7109BFBul, 0xA19C0C9Dul, 853, 276},
+      {0xAC2820D9ul, 0x623BF429ul, 880, 284},
+      {0x80444B5Eul, 0x7AA7CF85ul, 907, 292},
+      {0xBF21E440ul, 0x03ACDD2Dul, 933, 300},
+      {0x8E679C2Ful, 0x5E44FF8Ful, 960, 308},
+      {0xD433179Dul, 0x9C8CB841ul, 986, 316},
+      {0x9E19DB92ul, 0xB4E31BA9ul, 1013, 324},
+  };
+  const json_uintmax_t hidden_bit = (json_uintmax_t)1 << 52;
+  json_uintmax_t bits = 0;
+  json_uintmax_t fraction;
+  json_uintmax_t delta, distance, rest, pow10;
+  struct json_diyfp_s v, plus, minus, cached, one;
+  unsigned long p1;
+  long biased, f, k;
+  size_t index, size = 0, n;
+
+  memcpy(&bits, &value, sizeof(double));
+  fraction = bits & (hidden_bit - 1);
+  biased = (long)((bits >> 52) & 0x7FF);
+
+  if (0 == biased) {
+    /* the double is denormal. */
+    v.f = fraction;
+    v.e = 1 - 1075;
+  } else {
+    v.f = fraction + hidden_bit;
+    v.e = biased - 1075;
+  }
+
+  /* the boundaries half way between the double and its neighbours (the lower
+   * neighbour is closer if the double is a power of two). */
+  plus.f = 2 * v.f + 1;
+  plus.e = v.e - 1;
+
+  if ((0 == fraction) && (1 < biased)) {
+    minus.f = 4 * v.f - 1;
+    minus.e = v.e - 2;
+  } else {
+    minus.f = 2 * v.f - 1;
+    minus.e = v.e - 1;
+  }
+
+  plus = json_diyfp_normalize(plus, 0);
+  minus = json_diyfp_normalize(minus, plus.e);
+  v = json_diyfp_normalize(v, 0);
+
+  /* pick the cached power that scales the boundaries into [2^-60, 2^-32]. */
+  f = -60 - plus.e - 1;
+  k = (f * 78913) / (1L << 18) + (0 < f);
+  index = (size_t)((300 + k + 7) / 8);
+
+  cached.f = ((json_uintmax_t)powers[index].f_hi << 32) | powers[index].f_lo;
+  cached.e = powers[index].e;
+  *exponent = -(long)powers[index].k;
+
+  v = json_diyfp_multiply(v, cached);
+  plus = json_diyfp_multiply(plus, cached);
+  minus = json_diyfp_multiply(minus, cached);
+
+  /* be conservative about the imprecision of the cached powers. */
+  plus.f -= 1;
+  minus.f += 1;
+
+  delta = plus.f - minus.f;
+  distance = plus.f - v.f;
+
+  one.f = (json_uintmax_t)1 << -plus.e;
+  one.e = plus.e;
+
+  p1 = (unsigned long)(plus.f >> -one.e);
+  rest = plus.f & (one.f - 1);
+
+  for (n = 10, pow10 = 1000000000ul; pow10 > p1 && 1 < n; n--) {
+    pow10 /= 10;
+  }
+
+  /* generate the digits of the integral part. */
+  while (0 < n) {
+    digits[size++] = '0' + (char)(p1 / pow10);
+    p1 %= (unsigned long)pow10;
+    n--;
+
+    if ((((json_uintmax_t)p1 << -one.e) + rest) <= delta) {
+      *exponent += (long)n;
+      json_grisu2_round(digits, size, distance, delta,
+                              ((json_uintmax_t)p1 << -one.e) + rest,
+                              pow10 << -one.e);
+      return size;
+    }
+
+    pow10 /= 10;
+  }
+
+  /* and then of the fractional part, until we're within the interval. */
+  for (;;) {
+    rest *= 10;
+    digits[size++] = '0' + (char)(rest >> -one.e);
+    rest &= one.f - 1;
+    delta *= 10;
+    distance *= 10;
+    *exponent -= 1;
+
+    if (rest <= delta) {
+      break;
+    }
+  }
+
+  json_grisu2_round(digits, size, distance, delta, rest, one.f);
+
+  return size;
+}
+
+json_weak size_t json_format_double(double value, char *data);
+size_t json_format_double(double value, char *data) {
+  char digits[32];
+  char *const start = data;
+  json_uintmax_t bits = 0;
+  long exponent = 0;
+  long point;
+  size_t size, i;
+
+  if (!((-DBL_MAX <= value) && (value <= DBL_MAX))) {
+    /* JSON can't represent infinities or NaN! */
+    return 0;
+  }
+
+  /* check the sign bit so that negative zero keeps its sign. */
+  memcpy(&bits, &value, sizeof(double));
+
+  if (0 != (bits >> 63)) {
+    *data++ = '-';
+    value = -value;
+  }
+
+  if (!(0 < value)) {
+    /* zero (and negative zero). */
+    *data++ = '0';
+    return (size_t)(data - start);
+  }
+
+  /* the shortest digits that round trip, and where the decimal point goes. */
+  size = json_grisu2(value, digits, &exponent);
+  point = (long)size + exponent;
+
+  if ((0 <= exponent) && (point <= 21)) {
+    /* an integer, like 123 or 1200. */
+    memcpy(data, digits, size);
+    data += size;
+
+    for (i = 0; i < (size_t)exponent; i++) {
+      *data++ = '0';
+    }
+  } else if ((0 < point) && (point <= 21)) {
+    /* a decimal point within the digits, like 1.25. */
+    memcpy(data, digits, (size_t)point);
+    data += point;
+    *data++ = '.';
+    memcpy(data, digits + point, size - (size_t)point);
+    data += size - (size_t)point;
+  } else if ((-6 < point) && (point <= 0)) {
+    /* a small number, like 0.00125. */
+    *data++ = '0';
+    *data++ = '.';
+
+    for (i = 0; i < (size_t)-point; i++) {
+      *data++ = '0';
+    }
+
+    memcpy(data, digits, size);
+    data += size;
+  } else {
+    /* scientific notation, like 1.25e+300. */
+    *data++ = digits[0];
+
+    if (1 < size) {
+      *data++ = '.';
+      memcpy(data, digits + 1, size - 1);
+      data += size - 1;
+    }
+
+    *data++ = 'e';
+    *data++ = (0 < point) ? '+' : '-';
+    data += json_format_integer((0 < point) ? (point - 1) : (1 - point), data);
+  }
+
+  return (size_t)(data - start);
+}
+
+struct json_builder_chunk_s {
+  struct json_builder_chunk_s *next;
+};
+
+struct json_builder_frame_s {
+  struct json_builder_frame_s *parent;
+  struct json_value_s *value;
+  void *last_element;
+  struct json_string_s *name;
+};
+
+struct json_builder_s {
+  void *(*alloc_func_ptr)(void *user_data, size_t size);
+  void *user_data;
+  struct json_builder_chunk_s *chunks;
+  char *data;
+  size_t data_size;
+  struct json_builder_frame_s *frame;
+  struct json_builder_frame_s *free_frames;
+  struct json_value_s *root;
+  size_t error;
+};
+
+json_weak void *json_builder_alloc(struct json_builder_s *builder,
+                                   size_t size);
+void *json_builder_alloc(struct json_builder_s *builder, size_t size) {
+  struct json_builder_chunk_s *chunk;
+  size_t chunk_size = JSON_BUILDER_CHUNK_SIZE;
+  void *allocation;
+
+  /* keep every allocation pointer aligned, like the slices of the single
+   * allocation json_parse makes. */
+  size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  if (size > builder->data_size) {
+    if (size > chunk_size - sizeof(struct json_builder_chunk_s)) {
+      if (size > ((size_t)-1) - sizeof(struct json_builder_chunk_s)) {
+        /* the allocation can't get any bigger! */
+        builder->error = 1;
+        return json_null;
+      }
+
+      /* the allocation won't fit in a chunk, so give it one of its own. */
+      chunk_size = sizeof(struct json_builder_chunk_s) + size;
+    }
+
+    if (json_null == builder->alloc_func_ptr) {
+      chunk = (struct json_builder_chunk_s *)malloc(chunk_size);
+    } else {
+      chunk = (struct json_builder_chunk_s *)builder->alloc_func_ptr(
+          builder->user_data, chunk_size);
+    }
+
+    if (json_null == chunk) {
+      /* malloc failed! */
+      builder->error = 1;
+      return json_null;
+    }
+
+    chunk->next = builder->chunks;
+    builder->chunks = chunk;
+    builder->data = (char *)(chunk + 1);
+    builder->data_size = chunk_size - sizeof(struct json_builder_chunk_s);
+  }
+
+  allocation = builder->data;
+  builder->data += size;
+  builder->data_size -= size;
+
+  return allocation;
+}
+
+json_weak struct json_string_s *
+json_builder_new_string(struct json_builder_s *builder, const char *string,
+                        size_t string_size);
+struct json_string_s *json_builder_new_string(struct json_builder_s *builder,
+                                              const char *string,
+                                              size_t string_size) {
+  struct json_string_s *result;
+  char *data;
+
+  if (string_size >= ((size_t)-1) - sizeof(struct json_string_s)) {
+    builder->error = 1;
+    return json_null;
+  }
+
+  /* the string is null terminated just like the strings json_parse makes. */
+  result = (struct json_string_s *)json_builder_alloc(
+      builder, sizeof(struct json_string_s) + string_size + 1);
+
+  if (json_null == result) {
+    return json_null;
+  }
+
+  data = (char *)(result + 1);
+
+  if (0 < string_size) {
+    memcpy(data, string, string_size);
+  }
+
+  data[string_size] = '\0';
+
+  result->string = data;
+  result->string_size = string_size;
+
+  return result;
+}
+
+json_weak int json_builder_add(struct json_builder_s *builder, size_t type,
+                               void *payload);
+int json_builder_add(struct json_builder_s *builder, size_t type,
+                     void *payload) {
+  struct json_builder_frame_s *const frame = builder->frame;
+  struct json_value_s *value;
+
+  if ((json_null == frame) && (json_null != builder->root)) {
+    /* there can only be one value at the root! */
+    builder->error = 1;
+    return 1;
+  }
+
+  if ((json_null != frame) && (json_type_object == frame->value->type) &&
+      (json_null == frame->name)) {
+    /* values in an object need a name first! */
+    builder->error = 1;
+    return 1;
+  }
+
+  value = (struct json_value_s *)json_builder_alloc(
+      builder, sizeof(struct json_value_s));
+
+  if (json_null == value) {
+    return 1;
+  }
+
+  value->payload = payload;
+  value->type = type;
+
+  if (json_null == frame) {
+    builder->root = value;
+  } else if (json_type_array == frame->value->type) {
+    struct json_array_s *const array =
+        (struct json_array_s *)frame->value->payload;
+    struct json_array_element_s *const element =
+        (struct json_array_element_s *)json_builder_alloc(
+            builder, sizeof(struct json_array_element_s));
+
+    if (json_null == element) {
+      return 1;
+    }
+
+    element->value = value;
+    element->next = json_null;
+
+    if (json_null == frame->last_element) {
+      array->start = element;
+    } else {
+      ((struct json_array_element_s *)frame->last_element)->next = element;
+    }
+
+    frame->last_element = element;
+    array->length++;
+  } else {
+    struct json_object_s *const object =
+        (struct json_object_s *)frame->value->payload;
+    struct json_object_element_s *const element =
+        (struct json_object_element_s *)json_builder_alloc(
+            builder, sizeof(struct json_object_element_s));
+
+    if (json_null == element) {
+      return 1;
+    }
+
+    element->name = frame->name;
+    element->value = value;
+    element->next = json_null;
+
+    if (json_null == frame->last_element) {
+      object->start = element;
+    } else {
+      ((struct json_object_element_s *)frame->last_element)->next = element;
+    }
+
+    frame->name = json_null;
+    frame->last_element = element;
+    object->length++;
+  }
+
+  return 0;
+}
+
+json_weak int json_builder_begin(struct json_builder_s *builder, size_t type);
+int json_builder_begin(struct json_builder_s *builder, size_t type) {
+  struct json_builder_frame_s *frame;
+  void *payload;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  /* json_object_s and json_array_s have the same layout, a start and a
+   * length. */
+  payload = json_builder_alloc(builder, sizeof(struct json_object_s));
+
+  if (json_null == payload) {
+    return 1;
+  }
+
+  ((struct json_object_s *)payload)->start = json_null;
+  ((struct json_object_s *)payload)->length = 0;
+
+  if (json_builder_add(builder, type, payload)) {
+    return 1;
+  }
+
+  frame = builder->free_frames;
+
+  if (json_null == frame) {
+    frame = (struct json_builder_frame_s *)json_builder_alloc(
+        builder, sizeof(struct json_builder_frame_s));
+
+    if (json_null == frame) {
+      return 1;
+    }
+  } else {
+    builder->free_frames = frame->parent;
+  }
+
+  frame->parent = builder->frame;
+  frame->last_element = json_null;
+  frame->name = json_null;
+
+  /* the value we just added is the last one in its parent (or the root). */
+  if (json_null == builder->frame) {
+    frame->value = builder->root;
+  } else if (json_type_array == builder->frame->value->type) {
+    frame->value =
+        ((struct json_array_element_s *)builder->frame->last_element)->value;
+  } else {
+    frame->value =
+        ((struct json_object_element_s *)builder->frame->last_element)->value;
+  }
+
+  builder->frame = frame;
+
+  return 0;
+}
+
+struct json_builder_s *
+json_builder_create(void *(*alloc_func_ptr)(void *user_data, size_t size),
+                    void *user_data) {
+  struct json_builder_s builder;
+  struct json_builder_s *result;
+
+  builder.alloc_func_ptr = alloc_func_ptr;
+  builder.user_data = user_data;
+  builder.chunks = json_null;
+  builder.data = json_null;
+  builder.data_size = 0;
+  builder.frame = json_null;
+  builder.free_frames = json_null;
+  builder.root = json_null;
+  builder.error = 0;
+
+  /* the builder lives at the start of the first chunk of the arena. */
+  result = (struct json_builder_s *)json_builder_alloc(
+      &builder, sizeof(struct json_builder_s));
+
+  if (json_null != result) {
+    memcpy(result, &builder, sizeof(struct json_builder_s));
+  }
+
+  return result;
+}
+
+int json_builder_begin_object(struct json_builder_s *builder) {
+  return json_builder_begin(builder, json_type_object);
+}
+
+int json_builder_begin_array(struct json_builder_s *builder) {
+  return json_builder_begin(builder, json_type_array);
+}
+
+int json_builder_end(struct json_builder_s *builder) {
+  struct json_builder_frame_s *const frame = builder->frame;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  if ((json_null == frame) || (json_null != frame->name)) {
+    /* there was no object or array to end, or a name had no value! */
+    builder->error = 1;
+    return 1;
+  }
+
+  builder->frame = frame->parent;
+  frame->parent = builder->free_frames;
+  builder->free_frames = frame;
+
+  return 0;
+}
+
+int json_builder_name(struct json_builder_s *builder, const char *name,
+                      size_t name_size) {
+  struct json_builder_frame_s *const frame = builder->frame;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  if ((json_null == frame) || (json_type_object != frame->value->type) ||
+      (json_null != frame->name)) {
+    /* names are only allowed before each value in an object! */
+    builder->error = 1;
+    return 1;
+  }
+
+  frame->name = json_builder_new_string(builder, name, name_size);
+
+  return json_null == frame->name;
+}
+
+int json_builder_string(struct json_builder_s *builder, const char *string,
+                        size_t string_size) {
+  struct json_string_s *payload;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  payload = json_builder_new_string(builder, string, string_size);
+
+  if (json_null == payload) {
+    return 1;
+  }
+
+  return json_builder_add(builder, json_type_string, payload);
+}
+
+json_weak int json_builder_number(struct json_builder_s *builder,
+                                  const char *number, size_t number_size);
+int json_builder_number(struct json_builder_s *builder, const char *number,
+                        size_t number_size) {
+  struct json_string_s *payload;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  /* json_number_s has the same layout as json_string_s. */
+  payload = json_builder_new_string(builder, number, number_size);
+
+  if (json_null == payload) {
+    return 1;
+  }
+
+  return json_builder_add(builder, json_type_number, payload);
+}
+
+int json_builder_integer(struct json_builder_s *builder, json_intmax_t value) {
+  char digits[32];
+
+  return json_builder_number(builder, digits,
+                             json_format_integer(value, digits));
+}
+
+int json_builder_double(struct json_builder_s *builder, double value) {
+  char digits[32];
+  const size_t size = json_format_double(value, digits);
+
+  if (0 == size) {
+    /* JSON can't represent infinities or NaN! */
+    builder->error = 1;
+    return 1;
+  }
+
+  return json_builder_number(builder, digits, size);
+}
+
+int json_builder_boolean(struct json_builder_s *builder, int value) {
+  if (builder->error) {
+    return 1;
+  }
+
+  return json_builder_add(builder, value ? json_type_true : json_type_false,
+                          json_null);
+}
+
+int json_builder_null(struct json_builder_s *builder) {
+  if (builder->error) {
+    return 1;
+  }
+
+  return json_builder_add(builder, json_type_null, json_null);
+}
+
+int json_builder_raw(struct json_builder_s *builder, const char *raw,
+                     size_t raw_size) {
+  struct json_string_s *payload;
+
+  if (builder->error) {
+    return 1;
+  }
+
+  if (json_parse_size(raw, raw_size, json_parse_flags_default, json_null,
+                      json_null, json_null, json_null)) {
+    /* the raw JSON text was malformed! */
+    builder->error = 1;
+    return 1;
+  }
+
+  /* json_raw_s has the same layout as json_string_s. */
+  payload = json_builder_new_string(builder, raw, raw_size);
+
+  if (json_null == payload) {
+    return 1;
+  }
+
+  return json_builder_add(builder, json_type_raw, payload);
+}
+
+struct json_value_s *json_builder_finish(struct json_builder_s *builder) {
+  if ((json_null == builder) || builder->error ||
+      (json_null != builder->frame)) {
+    /* an error occurred, or an object or array wasn't ended! */
+    return json_null;
+  }
+
+  return builder->root;
+}
+
+void json_builder_destroy(struct json_builder_s *builder) {
+  struct json_builder_chunk_s *chunk;
+
+  if ((json_null == builder) || (json_null != builder->alloc_func_ptr)) {
+    /* memory from a user allocator is theirs to release. */
+    return;
+  }
+
+  /* the builder itself is in the last chunk, so don't touch it again. */
+  chunk = builder->chunks;
+
+  while (json_null != chunk) {
+    struct json_builder_chunk_s *const next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+}
+
+/* an array or object that the writers are part way through. */
+struct json_write_frame_s {
+  /* the json_array_element_s or json_object_element_s being written (or null
+   * at the root). */
+  const void *element;
+  /* non-zero if element is a json_object_element_s. */
+  size_t is_object;
+  /* the cache entry of the array or object that element is in (only used
+   * when filling in a cache). */
+  struct json_write_cache_entry_s *entry;
+};
+
+/* the arrays and objects the writers are part way through, which move onto the
+ * heap once there are more than JSON_WRITE_STACK_SIZE of them so that deeply
+ * nested values don't need a deep C stack. The heap is alloc_func_ptr if it
+ * isn't null (and the memory is then the user's to release), or malloc. */
+struct json_write_stack_s {
+  struct json_write_frame_s *frames;
+  size_t size;
+  size_t capacity;
+  void *(*alloc_func_ptr)(void *, size_t);
+  void *user_data;
+  struct json_write_frame_s local[JSON_WRITE_STACK_SIZE];
+};
+
+json_weak void json_write_stack_init(struct json_write_stack_s *stack,
+                                     void *(*alloc_func_ptr)(void *, size_t),
+                                     void *user_data);
+void json_write_stack_init(struct json_write_stack_s *stack,
+                           void *(*alloc_func_ptr)(void *user_data,
+                                                   size_t size),
+                           void *user_data) {
+  stack->frames = stack->local;
+  stack->size = 0;
+  stack->capacity = JSON_WRITE_STACK_SIZE;
+  stack->alloc_func_ptr = alloc_func_ptr;
+  stack->user_data = user_data;
+}
+
+json_weak void json_write_stack_release(struct json_write_stack_s *stack);
+void json_write_stack_release(struct json_write_stack_s *stack) {
+  if ((stack->local != stack->frames) && (json_null == stack->alloc_func_ptr)) {
+    free(stack->frames);
+  }
+}
+
+json_weak void *json_write_no_alloc(void *user_data, size_t size);
+void *json_write_no_alloc(void *user_data, size_t size) {
+  /* the allocator for writers that must not allocate, which makes values
+   * nested too deeply for the stack on the C stack an error. */
+  (void)user_data;
+  (void)size;
+  return json_null;
+}
+
+json_weak int json_write_stack_grow(struct json_write_stack_s *stack);
+int json_write_stack_grow(struct json_write_stack_s *stack) {
+  struct json_write_frame_s *frames;
+
+  if (stack->capacity >
+      ((size_t)-1) / (2 * sizeof(struct json_write_frame_s))) {
+    /* the stack can't get any bigger! */
+    return 1;
+  }
+
+  if (json_null == stack->alloc_func_ptr) {
+    frames = (struct json_write_frame_s *)malloc(
+        2 * stack->capacity * sizeof(struct json_write_frame_s));
+  } else {
+    frames = (struct json_write_frame_s *)stack->alloc_func_ptr(
+        stack->user_data,
+        2 * stack->capacity * sizeof(struct json_write_frame_s));
+  }
+
+  if (json_null == frames) {
+    /* malloc failed! */
+    return 1;
+  }
+
+  memcpy(frames, stack->frames,
+         stack->size * sizeof(struct json_write_frame_s));
+  json_write_stack_release(stack);
+
+  stack->frames = frames;
+  stack->capacity *= 2;
+
+  return 0;
+}
+
+/* a newline followed by as many whole indents as fit in
+ * JSON_WRITE_INDENT_SIZE bytes, so that the start of most lines can be written
+ * with one memcpy of its first newline_size + depth * indent_size bytes. */
+struct json_write_indent_s {
+  const char *indent;
+  size_t indent_size;
+  const char *newline;
+  size_t newline_size;
+  /* the bytes of data that are used. */
+  size_t size;
+  /* the number of indents in data after the newline. */
+  size_t indents;
+  char data[JSON_WRITE_INDENT_SIZE];
+};
+
+json_weak void json_write_indent_init(struct json_write_indent_s *lines,
+                                      const char *indent,
+                                      const char *newline);
+void json_write_indent_init(struct json_write_indent_s *lines,
+                            const char *indent, const char *newline) {
+  lines->indent = indent;
+  lines->indent_size = strlen(indent);
+  lines->newline = newline;
+  lines->newline_size = strlen(newline);
+  lines->size = 0;
+  lines->indents = 0;
+
+  if (lines->newline_size > JSON_WRITE_INDENT_SIZE) {
+    /* every line will be written a piece at a time. */
+    return;
+  }
+
+  memcpy(lines->data, newline, lines->newline_size);
+  lines->size = lines->newline_size;
+
+  while ((0 != lines->indent_size) &&
+         (lines->size + lines->indent_size <= JSON_WRITE_INDENT_SIZE)) {
+    memcpy(lines->data + lines->size, indent, lines->indent_size);
+    lines->size += lines->indent_size;
+    lines->indents++;
+  }
+}
+
+json_weak char *json_write_indent_line(const struct json_write_indent_s *lines,
+                                       size_t depth, char *data);
+char *json_write_indent_line(const struct json_write_indent_s *lines,
+                             size_t depth, char *data) {
+  const size_t size = lines->newline_size + depth * lines->indent_size;
+  size_t count;
+
+  if (size <= lines->size) {
+    memcpy(data, lines->data, size);
+    return data + size;
+  }
+
+  /* deeper lines are written a run of indents at a time, so that writing them
+   * never needs more memory. */
+  memcpy(data, lines->newline, lines->newline_size);
+  data += lines->newline_size;
+
+  while (0 < depth) {
+    if (0 == lines->indents) {
+      memcpy(data, lines->indent, lines->indent_size);
+      count = 1;
+    } else {
+      count = (depth < lines->indents) ? depth : lines->indents;
+      memcpy(data, lines->data + lines->newline_size,
+             count * lines->indent_size);
+    }
+
+    data += count * lines->indent_size;
+    depth -= count;
+  }
+
+  return data;
+}
+
+json_weak int json_write_minified_get_value_size(
+    const struct json_value_s *value, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *, size_t), void *user_data, size_t *size);
+
+json_weak int json_write_get_number_size(const struct json_number_s *number,
+                                         size_t *size);
+int json_write_get_number_size(const struct json_number_s *number,
+                               size_t *size) {
+  json_uintmax_t parsed_number;
+  size_t i;
+
+  if (number->number_size >= 2) {
+    switch (number->number[1]) {
+    default:
+      break;
+    case 'x':
+    case 'X':
+      /* the number is a json_parse_flags_allow_hexadecimal_numbers hexadecimal
+       * so we have to do extra work to convert it to a non-hexadecimal for JSON
+       * output. */
+      parsed_number = json_strtoumax(number->number, json_null, 0);
+
+      i = 0;
+
+      do {
+        parsed_number /= 10;
+        i++;
+      } while (0 != parsed_number);
+
+      *size += i;
+      return 0;
+    }
+  }
+
+  /* check to see if the number has leading/trailing decimal point. */
+  i = 0;
+
+  /* skip any leading '+' or '-'. */
+  if ((i < number->number_size) &&
+      (('+' == number->number[i]) || ('-' == number->number[i]))) {
+    i++;
+  }
+
+  /* check if we have infinity. */
+  if ((i < number->number_size) && ('I' == number->number[i])) {
+    const char *inf = "Infinity";
+    size_t k;
+
+    for (k = i; k < number->number_size; k++) {
+      const char c = *inf++;
+
+      /* Check if we found the Infinity string! */
+      if ('\0' == c) {
+        break;
+      } else if (c != number->number[k]) {
+        break;
+      }
+    }
+
+    if ('\0' == *inf) {
+      /* Inf becomes 1.7976931348623158e308 because JSON can't support it. */
+      *size += 22;
+
+      /* if we had a leading '-' we need to record it in the JSON output. */
+      if ('-' == number->number[0]) {
+        *size += 1;
+      }
+    }
+
+    return 0;
+  }
+
+  /* check if we have nan. */
+  if ((i < number->number_size) && ('N' == number->number[i])) {
+    const char *nan = "NaN";
+    size_t k;
+
+    for (k = i; k < number->number_size; k++) {
+      const char c = *nan++;
+
+      /* Check if we found the NaN string! */
+      if ('\0' == c) {
+        break;
+      } else if (c != number->number[k]) {
+        break;
+      }
+    }
+
+    if ('\0' == *nan) {
+      /* NaN becomes 1 because JSON can't support it. */
+      *size += 1;
+
+      return 0;
+    }
+  }
+
+  /* if we had a leading decimal point. */
+  if ((i < number->number_size) && ('.' == number->number[i])) {
+    /* 1 + because we had a leading decimal point. */
+    *size += 1;
+    goto cleanup;
+  }
+
+  for (; i < number->number_size; i++) {
+    const char c = number->number[i];
+    if (!('0' <= c && c <= '9')) {
+      break;
+    }
+  }
+
+  /* if we had a trailing decimal point. */
+  if ((i + 1 == number->number_size) && ('.' == number->number[i])) {
+    /* 1 + because we had a trailing decimal point. */
+    *size += 1;
+    goto cleanup;
+  }
+
+cleanup:
+  *size += number->number_size; /* the actual string of the number. */
+
+  /* if we had a leading '+' we don't record it in the JSON output. */
+  if ('+' == number->number[0]) {
+    *size -= 1;
+  }
+
+  return 0;
+}
+
+json_weak size_t json_write_utf8_decode(const char *string, size_t size,
+                                        size_t *code_point);
+size_t json_write_utf8_decode(const char *string, size_t size,
+                              size_t *code_point) {
+  const unsigned char *const bytes = (const unsigned char *)string;
+  size_t length;
+  size_t minimum;
+  size_t i;
+
+  /* work out how long the sequence is from its leading byte. */
+  if (0xc0 == (0xe0 & bytes[0])) {
+    length = 2;
+    minimum = 0x80;
+    *code_point = 0x1f & bytes[0];
+  } else if (0xe0 == (0xf0 & bytes[0])) {
+    length = 3;
+    minimum = 0x800;
+    *code_point = 0x0f & bytes[0];
+  } else if (0xf0 == (0xf8 & bytes[0])) {
+    length = 4;
+    minimum = 0x10000;
+    *code_point = 0x07 & bytes[0];
+  } else {
+    /* a stray continuation byte, or a byte that is never in utf-8! */
+    return 0;
+  }
+
+  if (length > size) {
+    /* the sequence was cut short! */
+    return 0;
+  }
+
+  for (i = 1; i < length; i++) {
+    if (0x80 != (0xc0 & bytes[i])) {
+      /* the sequence was cut short! */
+      return 0;
+    }
+
+    *code_point = (*code_point << 6) | (0x3f & bytes[i]);
+  }
+
+  if ((*code_point < minimum) || (0x10ffff < *code_point) ||
+      ((0xd800 <= *code_point) && (*code_point <= 0xdfff))) {
+    /* an overlong encoding, a code point that is out of range, or a
+     * surrogate! */
+    return 0;
+  }
+
+  return length;
+}
+
+json_weak int json_write_get_ascii_string_size(const char *string, size_t size,
+                                               size_t *out_size);
+int json_write_get_ascii_string_size(const char *string, size_t size,
+                                     size_t *out_size) {
+  const size_t high_bits = (((size_t)-1) / 0xff) << 7;
+  size_t i = 0;
+
+  while (i < size) {
+    size_t code_point;
+    size_t length;
+
+    /* skip a word at a time while it is ASCII that needs no escaping. */
+    while (i + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, string + i, sizeof(size_t));
+
+      if ((high_bits & word) | json_swar_needs_escape(word)) {
+        break;
+      }
+
+      *out_size += sizeof(size_t);
+      i += sizeof(size_t);
+    }
+
+    if (i == size) {
+      break;
+    }
+
+    switch (string[i]) {
+    case '"':
+    case '\\':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+      *out_size += 2;
+      i++;
+      continue;
+    default:
+      break;
+    }
+
+    if (0 == (0x80 & (unsigned char)string[i])) {
+      *out_size += 1;
+      i++;
+      continue;
+    }
+
+    length = json_write_utf8_decode(string + i, size - i, &code_point);
+
+    if (0 == length) {
+      /* the string was not valid utf-8! */
+      return 1;
+    }
+
+    /* code points beyond the basic multilingual plane need a surrogate pair
+     * of \uXXXX escapes, and the rest need just one. */
+    *out_size += (0x10000 <= code_point) ? 12 : 6;
+    i += length;
+  }
+
+  return 0;
+}
+
+json_weak int json_write_get_string_size(const struct json_string_s *string,
+                                         size_t flags_bitset, size_t *size);
+int json_write_get_string_size(const struct json_string_s *string,
+                               size_t flags_bitset, size_t *size) {
+  size_t i;
+
+  if (json_write_flags_ensure_ascii & flags_bitset) {
+    *size += 2; /* need to encode the surrounding '"' characters. */
+
+    return json_write_get_ascii_string_size(string->string,
+                                            string->string_size, size);
+  }
+
+  for (i = 0; i < string->string_size; i++) {
+    /* skip a word at a time while nothing in it needs escaping. */
+    while (i + sizeof(size_t) <= string->string_size) {
+      size_t word;
+      memcpy(&word, string->string + i, sizeof(size_t));
+
+      if (json_swar_needs_escape(word)) {
+        break;
+      }
+
+      *size += sizeof(size_t);
+      i += sizeof(size_t);
+    }
+
+    if (i == string->string_size) {
+      break;
+    }
+
+    switch (string->string[i]) {
+    case '"':
+    case '\\':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+      *size += 2;
+      break;
+    default:
+      *size += 1;
+      break;
+    }
+  }
+
+  *size += 2; /* need to encode the surrounding '"' characters. */
+
+  return 0;
+}
+
+json_weak int json_write_get_raw_size(const struct json_raw_s *raw,
+                                      size_t flags_bitset, size_t *size);
+int json_write_get_raw_size(const struct json_raw_s *raw, size_t flags_bitset,
+                            size_t *size) {
+  size_t i = 0;
+  int in_string = 0;
+
+  if (!(json_write_flags_ensure_ascii & flags_bitset)) {
+    /* the raw JSON text is copied as is. */
+    *size += raw->raw_size;
+    return 0;
+  }
+
+  while (i < raw->raw_size) {
+    size_t code_point;
+    size_t length;
+
+    if (0 == (0x80 & (unsigned char)raw->raw[i])) {
+      if ('"' == raw->raw[i]) {
+        in_string = !in_string;
+      } else if (in_string && ('\\' == raw->raw[i]) &&
+                 (i + 1 < raw->raw_size)) {
+        /* skip the escaped character, which might be a '"'. */
+        *size += 1;
+        i++;
+      }
+
+      *size += 1;
+      i++;
+      continue;
+    }
+
+    /* non-ASCII can only be escaped inside a string. */
+    if (!in_string) {
+      return 1;
+    }
+
+    length = json_write_utf8_decode(raw->raw + i, raw->raw_size - i,
+                                    &code_point);
+
+    if (0 == length) {
+      /* the string was not valid utf-8! */
+      return 1;
+    }
+
+    *size += (0x10000 <= code_point) ? 12 : 6;
+    i += length;
+  }
+
+  return 0;
+}
+
+json_weak int json_write_minified_get_value_size(
+    const struct json_value_s *value, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *, size_t), void *user_data, size_t *size);
+int json_write_minified_get_value_size(
+    const struct json_value_s *value, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *user_data, size_t size), void *user_data,
+    size_t *size) {
+  struct json_write_stack_s stack;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  int error = 0;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+
+  for (;;) {
+    switch (value->type) {
+    default:
+      /* unknown value type found! */
+      error = 1;
+      break;
+    case json_type_number:
+      error = json_write_get_number_size(
+          (struct json_number_s *)value->payload, size);
+      break;
+    case json_type_string:
+      error = json_write_get_string_size(
+          (struct json_string_s *)value->payload, flags_bitset, size);
+      break;
+    case json_type_array:
+      array = (const struct json_array_s *)value->payload;
+
+      *size += 2; /* '[' and ']'. */
+
+      if ((0 == array->length) || (json_null == array->start)) {
+        break;
+      }
+
+      *size += array->length - 1; /* ','s seperate each element. */
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        error = 1;
+        break;
+      }
+
+      /* remember where we were, and move into the array. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      array_element = array->start;
+      object_element = json_null;
+      value = array_element->value;
+      continue;
+    case json_type_object:
+      object = (const struct json_object_s *)value->payload;
+
+      *size += 2; /* '{' and '}'. */
+
+      if ((0 == object->length) || (json_null == object->start)) {
+        break;
+      }
+
+      *size += object->length; /* ':'s seperate each name/value pair. */
+      *size += object->length - 1; /* ','s seperate each element. */
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        error = 1;
+        break;
+      }
+
+      /* remember where we were, and move into the object. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      object_element = object->start;
+      array_element = json_null;
+      error = json_write_get_string_size(object_element->name, flags_bitset,
+                                         size);
+      value = object_element->value;
+      continue;
+    case json_type_true:
+      *size += 4; /* the string "true". */
+      break;
+    case json_type_false:
+      *size += 5; /* the string "false". */
+      break;
+    case json_type_null:
+      *size += 4; /* the string "null". */
+      break;
+    case json_type_raw:
+      error = json_write_get_raw_size((struct json_raw_s *)value->payload,
+                                      flags_bitset, size);
+      break;
+    }
+
+    /* the value is done, so move on to the next element of the innermost
+     * array or object that has one. */
+    for (value = json_null; !error && (0 < stack.size);) {
+      if (json_null != object_element) {
+        object_element = object_element->next;
+
+        if (json_null != object_element) {
+          error = json_write_get_string_size(object_element->name,
+                                             flags_bitset, size);
+          value = object_element->value;
+          break;
+        }
+      } else {
+        array_element = array_element->next;
+
+        if (json_null != array_element) {
+          value = array_element->value;
+          break;
+        }
+      }
+
+      /* the array or object is done, so go back to where we were. */
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
+    }
+
+    if (error || (json_null == value)) {
+      break;
+    }
+  }
+
+  json_write_stack_release(&stack);
+
+  return error;
+}
+
+json_weak char *
+json_write_minified_value(const struct json_value_s *value, size_t flags_bitset,
+                          void *(*alloc_func_ptr)(void *, size_t),
+                          void *user_data, char *data);
+
+json_weak char *json_write_number(const struct json_number_s *number,
+                                  char *data);
+char *json_write_number(const struct json_number_s *number, char *data) {
+  json_uintmax_t parsed_number, backup;
+  size_t i;
+
+  if (number->number_size >= 2) {
+    switch (number->number[1]) {
+    default:
+      break;
+    case 'x':
+    case 'X':
+      /* The number is a json_parse_flags_allow_hexadecimal_numbers hexadecimal
+       * so we have to do extra work to convert it to a non-hexadecimal for JSON
+       * output. */
+      parsed_number = json_strtoumax(number->number, json_null, 0);
+
+      /* We need a copy of parsed number twice, so take a backup of it. */
+      backup = parsed_number;
+
+      i = 0;
+
+      do {
+        parsed_number /= 10;
+        i++;
+      } while (0 != parsed_number);
+
+      /* Restore parsed_number to its original value stored in the backup. */
+      parsed_number = backup;
+
+      /* Now use backup to take a copy of i, or the length of the string. */
+      backup = i;
+
+      do {
+        *(data + i - 1) = '0' + (char)(parsed_number % 10);
+        parsed_number /= 10;
+        i--;
+      } while (0 != parsed_number);
+
+      data += backup;
+
+      return data;
+    }
+  }
+
+  /* check to see if the number has leading/trailing decimal point. */
+  i = 0;
+
+  /* skip any leading '-'. */
+  if ((i < number->number_size) &&
+      (('+' == number->number[i]) || ('-' == number->number[i]))) {
+    i++;
+  }
+
+  /* check if we have infinity. */
+  if ((i < number->number_size) && ('I' == number->number[i])) {
+    const char *inf = "Infinity";
+    size_t k;
+
+    for (k = i; k < number->number_size; k++) {
+      const char c = *inf++;
+
+      /* Check if we found the Infinity string! */
+      if ('\0' == c) {
+        break;
+      } else if (c != number->number[k]) {
+        break;
+      }
+    }
+
+    if ('\0' == *inf++) {
+      const char *dbl_max;
+
+      /* if we had a leading '-' we need to record it in the JSON output. */
+      if ('-' == number->number[0]) {
+        *data++ = '-';
+      }
+
+      /* Inf becomes 1.7976931348623158e308 because JSON can't support it. */
+      for (dbl_max = "1.7976931348623158e308"; '\0' != *dbl_max; dbl_max++) {
+        *data++ = *dbl_max;
+      }
+
+      return data;
+    }
+  }
+
+  /* check if we have nan. */
+  if ((i < number->number_size) && ('N' == number->number[i])) {
+    const char *nan = "NaN";
+    size_t k;
+
+    for (k = i; k < number->number_size; k++) {
+      const char c = *nan++;
+
+      /* Check if we found the NaN string! */
+      if ('\0' == c) {
+        break;
+      } else if (c != number->number[k]) {
+        break;
+      }
+    }
+
+    if ('\0' == *nan++) {
+      /* NaN becomes 0 because JSON can't support it. */
+      *data++ = '0';
+      return data;
+    }
+  }
+
+  /* if we had a leading decimal point. */
+  if ((i < number->number_size) && ('.' == number->number[i])) {
+    i = 0;
+
+    /* skip any leading '+'. */
+    if ('+' == number->number[i]) {
+      i++;
+    }
+
+    /* output the leading '-' if we had one. */
+    if ('-' == number->number[i]) {
+      *data++ = '-';
+      i++;
+    }
+
+    /* insert a '0' to fix the leading decimal point for JSON output. */
+    *data++ = '0';
+
+    /* and output the rest of the number as normal. */
+    for (; i < number->number_size; i++) {
+      *data++ = number->number[i];
+    }
+
+    return data;
+  }
+
+  for (; i < number->number_size; i++) {
+    const char c = number->number[i];
+    if (!('0' <= c && c <= '9')) {
+      break;
+    }
+  }
+
+  /* if we had a trailing decimal point. */
+  if ((i + 1 == number->number_size) && ('.' == number->number[i])) {
+    i = 0;
+
+    /* skip any leading '+'. */
+    if ('+' == number->number[i]) {
+      i++;
+    }
+
+    /* output the leading '-' if we had one. */
+    if ('-' == number->number[i]) {
+      *data++ = '-';
+      i++;
+    }
+
+    /* and output the rest of the number as normal. */
+    for (; i < number->number_size; i++) {
+      *data++ = number->number[i];
+    }
+
+    /* insert a '0' to fix the trailing decimal point for JSON output. */
+    *data++ = '0';
+
+    return data;
+  }
+
+  i = 0;
+
+  /* skip any leading '+'. */
+  if ('+' == number->number[i]) {
+    i++;
+  }
+
+  for (; i < number->number_size; i++) {
+    *data++ = number->number[i];
+  }
+
+  return data;
+}
+
+json_weak char *json_write_string_chars(const char *string, size_t size,
+                                        char *data);
+char *json_write_string_chars(const char *string, size_t size, char *data) {
+  size_t i;
+
+  for (i = 0; i < size; i++) {
+    /* copy a word at a time while nothing in it needs escaping. */
+    while (i + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, string + i, sizeof(size_t));
+
+      if (json_swar_needs_escape(word)) {
+        break;
+      }
+
+      memcpy(data, &word, sizeof(size_t));
+      data += sizeof(size_t);
+      i += sizeof(size_t);
+    }
+
+    if (i == size) {
+      break;
+    }
+
+    switch (string[i]) {
+    case '"':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = '"';
+      break;
+    case '\\':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = '\\';
+      break;
+    case '\b':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = 'b';
+      break;
+    case '\f':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = 'f';
+      break;
+    case '\n':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = 'n';
+      break;
+    case '\r':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = 'r';
+      break;
+    case '\t':
+      *data++ = '\\'; /* escape the control character. */
+      *data++ = 't';
+      break;
+    default:
+      *data++ = string[i];
+      break;
+    }
+  }
+
+  return data;
+}
+
+json_weak char *json_write_unicode_escape(size_t code_unit, char *data);
+char *json_write_unicode_escape(size_t code_unit, char *data) {
+  const char *const hex = "0123456789abcdef";
+
+  *data++ = '\\';
+  *data++ = 'u';
+  *data++ = hex[0xf & (code_unit >> 12)];
+  *data++ = hex[0xf & (code_unit >> 8)];
+  *data++ = hex[0xf & (code_unit >> 4)];
+  *data++ = hex[0xf & code_unit];
+
+  return data;
+}
+
+json_weak char *json_write_ascii_string_chars(const char *string, size_t size,
+                                              char *data);
+char *json_write_ascii_string_chars(const char *string, size_t size,
+                                    char *data) {
+  const size_t high_bits = (((size_t)-1) / 0xff) << 7;
+  size_t i = 0;
+
+  while (i < size) {
+    size_t code_point = 0;
+    size_t length;
+
+    /* copy a word at a time while it is ASCII that needs no escaping. */
+    while (i + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, string + i, sizeof(size_t));
+
+      if ((high_bits & word) | json_swar_needs_escape(word)) {
+        break;
+      }
+
+      memcpy(data, &word, sizeof(size_t));
+      data += sizeof(size_t);
+      i += sizeof(size_t);
+    }
+
+    if (i == size) {
+      break;
+    }
+
+    if (0 == (0x80 & (unsigned char)string[i])) {
+      /* ASCII is escaped like json_write_string_chars does. */
+      data = json_write_string_chars(string + i, 1, data);
+      i++;
+      continue;
+    }
+
+    /* the string was sized by json_write_get_ascii_string_size, so we know it
+     * is valid utf-8. */
+    length = json_write_utf8_decode(string + i, size - i, &code_point);
+
+    if (0x10000 <= code_point) {
+      code_point -= 0x10000;
+      data = json_write_unicode_escape(0xd800 + (code_point >> 10), data);
+      data = json_write_unicode_escape(0xdc00 + (0x3ff & code_point), data);
+    } else {
+      data = json_write_unicode_escape(code_point, data);
+    }
+
+    i += length;
+  }
+
+  return data;
+}
+
+json_weak char *json_write_string(const struct json_string_s *string,
+                                  size_t flags_bitset, char *data);
+char *json_write_string(const struct json_string_s *string, size_t flags_bitset,
+                        char *data) {
+  *data++ = '"'; /* open the string. */
+
+  if (json_write_flags_ensure_ascii & flags_bitset) {
+    data = json_write_ascii_string_chars(string->string, string->string_size,
+                                         data);
+  } else {
+    data = json_write_string_chars(string->string, string->string_size, data);
+  }
+
+  *data++ = '"'; /* close the string. */
+
+  return data;
+}
+
+json_weak char *json_write_raw(const struct json_raw_s *raw,
+                               size_t flags_bitset, char *data);
+char *json_write_raw(const struct json_raw_s *raw, size_t flags_bitset,
+                     char *data) {
+  size_t i = 0;
+
+  if (!(json_write_flags_ensure_ascii & flags_bitset)) {
+    /* the raw JSON text is copied as is. */
+    if (0 < raw->raw_size) {
+      memcpy(data, raw->raw, raw->raw_size);
+    }
+
+    return data + raw->raw_size;
+  }
+
+  while (i < raw->raw_size) {
+    size_t code_point;
+    size_t length;
+
+    if (0 == (0x80 & (unsigned char)raw->raw[i])) {
+      *data++ = raw->raw[i++];
+      continue;
+    }
+
+    /* the raw JSON text was sized by json_write_get_raw_size, so we know any
+     * non-ASCII is valid utf-8 inside a string, which is escaped. */
+    length = json_write_utf8_decode(raw->raw + i, raw->raw_size - i,
+                                    &code_point);
+    data = json_write_ascii_string_chars(raw->raw + i, length, data);
+    i += length;
+  }
+
+  return data;
+}
+
+json_weak char *
+json_write_minified_value(const struct json_value_s *value, size_t flags_bitset,
+                          void *(*alloc_func_ptr)(void *, size_t),
+                          void *user_data, char *data);
+char *json_write_minified_value(const struct json_value_s *value,
+                                size_t flags_bitset,
+                                void *(*alloc_func_ptr)(void *user_data,
+                                                        size_t size),
+                                void *user_data, char *data) {
+  struct json_write_stack_s stack;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+
+  for (;;) {
+    switch (value->type) {
+    default:
+      /* unknown value type found! */
+      data = json_null;
+      break;
+    case json_type_number:
+      data = json_write_number((struct json_number_s *)value->payload, data);
+      break;
+    case json_type_string:
+      data = json_write_string((struct json_string_s *)value->payload,
+                               flags_bitset, data);
+      break;
+    case json_type_array:
+      array = (const struct json_array_s *)value->payload;
+
+      *data++ = '['; /* open the array. */
+
+      if ((0 == array->length) || (json_null == array->start)) {
+        *data++ = ']'; /* close the array. */
+        break;
+      }
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        data = json_null;
+        break;
+      }
+
+      /* remember where we were, and move into the array. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      array_element = array->start;
+      object_element = json_null;
+      value = array_element->value;
+      continue;
+    case json_type_object:
+      object = (const struct json_object_s *)value->payload;
+
+      *data++ = '{'; /* open the object. */
+
+      if ((0 == object->length) || (json_null == object->start)) {
+        *data++ = '}'; /* close the object. */
+        break;
+      }
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        data = json_null;
+        break;
+      }
+
+      /* remember where we were, and move into the object. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      object_element = object->start;
+      array_element = json_null;
+
+      data = json_write_string(object_element->name, flags_bitset, data);
+      *data++ = ':'; /* ':'s seperate each name/value pair. */
+
+      value = object_element->value;
+      continue;
+    case json_type_true:
+      data[0] = 't';
+      data[1] = 'r';
+      data[2] = 'u';
+      data[3] = 'e';
+      data += 4;
+      break;
+    case json_type_false:
+      data[0] = 'f';
+      data[1] = 'a';
+      data[2] = 'l';
+      data[3] = 's';
+      data[4] = 'e';
+      data += 5;
+      break;
+    case json_type_null:
+      data[0] = 'n';
+      data[1] = 'u';
+      data[2] = 'l';
+      data[3] = 'l';
+      data += 4;
+      break;
+    case json_type_raw:
+      data = json_write_raw((struct json_raw_s *)value->payload, flags_bitset,
+                            data);
+      break;
+    }
+
+    /* the value is done, so move on to the next element of the innermost
+     * array or object that has one, closing the others. */
+    for (value = json_null; (json_null != data) && (0 < stack.size);) {
+      if (json_null != object_element) {
+        object_element = object_element->next;
+
+        if (json_null != object_element) {
+          *data++ = ','; /* ','s seperate each element. */
+          data = json_write_string(object_element->name, flags_bitset, data);
+          *data++ = ':'; /* ':'s seperate each name/value pair. */
+
+          value = object_element->value;
+          break;
+        }
+
+        *data++ = '}'; /* close the object. */
+      } else {
+        array_element = array_element->next;
+
+        if (json_null != array_element) {
+          *data++ = ','; /* ','s seperate each element. */
+
+          value = array_element->value;
+          break;
+        }
+
+        *data++ = ']'; /* close the array. */
+      }
+
+      /* the array or object is done, so go back to where we were. */
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
+    }
+
+    if ((json_null == data) || (json_null == value)) {
+      break;
+    }
+  }
+
+  json_write_stack_release(&stack);
+
+  return data;
+}
+
+void *json_write_minified(const struct json_value_s *value, size_t *out_size) {
+  return json_write_minified_ex(value, json_null, json_null, out_size);
+}
+
+void *json_write_minified_ex(const struct json_value_s *value,
+                             void *(*alloc_func_ptr)(void *user_data,
+                                                     size_t size),
+                             void *user_data, size_t *out_size) {
+  return json_write_minified_flags(value, json_write_flags_default,
+                                   alloc_func_ptr, user_data, out_size);
+}
+
+void *json_write_minified_flags(const struct json_value_s *value,
+                                size_t flags_bitset,
+                                void *(*alloc_func_ptr)(void *user_data,
+                                                        size_t size),
+                                void *user_data, size_t *out_size) {
+  size_t size = 0;
+  char *data = json_null;
+  char *data_end = json_null;
+
+  if (json_null == value) {
+    return json_null;
+  }
+
+  if (json_write_minified_get_value_size(value, flags_bitset, alloc_func_ptr,
+                                         user_data, &size)) {
+    /* value was malformed! */
+    return json_null;
+  }
+
+  size += 1; /* for the '\0' null terminating character. */
+
+  if (json_null == alloc_func_ptr) {
+    data = (char *)malloc(size);
+  } else {
+    data = (char *)alloc_func_ptr(user_data, size);
+  }
+
+  if (json_null == data) {
+    /* malloc failed! */
+    return json_null;
+  }
+
+  data_end = json_write_minified_value(value, flags_bitset, alloc_func_ptr,
+                                       user_data, data);
+
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(data);
+    }
+
+    return json_null;
+  }
+
+  /* null terminated the string. */
+  *data_end = '\0';
+
+  if (json_null != out_size) {
+    *out_size = size;
+  }
+
+  return data;
+}
+
+int json_write_minified_into(const struct json_value_s *value, void *buffer,
+                             size_t capacity, size_t *needed) {
+  size_t size = 0;
+  char *data_end = json_null;
+
+  if (json_null != needed) {
+    *needed = 0;
+  }
+
+  if (json_null == value) {
+    return 1;
+  }
+
+  if (json_write_minified_get_value_size(value, json_write_flags_default,
+                                         json_write_no_alloc, json_null,
+                                         &size)) {
+    /* value was malformed! */
+    return 1;
+  }
+
+  size += 1; /* for the '\0' null terminating character. */
+
+  if (json_null != needed) {
+    *needed = size;
+  }
+
+  if ((json_null == buffer) || (capacity < size)) {
+    /* the buffer is too small! */
+    return 1;
+  }
+
+  data_end = json_write_minified_value(value, json_write_flags_default,
+                                       json_write_no_alloc, json_null,
+                                       (char *)buffer);
+
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    return 1;
+  }
+
+  /* null terminated the string. */
+  *data_end = '\0';
+
+  return 0;
+}
+
+size_t json_write_minified_split(const struct json_value_s *value,
+                                 struct json_write_slice_s *slices,
+                                 size_t slices_capacity) {
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  size_t length = 0;
+  size_t slices_size, slice, index;
+
+  if ((json_null == value) || (json_null == slices) || (0 == slices_capacity)) {
+    return 0;
+  }
+
+  if (json_type_array == value->type) {
+    array_element = ((struct json_array_s *)value->payload)->start;
+    length = ((struct json_array_s *)value->payload)->length;
+  } else if (json_type_object == value->type) {
+    object_element = ((struct json_object_s *)value->payload)->start;
+    length = ((struct json_object_s *)value->payload)->length;
+  }
+
+  /* every slice gets at least one element (or the whole value). */
+  slices_size = (length < slices_capacity) ? length : slices_capacity;
+
+  if (0 == slices_size) {
+    slices_size = 1;
+  }
+
+  for (slice = 0, index = 0; slice < slices_size; slice++) {
+    /* split the elements as evenly as we can. */
+    const size_t end = (length / slices_size) * (slice + 1) +
+                       ((length % slices_size) * (slice + 1)) / slices_size;
+
+    slices[slice].index = index;
+    slices[slice].length = end - index;
+    slices[slice].offset = 0;
+    slices[slice].size = 0;
+
+    if (json_null != array_element) {
+      slices[slice].start = array_element;
+    } else {
+      slices[slice].start = object_element;
+    }
+
+    for (; index < end; index++) {
+      if (json_null != array_element) {
+        array_element = array_element->next;
+      } else {
+        object_element = object_element->next;
+      }
+    }
+  }
+
+  return slices_size;
+}
+
+int json_write_minified_slice_size(const struct json_value_s *value,
+                                   struct json_write_slice_s *slice) {
+  size_t length, i;
+  size_t size = 0;
+
+  if ((json_null == value) || (json_null == slice)) {
+    return 1;
+  }
+
+  if (json_type_array == value->type) {
+    const struct json_array_element_s *element =
+        (const struct json_array_element_s *)slice->start;
+
+    length = ((struct json_array_s *)value->payload)->length;
+
+    for (i = 0; i < slice->length; i++, element = element->next) {
+      if (json_write_minified_get_value_size(element->value,
+                                             json_write_flags_default,
+                                             json_null, json_null, &size)) {
+        /* value was malformed! */
+        return 1;
+      }
+    }
+  } else if (json_type_object == value->type) {
+    const struct json_object_element_s *element =
+        (const struct json_object_element_s *)slice->start;
+
+    length = ((struct json_object_s *)value->payload)->length;
+
+    for (i = 0; i < slice->length; i++, element = element->next) {
+      if (json_write_get_string_size(element->name, json_write_flags_default,
+                                     &size) ||
+          json_write_minified_get_value_size(element->value,
+                                             json_write_flags_default,
+                                             json_null, json_null, &size)) {
+        /* value was malformed! */
+        return 1;
+      }
+    }
+
+    size += slice->length; /* ':'s seperate each name/value pair. */
+  } else {
+    /* the slice is the whole value, and the '\0' null terminating character.
+     */
+    if (json_write_minified_get_value_size(value, json_write_flags_default,
+                                           json_null, json_null, &size)) {
+      return 1;
+    }
+
+    slice->size = size + 1;
+    return 0;
+  }
+
+  /* ','s come before every element but the first. */
+  size += slice->length;
+
+  if ((0 == slice->index) && (0 < slice->length)) {
+    size -= 1;
+  }
+
+  if (0 == slice->index) {
+    size += 1; /* the opening '[' or '{'. */
+  }
+
+  if (slice->index + slice->length == length) {
+    size += 2; /* the closing ']' or '}', and the '\0'. */
+  }
+
+  slice->size = size;
+
+  return 0;
+}
+
+size_t json_write_minified_slice_offsets(struct json_write_slice_s *slices,
+                                         size_t slices_size) {
+  size_t offset = 0;
+  size_t i;
+
+  for (i = 0; i < slices_size; i++) {
+    slices[i].offset = offset;
+    offset += slices[i].size;
+  }
+
+  return offset;
+}
+
+int json_write_minified_slice(const struct json_value_s *value,
+                              const struct json_write_slice_s *slice,
+                              void *buffer) {
+  char *data;
+  size_t length, i;
+
+  if ((json_null == value) || (json_null == slice) || (json_null == buffer)) {
+    return 1;
+  }
+
+  data = (char *)buffer + slice->offset;
+
+  if (json_type_array == value->type) {
+    const struct json_array_element_s *element =
+        (const struct json_array_element_s *)slice->start;
+
+    length = ((struct json_array_s *)value->payload)->length;
+
+    if (0 == slice->index) {
+      *data++ = '['; /* open the array. */
+    }
+
+    for (i = 0; i < slice->length; i++, element = element->next) {
+      if (0 < slice->index + i) {
+        *data++ = ','; /* ','s seperate each element. */
+      }
+
+      data = json_write_minified_value(element->value,
+                                       json_write_flags_default, json_null,
+                                       json_null, data);
+
+      if (json_null == data) {
+        /* value was malformed! */
+        return 1;
+      }
+    }
+
+    if (slice->index + slice->length == length) {
+      *data++ = ']'; /* close the array. */
+      *data = '\0';
+    }
+  } else if (json_type_object == value->type) {
+    const struct json_object_element_s *element =
+        (const struct json_object_element_s *)slice->start;
+
+    length = ((struct json_object_s *)value->payload)->length;
+
+    if (0 == slice->index) {
+      *data++ = '{'; /* open the object. */
+    }
+
+    for (i = 0; i < slice->length; i++, element = element->next) {
+      if (0 < slice->index + i) {
+        *data++ = ','; /* ','s seperate each element. */
+      }
+
+      data = json_write_string(element->name, json_write_flags_default, data);
+
+      *data++ = ':'; /* ':'s seperate each name/value pair. */
+
+      data = json_write_minified_value(element->value,
+                                       json_write_flags_default, json_null,
+                                       json_null, data);
+
+      if (json_null == data) {
+        /* value was malformed! */
+        return 1;
+      }
+    }
+
+    if (slice->index + slice->length == length) {
+      *data++ = '}'; /* close the object. */
+      *data = '\0';
+    }
+  } else {
+    data = json_write_minified_value(value, json_write_flags_default,
+                                     json_null, json_null, data);
+
+    if (json_null == data) {
+      /* value was malformed! */
+      return 1;
+    }
+
+    *data = '\0';
+  }
+
+  return 0;
+}
+
+struct json_write_segments_s {
+  struct json_write_segment_s *segments;
+  size_t size;
+  size_t capacity;
+  /* where the staged bytes that no segment points at yet start. */
+  size_t pending;
+  int (*write_func_ptr)(void *user_data,
+                        const struct json_write_segment_s *segments,
+                        size_t size);
+};
+
+struct json_write_buffer_s {
+  char *data;
+  size_t size;
+  size_t capacity;
+  void *(*realloc_func_ptr)(void *user_data, void *ptr, size_t size);
+  int (*write_func_ptr)(void *user_data, const void *data, size_t size);
+  struct json_write_segments_s *segments;
+  void *user_data;
+  const char *indent;
+  size_t indent_size;
+  const char *newline;
+  size_t newline_size;
+  /* non-zero if the line breaks in raw values are written as spaces. */
+  size_t single_line;
+};
+
+json_weak int json_write_buffer_segment(struct json_write_buffer_s *buffer,
+                                        const char *data, size_t size);
+int json_write_buffer_segment(struct json_write_buffer_s *buffer,
+                              const char *data, size_t size) {
+  struct json_write_segments_s *const segments = buffer->segments;
+  struct json_write_segment_s *segment;
+
+  if (0 == size) {
+    return 0;
+  }
+
+  if (0 < segments->size) {
+    segment = segments->segments + segments->size - 1;
+
+    if ((const char *)segment->data + segment->size == data) {
+      /* the bytes follow straight on from the last segment, so extend it. */
+      segment->size += size;
+      return 0;
+    }
+  }
+
+  if (segments->size == segments->capacity) {
+    /* the segments are full, so hand them on (the staged bytes they point at
+     * are left where they are). */
+    if (segments->write_func_ptr(buffer->user_data, segments->segments,
+                                 segments->size)) {
+      /* the write failed! */
+      return 1;
+    }
+
+    segments->size = 0;
+  }
+
+  segment = segments->segments + segments->size++;
+  segment->data = data;
+  segment->size = size;
+
+  return 0;
+}
+
+json_weak int json_write_buffer_reference(struct json_write_buffer_s *buffer,
+                                          const char *data, size_t size);
+int json_write_buffer_reference(struct json_write_buffer_s *buffer,
+                                const char *data, size_t size) {
+  struct json_write_segments_s *const segments = buffer->segments;
+
+  /* the bytes staged so far have to come out before the referenced ones. */
+  if (json_write_buffer_segment(buffer, buffer->data + segments->pending,
+                                buffer->size - segments->pending)) {
+    return 1;
+  }
+
+  segments->pending = buffer->size;
+
+  return json_write_buffer_segment(buffer, data, size);
+}
+
+json_weak int json_write_buffer_flush(struct json_write_buffer_s *buffer,
+                                      size_t needed);
+int json_write_buffer_flush(struct json_write_buffer_s *buffer,
+                            size_t needed) {
+  size_t capacity = (0 == buffer->capacity) ? 256 : buffer->capacity;
+  char *data;
+
+  if (json_null != buffer->segments) {
+    struct json_write_segments_s *const segments = buffer->segments;
+
+    /* the staging buffer is about to be reused, so hand on every segment that
+     * could point into it. */
+    if (json_write_buffer_reference(buffer, json_null, 0)) {
+      return 1;
+    }
+
+    if ((0 < segments->size) &&
+        segments->write_func_ptr(buffer->user_data, segments->segments,
+                                 segments->size)) {
+      /* the write failed! */
+      return 1;
+    }
+
+    segments->size = 0;
+    segments->pending = 0;
+    buffer->size = 0;
+
+    return 0;
+  }
+
+  if (json_null != buffer->write_func_ptr) {
+    /* the buffer is a fixed size staging buffer, so hand everything in it on
+     * (the caller has to check if there is now enough room). */
+    if ((0 < buffer->size) &&
+        buffer->write_func_ptr(buffer->user_data, buffer->data, buffer->size)) {
+      /* the write failed! */
+      return 1;
+    }
+
+    buffer->size = 0;
+
+    return 0;
+  }
+
+  /* grow geometrically so that writing n bytes costs O(n) copying overall. */
+  while (capacity < buffer->size + needed) {
+    if (capacity > ((size_t)-1) / 2) {
+      /* the buffer can't get any bigger! */
+      return 1;
+    }
+
+    capacity *= 2;
+  }
+
+  if (json_null == buffer->realloc_func_ptr) {
+    data = (char *)realloc(buffer->data, capacity);
+  } else {
+    data = (char *)buffer->realloc_func_ptr(buffer->user_data, buffer->data,
+                                            capacity);
+  }
+
+  if (json_null == data) {
+    /* realloc failed! */
+    return 1;
+  }
+
+  buffer->data = data;
+  buffer->capacity = capacity;
+
+  return 0;
+}
+
+json_weak char *json_write_buffer_reserve(struct json_write_buffer_s *buffer,
+                                          size_t size);
+char *json_write_buffer_reserve(struct json_write_buffer_s *buffer,
+                                size_t size) {
+  char *data;
+
+  if (buffer->capacity - buffer->size < size) {
+    if (json_write_buffer_flush(buffer, size)) {
+      return json_null;
+    }
+
+    if (buffer->capacity - buffer->size < size) {
+      /* the staging buffer is too small to ever hold size bytes! */
+      return json_null;
+    }
+  }
+
+  data = buffer->data + buffer->size;
+  buffer->size += size;
+
+  return data;
+}
+
+json_weak int json_write_buffer_bytes(struct json_write_buffer_s *buffer,
+                                      const char *data, size_t size);
+int json_write_buffer_bytes(struct json_write_buffer_s *buffer,
+                            const char *data, size_t size) {
+  char *destination;
+
+  if ((json_null != buffer->segments) && (buffer->capacity < size)) {
+    /* too big to stage, so point at the bytes where they are. */
+    return json_write_buffer_reference(buffer, data, size);
+  }
+
+  if ((json_null != buffer->write_func_ptr) && (buffer->capacity < size)) {
+    /* too big to stage, so flush what we have and write the bytes directly. */
+    if (json_write_buffer_flush(buffer, size)) {
+      return 1;
+    }
+
+    return buffer->write_func_ptr(buffer->user_data, data, size);
+  }
+
+  destination = json_write_buffer_reserve(buffer, size);
+
+  if (json_null == destination) {
+    return 1;
+  }
+
+  memcpy(destination, data, size);
+
+  return 0;
+}
+
+json_weak int json_write_buffer_number(struct json_write_buffer_s *buffer,
+                                       const struct json_number_s *number);
+int json_write_buffer_number(struct json_write_buffer_s *buffer,
+                             const struct json_number_s *number) {
+  size_t size = 0;
+  size_t i = 0;
+  size_t start;
+  char *data;
+
+  if (json_write_get_number_size(number, &size)) {
+    return 1;
+  }
+
+  if (((json_null == buffer->write_func_ptr) &&
+       (json_null == buffer->segments)) ||
+      (size <= buffer->capacity)) {
+    data = json_write_buffer_reserve(buffer, size);
+
+    if (json_null == data) {
+      return 1;
+    }
+
+    (void)json_write_number(number, data);
+
+    return 0;
+  }
+
+  /* the number is too big to stage. Only decimal numbers can be this long, so
+   * skip any leading '+' and fix up a leading or trailing decimal point like
+   * json_write_number does while writing the rest as is. */
+  if ('+' == number->number[i]) {
+    i++;
+  }
+
+  start = i;
+
+  if ('-' == number->number[i]) {
+    i++;
+  }
+
+  if (json_write_buffer_bytes(buffer, number->number + start, i - start)) {
+    return 1;
+  }
+
+  if (('.' == number->number[i]) && json_write_buffer_bytes(buffer, "0", 1)) {
+    return 1;
+  }
+
+  if (json_write_buffer_bytes(buffer, number->number + i,
+                              number->number_size - i)) {
+    return 1;
+  }
+
+  if (('.' != number->number[i]) &&
+      ('.' == number->number[number->number_size - 1])) {
+    return json_write_buffer_bytes(buffer, "0", 1);
+  }
+
+  return 0;
+}
+
+json_weak int json_write_buffer_segment_run(struct json_write_buffer_s *buffer,
+                                            const char *data, size_t size);
+int json_write_buffer_segment_run(struct json_write_buffer_s *buffer,
+                                  const char *data, size_t size) {
+  /* point at a run of characters that need no escaping if it is long enough
+   * to be worth it, and copy it otherwise. */
+  if (JSON_WRITE_SEGMENT_REFERENCE_SIZE <= size) {
+    return json_write_buffer_reference(buffer, data, size);
+  }
+
+  return json_write_buffer_bytes(buffer, data, size);
+}
+
+json_weak int
+json_write_buffer_segment_string(struct json_write_buffer_s *buffer,
+                                 const struct json_string_s *string);
+int json_write_buffer_segment_string(struct json_write_buffer_s *buffer,
+                                     const struct json_string_s *string) {
+  const char *const src = string->string;
+  const size_t size = string->string_size;
+  size_t start = 0;
+  size_t i = 0;
+  char *data;
+
+  if (json_write_buffer_bytes(buffer, "\"", 1)) {
+    return 1;
+  }
+
+  while (i < size) {
+    char c;
+
+    /* skip a word at a time while nothing in it needs escaping. */
+    while (i + sizeof(size_t) <= size) {
+      size_t word;
+      memcpy(&word, src + i, sizeof(size_t));
+
+      if (json_swar_needs_escape(word)) {
+        break;
+      }
+
+      i += sizeof(size_t);
+    }
+
+    if (i == size) {
+      break;
+    }
+
+    c = src[i];
+
+    if (('"' != c) && ('\\' != c) && ('\b' != c) && ('\f' != c) &&
+        ('\n' != c) && ('\r' != c) && ('\t' != c)) {
+      /* other control characters are written as is. */
+      i++;
+      continue;
+    }
+
+    if (json_write_buffer_segment_run(buffer, src + start, i - start)) {
+      return 1;
+    }
+
+    if ((buffer->capacity - buffer->size < 2) &&
+        json_write_buffer_flush(buffer, 2)) {
+      return 1;
+    }
+
+    data = json_write_string_chars(src + i, 1, buffer->data + buffer->size);
+    buffer->size = (size_t)(data - buffer->data);
+
+    start = ++i;
+  }
+
+  if (json_write_buffer_segment_run(buffer, src + start, size - start)) {
+    return 1;
+  }
+
+  return json_write_buffer_bytes(buffer, "\"", 1);
+}
+
+json_weak int json_write_buffer_string(struct json_write_buffer_s *buffer,
+                                       const struct json_string_s *string);
+int json_write_buffer_string(struct json_write_buffer_s *buffer,
+                             const struct json_string_s *string) {
+  size_t i;
+  char *data;
+
+  if ((json_null != buffer->segments) &&
+      (JSON_WRITE_SEGMENT_REFERENCE_SIZE <= string->string_size)) {
+    /* the string might have runs long enough to point at. */
+    return json_write_buffer_segment_string(buffer, string);
+  }
+
+  /* every character needs at most 2 bytes once escaped, plus the quotes. */
+  if ((buffer->capacity - buffer->size < 2 * string->string_size + 2) &&
+      json_write_buffer_flush(buffer, 2 * string->string_size + 2)) {
+    return 1;
+  }
 
-      /* we need to record whether we had any leading digits for checks later.
-       */
-      had_leading_digits = 1;
-    }
+  if (2 * string->string_size + 2 <= buffer->capacity - buffer->size) {
+    data = json_write_string(string, json_write_flags_default,
+                             buffer->data + buffer->size);
+    buffer->size = (size_t)(data - buffer->data);
 
-    if ((offset < size) && ('.' == src[offset])) {
-      offset++;
+    return 0;
+  }
 
-      if ((offset >= size) || !('0' <= src[offset] && src[offset] <= '9')) {
-        if (!(json_parse_flags_allow_leading_or_trailing_decimal_point &
-              flags_bitset) ||
-            !had_leading_digits) {
-          /* a decimal point must be followed by at least one digit. */
-          state->error = json_parse_error_invalid_number_format;
-          state->offset = offset;
-          return 1;
-        }
-      }
+  /* the string is too big to stage in one go, so escape it in pieces that fit
+   * into the (now empty) staging buffer. */
+  buffer->data[buffer->size++] = '"'; /* open the string. */
 
-      /* a decimal point can be followed by more digits of course! */
-      while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9')) {
-        offset++;
+  for (i = 0; i < string->string_size;) {
+    size_t count = (buffer->capacity - buffer->size) / 2;
+
+    if (count > string->string_size - i) {
+      count = string->string_size - i;
+    }
+
+    if (0 == count) {
+      if ((0 == buffer->size) || json_write_buffer_flush(buffer, 2)) {
+        /* the staging buffer is too small to hold an escaped character! */
+        return 1;
       }
+
+      continue;
     }
 
-    if ((offset < size) && ('e' == src[offset] || 'E' == src[offset])) {
-      /* our number has an exponent! Skip 'e' or 'E'. */
-      offset++;
+    data = json_write_string_chars(string->string + i, count,
+                                   buffer->data + buffer->size);
+    buffer->size = (size_t)(data - buffer->data);
+    i += count;
+  }
 
-      if ((offset < size) && ('-' == src[offset] || '+' == src[offset])) {
-        /* skip optional '-' or '+'. */
-        offset++;
-      }
+  if ((buffer->capacity == buffer->size) &&
+      json_write_buffer_flush(buffer, 1)) {
+    return 1;
+  }
 
-      if ((offset < size) && !('0' <= src[offset] && src[offset] <= '9')) {
-        /* an exponent must have at least one digit! */
-        state->error = json_parse_error_invalid_number_format;
-        state->offset = offset;
-        return 1;
-      }
+  buffer->data[buffer->size++] = '"'; /* close the string. */
 
-      /* consume exponent digits. */
-      do {
-        offset++;
-      } while ((offset < size) && ('0' <= src[offset] && src[offset] <= '9'));
+  return 0;
+}
+
+json_weak int json_write_buffer_char(struct json_write_buffer_s *buffer,
+                                     char c);
+int json_write_buffer_char(struct json_write_buffer_s *buffer, char c) {
+  if ((buffer->capacity == buffer->size) &&
+      json_write_buffer_flush(buffer, 1)) {
+    return 1;
+  }
+
+  buffer->data[buffer->size++] = c;
+
+  return 0;
+}
+
+json_weak int json_write_buffer_newline(struct json_write_buffer_s *buffer,
+                                        size_t depth);
+int json_write_buffer_newline(struct json_write_buffer_s *buffer,
+                              size_t depth) {
+  const size_t size = buffer->newline_size + depth * buffer->indent_size;
+  size_t k;
+  char *data;
+
+  if (size <= buffer->capacity - buffer->size) {
+    /* the whole line fits, so fill it in place. */
+    data = buffer->data + buffer->size;
+    buffer->size += size;
+
+    for (k = 0; k < buffer->newline_size; k++) {
+      *data++ = buffer->newline[k];
+    }
+
+    for (k = 0; (1 == buffer->indent_size) && (k < depth); k++) {
+      *data++ = buffer->indent[0];
+    }
+
+    for (k = 0; (1 < buffer->indent_size) && (k < depth); k++) {
+      memcpy(data, buffer->indent, buffer->indent_size);
+      data += buffer->indent_size;
     }
+
+    return 0;
   }
 
-  if (offset < size) {
-    switch (src[offset]) {
-    case ' ':
-    case '\t':
-    case '\r':
-    case '\n':
-    case '}':
-    case ',':
-    case ']':
-      /* all of the above are ok. */
-      break;
-    case '=':
-      if (json_parse_flags_allow_equals_in_object & flags_bitset) {
-        break;
-      }
+  if (json_write_buffer_bytes(buffer, buffer->newline, buffer->newline_size)) {
+    return 1;
+  }
 
-      state->error = json_parse_error_invalid_number_format;
-      state->offset = offset;
-      return 1;
-    default:
-      state->error = json_parse_error_invalid_number_format;
-      state->offset = offset;
+  for (k = 0; (0 < buffer->indent_size) && (k < depth); k++) {
+    if (json_write_buffer_bytes(buffer, buffer->indent, buffer->indent_size)) {
       return 1;
     }
   }
 
-  state->data_size += offset - state->offset;
+  return 0;
+}
 
-  /* one more byte for null terminator ending the number string! */
-  state->data_size++;
+json_weak int json_write_buffer_name(struct json_write_buffer_s *buffer,
+                                     const struct json_string_s *name,
+                                     size_t depth, int pretty);
+int json_write_buffer_name(struct json_write_buffer_s *buffer,
+                           const struct json_string_s *name, size_t depth,
+                           int pretty) {
+  if (pretty && json_write_buffer_newline(buffer, depth)) {
+    return 1;
+  }
 
-  /* update offset. */
-  state->offset = offset;
+  if (json_write_buffer_string(buffer, name)) {
+    /* string was malformed! */
+    return 1;
+  }
+
+  /* ':'s (or " : "s when pretty) seperate each name/value pair. */
+  if (pretty) {
+    return json_write_buffer_bytes(buffer, " : ", 3);
+  }
+
+  if ((buffer->capacity == buffer->size) &&
+      json_write_buffer_flush(buffer, 1)) {
+    return 1;
+  }
+
+  buffer->data[buffer->size++] = ':';
 
   return 0;
 }
 
-json_weak int json_get_value_size(struct json_parse_state_s *state,
-                                  int is_global_object);
-int json_get_value_size(struct json_parse_state_s *state,
-                        int is_global_object) {
-  const size_t flags_bitset = state->flags_bitset;
-  const char *const src = state->src;
-  size_t offset;
-  const size_t size = state->size;
+json_weak int json_write_buffer_raw(struct json_write_buffer_s *buffer,
+                                    const struct json_raw_s *raw);
+int json_write_buffer_raw(struct json_write_buffer_s *buffer,
+                          const struct json_raw_s *raw) {
+  size_t i;
+  size_t run = 0;
 
-  if (json_parse_flags_allow_location_information & flags_bitset) {
-    state->dom_size += sizeof(struct json_value_ex_s);
-  } else {
-    state->dom_size += sizeof(struct json_value_s);
+  if (!buffer->single_line) {
+    /* the raw JSON text is copied as is. */
+    return json_write_buffer_bytes(buffer, raw->raw, raw->raw_size);
   }
 
-  if (is_global_object) {
-    return json_get_object_size(state, /* is_global_object = */ 1);
-  } else {
-    if (json_skip_all_skippables(state)) {
-      state->error = json_parse_error_premature_end_of_buffer;
-      return 1;
+  /* a line break can only be whitespace in a valid JSON value, so a space
+   * takes its place. */
+  for (i = 0; i < raw->raw_size; i++) {
+    if (('\n' != raw->raw[i]) && ('\r' != raw->raw[i])) {
+      continue;
     }
 
-    /* can cache offset now. */
-    offset = state->offset;
-
-    switch (src[offset]) {
-    case '"':
-      return json_get_string_size(state, 0);
-    case '\'':
-      if (json_parse_flags_allow_single_quoted_strings & flags_bitset) {
-        return json_get_string_size(state, 0);
-      } else {
-        /* invalid value! */
-        state->error = json_parse_error_invalid_value;
-        return 1;
-      }
-    case '{':
-      return json_get_object_size(state, /* is_global_object = */ 0);
-    case '[':
-      return json_get_array_size(state);
-    case '-':
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-      return json_get_number_size(state);
-    case '+':
-      if (json_parse_flags_allow_leading_plus_sign & flags_bitset) {
-        return json_get_number_size(state);
-      } else {
-        /* invalid value! */
-        state->error = json_parse_error_invalid_number_format;
-        return 1;
-      }
-    case '.':
-      if (json_parse_flags_allow_leading_or_trailing_decimal_point &
-          flags_bitset) {
-        return json_get_number_size(state);
-      } else {
-        /* invalid value! */
-        state->error = json_parse_error_invalid_number_format;
-        return 1;
-      }
-    default:
-      if ((offset + 4) <= size && 't' == src[offset + 0] &&
-          'r' == src[offset + 1] && 'u' == src[offset + 2] &&
-          'e' == src[offset + 3]) {
-        state->offset += 4;
-        return 0;
-      } else if ((offset + 5) <= size && 'f' == src[offset + 0] &&
-                 'a' == src[offset + 1] && 'l' == src[offset + 2] &&
-                 's' == src[offset + 3] && 'e' == src[offset + 4]) {
-        state->offset += 5;
-        return 0;
-      } else if ((offset + 4) <= size && 'n' == state->src[offset + 0] &&
-                 'u' == state->src[offset + 1] &&
-                 'l' == state->src[offset + 2] &&
-                 'l' == state->src[offset + 3]) {
-        state->offset += 4;
-        return 0;
-      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
-                 (offset + 3) <= size && 'N' == src[offset + 0] &&
-                 'a' == src[offset + 1] && 'N' == src[offset + 2]) {
-        return json_get_number_size(state);
-      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
-                 (offset + 8) <= size && 'I' == src[offset + 0] &&
-                 'n' == src[offset + 1] && 'f' == src[offset + 2] &&
-                 'i' == src[offset + 3] && 'n' == src[offset + 4] &&
-                 'i' == src[offset + 5] && 't' == src[offset + 6] &&
-                 'y' == src[offset + 7]) {
-        return json_get_number_size(state);
-      }
+    if (json_write_buffer_bytes(buffer, raw->raw + run, i - run)) {
+      return 1;
+    }
 
-      /* invalid value! */
-      state->error = json_parse_error_invalid_value;
+    if ((buffer->capacity == buffer->size) &&
+        json_write_buffer_flush(buffer, 1)) {
       return 1;
     }
+
+    buffer->data[buffer->size++] = ' ';
+    run = i + 1;
   }
+
+  return json_write_buffer_bytes(buffer, raw->raw + run, i - run);
 }
 
-json_weak void json_parse_value(struct json_parse_state_s *state,
-                                int is_global_object,
-                                struct json_value_s *value);
+struct json_write_patch_s {
+  const char *src;
+  size_t src_size;
+  size_t flags_bitset;
+  int (*dirty_func_ptr)(void *user_data, const struct json_value_s *value);
+  void *user_data;
+};
 
-json_weak void json_parse_string(struct json_parse_state_s *state,
-                                 struct json_string_s *string);
-void json_parse_string(struct json_parse_state_s *state,
-                       struct json_string_s *string) {
-  size_t offset = state->offset;
-  size_t bytes_written = 0;
-  const char *const src = state->src;
-  const char quote_to_use = '\'' == src[offset] ? '\'' : '"';
-  char *data = state->data;
-  unsigned long high_surrogate = 0;
-  unsigned long codepoint;
+json_weak size_t json_write_patch_span(const struct json_write_patch_s *patch,
+                                       const struct json_value_s *value,
+                                       size_t *offset);
+size_t json_write_patch_span(const struct json_write_patch_s *patch,
+                             const struct json_value_s *value,
+                             size_t *offset) {
+  size_t end;
+
+  if (patch->dirty_func_ptr(patch->user_data, value)) {
+    /* the value was changed, so it has to be written out afresh. */
+    return 0;
+  }
+
+  *offset = ((const struct json_value_ex_s *)value)->offset;
+
+  /* the root value's offset is from before any leading whitespace. */
+  while ((*offset < patch->src_size) &&
+         ((' ' == patch->src[*offset]) || ('\t' == patch->src[*offset]) ||
+          ('\r' == patch->src[*offset]) || ('\n' == patch->src[*offset]))) {
+    (*offset)++;
+  }
+
+  end = json_skip_value(patch->src, patch->src_size, *offset,
+                        patch->flags_bitset);
+
+  /* a global object without braces (or a value after a comment) can't be
+   * copied as is, so it is written out afresh instead. */
+  if ((0 == end) || ('/' == patch->src[*offset]) ||
+      ((json_type_object == value->type) && ('{' != patch->src[*offset]))) {
+    return 0;
+  }
+
+  return end;
+}
+
+json_weak int json_write_buffer_value(struct json_write_buffer_s *buffer,
+                                      const struct json_value_s *value,
+                                      int pretty,
+                                      const struct json_write_patch_s *patch);
+int json_write_buffer_value(struct json_write_buffer_s *buffer,
+                            const struct json_value_s *value, int pretty,
+                            const struct json_write_patch_s *patch) {
+  struct json_write_stack_s stack;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  size_t offset = 0;
+  size_t end = 0;
+  int error = 0;
+
+  json_write_stack_init(&stack, json_null, json_null);
+
+  for (;;) {
+    if (json_null != patch) {
+      end = json_write_patch_span(patch, value, &offset);
+    }
+
+    if (0 != end) {
+      /* the value is unchanged, so its bytes are copied from the source. */
+      error = json_write_buffer_bytes(buffer, patch->src + offset,
+                                      end - offset);
+    } else {
+      switch (value->type) {
+      default:
+        /* unknown value type found! */
+        error = 1;
+        break;
+      case json_type_number:
+        error = json_write_buffer_number(
+            buffer, (struct json_number_s *)value->payload);
+        break;
+      case json_type_string:
+        error = json_write_buffer_string(
+            buffer, (struct json_string_s *)value->payload);
+        break;
+      case json_type_array:
+        array = (const struct json_array_s *)value->payload;
+
+        if ((buffer->capacity == buffer->size) &&
+            json_write_buffer_flush(buffer, 1)) {
+          error = 1;
+          break;
+        }
+
+        buffer->data[buffer->size++] = '[';
+
+        if ((0 == array->length) || (json_null == array->start)) {
+          error = json_write_buffer_char(buffer, ']');
+          break;
+        }
+
+        if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+          error = 1;
+          break;
+        }
+
+        /* remember where we were, and move into the array. */
+        frame = stack.frames + stack.size++;
+        frame->element = (json_null != object_element)
+                             ? (const void *)object_element
+                             : (const void *)array_element;
+        frame->is_object = json_null != object_element;
 
-  string->string = data;
+        array_element = array->start;
+        object_element = json_null;
 
-  /* skip leading '"' or '\''. */
-  offset++;
+        if (pretty && json_write_buffer_newline(buffer, stack.size)) {
+          error = 1;
+          break;
+        }
 
-  while (quote_to_use != src[offset]) {
-    if ('\\' == src[offset]) {
-      /* skip the reverse solidus. */
-      offset++;
+        value = array_element->value;
+        continue;
+      case json_type_object:
+        object = (const struct json_object_s *)value->payload;
 
-      switch (src[offset++]) {
-      default:
-        return; /* we cannot ever reach here. */
-      case 'u': {
-        codepoint = 0;
-        if (!json_hexadecimal_value(&src[offset], 4, &codepoint)) {
-          return; /* this shouldn't happen as the value was already validated.
-                   */
+        if ((buffer->capacity == buffer->size) &&
+            json_write_buffer_flush(buffer, 1)) {
+          error = 1;
+          break;
         }
 
-        offset += 4;
+        buffer->data[buffer->size++] = '{';
 
-        if (codepoint <= 0x7fu) {
-          data[bytes_written++] = (char)codepoint; /* 0xxxxxxx. */
-        } else if (codepoint <= 0x7ffu) {
-          data[bytes_written++] =
-              (char)(0xc0u | (codepoint >> 6)); /* 110xxxxx. */
-          data[bytes_written++] =
-              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
-        } else if (codepoint >= 0xd800 &&
-                   codepoint <= 0xdbff) { /* high surrogate. */
-          high_surrogate = codepoint;
-          continue; /* we need the low half to form a complete codepoint. */
-        } else if (codepoint >= 0xdc00 &&
-                   codepoint <= 0xdfff) { /* low surrogate. */
-          /* combine with the previously read half to obtain the complete
-           * codepoint. */
-          const unsigned long surrogate_offset =
-              0x10000u - (0xD800u << 10) - 0xDC00u;
-          codepoint = (high_surrogate << 10) + codepoint + surrogate_offset;
-          high_surrogate = 0;
-          data[bytes_written++] =
-              (char)(0xF0u | (codepoint >> 18)); /* 11110xxx. */
-          data[bytes_written++] =
-              (char)(0x80u | ((codepoint >> 12) & 0x3fu)); /* 10xxxxxx. */
-          data[bytes_written++] =
-              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
-          data[bytes_written++] =
-              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+        if ((0 == object->length) || (json_null == object->start)) {
+          error = json_write_buffer_char(buffer, '}');
+          break;
+        }
+
+        if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+          error = 1;
+          break;
+        }
+
+        /* remember where we were, and move into the object. */
+        frame = stack.frames + stack.size++;
+        frame->element = (json_null != object_element)
+                             ? (const void *)object_element
+                             : (const void *)array_element;
+        frame->is_object = json_null != object_element;
+
+        object_element = object->start;
+        array_element = json_null;
+
+        if (json_write_buffer_name(buffer, object_element->name, stack.size,
+                                   pretty)) {
+          error = 1;
+          break;
+        }
+
+        value = object_element->value;
+        continue;
+      case json_type_true:
+        if (4 <= buffer->capacity - buffer->size) {
+          memcpy(buffer->data + buffer->size, "true", 4);
+          buffer->size += 4;
         } else {
-          /* we assume the value was validated and thus is within the valid
-           * range. */
-          data[bytes_written++] =
-              (char)(0xe0u | (codepoint >> 12)); /* 1110xxxx. */
-          data[bytes_written++] =
-              (char)(0x80u | ((codepoint >> 6) & 0x3fu)); /* 10xxxxxx. */
-          data[bytes_written++] =
-              (char)(0x80u | (codepoint & 0x3fu)); /* 10xxxxxx. */
+          error = json_write_buffer_bytes(buffer, "true", 4);
         }
-      } break;
-      case '"':
-        data[bytes_written++] = '"';
-        break;
-      case '\\':
-        data[bytes_written++] = '\\';
-        break;
-      case '/':
-        data[bytes_written++] = '/';
         break;
-      case 'b':
-        data[bytes_written++] = '\b';
+      case json_type_false:
+        if (5 <= buffer->capacity - buffer->size) {
+          memcpy(buffer->data + buffer->size, "false", 5);
+          buffer->size += 5;
+        } else {
+          error = json_write_buffer_bytes(buffer, "false", 5);
+        }
         break;
-      case 'f':
-        data[bytes_written++] = '\f';
+      case json_type_null:
+        if (4 <= buffer->capacity - buffer->size) {
+          memcpy(buffer->data + buffer->size, "null", 4);
+          buffer->size += 4;
+        } else {
+          error = json_write_buffer_bytes(buffer, "null", 4);
+        }
         break;
-      case 'n':
-        data[bytes_written++] = '\n';
+      case json_type_raw:
+        error = json_write_buffer_raw(buffer,
+                                      (struct json_raw_s *)value->payload);
         break;
-      case 'r':
-        data[bytes_written++] = '\r';
+      }
+    }
+
+    /* the value is done, so move on to the next element of the innermost
+     * array or object that has one, closing the others. */
+    for (value = json_null; !error && (0 < stack.size);) {
+      char c;
+
+      if (json_null != object_element) {
+        object_element = object_element->next;
+        c = (json_null != object_element) ? ',' : '}';
+      } else {
+        array_element = array_element->next;
+        c = (json_null != array_element) ? ',' : ']';
+      }
+
+      /* the closing character goes on a line of its own when pretty. */
+      if ((',' != c) && pretty &&
+          json_write_buffer_newline(buffer, stack.size - 1)) {
+        error = 1;
         break;
-      case 't':
-        data[bytes_written++] = '\t';
+      }
+
+      if ((buffer->capacity == buffer->size) &&
+          json_write_buffer_flush(buffer, 1)) {
+        error = 1;
         break;
-      case '\r':
-        data[bytes_written++] = '\r';
+      }
 
-        /* check if we have a "\r\n" sequence. */
-        if ('\n' == src[offset]) {
-          data[bytes_written++] = '\n';
-          offset++;
+      buffer->data[buffer->size++] = c;
+
+      if (',' == c) {
+        /* ','s seperate each element. */
+        if (json_null == object_element) {
+          error = pretty && json_write_buffer_newline(buffer, stack.size);
+          value = array_element->value;
+        } else if (pretty) {
+          error = json_write_buffer_name(buffer, object_element->name,
+                                         stack.size, pretty);
+          value = object_element->value;
+        } else {
+          /* ':'s seperate each name/value pair. */
+          error = json_write_buffer_string(buffer, object_element->name) ||
+                  ((buffer->capacity == buffer->size) &&
+                   json_write_buffer_flush(buffer, 1));
+
+          if (!error) {
+            buffer->data[buffer->size++] = ':';
+          }
+
+          value = object_element->value;
         }
 
-        break;
-      case '\n':
-        data[bytes_written++] = '\n';
         break;
       }
-    } else {
-      /* copy the character. */
-      data[bytes_written++] = src[offset++];
+
+      /* the array or object is done, so go back to where we were. */
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
+    }
+
+    if (error || (json_null == value)) {
+      break;
     }
   }
 
-  /* skip trailing '"' or '\''. */
-  offset++;
+  json_write_stack_release(&stack);
 
-  /* record the size of the string. */
-  string->string_size = bytes_written;
+  return error;
+}
 
-  /* add null terminator to string. */
-  data[bytes_written++] = '\0';
+void *json_write_minified_growable(
+    const struct json_value_s *value,
+    void *(*realloc_func_ptr)(void *user_data, void *ptr, size_t size),
+    void *user_data, size_t *out_size) {
+  struct json_write_buffer_s buffer;
 
-  /* move data along. */
-  state->data += bytes_written;
+  if (json_null == value) {
+    return json_null;
+  }
 
-  /* update offset. */
-  state->offset = offset;
-}
+  buffer.data = json_null;
+  buffer.size = 0;
+  buffer.capacity = 0;
+  buffer.realloc_func_ptr = realloc_func_ptr;
+  buffer.write_func_ptr = json_null;
+  buffer.segments = json_null;
+  buffer.user_data = user_data;
+  buffer.indent = json_null;
+  buffer.indent_size = 0;
+  buffer.newline = json_null;
+  buffer.newline_size = 0;
+  buffer.single_line = 0;
+
+  if (json_write_buffer_value(&buffer, value, 0, json_null)) {
+    /* bad chi occurred! */
+    if (json_null == realloc_func_ptr) {
+      free(buffer.data);
+    } else if (json_null != buffer.data) {
+      (void)realloc_func_ptr(user_data, buffer.data, 0);
+    }
 
-json_weak void json_parse_key(struct json_parse_state_s *state,
-                              struct json_string_s *string);
-void json_parse_key(struct json_parse_state_s *state,
-                    struct json_string_s *string) {
-  if (json_parse_flags_allow_unquoted_keys & state->flags_bitset) {
-    const char *const src = state->src;
-    char *const data = state->data;
-    size_t offset = state->offset;
+    return json_null;
+  }
 
-    /* if we are allowing unquoted keys, check for quoted anyway... */
-    if (('"' == src[offset]) || ('\'' == src[offset])) {
-      /* ... if we got a quote, just parse the key as a string as normal. */
-      json_parse_string(state, string);
+  /* null terminated the string. */
+  if (json_write_buffer_bytes(&buffer, "", 1)) {
+    if (json_null == realloc_func_ptr) {
+      free(buffer.data);
     } else {
-      size_t size = 0;
+      (void)realloc_func_ptr(user_data, buffer.data, 0);
+    }
 
-      string->string = state->data;
+    return json_null;
+  }
 
-      while (is_valid_unquoted_key_char(src[offset])) {
-        data[size++] = src[offset++];
-      }
+  if (json_null != out_size) {
+    *out_size = buffer.size;
+  }
 
-      /* add null terminator to string. */
-      data[size] = '\0';
+  return buffer.data;
+}
 
-      /* record the size of the string. */
-      string->string_size = size++;
+void *json_write_patched(const struct json_value_s *value, const void *src,
+                         size_t src_size, size_t flags_bitset,
+                         int (*dirty_func_ptr)(
+                             void *user_data, const struct json_value_s *value),
+                         void *user_data, size_t *out_size) {
+  struct json_write_patch_s patch;
+  struct json_write_buffer_s buffer;
+
+  if ((json_null == value) || (json_null == src) ||
+      (json_null == dirty_func_ptr) ||
+      !(json_parse_flags_allow_location_information & flags_bitset)) {
+    return json_null;
+  }
 
-      /* move data along. */
-      state->data += size;
+  patch.src = (const char *)src;
+  patch.src_size = src_size;
+  patch.flags_bitset = flags_bitset;
+  patch.dirty_func_ptr = dirty_func_ptr;
+  patch.user_data = user_data;
+
+  buffer.data = json_null;
+  buffer.size = 0;
+  buffer.capacity = 0;
+  buffer.realloc_func_ptr = json_null;
+  buffer.write_func_ptr = json_null;
+  buffer.segments = json_null;
+  buffer.user_data = json_null;
+  buffer.indent = json_null;
+  buffer.indent_size = 0;
+  buffer.newline = json_null;
+  buffer.newline_size = 0;
+  buffer.single_line = 0;
+
+  /* write the value, and null terminate the string. */
+  if (json_write_buffer_value(&buffer, value, 0, &patch) ||
+      json_write_buffer_bytes(&buffer, "", 1)) {
+    free(buffer.data);
+    return json_null;
+  }
 
-      /* update offset. */
-      state->offset = offset;
-    }
-  } else {
-    /* we are only allowed to have quoted keys, so just parse a string! */
-    json_parse_string(state, string);
+  if (json_null != out_size) {
+    *out_size = buffer.size;
   }
+
+  return buffer.data;
 }
 
-json_weak void json_parse_object(struct json_parse_state_s *state,
-                                 int is_global_object,
-                                 struct json_object_s *object);
-void json_parse_object(struct json_parse_state_s *state, int is_global_object,
-                       struct json_object_s *object) {
-  const size_t flags_bitset = state->flags_bitset;
-  const size_t size = state->size;
-  const char *const src = state->src;
-  size_t elements = 0;
-  int allow_comma = 0;
-  struct json_object_element_s *previous = json_null;
+json_weak int json_write_is_scalar_array(const struct json_array_s *array);
+int json_write_is_scalar_array(const struct json_array_s *array) {
+  const struct json_array_element_s *element;
 
-  if (is_global_object) {
-    /* if we skipped some whitespace, and then found an opening '{' of an. */
-    /* object, we actually have a normal JSON object at the root of the DOM...
-     */
-    if ('{' == src[state->offset]) {
-      /* . and we don't actually have a global object after all! */
-      is_global_object = 0;
+  for (element = array->start; json_null != element; element = element->next) {
+    if ((json_type_array == element->value->type) ||
+        (json_type_object == element->value->type)) {
+      return 0;
     }
   }
 
-  if (!is_global_object) {
-    /* skip leading '{'. */
-    state->offset++;
+  return 1;
+}
+
+json_weak int json_write_pretty_get_value_size(
+    const struct json_value_s *value, size_t depth, size_t indent_size,
+    size_t newline_size, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *, size_t), void *user_data, size_t *size);
+int json_write_pretty_get_value_size(
+    const struct json_value_s *value, size_t depth, size_t indent_size,
+    size_t newline_size, size_t flags_bitset,
+    void *(*alloc_func_ptr)(void *user_data, size_t size), void *user_data,
+    size_t *size) {
+  struct json_write_stack_s stack;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  int error = 0;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+
+  for (;;) {
+    switch (value->type) {
+    default:
+      /* unknown value type found! */
+      error = 1;
+      break;
+    case json_type_number:
+      error = json_write_get_number_size(
+          (struct json_number_s *)value->payload, size);
+      break;
+    case json_type_string:
+      error = json_write_get_string_size(
+          (struct json_string_s *)value->payload, flags_bitset, size);
+      break;
+    case json_type_array:
+      array = (const struct json_array_s *)value->payload;
+
+      *size += 2; /* '[' and ']'. */
+
+      if ((0 == array->length) || (json_null == array->start)) {
+        break;
+      }
+
+      if ((json_write_flags_inline_scalar_arrays & flags_bitset) &&
+          json_write_is_scalar_array(array)) {
+        /* the array is on one line, with ", "s seperating each element. */
+        *size += 2 * (array->length - 1);
+      } else {
+        /* a newline after the '[' and each element, an indent before each
+         * element and the ']', and ','s seperate each element. */
+        *size += (array->length + 1) * newline_size;
+        *size += array->length * (depth + stack.size + 1) * indent_size;
+        *size += (depth + stack.size) * indent_size;
+        *size += array->length - 1;
+      }
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        error = 1;
+        break;
+      }
+
+      /* remember where we were, and move into the array. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      array_element = array->start;
+      object_element = json_null;
+      value = array_element->value;
+      continue;
+    case json_type_object:
+      object = (const struct json_object_s *)value->payload;
+
+      *size += 2; /* '{' and '}'. */
+
+      if ((0 == object->length) || (json_null == object->start)) {
+        break;
+      }
+
+      /* a newline after the '{' and each element, an indent before each
+       * element and the '}', ','s seperate each element, and " : "s seperate
+       * each name/value pair. */
+      *size += (object->length + 1) * newline_size;
+      *size += object->length * (depth + stack.size + 1) * indent_size;
+      *size += (depth + stack.size) * indent_size;
+      *size += object->length - 1;
+      *size += 3 * object->length;
+
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        error = 1;
+        break;
+      }
+
+      /* remember where we were, and move into the object. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      object_element = object->start;
+      array_element = json_null;
+      error = json_write_get_string_size(object_element->name, flags_bitset,
+                                         size);
+      value = object_element->value;
+      continue;
+    case json_type_true:
+      *size += 4; /* the string "true". */
+      break;
+    case json_type_false:
+      *size += 5; /* the string "false". */
+      break;
+    case json_type_null:
+      *size += 4; /* the string "null". */
+      break;
+    case json_type_raw:
+      error = json_write_get_raw_size((struct json_raw_s *)value->payload,
+                                      flags_bitset, size);
+      break;
+    }
+
+    /* the value is done, so move on to the next element of the innermost
+     * array or object that has one. */
+    for (value = json_null; !error && (0 < stack.size);) {
+      if (json_null != object_element) {
+        object_element = object_element->next;
+
+        if (json_null != object_element) {
+          error = json_write_get_string_size(object_element->name,
+                                             flags_bitset, size);
+          value = object_element->value;
+          break;
+        }
+      } else {
+        array_element = array_element->next;
+
+        if (json_null != array_element) {
+          value = array_element->value;
+          break;
+        }
+      }
+
+      /* the array or object is done, so go back to where we were. */
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
+    }
+
+    if (error || (json_null == value)) {
+      break;
+    }
   }
 
-  (void)json_skip_all_skippables(state);
+  json_write_stack_release(&stack);
 
-  /* reset elements. */
-  elements = 0;
+  return error;
+}
 
-  while (state->offset < size) {
-    struct json_object_element_s *element = json_null;
-    struct json_string_s *string = json_null;
-    struct json_value_s *value = json_null;
+json_weak char *json_write_pretty_value(const struct json_value_s *value,
+                                        size_t depth, const char *indent,
+                                        const char *newline,
+                                        size_t flags_bitset,
+                                        void *(*alloc_func_ptr)(void *, size_t),
+                                        void *user_data, char *data);
+char *json_write_pretty_value(const struct json_value_s *value, size_t depth,
+                              const char *indent, const char *newline,
+                              size_t flags_bitset,
+                              void *(*alloc_func_ptr)(void *user_data,
+                                                      size_t size),
+                              void *user_data, char *data) {
+  struct json_write_stack_s stack;
+  struct json_write_indent_s lines;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  int inline_array = 0;
+  char close;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+  json_write_indent_init(&lines, indent, newline);
+
+  for (;;) {
+    switch (value->type) {
+    default:
+      /* unknown value type found! */
+      data = json_null;
+      break;
+    case json_type_number:
+      data = json_write_number((struct json_number_s *)value->payload, data);
+      break;
+    case json_type_string:
+      data = json_write_string((struct json_string_s *)value->payload,
+                               flags_bitset, data);
+      break;
+    case json_type_array:
+      array = (const struct json_array_s *)value->payload;
 
-    if (!is_global_object) {
-      (void)json_skip_all_skippables(state);
+      *data++ = '['; /* open the array. */
 
-      if ('}' == src[state->offset]) {
-        /* skip trailing '}'. */
-        state->offset++;
+      if ((0 == array->length) || (json_null == array->start)) {
+        *data++ = ']'; /* close the array. */
+        break;
+      }
 
-        /* finished the object! */
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        data = json_null;
         break;
       }
-    } else {
-      if (json_skip_all_skippables(state)) {
-        /* global object ends when the file ends! */
+
+      /* remember where we were, and move into the array. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      array_element = array->start;
+      object_element = json_null;
+
+      /* an array of scalars can't contain another array or object, so this
+       * stays put until the array is closed. */
+      inline_array = (json_write_flags_inline_scalar_arrays & flags_bitset) &&
+                     json_write_is_scalar_array(array);
+
+      if (!inline_array) {
+        data = json_write_indent_line(&lines, depth + stack.size, data);
+      }
+
+      value = array_element->value;
+      continue;
+    case json_type_object:
+      object = (const struct json_object_s *)value->payload;
+
+      *data++ = '{'; /* open the object. */
+
+      if ((0 == object->length) || (json_null == object->start)) {
+        *data++ = '}'; /* close the object. */
         break;
       }
-    }
 
-    /* if we parsed at least one element previously, grok for a comma. */
-    if (allow_comma) {
-      if (',' == src[state->offset]) {
-        /* skip comma. */
-        state->offset++;
-        allow_comma = 0;
-        continue;
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        data = json_null;
+        break;
       }
-    }
 
-    element = (struct json_object_element_s *)state->dom;
+      /* remember where we were, and move into the object. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
 
-    state->dom += sizeof(struct json_object_element_s);
+      object_element = object->start;
+      array_element = json_null;
 
-    if (json_null == previous) {
-      /* this is our first element, so record it in our object. */
-      object->start = element;
-    } else {
-      previous->next = element;
+      data = json_write_indent_line(&lines, depth + stack.size, data);
+      data = json_write_string(object_element->name, flags_bitset, data);
+
+      /* " : "s seperate each name/value pair. */
+      *data++ = ' ';
+      *data++ = ':';
+      *data++ = ' ';
+
+      value = object_element->value;
+      continue;
+    case json_type_true:
+      data[0] = 't';
+      data[1] = 'r';
+      data[2] = 'u';
+      data[3] = 'e';
+      data += 4;
+      break;
+    case json_type_false:
+      data[0] = 'f';
+      data[1] = 'a';
+      data[2] = 'l';
+      data[3] = 's';
+      data[4] = 'e';
+      data += 5;
+      break;
+    case json_type_null:
+      data[0] = 'n';
+      data[1] = 'u';
+      data[2] = 'l';
+      data[3] = 'l';
+      data += 4;
+      break;
+    case json_type_raw:
+      data = json_write_raw((struct json_raw_s *)value->payload, flags_bitset,
+                            data);
+      break;
     }
 
-    previous = element;
+    /* the value is done, so move on to the next element of the innermost
+     * array or object that has one, closing the others. */
+    for (value = json_null; (json_null != data) && (0 < stack.size);) {
+      if (json_null != object_element) {
+        object_element = object_element->next;
 
-    if (json_parse_flags_allow_location_information & flags_bitset) {
-      struct json_string_ex_s *string_ex =
-          (struct json_string_ex_s *)state->dom;
-      state->dom += sizeof(struct json_string_ex_s);
+        if (json_null != object_element) {
+          *data++ = ','; /* ','s seperate each element. */
 
-      string_ex->offset = state->offset;
-      string_ex->line_no = state->line_no;
-      string_ex->row_no = state->offset - state->line_offset;
+          data = json_write_indent_line(&lines, depth + stack.size, data);
+          data = json_write_string(object_element->name, flags_bitset, data);
 
-      string = &(string_ex->string);
-    } else {
-      string = (struct json_string_s *)state->dom;
-      state->dom += sizeof(struct json_string_s);
-    }
+          /* " : "s seperate each name/value pair. */
+          *data++ = ' ';
+          *data++ = ':';
+          *data++ = ' ';
 
-    element->name = string;
+          value = object_element->value;
+          break;
+        }
 
-    (void)json_parse_key(state, string);
+        close = '}';
+      } else {
+        array_element = array_element->next;
 
-    (void)json_skip_all_skippables(state);
+        if (json_null != array_element) {
+          *data++ = ','; /* ','s seperate each element. */
 
-    /* skip colon or equals. */
-    state->offset++;
+          if (inline_array) {
+            *data++ = ' ';
+          } else {
+            data = json_write_indent_line(&lines, depth + stack.size, data);
+          }
 
-    (void)json_skip_all_skippables(state);
+          value = array_element->value;
+          break;
+        }
 
-    if (json_parse_flags_allow_location_information & flags_bitset) {
-      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
-      state->dom += sizeof(struct json_value_ex_s);
+        close = ']';
+      }
 
-      value_ex->offset = state->offset;
-      value_ex->line_no = state->line_no;
-      value_ex->row_no = state->offset - state->line_offset;
+      /* the array or object is done, so close it at the indent it was opened
+       * at. */
+      if (inline_array) {
+        inline_array = 0;
+      } else {
+        data = json_write_indent_line(&lines, depth + stack.size - 1, data);
+      }
 
-      value = &(value_ex->value);
-    } else {
-      value = (struct json_value_s *)state->dom;
-      state->dom += sizeof(struct json_value_s);
+      *data++ = close;
+
+      /* go back to where we were. */
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
     }
 
-    element->value = value;
+    if ((json_null == data) || (json_null == value)) {
+      break;
+    }
+  }
 
-    json_parse_value(state, /* is_global_object = */ 0, value);
+  json_write_stack_release(&stack);
 
-    /* successfully parsed a name/value pair! */
-    elements++;
-    allow_comma = 1;
+  return data;
+}
+
+json_weak int json_write_pretty_get_size(const struct json_value_s *value,
+                                         const char *indent,
+                                         const char *newline,
+                                         size_t flags_bitset,
+                                         void *(*alloc_func_ptr)(void *,
+                                                                 size_t),
+                                         void *user_data, size_t *size);
+int json_write_pretty_get_size(const struct json_value_s *value,
+                               const char *indent, const char *newline,
+                               size_t flags_bitset,
+                               void *(*alloc_func_ptr)(void *user_data,
+                                                       size_t size),
+                               void *user_data, size_t *size) {
+  size_t indent_size = 0;
+  size_t newline_size = 0;
+
+  while ('\0' != indent[indent_size]) {
+    ++indent_size; /* skip non-null terminating characters. */
   }
 
-  /* if we had at least one element, end the linked list. */
-  if (previous) {
-    previous->next = json_null;
+  while ('\0' != newline[newline_size]) {
+    ++newline_size; /* skip non-null terminating characters. */
   }
 
-  if (0 == elements) {
-    object->start = json_null;
+  if (json_write_pretty_get_value_size(value, 0, indent_size, newline_size,
+                                       flags_bitset, alloc_func_ptr, user_data,
+                                       size)) {
+    /* value was malformed! */
+    return 1;
   }
 
-  object->length = elements;
+  *size += 1; /* for the '\0' null terminating character. */
+
+  return 0;
 }
 
-json_weak void json_parse_array(struct json_parse_state_s *state,
-                                struct json_array_s *array);
-void json_parse_array(struct json_parse_state_s *state,
-                      struct json_array_s *array) {
-  const char *const src = state->src;
-  const size_t size = state->size;
-  size_t elements = 0;
-  int allow_comma = 0;
-  struct json_array_element_s *previous = json_null;
+void *json_write_pretty(const struct json_value_s *value, const char *indent,
+                        const char *newline, size_t *out_size) {
+  return json_write_pretty_ex(value, indent, newline, json_null, json_null,
+                              out_size);
+}
 
-  /* skip leading '['. */
-  state->offset++;
+void *json_write_pretty_ex(const struct json_value_s *value,
+                           const char *indent, const char *newline,
+                           void *(*alloc_func_ptr)(void *user_data,
+                                                   size_t size),
+                           void *user_data, size_t *out_size) {
+  return json_write_pretty_flags(value, indent, newline,
+                                 json_write_flags_default, alloc_func_ptr,
+                                 user_data, out_size);
+}
 
-  (void)json_skip_all_skippables(state);
+void *json_write_pretty_flags(const struct json_value_s *value,
+                              const char *indent, const char *newline,
+                              size_t flags_bitset,
+                              void *(*alloc_func_ptr)(void *user_data,
+                                                      size_t size),
+                              void *user_data, size_t *out_size) {
+  size_t size = 0;
+  char *data = json_null;
+  char *data_end = json_null;
 
-  /* reset elements. */
-  elements = 0;
+  if (json_null == value) {
+    return json_null;
+  }
 
-  do {
-    struct json_array_element_s *element = json_null;
-    struct json_value_s *value = json_null;
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
+  }
 
-    (void)json_skip_all_skippables(state);
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
+  }
 
-    if (']' == src[state->offset]) {
-      /* skip trailing ']'. */
-      state->offset++;
+  if (json_write_pretty_get_size(value, indent, newline, flags_bitset,
+                                 alloc_func_ptr, user_data, &size)) {
+    /* value was malformed! */
+    return json_null;
+  }
 
-      /* finished the array! */
-      break;
-    }
+  if (json_null == alloc_func_ptr) {
+    data = (char *)malloc(size);
+  } else {
+    data = (char *)alloc_func_ptr(user_data, size);
+  }
 
-    /* if we parsed at least one element previously, grok for a comma. */
-    if (allow_comma) {
-      if (',' == src[state->offset]) {
-        /* skip comma. */
-        state->offset++;
-        allow_comma = 0;
-        continue;
-      }
+  if (json_null == data) {
+    /* malloc failed! */
+    return json_null;
+  }
+
+  data_end =
+      json_write_pretty_value(value, 0, indent, newline, flags_bitset,
+                              alloc_func_ptr, user_data, data);
+
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(data);
     }
 
-    element = (struct json_array_element_s *)state->dom;
+    return json_null;
+  }
 
-    state->dom += sizeof(struct json_array_element_s);
+  /* null terminated the string. */
+  *data_end = '\0';
 
-    if (json_null == previous) {
-      /* this is our first element, so record it in our array. */
-      array->start = element;
-    } else {
-      previous->next = element;
-    }
+  if (json_null != out_size) {
+    *out_size = size;
+  }
 
-    previous = element;
+  return data;
+}
 
-    if (json_parse_flags_allow_location_information & state->flags_bitset) {
-      struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state->dom;
-      state->dom += sizeof(struct json_value_ex_s);
+int json_write_pretty_into(const struct json_value_s *value,
+                           const char *indent, const char *newline,
+                           void *buffer, size_t capacity, size_t *needed) {
+  size_t size = 0;
+  char *data_end = json_null;
 
-      value_ex->offset = state->offset;
-      value_ex->line_no = state->line_no;
-      value_ex->row_no = state->offset - state->line_offset;
+  if (json_null != needed) {
+    *needed = 0;
+  }
 
-      value = &(value_ex->value);
-    } else {
-      value = (struct json_value_s *)state->dom;
-      state->dom += sizeof(struct json_value_s);
-    }
+  if (json_null == value) {
+    return 1;
+  }
+
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
+  }
+
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
+  }
+
+  if (json_write_pretty_get_size(value, indent, newline,
+                                 json_write_flags_default, json_write_no_alloc,
+                                 json_null, &size)) {
+    /* value was malformed! */
+    return 1;
+  }
+
+  if (json_null != needed) {
+    *needed = size;
+  }
+
+  if ((json_null == buffer) || (capacity < size)) {
+    /* the buffer is too small! */
+    return 1;
+  }
+
+  data_end = json_write_pretty_value(value, 0, indent, newline,
+                                     json_write_flags_default,
+                                     json_write_no_alloc, json_null,
+                                     (char *)buffer);
+
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    return 1;
+  }
 
-    element->value = value;
+  /* null terminated the string. */
+  *data_end = '\0';
 
-    json_parse_value(state, /* is_global_object = */ 0, value);
+  return 0;
+}
 
-    /* successfully parsed an array element! */
-    elements++;
-    allow_comma = 1;
-  } while (state->offset < size);
+struct json_write_cache_entry_s {
+  const struct json_value_s *value;
+  size_t minified_size;
+  size_t pretty_size;
+  size_t pretty_newlines;
+  size_t pretty_indents;
+  size_t pretty_indented_lines;
+};
 
-  /* end the linked list. */
-  if (previous) {
-    previous->next = json_null;
-  }
+struct json_write_cache_s {
+  struct json_write_cache_entry_s *entries;
+  size_t capacity;
+};
 
-  if (0 == elements) {
-    array->start = json_null;
+json_weak size_t json_write_cache_slot(const struct json_write_cache_s *cache,
+                                       const struct json_value_s *value);
+size_t json_write_cache_slot(const struct json_write_cache_s *cache,
+                             const struct json_value_s *value) {
+  /* values are at least pointer aligned, so drop the low bits that are always
+   * zero before mixing the address into a slot of the power of two table. */
+  const size_t key = (size_t)value / sizeof(void *);
+  size_t slot = (key * 2654435761u) & (cache->capacity - 1);
+
+  while ((json_null != cache->entries[slot].value) &&
+         (value != cache->entries[slot].value)) {
+    slot = (slot + 1) & (cache->capacity - 1);
   }
 
-  array->length = elements;
+  return slot;
 }
 
-json_weak void json_parse_number(struct json_parse_state_s *state,
-                                 struct json_number_s *number);
-void json_parse_number(struct json_parse_state_s *state,
-                       struct json_number_s *number) {
-  const size_t flags_bitset = state->flags_bitset;
-  size_t offset = state->offset;
-  const size_t size = state->size;
-  size_t bytes_written = 0;
-  const char *const src = state->src;
-  char *data = state->data;
+json_weak int json_write_cache_count(const struct json_value_s *value,
+                                     void *(*alloc_func_ptr)(void *, size_t),
+                                     void *user_data, size_t *count);
+int json_write_cache_count(const struct json_value_s *value,
+                           void *(*alloc_func_ptr)(void *user_data,
+                                                   size_t size),
+                           void *user_data, size_t *count) {
+  struct json_write_stack_s stack;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  const void *start;
+  int error = 0;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+
+  for (;;) {
+    *count += 1;
+    start = json_null;
+
+    switch (value->type) {
+    default:
+      /* unknown value type found! */
+      error = 1;
+      break;
+    case json_type_array:
+      start = ((const struct json_array_s *)value->payload)->start;
+      break;
+    case json_type_object:
+      start = ((const struct json_object_s *)value->payload)->start;
+      break;
+    case json_type_string:
+    case json_type_number:
+    case json_type_true:
+    case json_type_false:
+    case json_type_null:
+    case json_type_raw:
+      break;
+    }
 
-  number->number = data;
+    if (json_null != start) {
+      if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+        error = 1;
+        break;
+      }
 
-  if (json_parse_flags_allow_hexadecimal_numbers & flags_bitset) {
-    if (('0' == src[offset]) &&
-        (('x' == src[offset + 1]) || ('X' == src[offset + 1]))) {
-      /* consume hexadecimal digits. */
-      while ((offset < size) &&
-             (('0' <= src[offset] && src[offset] <= '9') ||
-              ('a' <= src[offset] && src[offset] <= 'f') ||
-              ('A' <= src[offset] && src[offset] <= 'F') ||
-              ('x' == src[offset]) || ('X' == src[offset]))) {
-        data[bytes_written++] = src[offset++];
+      /* remember where we were, and move into the array or object. */
+      frame = stack.frames + stack.size++;
+      frame->element = (json_null != object_element)
+                           ? (const void *)object_element
+                           : (const void *)array_element;
+      frame->is_object = json_null != object_element;
+
+      if (json_type_object == value->type) {
+        object_element = (const struct json_object_element_s *)start;
+        array_element = json_null;
+        value = object_element->value;
+      } else {
+        array_element = (const struct json_array_element_s *)start;
+        object_element = json_null;
+        value = array_element->value;
       }
+
+      continue;
     }
-  }
 
-  while (offset < size) {
-    int end = 0;
+    /* move on to the next element of the innermost array or object that has
+     * one. */
+    for (value = json_null; !error && (0 < stack.size);) {
+      if (json_null != object_element) {
+        object_element = object_element->next;
 
-    switch (src[offset]) {
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-    case '.':
-    case 'e':
-    case 'E':
-    case '+':
-    case '-':
-      data[bytes_written++] = src[offset++];
-      break;
-    default:
-      end = 1;
-      break;
+        if (json_null != object_element) {
+          value = object_element->value;
+          break;
+        }
+      } else {
+        array_element = array_element->next;
+
+        if (json_null != array_element) {
+          value = array_element->value;
+          break;
+        }
+      }
+
+      frame = stack.frames + --stack.size;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
     }
 
-    if (0 != end) {
+    if (error || (json_null == value)) {
       break;
     }
   }
 
-  if (json_parse_flags_allow_inf_and_nan & flags_bitset) {
-    const size_t inf_strlen = 8; /* = strlen("Infinity");. */
-    const size_t nan_strlen = 3; /* = strlen("NaN");. */
+  json_write_stack_release(&stack);
 
-    if (offset + inf_strlen < size) {
-      if ('I' == src[offset]) {
-        size_t i;
-        /* We found our special 'Infinity' keyword! */
-        for (i = 0; i < inf_strlen; i++) {
-          data[bytes_written++] = src[offset++];
+  return error;
+}
+
+json_weak struct json_write_cache_entry_s *
+json_write_cache_fill(struct json_write_cache_s *cache,
+                      const struct json_value_s *value,
+                      void *(*alloc_func_ptr)(void *, size_t),
+                      void *user_data);
+struct json_write_cache_entry_s *
+json_write_cache_fill(struct json_write_cache_s *cache,
+                      const struct json_value_s *value,
+                      void *(*alloc_func_ptr)(void *user_data, size_t size),
+                      void *user_data) {
+  struct json_write_stack_s stack;
+  const struct json_array_s *array;
+  const struct json_object_s *object;
+  const struct json_array_element_s *array_element = json_null;
+  const struct json_object_element_s *object_element = json_null;
+  struct json_write_frame_s *frame;
+  /* the array or object whose elements are being filled in. */
+  struct json_write_cache_entry_s *parent = json_null;
+  struct json_write_cache_entry_s *entry = json_null;
+  size_t length;
+  int error = 0;
+
+  json_write_stack_init(&stack, alloc_func_ptr, user_data);
+
+  for (;;) {
+    entry = cache->entries + json_write_cache_slot(cache, value);
+
+    /* if the value was already seen elsewhere in the DOM its entry is done. */
+    if (value != entry->value) {
+      entry->value = value;
+      entry->minified_size = 0;
+      entry->pretty_size = 0;
+      entry->pretty_newlines = 0;
+      entry->pretty_indents = 0;
+      entry->pretty_indented_lines = 0;
+
+      switch (value->type) {
+      default:
+        /* unknown value type found! */
+        error = 1;
+        break;
+      case json_type_number:
+        error = json_write_get_number_size(
+            (struct json_number_s *)value->payload, &entry->minified_size);
+        entry->pretty_size = entry->minified_size;
+        break;
+      case json_type_string:
+        error = json_write_get_string_size(
+            (struct json_string_s *)value->payload, json_write_flags_default,
+            &entry->minified_size);
+        entry->pretty_size = entry->minified_size;
+        break;
+      case json_type_array:
+      case json_type_object:
+        array = (const struct json_array_s *)value->payload;
+        object = (const struct json_object_s *)value->payload;
+        length = (json_type_array == value->type) ? array->length
+                                                  : object->length;
+
+        /* the opening and closing characters, and the ','s that seperate
+         * each element. */
+        entry->minified_size = 2;
+        entry->pretty_size = 2;
+
+        if ((0 == length) ||
+            ((json_type_array == value->type) ? (json_null == array->start)
+                                              : (json_null == object->start))) {
+          break;
+        }
+
+        entry->minified_size += length - 1;
+        entry->pretty_size += length - 1;
+
+        if ((stack.size == stack.capacity) && json_write_stack_grow(&stack)) {
+          error = 1;
+          break;
+        }
+
+        /* remember where we were, and move into the array or object. */
+        frame = stack.frames + stack.size++;
+        frame->element = (json_null != object_element)
+                             ? (const void *)object_element
+                             : (const void *)array_element;
+        frame->is_object = json_null != object_element;
+        frame->entry = parent;
+        parent = entry;
+
+        if (json_type_object == value->type) {
+          object_element = object->start;
+          array_element = json_null;
+
+          /* each name is followed by ':' when minified, and " : " when
+           * pretty. */
+          length = 0;
+          error = json_write_get_string_size(
+              object_element->name, json_write_flags_default, &length);
+          parent->minified_size += length + 1;
+          parent->pretty_size += length + 3;
+
+          value = object_element->value;
+        } else {
+          array_element = array->start;
+          object_element = json_null;
+          value = array_element->value;
+        }
+
+        if (error) {
+          break;
         }
+
+        continue;
+      case json_type_true:
+        entry->minified_size = 4; /* the string "true". */
+        entry->pretty_size = 4;
+        break;
+      case json_type_false:
+        entry->minified_size = 5; /* the string "false". */
+        entry->pretty_size = 5;
+        break;
+      case json_type_null:
+        entry->minified_size = 4; /* the string "null". */
+        entry->pretty_size = 4;
+        break;
+      case json_type_raw:
+        entry->minified_size = ((struct json_raw_s *)value->payload)->raw_size;
+        entry->pretty_size = entry->minified_size;
+        break;
       }
     }
 
-    if (offset + nan_strlen < size) {
-      if ('N' == src[offset]) {
-        size_t i;
-        /* We found our special 'NaN' keyword! */
-        for (i = 0; i < nan_strlen; i++) {
-          data[bytes_written++] = src[offset++];
+    /* the entry is done, so add it to the array or object it is in and move
+     * on to the next element of the innermost one that has one, finishing
+     * off the others. */
+    for (value = json_null; !error && (json_null != parent);) {
+      parent->minified_size += entry->minified_size;
+      parent->pretty_size += entry->pretty_size;
+      parent->pretty_newlines += entry->pretty_newlines;
+      parent->pretty_indents += entry->pretty_indents;
+      parent->pretty_indented_lines += entry->pretty_indented_lines;
+
+      if (json_null != object_element) {
+        object_element = object_element->next;
+
+        if (json_null != object_element) {
+          length = 0;
+          error = json_write_get_string_size(
+              object_element->name, json_write_flags_default, &length);
+          parent->minified_size += length + 1;
+          parent->pretty_size += length + 3;
+
+          value = object_element->value;
+          break;
+        }
+
+        length = ((const struct json_object_s *)parent->value->payload)->length;
+      } else {
+        array_element = array_element->next;
+
+        if (json_null != array_element) {
+          value = array_element->value;
+          break;
         }
+
+        length = ((const struct json_array_s *)parent->value->payload)->length;
       }
+
+      /* a newline after the opening character and each element, and each
+       * element (and everything in it) is indented once more than the value.
+       * The closing character gets the indent of the value, so the number of
+       * indents at a depth of d is pretty_indents + d *
+       * pretty_indented_lines. */
+      parent->pretty_newlines += length + 1;
+      parent->pretty_indents += parent->pretty_indented_lines + length;
+      parent->pretty_indented_lines += length + 1;
+
+      /* the array or object is done, so go back to where we were. */
+      entry = parent;
+      frame = stack.frames + --stack.size;
+      parent = frame->entry;
+
+      if (frame->is_object) {
+        object_element = (const struct json_object_element_s *)frame->element;
+      } else {
+        array_element = (const struct json_array_element_s *)frame->element;
+      }
+    }
+
+    if (error || (json_null == value)) {
+      break;
     }
   }
 
-  /* record the size of the number. */
-  number->number_size = bytes_written;
-  /* add null terminator to number string. */
-  data[bytes_written++] = '\0';
-  /* move data along. */
-  state->data += bytes_written;
-  /* update offset. */
-  state->offset = offset;
+  json_write_stack_release(&stack);
+
+  return error ? json_null : entry;
 }
 
-json_weak void json_parse_value(struct json_parse_state_s *state,
-                                int is_global_object,
-                                struct json_value_s *value);
-void json_parse_value(struct json_parse_state_s *state, int is_global_object,
-                      struct json_value_s *value) {
-  const size_t flags_bitset = state->flags_bitset;
-  const char *const src = state->src;
-  const size_t size = state->size;
-  size_t offset;
+struct json_write_cache_s *
+json_write_cache_create(const struct json_value_s *value,
+                        void *(*alloc_func_ptr)(void *user_data, size_t size),
+                        void *user_data) {
+  struct json_write_cache_s *cache = json_null;
+  size_t count = 0;
+  size_t capacity = 1;
+  size_t i;
 
-  (void)json_skip_all_skippables(state);
+  if (json_null == value) {
+    return json_null;
+  }
 
-  /* cache offset now. */
-  offset = state->offset;
+  if (json_write_cache_count(value, alloc_func_ptr, user_data, &count)) {
+    /* value was malformed! */
+    return json_null;
+  }
 
-  if (is_global_object) {
-    value->type = json_type_object;
-    value->payload = state->dom;
-    state->dom += sizeof(struct json_object_s);
-    json_parse_object(state, /* is_global_object = */ 1,
-                      (struct json_object_s *)value->payload);
-  } else {
-    switch (src[offset]) {
-    case '"':
-    case '\'':
-      value->type = json_type_string;
-      value->payload = state->dom;
-      state->dom += sizeof(struct json_string_s);
-      json_parse_string(state, (struct json_string_s *)value->payload);
-      break;
-    case '{':
-      value->type = json_type_object;
-      value->payload = state->dom;
-      state->dom += sizeof(struct json_object_s);
-      json_parse_object(state, /* is_global_object = */ 0,
-                        (struct json_object_s *)value->payload);
-      break;
-    case '[':
-      value->type = json_type_array;
-      value->payload = state->dom;
-      state->dom += sizeof(struct json_array_s);
-      json_parse_array(state, (struct json_array_s *)value->payload);
-      break;
-    case '-':
-    case '+':
-    case '0':
-    case '1':
-    case '2':
-    case '3':
-    case '4':
-    case '5':
-    case '6':
-    case '7':
-    case '8':
-    case '9':
-    case '.':
-      value->type = json_type_number;
-      value->payload = state->dom;
-      state->dom += sizeof(struct json_number_s);
-      json_parse_number(state, (struct json_number_s *)value->payload);
-      break;
-    default:
-      if ((offset + 4) <= size && 't' == src[offset + 0] &&
-          'r' == src[offset + 1] && 'u' == src[offset + 2] &&
-          'e' == src[offset + 3]) {
-        value->type = json_type_true;
-        value->payload = json_null;
-        state->offset += 4;
-      } else if ((offset + 5) <= size && 'f' == src[offset + 0] &&
-                 'a' == src[offset + 1] && 'l' == src[offset + 2] &&
-                 's' == src[offset + 3] && 'e' == src[offset + 4]) {
-        value->type = json_type_false;
-        value->payload = json_null;
-        state->offset += 5;
-      } else if ((offset + 4) <= size && 'n' == src[offset + 0] &&
-                 'u' == src[offset + 1] && 'l' == src[offset + 2] &&
-                 'l' == src[offset + 3]) {
-        value->type = json_type_null;
-        value->payload = json_null;
-        state->offset += 4;
-      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
-                 (offset + 3) <= size && 'N' == src[offset + 0] &&
-                 'a' == src[offset + 1] && 'N' == src[offset + 2]) {
-        value->type = json_type_number;
-        value->payload = state->dom;
-        state->dom += sizeof(struct json_number_s);
-        json_parse_number(state, (struct json_number_s *)value->payload);
-      } else if ((json_parse_flags_allow_inf_and_nan & flags_bitset) &&
-                 (offset + 8) <= size && 'I' == src[offset + 0] &&
-                 'n' == src[offset + 1] && 'f' == src[offset + 2] &&
-                 'i' == src[offset + 3] && 'n' == src[offset + 4] &&
-                 'i' == src[offset + 5] && 't' == src[offset + 6] &&
-                 'y' == src[offset + 7]) {
-        value->type = json_type_number;
-        value->payload = state->dom;
-        state->dom += sizeof(struct json_number_s);
-        json_parse_number(state, (struct json_number_s *)value->payload);
-      }
-      break;
-    }
+  /* keep the table at most half full so that probe sequences stay short. */
+  while (capacity < 2 * count) {
+    capacity *= 2;
+  }
+
+  if (json_null == alloc_func_ptr) {
+    cache = (struct json_write_cache_s *)malloc(
+        sizeof(struct json_write_cache_s) +
+        sizeof(struct json_write_cache_entry_s) * capacity);
+  } else {
+    cache = (struct json_write_cache_s *)alloc_func_ptr(
+        user_data, sizeof(struct json_write_cache_s) +
+                       sizeof(struct json_write_cache_entry_s) * capacity);
   }
-}
 
-struct json_value_s *
-json_parse_ex(const void *src, size_t src_size, size_t flags_bitset,
-              void *(*alloc_func_ptr)(void *user_data, size_t size),
-              void *user_data, struct json_parse_result_s *result) {
-  struct json_parse_state_s state;
-  void *allocation;
-  struct json_value_s *value;
-  size_t total_size;
-  int input_error;
+  if (json_null == cache) {
+    /* malloc failed! */
+    return json_null;
+  }
 
-  if (result) {
-    result->error = json_parse_error_none;
-    result->error_offset = 0;
-    result->error_line_no = 0;
-    result->error_row_no = 0;
+  cache->entries = (struct json_write_cache_entry_s *)(cache + 1);
+  cache->capacity = capacity;
+
+  for (i = 0; i < capacity; i++) {
+    cache->entries[i].value = json_null;
   }
 
-  if (json_null == src) {
-    /* invalid src pointer was null! */
+  if (json_null ==
+      json_write_cache_fill(cache, value, alloc_func_ptr, user_data)) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(cache);
+    }
+
     return json_null;
   }
 
-  state.src = (const char *)src;
-  state.size = src_size;
-  state.offset = 0;
-  state.line_no = 1;
-  state.line_offset = 0;
-  state.error = json_parse_error_none;
-  state.dom_size = 0;
-  state.data_size = 0;
-  state.flags_bitset = flags_bitset;
-  state.recursion = 0;
+  return cache;
+}
 
-  input_error = json_get_value_size(
-      &state, (int)(json_parse_flags_allow_global_object & state.flags_bitset));
+json_weak int json_write_cache_get_size(const struct json_write_cache_s *cache,
+                                        const struct json_value_s *value,
+                                        const char *indent, const char *newline,
+                                        void *(*alloc_func_ptr)(void *, size_t),
+                                        void *user_data, size_t *size);
+int json_write_cache_get_size(const struct json_write_cache_s *cache,
+                              const struct json_value_s *value,
+                              const char *indent, const char *newline,
+                              void *(*alloc_func_ptr)(void *user_data,
+                                                      size_t size),
+                              void *user_data, size_t *size) {
+  const struct json_write_cache_entry_s *entry = json_null;
 
-  if (0 == input_error) {
-    json_skip_all_skippables(&state);
+  if (json_null != cache) {
+    entry = cache->entries + json_write_cache_slot(cache, value);
+  }
 
-    if (state.offset != state.size) {
-      /* our parsing didn't have an error, but there are characters remaining in
-       * the input that weren't part of the JSON! */
+  if ((json_null == entry) || (value != entry->value)) {
+    /* the value isn't in the cache, so work out its size the slow way. */
+    if (json_null == indent) {
+      if (json_write_minified_get_value_size(value, json_write_flags_default,
+                                             alloc_func_ptr, user_data, size)) {
+        return 1;
+      }
 
-      state.error = json_parse_error_unexpected_trailing_characters;
-      input_error = 1;
+      *size += 1; /* for the '\0' null terminating character. */
+      return 0;
     }
+
+    return json_write_pretty_get_size(value, indent, newline,
+                                      json_write_flags_default, alloc_func_ptr,
+                                      user_data, size);
   }
 
-  if (input_error) {
-    /* parsing value's size failed (most likely an invalid JSON DOM!). */
-    if (result) {
-      result->error = state.error;
-      result->error_offset = state.offset;
-      result->error_line_no = state.line_no;
-      result->error_row_no = state.offset - state.line_offset;
-    }
+  if (json_null == indent) {
+    *size += entry->minified_size;
+  } else {
+    *size += entry->pretty_size + entry->pretty_newlines * strlen(newline) +
+             entry->pretty_indents * strlen(indent);
+  }
+
+  *size += 1; /* for the '\0' null terminating character. */
+
+  return 0;
+}
+
+void *json_write_minified_cached(
+    const struct json_write_cache_s *cache, const struct json_value_s *value,
+    void *(*alloc_func_ptr)(void *user_data, size_t size), void *user_data,
+    size_t *out_size) {
+  size_t size = 0;
+  char *data = json_null;
+  char *data_end = json_null;
+
+  if (json_null == value) {
     return json_null;
   }
 
-  /* our total allocation is the combination of the dom and data sizes (we. */
-  /* first encode the structure of the JSON, and then the data referenced by. */
-  /* the JSON values). */
-  total_size = state.dom_size + state.data_size;
+  if (json_write_cache_get_size(cache, value, json_null, json_null,
+                                alloc_func_ptr, user_data, &size)) {
+    /* value was malformed! */
+    return json_null;
+  }
 
   if (json_null == alloc_func_ptr) {
-    allocation = malloc(total_size);
+    data = (char *)malloc(size);
   } else {
-    allocation = alloc_func_ptr(user_data, total_size);
+    data = (char *)alloc_func_ptr(user_data, size);
   }
 
-  if (json_null == allocation) {
+  if (json_null == data) {
     /* malloc failed! */
-    if (result) {
-      result->error = json_parse_error_allocator_failed;
-      result->error_offset = 0;
-      result->error_line_no = 0;
-      result->error_row_no = 0;
+    return json_null;
+  }
+
+  data_end = json_write_minified_value(value, json_write_flags_default,
+                                       alloc_func_ptr, user_data, data);
+
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(data);
     }
 
     return json_null;
   }
 
-  /* reset offset so we can reuse it. */
-  state.offset = 0;
+  /* null terminated the string. */
+  *data_end = '\0';
 
-  /* reset the line information so we can reuse it. */
-  state.line_no = 1;
-  state.line_offset = 0;
+  if (json_null != out_size) {
+    *out_size = size;
+  }
 
-  state.dom = (char *)allocation;
-  state.data = state.dom + state.dom_size;
+  return data;
+}
 
-  if (json_parse_flags_allow_location_information & state.flags_bitset) {
-    struct json_value_ex_s *value_ex = (struct json_value_ex_s *)state.dom;
-    state.dom += sizeof(struct json_value_ex_s);
+void *json_write_pretty_cached(
+    const struct json_write_cache_s *cache, const struct json_value_s *value,
+    const char *indent, const char *newline,
+    void *(*alloc_func_ptr)(void *user_data, size_t size), void *user_data,
+    size_t *out_size) {
+  size_t size = 0;
+  char *data = json_null;
+  char *data_end = json_null;
 
-    value_ex->offset = state.offset;
-    value_ex->line_no = state.line_no;
-    value_ex->row_no = state.offset - state.line_offset;
+  if (json_null == value) {
+    return json_null;
+  }
 
-    value = &(value_ex->value);
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
+  }
+
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
+  }
+
+  if (json_write_cache_get_size(cache, value, indent, newline, alloc_func_ptr,
+                                user_data, &size)) {
+    /* value was malformed! */
+    return json_null;
+  }
+
+  if (json_null == alloc_func_ptr) {
+    data = (char *)malloc(size);
   } else {
-    value = (struct json_value_s *)state.dom;
-    state.dom += sizeof(struct json_value_s);
+    data = (char *)alloc_func_ptr(user_data, size);
   }
 
-  json_parse_value(
-      &state, (int)(json_parse_flags_allow_global_object & state.flags_bitset),
-      value);
+  if (json_null == data) {
+    /* malloc failed! */
+    return json_null;
+  }
 
-  return (struct json_value_s *)allocation;
-}
+  data_end = json_write_pretty_value(value, 0, indent, newline,
+                                     json_write_flags_default, alloc_func_ptr,
+                                     user_data, data);
 
-struct json_value_s *json_parse(const void *src, size_t src_size) {
-  return json_parse_ex(src, src_size, json_parse_flags_default, json_null,
-                       json_null, json_null);
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(data);
+    }
+
+    return json_null;
+  }
+
+  /* null terminated the string. */
+  *data_end = '\0';
+
+  if (json_null != out_size) {
+    *out_size = size;
+  }
+
+  return data;
 }
 
-struct json_extract_result_s {
-  size_t dom_size;
+struct json_template_s {
+  /* where each placeholder goes in data, in order. */
+  size_t *slots;
+  size_t slots_size;
+  /* the minified skeleton, with a '0' standing in for each placeholder. */
+  char *data;
   size_t data_size;
 };
 
-struct json_value_s *json_extract_value(const struct json_value_s *value) {
-  return json_extract_value_ex(value, json_null, json_null);
+json_weak int json_template_scan(const char *skeleton, size_t skeleton_size,
+                                 struct json_template_s *tmpl);
+int json_template_scan(const char *skeleton, size_t skeleton_size,
+                       struct json_template_s *tmpl) {
+  /* slots and data are only filled in once they have been allocated, so that
+   * the first scan can work out how big they need to be. */
+  char *const data = tmpl->data;
+  size_t offset = 0;
+  size_t size = 0;
+  char previous = ',';
+  int separated = 0;
+
+  tmpl->slots_size = 0;
+
+  while (offset < skeleton_size) {
+    const char c = skeleton[offset];
+
+    if ((' ' == c) || ('\t' == c) || ('\r' == c) || ('\n' == c)) {
+      separated = 1;
+      offset++;
+      continue;
+    }
+
+    if ('"' == c) {
+      const size_t start = offset++;
+
+      while ((offset < skeleton_size) && ('"' != skeleton[offset])) {
+        /* skip the reverse solidus and the character it escapes. */
+        offset += ('\\' == skeleton[offset]) ? 2 : 1;
+      }
+
+      if (offset >= skeleton_size) {
+        /* the string wasn't terminated. */
+        return 1;
+      }
+
+      offset++; /* skip trailing '"'. */
+
+      if (json_null != data) {
+        memcpy(data + size, skeleton + start, offset - start);
+      }
+
+      size += offset - start;
+      previous = '"';
+      separated = 0;
+      continue;
+    }
+
+    /* two numbers or literals can only follow one another if they are really
+     * one token, and a placeholder is always a token all of its own. */
+    if (json_minify_is_bare(previous) && json_minify_is_bare(c) &&
+        (separated || ('?' == previous) || ('?' == c))) {
+      return 1;
+    }
+
+    if ('?' == c) {
+      if (json_null != tmpl->slots) {
+        tmpl->slots[tmpl->slots_size] = size;
+      }
+
+      tmpl->slots_size++;
+    }
+
+    if (json_null != data) {
+      data[size] = ('?' == c) ? '0' : c;
+    }
+
+    size++;
+    offset++;
+    previous = c;
+    separated = 0;
+  }
+
+  tmpl->data_size = size;
+
+  return 0;
 }
 
-json_weak struct json_extract_result_s
-json_extract_get_number_size(const struct json_number_s *const number);
-json_weak struct json_extract_result_s
-json_extract_get_string_size(const struct json_string_s *const string);
-json_weak struct json_extract_result_s
-json_extract_get_object_size(const struct json_object_s *const object);
-json_weak struct json_extract_result_s
-json_extract_get_array_size(const struct json_array_s *const array);
-json_weak struct json_extract_result_s
-json_extract_get_value_size(const struct json_value_s *const value);
+struct json_template_s *
+json_template_compile(const void *skeleton, size_t skeleton_size,
+                      void *(*alloc_func_ptr)(void *user_data, size_t size),
+                      void *user_data) {
+  struct json_template_s sizing;
+  struct json_template_s *tmpl = json_null;
+  size_t size = 0;
 
-struct json_extract_result_s
-json_extract_get_number_size(const struct json_number_s *const number) {
-  struct json_extract_result_s result;
-  result.dom_size = sizeof(struct json_number_s);
-  result.data_size = number->number_size;
-  return result;
+  if (json_null == skeleton) {
+    return json_null;
+  }
+
+  sizing.slots = json_null;
+  sizing.data = json_null;
+
+  if (json_template_scan((const char *)skeleton, skeleton_size, &sizing)) {
+    /* skeleton was malformed! */
+    return json_null;
+  }
+
+  size = sizeof(struct json_template_s) +
+         (sizeof(size_t) * sizing.slots_size) + sizing.data_size;
+
+  if (json_null == alloc_func_ptr) {
+    tmpl = (struct json_template_s *)malloc(size);
+  } else {
+    tmpl = (struct json_template_s *)alloc_func_ptr(user_data, size);
+  }
+
+  if (json_null == tmpl) {
+    /* malloc failed! */
+    return json_null;
+  }
+
+  tmpl->slots = (size_t *)(tmpl + 1);
+  tmpl->data = (char *)(tmpl->slots + sizing.slots_size);
+
+  (void)json_template_scan((const char *)skeleton, skeleton_size, tmpl);
+
+  /* with a '0' standing in for each placeholder, the skeleton has to be valid
+   * JSON itself. */
+  if (json_parse_size(tmpl->data, tmpl->data_size, json_parse_flags_default,
+                      json_null, json_null, json_null, json_null)) {
+    /* skeleton was malformed! */
+    if (json_null == alloc_func_ptr) {
+      free(tmpl);
+    }
+
+    return json_null;
+  }
+
+  return tmpl;
 }
 
-struct json_extract_result_s
-json_extract_get_string_size(const struct json_string_s *const string) {
-  struct json_extract_result_s result;
-  result.dom_size = sizeof(struct json_string_s);
-  result.data_size = string->string_size + 1;
-  return result;
+size_t json_template_placeholders(const struct json_template_s *tmpl) {
+  return (json_null == tmpl) ? 0 : tmpl->slots_size;
+}
+
+json_weak int json_template_get_size(const struct json_template_s *tmpl,
+                                     const struct json_value_s *const *values,
+                                     void *(*alloc_func_ptr)(void *, size_t),
+                                     void *user_data, size_t *size);
+int json_template_get_size(const struct json_template_s *tmpl,
+                           const struct json_value_s *const *values,
+                           void *(*alloc_func_ptr)(void *user_data,
+                                                   size_t size),
+                           void *user_data, size_t *size) {
+  size_t i;
+
+  /* the '0' standing in for each placeholder is not written. */
+  *size = tmpl->data_size - tmpl->slots_size;
+
+  for (i = 0; i < tmpl->slots_size; i++) {
+    if ((json_null == values[i]) ||
+        json_write_minified_get_value_size(values[i], json_write_flags_default,
+                                           alloc_func_ptr, user_data, size)) {
+      /* value was malformed! */
+      return 1;
+    }
+  }
+
+  *size += 1; /* for the '\0' null terminating character. */
+
+  return 0;
 }
 
-struct json_extract_result_s
-json_extract_get_object_size(const struct json_object_s *const object) {
-  struct json_extract_result_s result;
+json_weak char *
+json_template_write_values(const struct json_template_s *tmpl,
+                           const struct json_value_s *const *values,
+                           void *(*alloc_func_ptr)(void *, size_t),
+                           void *user_data, char *data);
+char *json_template_write_values(const struct json_template_s *tmpl,
+                                 const struct json_value_s *const *values,
+                                 void *(*alloc_func_ptr)(void *user_data,
+                                                         size_t size),
+                                 void *user_data, char *data) {
+  size_t offset = 0;
   size_t i;
-  const struct json_object_element_s *element = object->start;
 
-  result.dom_size = sizeof(struct json_object_s) +
-                    (sizeof(struct json_object_element_s) * object->length);
-  result.data_size = 0;
+  for (i = 0; i < tmpl->slots_size; i++) {
+    const size_t slot = tmpl->slots[i];
 
-  for (i = 0; i < object->length; i++) {
-    const struct json_extract_result_s string_result =
-        json_extract_get_string_size(element->name);
-    const struct json_extract_result_s value_result =
-        json_extract_get_value_size(element->value);
+    memcpy(data, tmpl->data + offset, slot - offset);
+    data += slot - offset;
 
-    result.dom_size += string_result.dom_size;
-    result.data_size += string_result.data_size;
+    data = json_write_minified_value(values[i], json_write_flags_default,
+                                     alloc_func_ptr, user_data, data);
 
-    result.dom_size += value_result.dom_size;
-    result.data_size += value_result.data_size;
+    if (json_null == data) {
+      return json_null;
+    }
 
-    element = element->next;
+    /* skip the '0' standing in for the placeholder. */
+    offset = slot + 1;
   }
 
-  return result;
+  memcpy(data, tmpl->data + offset, tmpl->data_size - offset);
+  data += tmpl->data_size - offset;
+
+  return data;
 }
 
-struct json_extract_result_s
-json_extract_get_array_size(const struct json_array_s *const array) {
-  struct json_extract_result_s result;
-  size_t i;
-  const struct json_array_element_s *element = array->start;
+void *json_template_write(const struct json_template_s *tmpl,
+                          const struct json_value_s *const *values,
+                          void *(*alloc_func_ptr)(void *user_data, size_t size),
+                          void *user_data, size_t *out_size) {
+  size_t size = 0;
+  char *data = json_null;
+  char *data_end = json_null;
 
-  result.dom_size = sizeof(struct json_array_s) +
-                    (sizeof(struct json_array_element_s) * array->length);
-  result.data_size = 0;
+  if ((json_null == tmpl) ||
+      ((json_null == values) && (0 != tmpl->slots_size))) {
+    return json_null;
+  }
 
-  for (i = 0; i < array->length; i++) {
-    const struct json_extract_result_s value_result =
-        json_extract_get_value_size(element->value);
+  if (json_template_get_size(tmpl, values, alloc_func_ptr, user_data, &size)) {
+    /* value was malformed! */
+    return json_null;
+  }
 
-    result.dom_size += value_result.dom_size;
-    result.data_size += value_result.data_size;
+  if (json_null == alloc_func_ptr) {
+    data = (char *)malloc(size);
+  } else {
+    data = (char *)alloc_func_ptr(user_data, size);
+  }
 
-    element = element->next;
+  if (json_null == data) {
+    /* malloc failed! */
+    return json_null;
   }
 
-  return result;
-}
+  data_end =
+      json_template_write_values(tmpl, values, alloc_func_ptr, user_data, data);
 
-struct json_extract_result_s
-json_extract_get_value_size(const struct json_value_s *const value) {
-  struct json_extract_result_s result = {0, 0};
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    if (json_null == alloc_func_ptr) {
+      free(data);
+    }
 
-  switch (value->type) {
-  default:
-    break;
-  case json_type_object:
-    result = json_extract_get_object_size(
-        (const struct json_object_s *)value->payload);
-    break;
-  case json_type_array:
-    result = json_extract_get_array_size(
-        (const struct json_array_s *)value->payload);
-    break;
-  case json_type_number:
-    result = json_extract_get_number_size(
-        (const struct json_number_s *)value->payload);
-    break;
-  case json_type_string:
-    result = json_extract_get_string_size(
-        (const struct json_string_s *)value->payload);
-    break;
+    return json_null;
   }
 
-  result.dom_size += sizeof(struct json_value_s);
+  /* null terminated the string. */
+  *data_end = '\0';
 
-  return result;
+  if (json_null != out_size) {
+    *out_size = size;
+  }
+
+  return data;
 }
 
-struct json_extract_state_s {
-  char *dom;
-  char *data;
-};
+int json_template_write_into(const struct json_template_s *tmpl,
+                             const struct json_value_s *const *values,
+                             void *buffer, size_t capacity, size_t *needed) {
+  size_t size = 0;
+  char *data_end = json_null;
 
-json_weak void json_extract_copy_value(struct json_extract_state_s *const state,
-                                       const struct json_value_s *const value);
-void json_extract_copy_value(struct json_extract_state_s *const state,
-                             const struct json_value_s *const value) {
-  struct json_string_s *string;
-  struct json_number_s *number;
-  struct json_object_s *object;
-  struct json_array_s *array;
-  struct json_value_s *new_value;
+  if (json_null != needed) {
+    *needed = 0;
+  }
 
-  memcpy(state->dom, value, sizeof(struct json_value_s));
-  new_value = (struct json_value_s *)state->dom;
-  state->dom += sizeof(struct json_value_s);
-  new_value->payload = state->dom;
+  if ((json_null == tmpl) ||
+      ((json_null == values) && (0 != tmpl->slots_size))) {
+    return 1;
+  }
 
-  if (json_type_string == value->type) {
-    memcpy(state->dom, value->payload, sizeof(struct json_string_s));
-    string = (struct json_string_s *)state->dom;
-    state->dom += sizeof(struct json_string_s);
+  if (json_template_get_size(tmpl, values, json_write_no_alloc, json_null,
+                             &size)) {
+    /* value was malformed! */
+    return 1;
+  }
 
-    memcpy(state->data, string->string, string->string_size + 1);
-    string->string = state->data;
-    state->data += string->string_size + 1;
-  } else if (json_type_number == value->type) {
-    memcpy(state->dom, value->payload, sizeof(struct json_number_s));
-    number = (struct json_number_s *)state->dom;
-    state->dom += sizeof(struct json_number_s);
+  if (json_null != needed) {
+    *needed = size;
+  }
 
-    memcpy(state->data, number->number, number->number_size);
-    number->number = state->data;
-    state->data += number->number_size;
-  } else if (json_type_object == value->type) {
-    struct json_object_element_s *element;
-    size_t i;
+  if ((json_null == buffer) || (capacity < size)) {
+    /* the buffer is too small! */
+    return 1;
+  }
 
-    memcpy(state->dom, value->payload, sizeof(struct json_object_s));
-    object = (struct json_object_s *)state->dom;
-    state->dom += sizeof(struct json_object_s);
+  data_end = json_template_write_values(tmpl, values, json_write_no_alloc,
+                                        json_null, (char *)buffer);
 
-    element = object->start;
-    object->start = (struct json_object_element_s *)state->dom;
+  if (json_null == data_end) {
+    /* bad chi occurred! */
+    return 1;
+  }
 
-    for (i = 0; i < object->length; i++) {
-      struct json_value_s *previous_value;
-      struct json_object_element_s *previous_element;
+  /* null terminated the string. */
+  *data_end = '\0';
 
-      memcpy(state->dom, element, sizeof(struct json_object_element_s));
-      element = (struct json_object_element_s *)state->dom;
-      state->dom += sizeof(struct json_object_element_s);
+  return 0;
+}
 
-      string = element->name;
-      memcpy(state->dom, string, sizeof(struct json_string_s));
-      string = (struct json_string_s *)state->dom;
-      state->dom += sizeof(struct json_string_s);
-      element->name = string;
+json_weak int json_write_buffer_staged(struct json_write_buffer_s *buffer,
+                                       const struct json_value_s *value);
+int json_write_buffer_staged(struct json_write_buffer_s *buffer,
+                             const struct json_value_s *value) {
+  const size_t segments_size =
+      (json_null == buffer->segments)
+          ? 0
+          : sizeof(struct json_write_segment_s) * JSON_WRITE_SEGMENTS_SIZE;
+  char *const allocation =
+      (char *)malloc(segments_size + JSON_WRITE_STAGING_SIZE);
+  int error;
 
-      memcpy(state->data, string->string, string->string_size + 1);
-      string->string = state->data;
-      state->data += string->string_size + 1;
+  if (json_null == allocation) {
+    /* malloc failed! */
+    return 1;
+  }
 
-      previous_value = element->value;
-      element->value = (struct json_value_s *)state->dom;
-      json_extract_copy_value(state, previous_value);
+  if (json_null != buffer->segments) {
+    /* the segments go first so that they are suitably aligned. */
+    buffer->segments->segments =
+        (struct json_write_segment_s *)(void *)allocation;
+    buffer->segments->size = 0;
+    buffer->segments->capacity = JSON_WRITE_SEGMENTS_SIZE;
+    buffer->segments->pending = 0;
+  }
 
-      previous_element = element;
-      element = element->next;
+  buffer->data = allocation + segments_size;
+  buffer->size = 0;
+  buffer->capacity = JSON_WRITE_STAGING_SIZE;
+  buffer->realloc_func_ptr = json_null;
 
-      if (element) {
-        previous_element->next = (struct json_object_element_s *)state->dom;
-      }
-    }
-  } else if (json_type_array == value->type) {
-    struct json_array_element_s *element;
-    size_t i;
+  error = json_write_buffer_value(buffer, value, json_null != buffer->indent,
+                                  json_null);
 
-    memcpy(state->dom, value->payload, sizeof(struct json_array_s));
-    array = (struct json_array_s *)state->dom;
-    state->dom += sizeof(struct json_array_s);
+  /* hand on whatever is left in the staging buffer. */
+  if (!error) {
+    error = json_write_buffer_flush(buffer, 0);
+  }
 
-    element = array->start;
-    array->start = (struct json_array_element_s *)state->dom;
+  free(allocation);
 
-    for (i = 0; i < array->length; i++) {
-      struct json_value_s *previous_value;
-      struct json_array_element_s *previous_element;
+  return error;
+}
 
-      memcpy(state->dom, element, sizeof(struct json_array_element_s));
-      element = (struct json_array_element_s *)state->dom;
-      state->dom += sizeof(struct json_array_element_s);
+int json_write_minified_to(const struct json_value_s *value,
+                           int (*write_func_ptr)(void *user_data,
+                                                 const void *data, size_t size),
+                           void *user_data) {
+  struct json_write_buffer_s buffer;
 
-      previous_value = element->value;
-      element->value = (struct json_value_s *)state->dom;
-      json_extract_copy_value(state, previous_value);
+  if ((json_null == value) || (json_null == write_func_ptr)) {
+    return 1;
+  }
 
-      previous_element = element;
-      element = element->next;
+  buffer.write_func_ptr = write_func_ptr;
+  buffer.segments = json_null;
+  buffer.user_data = user_data;
+  buffer.indent = json_null;
+  buffer.indent_size = 0;
+  buffer.newline = json_null;
+  buffer.newline_size = 0;
+  buffer.single_line = 0;
 
-      if (element) {
-        previous_element->next = (struct json_array_element_s *)state->dom;
-      }
-    }
+  return json_write_buffer_staged(&buffer, value);
+}
+
+int json_write_pretty_to(const struct json_value_s *value, const char *indent,
+                         const char *newline,
+                         int (*write_func_ptr)(void *user_data,
+                                               const void *data, size_t size),
+                         void *user_data) {
+  struct json_write_buffer_s buffer;
+
+  if ((json_null == value) || (json_null == write_func_ptr)) {
+    return 1;
+  }
+
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
   }
+
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
+  }
+
+  buffer.write_func_ptr = write_func_ptr;
+  buffer.segments = json_null;
+  buffer.user_data = user_data;
+  buffer.indent = indent;
+  buffer.indent_size = strlen(indent);
+  buffer.newline = newline;
+  buffer.newline_size = strlen(newline);
+  buffer.single_line = 0;
+
+  return json_write_buffer_staged(&buffer, value);
 }
 
-struct json_value_s *json_extract_value_ex(const struct json_value_s *value,
-                                           void *(*alloc_func_ptr)(void *,
-                                                                   size_t),
-                                           void *user_data) {
-  void *allocation;
-  struct json_extract_result_s result;
-  struct json_extract_state_s state;
-  size_t total_size;
+int json_write_minified_segments(
+    const struct json_value_s *value,
+    int (*write_func_ptr)(void *user_data,
+                          const struct json_write_segment_s *segments,
+                          size_t size),
+    void *user_data) {
+  struct json_write_segments_s segments;
+  struct json_write_buffer_s buffer;
 
-  if (json_null == value) {
-    /* invalid value was null! */
-    return json_null;
+  if ((json_null == value) || (json_null == write_func_ptr)) {
+    return 1;
   }
 
-  result = json_extract_get_value_size(value);
-  total_size = result.dom_size + result.data_size;
+  segments.write_func_ptr = write_func_ptr;
 
-  if (json_null == alloc_func_ptr) {
-    allocation = malloc(total_size);
-  } else {
-    allocation = alloc_func_ptr(user_data, total_size);
+  buffer.write_func_ptr = json_null;
+  buffer.segments = &segments;
+  buffer.user_data = user_data;
+  buffer.indent = json_null;
+  buffer.indent_size = 0;
+  buffer.newline = json_null;
+  buffer.newline_size = 0;
+  buffer.single_line = 0;
+
+  return json_write_buffer_staged(&buffer, value);
+}
+
+int json_write_pretty_segments(
+    const struct json_value_s *value, const char *indent, const char *newline,
+    int (*write_func_ptr)(void *user_data,
+                          const struct json_write_segment_s *segments,
+                          size_t size),
+    void *user_data) {
+  struct json_write_segments_s segments;
+  struct json_write_buffer_s buffer;
+
+  if ((json_null == value) || (json_null == write_func_ptr)) {
+    return 1;
   }
 
-  state.dom = (char *)allocation;
-  state.data = state.dom + result.dom_size;
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
+  }
+
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
+  }
+
+  segments.write_func_ptr = write_func_ptr;
+
+  buffer.write_func_ptr = json_null;
+  buffer.segments = &segments;
+  buffer.user_data = user_data;
+  buffer.indent = indent;
+  buffer.indent_size = strlen(indent);
+  buffer.newline = newline;
+  buffer.newline_size = strlen(newline);
+  buffer.single_line = 0;
+
+  return json_write_buffer_staged(&buffer, value);
+}
+
+json_weak int json_write_ndjson_staged(
+    const struct json_array_element_s *element,
+    const struct json_value_s *const *values, size_t values_size,
+    int (*write_func_ptr)(void *, const void *, size_t), void *user_data);
+int json_write_ndjson_staged(const struct json_array_element_s *element,
+                             const struct json_value_s *const *values,
+                             size_t values_size,
+                             int (*write_func_ptr)(void *user_data,
+                                                   const void *data,
+                                                   size_t size),
+                             void *user_data) {
+  struct json_write_buffer_s buffer;
+  const struct json_value_s *value;
+  size_t i = 0;
+  int error = 0;
+
+  buffer.data = (char *)malloc(JSON_WRITE_STAGING_SIZE);
+
+  if (json_null == buffer.data) {
+    /* malloc failed! */
+    return 1;
+  }
+
+  buffer.size = 0;
+  buffer.capacity = JSON_WRITE_STAGING_SIZE;
+  buffer.realloc_func_ptr = json_null;
+  buffer.write_func_ptr = write_func_ptr;
+  buffer.segments = json_null;
+  buffer.user_data = user_data;
+  buffer.indent = json_null;
+  buffer.indent_size = 0;
+  buffer.newline = json_null;
+  buffer.newline_size = 0;
+  buffer.single_line = 1;
+
+  /* lines are written from the elements of an array if we have one, and from
+   * values otherwise. */
+  for (;;) {
+    if (json_null != element) {
+      value = element->value;
+      element = element->next;
+    } else if ((json_null == values) || (i == values_size)) {
+      break;
+    } else {
+      value = values[i++];
+    }
 
-  json_extract_copy_value(&state, value);
+    if ((json_null == value) ||
+        json_write_buffer_value(&buffer, value, 0, json_null)) {
+      /* value was malformed! */
+      error = 1;
+      break;
+    }
 
-  return (struct json_value_s *)allocation;
-}
+    if ((buffer.capacity == buffer.size) &&
+        json_write_buffer_flush(&buffer, 1)) {
+      error = 1;
+      break;
+    }
 
-struct json_string_s *json_value_as_string(struct json_value_s *const value) {
-  if (value->type != json_type_string) {
-    return json_null;
+    buffer.data[buffer.size++] = '\n'; /* end the line. */
   }
 
-  return (struct json_string_s *)value->payload;
-}
-
-struct json_number_s *json_value_as_number(struct json_value_s *const value) {
-  if (value->type != json_type_number) {
-    return json_null;
+  /* hand on whatever is left in the staging buffer. */
+  if (!error) {
+    error = json_write_buffer_flush(&buffer, 0);
   }
 
-  return (struct json_number_s *)value->payload;
+  free(buffer.data);
+
+  return error;
 }
 
-struct json_object_s *json_value_as_object(struct json_value_s *const value) {
-  if (value->type != json_type_object) {
-    return json_null;
+int json_write_ndjson_to(const struct json_value_s *value,
+                         int (*write_func_ptr)(void *user_data,
+                                               const void *data, size_t size),
+                         void *user_data) {
+  if ((json_null == value) || (json_null == write_func_ptr)) {
+    return 1;
   }
 
-  return (struct json_object_s *)value->payload;
-}
-
-struct json_array_s *json_value_as_array(struct json_value_s *const value) {
-  if (value->type != json_type_array) {
-    return json_null;
+  if (json_type_array != value->type) {
+    /* only the elements of an array can be written as lines! */
+    return 1;
   }
 
-  return (struct json_array_s *)value->payload;
+  return json_write_ndjson_staged(
+      ((const struct json_array_s *)value->payload)->start, json_null, 0,
+      write_func_ptr, user_data);
 }
 
-int json_value_is_true(const struct json_value_s *const value) {
-  return value->type == json_type_true;
-}
+int json_write_ndjson_values_to(
+    const struct json_value_s *const *values, size_t values_size,
+    int (*write_func_ptr)(void *user_data, const void *data, size_t size),
+    void *user_data) {
+  if (((json_null == values) && (0 != values_size)) ||
+      (json_null == write_func_ptr)) {
+    return 1;
+  }
 
-int json_value_is_false(const struct json_value_s *const value) {
-  return value->type == json_type_false;
+  return json_write_ndjson_staged(json_null, values, values_size,
+                                  write_func_ptr, user_data);
 }
 
-int json_value_is_null(const struct json_value_s *const value) {
-  return value->type == json_type_null;
+#ifndef JSON_NO_WRITE_CALLBACKS
+int json_write_file_callback(void *user_data, const void *data, size_t size) {
+  return size != fwrite(data, 1, size, (FILE *)user_data);
 }
 
-json_weak int
-json_write_minified_get_value_size(const struct json_value_s *value,
-                                   size_t *size);
-
-json_weak int json_write_get_number_size(const struct json_number_s *number,
-                                         size_t *size);
-int json_write_get_number_size(const struct json_number_s *number,
-                               size_t *size) {
-  json_uintmax_t parsed_number;
-  size_t i;
-
-  if (number->number_size >= 2) {
-    switch (number->number[1]) {
-    default:
-      break;
-    case 'x':
-    case 'X':
-      /* the number is a json_parse_flags_allow_hexadecimal_numbers hexadecimal
-       * so we have to do extra work to convert it to a non-hexadecimal for JSON
-       * output. */
-      parsed_number = json_strtoumax(number->number, json_null, 0);
-
-      i = 0;
+int json_write_fd_callback(void *user_data, const void *data, size_t size) {
+  const int fd = *(const int *)user_data;
+  const char *bytes = (const char *)data;
 
-      do {
-        parsed_number /= 10;
-        i++;
-      } while (0 != parsed_number);
+  while (0 < size) {
+#if defined(_WIN32)
+    const int written =
+        _write(fd, bytes, (unsigned)((size > 0x40000000) ? 0x40000000 : size));
+#else
+    const ssize_t written = write(fd, bytes, size);
+#endif
 
-      *size += i;
-      return 0;
+    if ((0 > written) && (EINTR == errno)) {
+      /* interrupted before anything was written, so try again. */
+      continue;
     }
-  }
 
-  /* check to see if the number has leading/trailing decimal point. */
-  i = 0;
+    if (0 >= written) {
+      /* the write failed (or wrote nothing, which would loop forever)! */
+      return 1;
+    }
 
-  /* skip any leading '+' or '-'. */
-  if ((i < number->number_size) &&
-      (('+' == number->number[i]) || ('-' == number->number[i]))) {
-    i++;
+    bytes += written;
+    size -= (size_t)written;
   }
 
-  /* check if we have infinity. */
-  if ((i < number->number_size) && ('I' == number->number[i])) {
-    const char *inf = "Infinity";
-    size_t k;
+  return 0;
+}
+#endif
 
-    for (k = i; k < number->number_size; k++) {
-      const char c = *inf++;
+enum json_writer_level_e {
+  json_writer_level_object = 1,
+  json_writer_level_has_elements = 2,
+  json_writer_level_has_name = 4
+};
 
-      /* Check if we found the Infinity string! */
-      if ('\0' == c) {
-        break;
-      } else if (c != number->number[k]) {
-        break;
-      }
-    }
+struct json_writer_s {
+  struct json_write_buffer_s buffer;
+  size_t depth;
+  size_t pretty;
+  size_t written;
+  size_t error;
+  unsigned char levels[JSON_MAX_RECURSION];
+};
 
-    if ('\0' == *inf) {
-      /* Inf becomes 1.7976931348623158e308 because JSON can't support it. */
-      *size += 22;
+json_weak int json_writer_separate(struct json_writer_s *writer, int is_name);
+int json_writer_separate(struct json_writer_s *writer, int is_name) {
+  unsigned char *level;
 
-      /* if we had a leading '-' we need to record it in the JSON output. */
-      if ('-' == number->number[0]) {
-        *size += 1;
-      }
+  if (writer->error) {
+    return 1;
+  }
+
+  if (0 == writer->depth) {
+    if (is_name || writer->written) {
+      /* there can only be one value at the root, and it has no name! */
+      writer->error = 1;
+      return 1;
     }
 
+    writer->written = 1;
     return 0;
   }
 
-  /* check if we have nan. */
-  if ((i < number->number_size) && ('N' == number->number[i])) {
-    const char *nan = "NaN";
-    size_t k;
-
-    for (k = i; k < number->number_size; k++) {
-      const char c = *nan++;
+  level = &writer->levels[writer->depth - 1];
 
-      /* Check if we found the NaN string! */
-      if ('\0' == c) {
-        break;
-      } else if (c != number->number[k]) {
-        break;
-      }
+  if (json_writer_level_has_name & *level) {
+    if (is_name) {
+      /* a name has to be followed by a value! */
+      writer->error = 1;
+      return 1;
     }
 
-    if ('\0' == *nan) {
-      /* NaN becomes 1 because JSON can't support it. */
-      *size += 1;
-
-      return 0;
-    }
+    /* the value follows straight on from its name. */
+    *level &= (unsigned char)~json_writer_level_has_name;
+    return 0;
   }
 
-  /* if we had a leading decimal point. */
-  if ((i < number->number_size) && ('.' == number->number[i])) {
-    /* 1 + because we had a leading decimal point. */
-    *size += 1;
-    goto cleanup;
+  if (is_name != ((json_writer_level_object & *level) ? 1 : 0)) {
+    /* values in an object need a name first, and names are only allowed in
+     * objects! */
+    writer->error = 1;
+    return 1;
   }
 
-  for (; i < number->number_size; i++) {
-    const char c = number->number[i];
-    if (!('0' <= c && c <= '9')) {
-      break;
+  if (json_writer_level_has_elements & *level) {
+    if ((writer->buffer.capacity == writer->buffer.size) &&
+        json_write_buffer_flush(&writer->buffer, 1)) {
+      writer->error = 1;
+      return 1;
     }
-  }
 
-  /* if we had a trailing decimal point. */
-  if ((i + 1 == number->number_size) && ('.' == number->number[i])) {
-    /* 1 + because we had a trailing decimal point. */
-    *size += 1;
-    goto cleanup;
+    /* ','s seperate each element. */
+    writer->buffer.data[writer->buffer.size++] = ',';
   }
 
-cleanup:
-  *size += number->number_size; /* the actual string of the number. */
+  *level |= json_writer_level_has_elements;
 
-  /* if we had a leading '+' we don't record it in the JSON output. */
-  if ('+' == number->number[0]) {
-    *size -= 1;
+  if (writer->pretty && json_write_buffer_newline(&writer->buffer,
+                                                  writer->depth)) {
+    writer->error = 1;
+    return 1;
   }
 
   return 0;
 }
 
-json_weak int json_write_get_string_size(const struct json_string_s *string,
-                                         size_t *size);
-int json_write_get_string_size(const struct json_string_s *string,
-                               size_t *size) {
-  size_t i;
-  for (i = 0; i < string->string_size; i++) {
-    switch (string->string[i]) {
-    case '"':
-    case '\\':
-    case '\b':
-    case '\f':
-    case '\n':
-    case '\r':
-    case '\t':
-      *size += 2;
-      break;
-    default:
-      *size += 1;
-      break;
-    }
+json_weak int json_writer_begin(struct json_writer_s *writer, char c,
+                                unsigned char level);
+int json_writer_begin(struct json_writer_s *writer, char c,
+                      unsigned char level) {
+  if (json_writer_separate(writer, 0)) {
+    return 1;
   }
 
-  *size += 2; /* need to encode the surrounding '"' characters. */
+  if ((JSON_MAX_RECURSION == writer->depth) ||
+      json_write_buffer_bytes(&writer->buffer, &c, 1)) {
+    /* we've nested too deep, or the write failed! */
+    writer->error = 1;
+    return 1;
+  }
+
+  writer->levels[writer->depth++] = level;
 
   return 0;
 }
 
-json_weak int
-json_write_minified_get_array_size(const struct json_array_s *array,
-                                   size_t *size);
-int json_write_minified_get_array_size(const struct json_array_s *array,
-                                       size_t *size) {
-  struct json_array_element_s *element;
-
-  *size += 2; /* '[' and ']'. */
-
-  if (1 < array->length) {
-    *size += array->length - 1; /* ','s seperate each element. */
+json_weak int json_writer_value(struct json_writer_s *writer,
+                                const char *data, size_t size);
+int json_writer_value(struct json_writer_s *writer, const char *data,
+                      size_t size) {
+  if (json_writer_separate(writer, 0)) {
+    return 1;
   }
 
-  for (element = array->start; json_null != element; element = element->next) {
-    if (json_write_minified_get_value_size(element->value, size)) {
-      /* value was malformed! */
-      return 1;
-    }
+  if (json_write_buffer_bytes(&writer->buffer, data, size)) {
+    writer->error = 1;
+    return 1;
   }
 
   return 0;
 }
 
-json_weak int
-json_write_minified_get_object_size(const struct json_object_s *object,
-                                    size_t *size);
-int json_write_minified_get_object_size(const struct json_object_s *object,
-                                        size_t *size) {
-  struct json_object_element_s *element;
-
-  *size += 2; /* '{' and '}'. */
-
-  *size += object->length; /* ':'s seperate each name/value pair. */
-
-  if (1 < object->length) {
-    *size += object->length - 1; /* ','s seperate each element. */
+json_weak void json_writer_init(
+    struct json_writer_s *writer, const char *indent, const char *newline,
+    int (*write_func_ptr)(void *, const void *, size_t), void *user_data,
+    char *staging);
+void json_writer_init(struct json_writer_s *writer, const char *indent,
+                      const char *newline,
+                      int (*write_func_ptr)(void *user_data, const void *data,
+                                            size_t size),
+                      void *user_data, char *staging) {
+  writer->buffer.data = json_null;
+  writer->buffer.size = 0;
+  writer->buffer.capacity = 0;
+  writer->buffer.realloc_func_ptr = json_null;
+  writer->buffer.write_func_ptr = write_func_ptr;
+  writer->buffer.segments = json_null;
+  writer->buffer.user_data = user_data;
+  writer->pretty = (json_null != indent) || (json_null != newline);
+
+  if (json_null != write_func_ptr) {
+    writer->buffer.data = staging;
+    writer->buffer.capacity = JSON_WRITE_STAGING_SIZE;
   }
 
-  for (element = object->start; json_null != element; element = element->next) {
-    if (json_write_get_string_size(element->name, size)) {
-      /* string was malformed! */
-      return 1;
-    }
+  if (json_null == indent) {
+    indent = "  "; /* default to two spaces. */
+  }
 
-    if (json_write_minified_get_value_size(element->value, size)) {
-      /* value was malformed! */
-      return 1;
-    }
+  if (json_null == newline) {
+    newline = "\n"; /* default to linux newlines. */
   }
 
-  return 0;
-}
+  writer->buffer.indent = indent;
+  writer->buffer.indent_size = strlen(indent);
+  writer->buffer.newline = newline;
+  writer->buffer.newline_size = strlen(newline);
+  writer->buffer.single_line = 0;
 
-json_weak int
-json_write_minified_get_value_size(const struct json_value_s *value,
-                                   size_t *size);
-int json_write_minified_get_value_size(const struct json_value_s *value,
-                                       size_t *size) {
-  switch (value->type) {
-  default:
-    /* unknown value type found! */
-    return 1;
-  case json_type_number:
-    return json_write_get_number_size((struct json_number_s *)value->payload,
-                                      size);
-  case json_type_string:
-    return json_write_get_string_size((struct json_string_s *)value->payload,
-                                      size);
-  case json_type_array:
-    return json_write_minified_get_array_size(
-        (struct json_array_s *)value->payload, size);
-  case json_type_object:
-    return json_write_minified_get_object_size(
-        (struct json_object_s *)value->payload, size);
-  case json_type_true:
-    *size += 4; /* the string "true". */
-    return 0;
-  case json_type_false:
-    *size += 5; /* the string "false". */
-    return 0;
-  case json_type_null:
-    *size += 4; /* the string "null". */
-    return 0;
-  }
+  json_writer_reset(writer);
 }
 
-json_weak char *json_write_minified_value(const struct json_value_s *value,
-                                          char *data);
-
-json_weak char *json_write_number(const struct json_number_s *number,
-                                  char *data);
-char *json_write_number(const struct json_number_s *number, char *data) {
-  json_uintmax_t parsed_number, backup;
-  size_t i;
+struct json_writer_s *json_writer_create(
+    const char *indent, const char *newline,
+    int (*write_func_ptr)(void *user_data, const void *data, size_t size),
+    void *user_data) {
+  struct json_writer_s *writer;
+  size_t size = sizeof(struct json_writer_s);
 
-  if (number->number_size >= 2) {
-    switch (number->number[1]) {
-    default:
-      break;
-    case 'x':
-    case 'X':
-      /* The number is a json_parse_flags_allow_hexadecimal_numbers hexadecimal
-       * so we have to do extra work to convert it to a non-hexadecimal for JSON
-       * output. */
-      parsed_number = json_strtoumax(number->number, json_null, 0);
+  if (json_null != write_func_ptr) {
+    /* the staging buffer lives just after the writer. */
+    size += JSON_WRITE_STAGING_SIZE;
+  }
 
-      /* We need a copy of parsed number twice, so take a backup of it. */
-      backup = parsed_number;
+  writer = (struct json_writer_s *)malloc(size);
 
-      i = 0;
+  if (json_null == writer) {
+    /* malloc failed! */
+    return json_null;
+  }
 
-      do {
-        parsed_number /= 10;
-        i++;
-      } while (0 != parsed_number);
+  json_writer_init(writer, indent, newline, write_func_ptr, user_data,
+                   (char *)(writer + 1));
 
-      /* Restore parsed_number to its original value stored in the backup. */
-      parsed_number = backup;
+  return writer;
+}
 
-      /* Now use backup to take a copy of i, or the length of the string. */
-      backup = i;
+void json_writer_reset(struct json_writer_s *writer) {
+  writer->buffer.size = 0;
+  writer->depth = 0;
+  writer->written = 0;
+  writer->error = 0;
+}
 
-      do {
-        *(data + i - 1) = '0' + (char)(parsed_number % 10);
-        parsed_number /= 10;
-        i--;
-      } while (0 != parsed_number);
+int json_writer_begin_object(struct json_writer_s *writer) {
+  return json_writer_begin(writer, '{', json_writer_level_object);
+}
 
-      data += backup;
+int json_writer_begin_array(struct json_writer_s *writer) {
+  return json_writer_begin(writer, '[', 0);
+}
 
-      return data;
-    }
+int json_writer_end(struct json_writer_s *writer) {
+  unsigned char level;
+
+  if (writer->error) {
+    return 1;
   }
 
-  /* check to see if the number has leading/trailing decimal point. */
-  i = 0;
+  if (0 == writer->depth) {
+    /* there was no object or array to end! */
+    writer->error = 1;
+    return 1;
+  }
 
-  /* skip any leading '-'. */
-  if ((i < number->number_size) &&
-      (('+' == number->number[i]) || ('-' == number->number[i]))) {
-    i++;
+  level = writer->levels[--writer->depth];
+
+  if (json_writer_level_has_name & level) {
+    /* a name had no value! */
+    writer->error = 1;
+    return 1;
   }
 
-  /* check if we have infinity. */
-  if ((i < number->number_size) && ('I' == number->number[i])) {
-    const char *inf = "Infinity";
-    size_t k;
+  if ((json_writer_level_has_elements & level) && writer->pretty &&
+      json_write_buffer_newline(&writer->buffer, writer->depth)) {
+    writer->error = 1;
+    return 1;
+  }
 
-    for (k = i; k < number->number_size; k++) {
-      const char c = *inf++;
+  if (json_write_buffer_bytes(&writer->buffer,
+                              (json_writer_level_object & level) ? "}" : "]",
+                              1)) {
+    writer->error = 1;
+    return 1;
+  }
 
-      /* Check if we found the Infinity string! */
-      if ('\0' == c) {
-        break;
-      } else if (c != number->number[k]) {
-        break;
-      }
-    }
+  return 0;
+}
 
-    if ('\0' == *inf++) {
-      const char *dbl_max;
+int json_writer_name(struct json_writer_s *writer, const char *name,
+                     size_t name_size) {
+  struct json_string_s string;
 
-      /* if we had a leading '-' we need to record it in the JSON output. */
-      if ('-' == number->number[0]) {
-        *data++ = '-';
-      }
+  if (json_writer_separate(writer, 1)) {
+    return 1;
+  }
 
-      /* Inf becomes 1.7976931348623158e308 because JSON can't support it. */
-      for (dbl_max = "1.7976931348623158e308"; '\0' != *dbl_max; dbl_max++) {
-        *data++ = *dbl_max;
-      }
+  string.string = name;
+  string.string_size = name_size;
 
-      return data;
-    }
+  /* " : "s seperate each name/value pair when pretty, and ':'s otherwise. */
+  if (json_write_buffer_string(&writer->buffer, &string) ||
+      json_write_buffer_bytes(&writer->buffer, writer->pretty ? " : " : ":",
+                              writer->pretty ? 3 : 1)) {
+    writer->error = 1;
+    return 1;
   }
 
-  /* check if we have nan. */
-  if ((i < number->number_size) && ('N' == number->number[i])) {
-    const char *nan = "NaN";
-    size_t k;
+  writer->levels[writer->depth - 1] |= json_writer_level_has_name;
 
-    for (k = i; k < number->number_size; k++) {
-      const char c = *nan++;
+  return 0;
+}
 
-      /* Check if we found the NaN string! */
-      if ('\0' == c) {
-        break;
-      } else if (c != number->number[k]) {
-        break;
-      }
-    }
+int json_writer_string(struct json_writer_s *writer, const char *string,
+                       size_t string_size) {
+  struct json_string_s value;
 
-    if ('\0' == *nan++) {
-      /* NaN becomes 0 because JSON can't support it. */
-      *data++ = '0';
-      return data;
-    }
+  if (json_writer_separate(writer, 0)) {
+    return 1;
   }
 
-  /* if we had a leading decimal point. */
-  if ((i < number->number_size) && ('.' == number->number[i])) {
-    i = 0;
+  value.string = string;
+  value.string_size = string_size;
 
-    /* skip any leading '+'. */
-    if ('+' == number->number[i]) {
-      i++;
-    }
+  if (json_write_buffer_string(&writer->buffer, &value)) {
+    writer->error = 1;
+    return 1;
+  }
 
-    /* output the leading '-' if we had one. */
-    if ('-' == number->number[i]) {
-      *data++ = '-';
-      i++;
-    }
+  return 0;
+}
 
-    /* insert a '0' to fix the leading decimal point for JSON output. */
-    *data++ = '0';
+int json_writer_integer(struct json_writer_s *writer, json_intmax_t value) {
+  char digits[32];
 
-    /* and output the rest of the number as normal. */
-    for (; i < number->number_size; i++) {
-      *data++ = number->number[i];
-    }
+  return json_writer_value(writer, digits, json_format_integer(value, digits));
+}
 
-    return data;
-  }
+int json_writer_double(struct json_writer_s *writer, double value) {
+  char digits[32];
+  const size_t size = json_format_double(value, digits);
 
-  for (; i < number->number_size; i++) {
-    const char c = number->number[i];
-    if (!('0' <= c && c <= '9')) {
-      break;
-    }
+  if (0 == size) {
+    /* JSON can't represent infinities or NaN! */
+    writer->error = 1;
+    return 1;
   }
 
-  /* if we had a trailing decimal point. */
-  if ((i + 1 == number->number_size) && ('.' == number->number[i])) {
-    i = 0;
+  return json_writer_value(writer, digits, size);
+}
 
-    /* skip any leading '+'. */
-    if ('+' == number->number[i]) {
-      i++;
-    }
+int json_writer_boolean(struct json_writer_s *writer, int value) {
+  return value ? json_writer_value(writer, "true", 4)
+               : json_writer_value(writer, "false", 5);
+}
 
-    /* output the leading '-' if we had one. */
-    if ('-' == number->number[i]) {
-      *data++ = '-';
-      i++;
-    }
+int json_writer_null(struct json_writer_s *writer) {
+  return json_writer_value(writer, "null", 4);
+}
 
-    /* and output the rest of the number as normal. */
-    for (; i < number->number_size; i++) {
-      *data++ = number->number[i];
-    }
+int json_writer_raw(struct json_writer_s *writer, const char *raw,
+                    size_t raw_size) {
+  return json_writer_value(writer, raw, raw_size);
+}
 
-    /* insert a '0' to fix the trailing decimal point for JSON output. */
-    *data++ = '0';
+int json_writer_finish(struct json_writer_s *writer) {
+  if (writer->error || (0 != writer->depth) || !writer->written) {
+    /* an error occurred, nothing was written, or an object or array wasn't
+     * ended! */
+    return 1;
+  }
 
-    return data;
+  if ((json_null != writer->buffer.write_func_ptr) &&
+      json_write_buffer_flush(&writer->buffer, 0)) {
+    /* handing on what was left in the staging buffer failed! */
+    writer->error = 1;
+    return 1;
   }
 
-  i = 0;
+  return 0;
+}
 
-  /* skip any leading '+'. */
-  if ('+' == number->number[i]) {
-    i++;
+const char *json_writer_get_output(struct json_writer_s *writer,
+                                   size_t *out_size) {
+  if ((json_null != writer->buffer.write_func_ptr) || writer->error ||
+      (0 != writer->depth) || !writer->written) {
+    return json_null;
   }
 
-  for (; i < number->number_size; i++) {
-    *data++ = number->number[i];
+  /* null terminate the output, without counting the terminator in it. */
+  if (json_null == json_write_buffer_reserve(&writer->buffer, 1)) {
+    writer->error = 1;
+    return json_null;
   }
 
-  return data;
-}
+  writer->buffer.data[--writer->buffer.size] = '\0';
 
-json_weak char *json_write_string(const struct json_string_s *string,
-                                  char *data);
-char *json_write_string(const struct json_string_s *string, char *data) {
-  size_t i;
+  if (json_null != out_size) {
+    *out_size = writer->buffer.size;
+  }
 
-  *data++ = '"'; /* open the string. */
+  return writer->buffer.data;
+}
 
-  for (i = 0; i < string->string_size; i++) {
-    switch (string->string[i]) {
-    case '"':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = '"';
-      break;
-    case '\\':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = '\\';
-      break;
-    case '\b':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = 'b';
-      break;
-    case '\f':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = 'f';
-      break;
-    case '\n':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = 'n';
-      break;
-    case '\r':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = 'r';
-      break;
-    case '\t':
-      *data++ = '\\'; /* escape the control character. */
-      *data++ = 't';
-      break;
-    default:
-      *data++ = string->string[i];
-      break;
-    }
+void json_writer_destroy(struct json_writer_s *writer) {
+  if (json_null == writer) {
+    return;
   }
 
-  *data++ = '"'; /* close the string. */
+  if (json_null == writer->buffer.write_func_ptr) {
+    free(writer->buffer.data);
+  }
 
-  return data;
+  free(writer);
 }
 
-json_weak char *json_write_minified_array(const struct json_array_s *array,
-                                          char *data);
-char *json_write_minified_array(const struct json_array_s *array, char *data) {
-  struct json_array_element_s *element = json_null;
-
-  *data++ = '['; /* open the array. */
+struct json_reformat_s {
+  struct json_writer_s writer;
+  /* non-zero while part way through a string. */
+  size_t in_string;
+  /* non-zero if a string's last byte was a '\\' that escapes the next. */
+  size_t escaped;
+  /* non-zero if the string is the name of an object's element. */
+  size_t in_name;
+  /* non-zero while part way through a number or literal. */
+  size_t in_bare;
+  /* non-zero if a name was written, and the ':' after it wasn't yet. */
+  size_t needs_colon;
+  /* non-zero if a value was just written, so a ',' or the end of an object
+   * or array (or nothing at the root) comes next. */
+  size_t has_value;
+};
 
-  for (element = array->start; json_null != element; element = element->next) {
-    if (element != array->start) {
-      *data++ = ','; /* ','s seperate each element. */
-    }
+json_weak int json_reformat_is_bare(char c);
+int json_reformat_is_bare(char c) {
+  switch (c) {
+  case ' ':
+  case '\t':
+  case '\n':
+  case '\r':
+  case '{':
+  case '}':
+  case '[':
+  case ']':
+  case ',':
+  case ':':
+  case '"':
+    return 0;
+  default:
+    return 1;
+  }
+}
 
-    data = json_write_minified_value(element->value, data);
+json_weak int json_reformat_string(struct json_reformat_s *reformat,
+                                   const char *src, size_t src_size,
+                                   size_t *offset);
+int json_reformat_string(struct json_reformat_s *reformat, const char *src,
+                         size_t src_size, size_t *offset) {
+  const size_t start = *offset;
+  size_t end = start;
+
+  for (;;) {
+    if (reformat->escaped) {
+      if (end == src_size) {
+        break;
+      }
 
-    if (json_null == data) {
-      /* value was malformed! */
-      return json_null;
+      /* skip the character the reverse solidus escapes. */
+      reformat->escaped = 0;
+      end++;
     }
-  }
 
-  *data++ = ']'; /* close the array. */
+    /* skip a word at a time while there are no quotes or escapes in it. */
+    while (end + sizeof(size_t) <= src_size) {
+      size_t word;
+      memcpy(&word, src + end, sizeof(size_t));
 
-  return data;
-}
-
-json_weak char *json_write_minified_object(const struct json_object_s *object,
-                                           char *data);
-char *json_write_minified_object(const struct json_object_s *object,
-                                 char *data) {
-  struct json_object_element_s *element = json_null;
+      if (json_swar_has_byte(word, '"') | json_swar_has_byte(word, '\\')) {
+        break;
+      }
 
-  *data++ = '{'; /* open the object. */
+      end += sizeof(size_t);
+    }
 
-  for (element = object->start; json_null != element; element = element->next) {
-    if (element != object->start) {
-      *data++ = ','; /* ','s seperate each element. */
+    while ((end < src_size) && ('"' != src[end]) && ('\\' != src[end])) {
+      end++;
     }
 
-    data = json_write_string(element->name, data);
+    if (end == src_size) {
+      /* the string goes on into the next chunk. */
+      break;
+    }
 
-    if (json_null == data) {
-      /* string was malformed! */
-      return json_null;
+    if ('\\' == src[end++]) {
+      reformat->escaped = 1;
+    } else {
+      /* we found the end of the string! */
+      reformat->in_string = 0;
+      break;
     }
+  }
 
-    *data++ = ':'; /* ':'s seperate each name/value pair. */
+  *offset = end;
 
-    data = json_write_minified_value(element->value, data);
+  if (json_write_buffer_bytes(&reformat->writer.buffer, src + start,
+                              end - start)) {
+    return 1;
+  }
 
-    if (json_null == data) {
-      /* value was malformed! */
-      return json_null;
+  if (!reformat->in_string) {
+    if (reformat->in_name) {
+      reformat->needs_colon = 1;
+    } else {
+      reformat->has_value = 1;
     }
   }
 
-  *data++ = '}'; /* close the object. */
-
-  return data;
+  return 0;
 }
 
-json_weak char *json_write_minified_value(const struct json_value_s *value,
-                                          char *data);
-char *json_write_minified_value(const struct json_value_s *value, char *data) {
-  switch (value->type) {
-  default:
-    /* unknown value type found! */
-    return json_null;
-  case json_type_number:
-    return json_write_number((struct json_number_s *)value->payload, data);
-  case json_type_string:
-    return json_write_string((struct json_string_s *)value->payload, data);
-  case json_type_array:
-    return json_write_minified_array((struct json_array_s *)value->payload,
-                                     data);
-  case json_type_object:
-    return json_write_minified_object((struct json_object_s *)value->payload,
-                                      data);
-  case json_type_true:
-    data[0] = 't';
-    data[1] = 'r';
-    data[2] = 'u';
-    data[3] = 'e';
-    return data + 4;
-  case json_type_false:
-    data[0] = 'f';
-    data[1] = 'a';
-    data[2] = 'l';
-    data[3] = 's';
-    data[4] = 'e';
-    return data + 5;
-  case json_type_null:
-    data[0] = 'n';
-    data[1] = 'u';
-    data[2] = 'l';
-    data[3] = 'l';
-    return data + 4;
+json_weak int json_reformat_token(struct json_reformat_s *reformat, char c);
+int json_reformat_token(struct json_reformat_s *reformat, char c) {
+  struct json_writer_s *const writer = &reformat->writer;
+  unsigned char level = 0;
+
+  if (0 < writer->depth) {
+    level = writer->levels[writer->depth - 1];
   }
-}
 
-void *json_write_minified(const struct json_value_s *value, size_t *out_size) {
-  size_t size = 0;
-  char *data = json_null;
-  char *data_end = json_null;
+  if (reformat->needs_colon) {
+    if (':' != c) {
+      /* a name has to be followed by a ':'! */
+      return 1;
+    }
 
-  if (json_null == value) {
-    return json_null;
+    reformat->needs_colon = 0;
+    writer->levels[writer->depth - 1] |= json_writer_level_has_name;
+
+    /* " : "s seperate each name/value pair. */
+    return json_write_buffer_bytes(&writer->buffer, " : ", 3);
   }
 
-  if (json_write_minified_get_value_size(value, &size)) {
-    /* value was malformed! */
-    return json_null;
+  switch (c) {
+  case ',':
+    if (!reformat->has_value || (0 == writer->depth)) {
+      /* a ',' has to follow a value in an object or array! */
+      return 1;
+    }
+
+    /* the writer adds the ',' when the next element is written. */
+    reformat->has_value = 0;
+    return 0;
+  case '}':
+  case ']':
+    if ((0 == writer->depth) ||
+        (('}' == c) != (0 != (json_writer_level_object & level))) ||
+        (!reformat->has_value &&
+         (json_writer_level_has_elements & level))) {
+      /* there was no object or array to end, it was the wrong kind, or there
+       * was a trailing ','! */
+      return 1;
+    }
+
+    reformat->has_value = 1;
+    return json_writer_end(writer);
+  case ':':
+    /* a ':' has to follow a name! */
+    return 1;
+  default:
+    break;
   }
 
-  size += 1; /* for the '\0' null terminating character. */
-
-  data = (char *)malloc(size);
+  if (reformat->has_value) {
+    /* values need a ',' between them! */
+    return 1;
+  }
 
-  if (json_null == data) {
-    /* malloc failed! */
-    return json_null;
+  switch (c) {
+  case '{':
+    return json_writer_begin_object(writer);
+  case '[':
+    return json_writer_begin_array(writer);
+  case '"':
+    reformat->in_string = 1;
+    reformat->in_name = (json_writer_level_object & level) &&
+                        !(json_writer_level_has_name & level);
+
+    return json_writer_separate(writer, reformat->in_name ? 1 : 0) ||
+           json_write_buffer_bytes(&writer->buffer, "\"", 1);
+  default:
+    reformat->in_bare = 1;
+    return json_writer_separate(writer, 0);
   }
+}
 
-  data_end = json_write_minified_value(value, data);
+struct json_reformat_s *json_reformat_create(
+    const char *indent, const char *newline,
+    int (*write_func_ptr)(void *user_data, const void *data, size_t size),
+    void *user_data) {
+  struct json_reformat_s *reformat;
 
-  if (json_null == data_end) {
-    /* bad chi occurred! */
-    free(data);
+  if (json_null == write_func_ptr) {
     return json_null;
   }
 
-  /* null terminated the string. */
-  *data_end = '\0';
+  /* the staging buffer lives just after the reformatter. */
+  reformat = (struct json_reformat_s *)malloc(sizeof(struct json_reformat_s) +
+                                              JSON_WRITE_STAGING_SIZE);
 
-  if (json_null != out_size) {
-    *out_size = size;
+  if (json_null == reformat) {
+    /* malloc failed! */
+    return json_null;
   }
 
-  return data;
-}
+  json_writer_init(&reformat->writer, indent, newline, write_func_ptr,
+                   user_data, (char *)(reformat + 1));
 
-json_weak int json_write_pretty_get_value_size(const struct json_value_s *value,
-                                               size_t depth, size_t indent_size,
-                                               size_t newline_size,
-                                               size_t *size);
+  /* the output is always pretty, even when both indent and newline default. */
+  reformat->writer.pretty = 1;
 
-json_weak int json_write_pretty_get_array_size(const struct json_array_s *array,
-                                               size_t depth, size_t indent_size,
-                                               size_t newline_size,
-                                               size_t *size);
-int json_write_pretty_get_array_size(const struct json_array_s *array,
-                                     size_t depth, size_t indent_size,
-                                     size_t newline_size, size_t *size) {
-  struct json_array_element_s *element;
+  reformat->in_string = 0;
+  reformat->escaped = 0;
+  reformat->in_name = 0;
+  reformat->in_bare = 0;
+  reformat->needs_colon = 0;
+  reformat->has_value = 0;
 
-  *size += 1; /* '['. */
+  return reformat;
+}
 
-  if (0 < array->length) {
-    /* if we have any elements we need to add a newline after our '['. */
-    *size += newline_size;
+int json_reformat_write(struct json_reformat_s *reformat, const void *src,
+                        size_t src_size) {
+  const char *const data = (const char *)src;
+  size_t offset = 0;
+  size_t start;
 
-    *size += array->length - 1; /* ','s seperate each element. */
+  if (reformat->writer.error) {
+    return 1;
+  }
 
-    for (element = array->start; json_null != element;
-         element = element->next) {
-      /* each element gets an indent. */
-      *size += (depth + 1) * indent_size;
+  while (offset < src_size) {
+    if (reformat->in_string) {
+      if (json_reformat_string(reformat, data, src_size, &offset)) {
+        reformat->writer.error = 1;
+        return 1;
+      }
+    } else if (reformat->in_bare) {
+      /* numbers and literals end at the first character that could not be a
+       * part of them. */
+      for (start = offset;
+           (offset < src_size) && json_reformat_is_bare(data[offset]);
+           offset++) {
+      }
 
-      if (json_write_pretty_get_value_size(element->value, depth + 1,
-                                           indent_size, newline_size, size)) {
-        /* value was malformed! */
+      if (json_write_buffer_bytes(&reformat->writer.buffer, data + start,
+                                  offset - start)) {
+        reformat->writer.error = 1;
         return 1;
       }
 
-      /* each element gets a newline too. */
-      *size += newline_size;
+      if (offset < src_size) {
+        reformat->in_bare = 0;
+        reformat->has_value = 1;
+      }
+    } else if ((' ' == data[offset]) || ('\t' == data[offset]) ||
+               ('\n' == data[offset]) || ('\r' == data[offset])) {
+      offset++;
+    } else if (json_reformat_token(reformat, data[offset])) {
+      reformat->writer.error = 1;
+      return 1;
+    } else if (!reformat->in_bare) {
+      /* the first character of a number or literal is copied with the rest of
+       * it. */
+      offset++;
     }
-
-    /* since we wrote out some elements, need to add a newline and indentation.
-     */
-    /* to the trailing ']'. */
-    *size += depth * indent_size;
   }
 
-  *size += 1; /* ']'. */
-
   return 0;
 }
 
-json_weak int
-json_write_pretty_get_object_size(const struct json_object_s *object,
-                                  size_t depth, size_t indent_size,
-                                  size_t newline_size, size_t *size);
-int json_write_pretty_get_object_size(const struct json_object_s *object,
-                                      size_t depth, size_t indent_size,
-                                      size_t newline_size, size_t *size) {
-  struct json_object_element_s *element;
+int json_reformat_finish(struct json_reformat_s *reformat) {
+  if (reformat->in_bare) {
+    /* a number or literal ends with the input. */
+    reformat->in_bare = 0;
+    reformat->has_value = 1;
+  }
 
-  *size += 1; /* '{'. */
+  if (reformat->in_string || reformat->needs_colon) {
+    /* a string wasn't terminated, or a name had no value! */
+    reformat->writer.error = 1;
+    return 1;
+  }
 
-  if (0 < object->length) {
-    *size += newline_size; /* need a newline next. */
+  return json_writer_finish(&reformat->writer);
+}
 
-    *size += object->length - 1; /* ','s seperate each element. */
+void json_reformat_destroy(struct json_reformat_s *reformat) {
+  free(reformat);
+}
 
-    for (element = object->start; json_null != element;
-         element = element->next) {
-      /* each element gets an indent and newline. */
-      *size += (depth + 1) * indent_size;
-      *size += newline_size;
+json_weak int json_transcode_string(struct json_write_buffer_s *buffer,
+                                    const char *src, size_t start,
+                                    size_t end);
+int json_transcode_string(struct json_write_buffer_s *buffer, const char *src,
+                          size_t start, size_t end) {
+  size_t offset;
+  size_t run = start + 1;
 
-      if (json_write_get_string_size(element->name, size)) {
-        /* string was malformed! */
-        return 1;
-      }
+  if (json_write_buffer_bytes(buffer, "\"", 1)) {
+    return 1;
+  }
 
-      *size += 3; /* seperate each name/value pair with " : ". */
+  /* the string was already validated, so only the characters strict JSON
+   * can't have as they are need changing. */
+  for (offset = run; offset + 1 < end; offset++) {
+    const char *escaped;
 
-      if (json_write_pretty_get_value_size(element->value, depth + 1,
-                                           indent_size, newline_size, size)) {
-        /* value was malformed! */
-        return 1;
-      }
+    switch (src[offset]) {
+    default:
+      continue;
+    case '\\':
+      /* escape sequences are copied as they are. */
+      offset++;
+      continue;
+    case '"':
+      /* a '"' in a single quoted string. */
+      escaped = "\\\"";
+      break;
+    case '\n':
+      /* a newline in a multi line string. */
+      escaped = "\\n";
+      break;
+    case '\r':
+      escaped = "\\r";
+      break;
     }
 
-    *size += depth * indent_size;
-  }
+    if (json_write_buffer_bytes(buffer, src + run, offset - run) ||
+        json_write_buffer_bytes(buffer, escaped, 2)) {
+      return 1;
+    }
 
-  *size += 1; /* '}'. */
+    run = offset + 1;
+  }
 
-  return 0;
+  return json_write_buffer_bytes(buffer, src + run, end - 1 - run) ||
+         json_write_buffer_bytes(buffer, "\"", 1);
 }
 
-json_weak int json_write_pretty_get_value_size(const struct json_value_s *value,
-                                               size_t depth, size_t indent_size,
-                                               size_t newline_size,
-                                               size_t *size);
-int json_write_pretty_get_value_size(const struct json_value_s *value,
-                                     size_t depth, size_t indent_size,
-                                     size_t newline_size, size_t *size) {
-  switch (value->type) {
-  default:
-    /* unknown value type found! */
-    return 1;
-  case json_type_number:
-    return json_write_get_number_size((struct json_number_s *)value->payload,
-                                      size);
-  case json_type_string:
-    return json_write_get_string_size((struct json_string_s *)value->payload,
-                                      size);
-  case json_type_array:
-    return json_write_pretty_get_array_size(
-        (struct json_array_s *)value->payload, depth, indent_size, newline_size,
-        size);
-  case json_type_object:
-    return json_write_pretty_get_object_size(
-        (struct json_object_s *)value->payload, depth, indent_size,
-        newline_size, size);
-  case json_type_true:
-    *size += 4; /* the string "true". */
-    return 0;
-  case json_type_false:
-    *size += 5; /* the string "false". */
-    return 0;
-  case json_type_null:
-    *size += 4; /* the string "null". */
-    return 0;
-  }
-}
+json_weak int json_transcode_value(struct json_parse_state_s *state,
+                                   struct json_writer_s *writer);
+int json_transcode_value(struct json_parse_state_s *state,
+                         struct json_writer_s *writer) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t start = state->offset;
+  const size_t size = state->size;
+  struct json_number_s number;
 
-json_weak char *json_write_pretty_value(const struct json_value_s *value,
-                                        size_t depth, const char *indent,
-                                        const char *newline, char *data);
+  switch (src[start]) {
+  case '{':
+  case '[':
+    if (JSON_MAX_RECURSION == writer->depth) {
+      /* recursion error */
+      state->error = json_parse_error_recursion;
+      return 1;
+    }
 
-json_weak char *json_write_pretty_array(const struct json_array_s *array,
-                                        size_t depth, const char *indent,
-                                        const char *newline, char *data);
-char *json_write_pretty_array(const struct json_array_s *array, size_t depth,
-                              const char *indent, const char *newline,
-                              char *data) {
-  size_t k, m;
-  struct json_array_element_s *element;
+    state->offset++;
 
-  *data++ = '['; /* open the array. */
+    return ('{' == src[start]) ? json_writer_begin_object(writer)
+                               : json_writer_begin_array(writer);
+  case '\'':
+    if (!(json_parse_flags_allow_single_quoted_strings & flags_bitset)) {
+      /* invalid value! */
+      state->error = json_parse_error_invalid_value;
+      return 1;
+    }
 
-  if (0 < array->length) {
-    for (k = 0; '\0' != newline[k]; k++) {
-      *data++ = newline[k];
+    /* fallthrough */
+  case '"':
+    if (json_get_string_size(state, 0)) {
+      /* string was malformed! */
+      return 1;
     }
 
-    for (element = array->start; json_null != element;
-         element = element->next) {
-      if (element != array->start) {
-        *data++ = ','; /* ','s seperate each element. */
+    return json_writer_separate(writer, 0) ||
+           json_transcode_string(&writer->buffer, src, start, state->offset);
+  case '+':
+  case '.':
+    if ((('+' == src[start]) &&
+         !(json_parse_flags_allow_leading_plus_sign & flags_bitset)) ||
+        (('.' == src[start]) &&
+         !(json_parse_flags_allow_leading_or_trailing_decimal_point &
+           flags_bitset))) {
+      /* invalid value! */
+      state->error = json_parse_error_invalid_number_format;
+      return 1;
+    }
 
-        for (k = 0; '\0' != newline[k]; k++) {
-          *data++ = newline[k];
-        }
-      }
+    /* fallthrough */
+  case 'I':
+  case 'N':
+    if ((('I' == src[start]) || ('N' == src[start])) &&
+        !(json_parse_flags_allow_inf_and_nan & flags_bitset)) {
+      /* invalid value! */
+      state->error = json_parse_error_invalid_value;
+      return 1;
+    }
 
-      for (k = 0; k < depth + 1; k++) {
-        for (m = 0; '\0' != indent[m]; m++) {
-          *data++ = indent[m];
-        }
-      }
+    /* fallthrough */
+  case '-':
+  case '0':
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9':
+    if (json_get_number_size(state)) {
+      /* number was malformed! */
+      return 1;
+    }
 
-      data = json_write_pretty_value(element->value, depth + 1, indent, newline,
-                                     data);
+    number.number = src + start;
+    number.number_size = state->offset - start;
 
-      if (json_null == data) {
-        /* value was malformed! */
-        return json_null;
-      }
+    return json_writer_separate(writer, 0) ||
+           json_write_buffer_number(&writer->buffer, &number);
+  case 't':
+    if ((start + 4 <= size) && (0 == memcmp(src + start, "true", 4))) {
+      state->offset += 4;
+      return json_writer_value(writer, "true", 4);
     }
 
-    for (k = 0; '\0' != newline[k]; k++) {
-      *data++ = newline[k];
+    break;
+  case 'f':
+    if ((start + 5 <= size) && (0 == memcmp(src + start, "false", 5))) {
+      state->offset += 5;
+      return json_writer_value(writer, "false", 5);
     }
 
-    for (k = 0; k < depth; k++) {
-      for (m = 0; '\0' != indent[m]; m++) {
-        *data++ = indent[m];
-      }
+    break;
+  case 'n':
+    if ((start + 4 <= size) && (0 == memcmp(src + start, "null", 4))) {
+      state->offset += 4;
+      return json_writer_value(writer, "null", 4);
     }
-  }
 
-  *data++ = ']'; /* close the array. */
+    break;
+  default:
+    break;
+  }
 
-  return data;
+  /* invalid value! */
+  state->error = json_parse_error_invalid_value;
+  return 1;
 }
 
-json_weak char *json_write_pretty_object(const struct json_object_s *object,
-                                         size_t depth, const char *indent,
-                                         const char *newline, char *data);
-char *json_write_pretty_object(const struct json_object_s *object, size_t depth,
-                               const char *indent, const char *newline,
-                               char *data) {
-  size_t k, m;
-  struct json_object_element_s *element;
-
-  *data++ = '{'; /* open the object. */
+json_weak int json_transcode_name(struct json_parse_state_s *state,
+                                  struct json_writer_s *writer);
+int json_transcode_name(struct json_parse_state_s *state,
+                        struct json_writer_s *writer) {
+  const size_t flags_bitset = state->flags_bitset;
+  const char *const src = state->src;
+  const size_t start = state->offset;
+  const int quoted =
+      ('"' == src[start]) ||
+      (('\'' == src[start]) &&
+       (json_parse_flags_allow_single_quoted_strings & flags_bitset));
+
+  if (json_get_key_size(state)) {
+    /* key parsing failed! */
+    state->error = json_parse_error_invalid_string;
+    return 1;
+  }
 
-  if (0 < object->length) {
-    for (k = 0; '\0' != newline[k]; k++) {
-      *data++ = newline[k];
+  if (!quoted) {
+    /* unquoted keys only have characters that don't need escaping. */
+    if (json_writer_name(writer, src + start, state->offset - start)) {
+      return 1;
     }
+  } else if (json_writer_separate(writer, 1) ||
+             json_transcode_string(&writer->buffer, src, start,
+                                   state->offset) ||
+             json_write_buffer_bytes(&writer->buffer, ":", 1)) {
+    return 1;
+  } else {
+    writer->levels[writer->depth - 1] |= json_writer_level_has_name;
+  }
 
-    for (element = object->start; json_null != element;
-         element = element->next) {
-      if (element != object->start) {
-        *data++ = ','; /* ','s seperate each element. */
+  if (json_skip_all_skippables(state)) {
+    state->error = json_parse_error_premature_end_of_buffer;
+    return 1;
+  }
 
-        for (k = 0; '\0' != newline[k]; k++) {
-          *data++ = newline[k];
-        }
-      }
+  if ((':' != src[state->offset]) &&
+      (!(json_parse_flags_allow_equals_in_object & flags_bitset) ||
+       ('=' != src[state->offset]))) {
+    state->error = json_parse_error_expected_colon;
+    return 1;
+  }
 
-      for (k = 0; k < depth + 1; k++) {
-        for (m = 0; '\0' != indent[m]; m++) {
-          *data++ = indent[m];
-        }
-      }
+  /* skip colon. */
+  state->offset++;
 
-      data = json_write_string(element->name, data);
+  return 0;
+}
 
-      if (json_null == data) {
-        /* string was malformed! */
-        return json_null;
-      }
+int json_transcode_to(const void *src, size_t src_size, size_t flags_bitset,
+                      int (*write_func_ptr)(void *user_data, const void *data,
+                                            size_t size),
+                      void *user_data, struct json_parse_result_s *result) {
+  struct json_parse_state_s state;
+  struct json_writer_s *writer;
+  /* non-zero if the root is an unbracketed object. */
+  int is_global_object = 0;
+  /* non-zero if a value was just written, so a ',' (or the end of the object
+   * or array) comes next. */
+  int has_value = 0;
+  /* non-zero if a ',' was just skipped. */
+  int has_comma = 0;
+  int error = 0;
 
-      /* " : "s seperate each name/value pair. */
-      *data++ = ' ';
-      *data++ = ':';
-      *data++ = ' ';
+  if (result) {
+    result->error = json_parse_error_none;
+    result->error_offset = 0;
+    result->error_line_no = 0;
+    result->error_row_no = 0;
+  }
 
-      data = json_write_pretty_value(element->value, depth + 1, indent, newline,
-                                     data);
+  if ((json_null == src) || (json_null == write_func_ptr)) {
+    return 1;
+  }
 
-      if (json_null == data) {
-        /* value was malformed! */
-        return json_null;
-      }
-    }
+  writer = json_writer_create(json_null, json_null, write_func_ptr, user_data);
 
-    for (k = 0; '\0' != newline[k]; k++) {
-      *data++ = newline[k];
-    }
+  if (json_null == writer) {
+    /* malloc failed! */
+    return 1;
+  }
 
-    for (k = 0; k < depth; k++) {
-      for (m = 0; '\0' != indent[m]; m++) {
-        *data++ = indent[m];
-      }
-    }
+  state.src = (const char *)src;
+  state.size = src_size;
+  state.offset = 0;
+  state.line_no = 1;
+  state.line_offset = 0;
+  state.error = json_parse_error_none;
+  state.dom_size = 0;
+  state.data_size = 0;
+  state.flags_bitset = flags_bitset;
+  state.recursion = 0;
+  state.tape = json_null;
+  state.tape_capacity = 0;
+  state.tape_size = 0;
+  state.tape_offset = 0;
+
+  if ((json_parse_flags_allow_global_object & flags_bitset) &&
+      (json_skip_all_skippables(&state) || ('{' != state.src[state.offset]))) {
+    is_global_object = 1;
+    error = json_writer_begin_object(writer);
   }
 
-  *data++ = '}'; /* close the object. */
+  while (!error) {
+    unsigned char level = 0;
+    char c;
 
-  return data;
-}
+    if (json_skip_all_skippables(&state)) {
+      /* we reached the end of the input, which ends a global object. */
+      if (is_global_object && (1 == writer->depth) &&
+          (!has_comma ||
+           (json_parse_flags_allow_trailing_comma & flags_bitset))) {
+        error = json_writer_end(writer);
+      }
 
-json_weak char *json_write_pretty_value(const struct json_value_s *value,
-                                        size_t depth, const char *indent,
-                                        const char *newline, char *data);
-char *json_write_pretty_value(const struct json_value_s *value, size_t depth,
-                              const char *indent, const char *newline,
-                              char *data) {
-  switch (value->type) {
-  default:
-    /* unknown value type found! */
-    return json_null;
-  case json_type_number:
-    return json_write_number((struct json_number_s *)value->payload, data);
-  case json_type_string:
-    return json_write_string((struct json_string_s *)value->payload, data);
-  case json_type_array:
-    return json_write_pretty_array((struct json_array_s *)value->payload, depth,
-                                   indent, newline, data);
-  case json_type_object:
-    return json_write_pretty_object((struct json_object_s *)value->payload,
-                                    depth, indent, newline, data);
-  case json_type_true:
-    data[0] = 't';
-    data[1] = 'r';
-    data[2] = 'u';
-    data[3] = 'e';
-    return data + 4;
-  case json_type_false:
-    data[0] = 'f';
-    data[1] = 'a';
-    data[2] = 'l';
-    data[3] = 's';
-    data[4] = 'e';
-    return data + 5;
-  case json_type_null:
-    data[0] = 'n';
-    data[1] = 'u';
-    data[2] = 'l';
-    data[3] = 'l';
-    return data + 4;
-  }
-}
+      if (!error && ((0 != writer->depth) || !writer->written)) {
+        state.error = json_parse_error_premature_end_of_buffer;
+        error = 1;
+      }
 
-void *json_write_pretty(const struct json_value_s *value, const char *indent,
-                        const char *newline, size_t *out_size) {
-  size_t size = 0;
-  size_t indent_size = 0;
-  size_t newline_size = 0;
-  char *data = json_null;
-  char *data_end = json_null;
+      break;
+    }
 
-  if (json_null == value) {
-    return json_null;
-  }
+    if (0 < writer->depth) {
+      level = writer->levels[writer->depth - 1];
+    }
 
-  if (json_null == indent) {
-    indent = "  "; /* default to two spaces. */
-  }
+    c = state.src[state.offset];
+
+    if ((('}' == c) && (json_writer_level_object & level) &&
+         !(is_global_object && (1 == writer->depth))) ||
+        ((']' == c) && (0 < writer->depth) &&
+         !(json_writer_level_object & level))) {
+      if (!has_value && (json_writer_level_has_elements & level) &&
+          !(has_comma &&
+            (json_parse_flags_allow_trailing_comma & flags_bitset))) {
+        /* there was a ',' with nothing after it (where the name of the next
+         * element of an object should be), or a name without a value! */
+        state.error = (has_comma && (json_writer_level_object & level))
+                          ? json_parse_error_invalid_string
+                          : json_parse_error_invalid_value;
+        error = 1;
+        break;
+      }
 
-  if (json_null == newline) {
-    newline = "\n"; /* default to linux newlines. */
-  }
+      state.offset++;
+      has_value = 1;
+      has_comma = 0;
+      error = json_writer_end(writer);
+      continue;
+    }
 
-  while ('\0' != indent[indent_size]) {
-    ++indent_size; /* skip non-null terminating characters. */
-  }
+    if (has_value) {
+      if (0 == writer->depth) {
+        /* there are characters remaining in the input that weren't part of the
+         * JSON! */
+        state.error = json_parse_error_unexpected_trailing_characters;
+        error = 1;
+        break;
+      }
 
-  while ('\0' != newline[newline_size]) {
-    ++newline_size; /* skip non-null terminating characters. */
-  }
+      if (',' == c) {
+        /* the writer adds the ',' when the next element is written. */
+        state.offset++;
+        has_value = 0;
+        has_comma = 1;
+        continue;
+      }
 
-  if (json_write_pretty_get_value_size(value, 0, indent_size, newline_size,
-                                       &size)) {
-    /* value was malformed! */
-    return json_null;
-  }
+      if (!(json_parse_flags_allow_no_commas & flags_bitset)) {
+        state.error = json_parse_error_expected_comma_or_closing_bracket;
+        error = 1;
+        break;
+      }
+    }
 
-  size += 1; /* for the '\0' null terminating character. */
+    has_value = 0;
+    has_comma = 0;
 
-  data = (char *)malloc(size);
+    if ((json_writer_level_object & level) &&
+        !(json_writer_level_has_name & level)) {
+      error = json_transcode_name(&state, writer);
+    } else {
+      error = json_transcode_value(&state, writer);
 
-  if (json_null == data) {
-    /* malloc failed! */
-    return json_null;
+      /* objects and arrays are values once they are ended. */
+      has_value = ('{' != c) && ('[' != c);
+    }
   }
 
-  data_end = json_write_pretty_value(value, 0, indent, newline, data);
-
-  if (json_null == data_end) {
-    /* bad chi occurred! */
-    free(data);
-    return json_null;
+  if (!error) {
+    error = json_writer_finish(writer);
+  } else if (result && (json_parse_error_none != state.error)) {
+    result->error = state.error;
+    result->error_offset = state.offset;
+    result->error_line_no = state.line_no;
+    result->error_row_no = state.offset - state.line_offset;
   }
 
-  /* null terminated the string. */
-  *data_end = '\0';
-
-  if (json_null != out_size) {
-    *out_size = size;
-  }
+  json_writer_destroy(writer);
 
-  return data;
+  return error;
 }
 
 #if defined(__clang__)
@@ -109,3 +109,101 @@ UTEST(allocator, user_data) {
   ASSERT_FALSE(object->start);
   ASSERT_EQ(0, object->length);
 }
+
+UTEST(allocator, write_user_data) {
+  struct _ {
+    static void *alloc(void *user_data, size_t size) {
+      *static_cast<size_t *>(user_data) = size;
+      return malloc(size);
+    }
+  };
+
+  const char payload[] = "{\"a\" : [true, null]}";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  size_t allocated = 0;
+  size_t size = 0;
+
+  ASSERT_TRUE(value);
+
+  void *minified =
+      json_write_minified_ex(value, &_::alloc, &allocated, &size);
+  ASSERT_TRUE(minified);
+  ASSERT_EQ(size, allocated);
+  ASSERT_STREQ("{\"a\":[true,null]}", static_cast<char *>(minified));
+  free(minified);
+
+  void *pretty =
+      json_write_pretty_ex(value, "", " ", &_::alloc, &allocated, &size);
+  ASSERT_TRUE(pretty);
+  ASSERT_EQ(size, allocated);
+  ASSERT_STREQ("{ \"a\" : [ true, null ] }", static_cast<char *>(pretty));
+  free(pretty);
+
+  free(value);
+}
+
+UTEST(allocator, write_null) {
+  struct _ {
+    static void *alloc(void *, size_t) { return 0; }
+  };
+
+  struct json_value_s value = {0, json_type_null};
+
+  ASSERT_FALSE(json_write_minified_ex(&value, &_::alloc, 0, 0));
+  ASSERT_FALSE(json_write_pretty_ex(&value, 0, 0, &_::alloc, 0, 0));
+}
+
+struct allocator_arena {
+  void *allocations[32];
+  size_t size;
+};
+
+UTEST(allocator, write_deep) {
+  struct _ {
+    static void *alloc(void *user_data, size_t size) {
+      struct allocator_arena *const arena =
+          static_cast<struct allocator_arena *>(user_data);
+
+      if (32 == arena->size) {
+        return 0;
+      }
+
+      return arena->allocations[arena->size++] = malloc(size);
+    }
+  };
+
+  // deep enough that the writers' stack doesn't fit on the C stack.
+  const size_t depth = 4 * JSON_WRITE_STACK_SIZE;
+  char *const payload = static_cast<char *>(malloc(2 * depth));
+  struct allocator_arena arena;
+  size_t i;
+
+  memset(payload, '[', depth);
+  memset(payload + depth, ']', depth);
+  struct json_value_s *value = json_parse(payload, 2 * depth);
+  ASSERT_TRUE(value);
+
+  // the stack grows through the allocator too, rather than with malloc.
+  arena.size = 0;
+  void *minified = json_write_minified_ex(value, &_::alloc, &arena, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_EQ(0, memcmp(minified, payload, 2 * depth));
+  ASSERT_LT(1, arena.size);
+
+  for (i = 0; i < arena.size; i++) {
+    free(arena.allocations[i]);
+  }
+
+  arena.size = 0;
+  void *pretty = json_write_pretty_ex(value, "", "", &_::alloc, &arena, 0);
+  ASSERT_TRUE(pretty);
+  ASSERT_EQ(0, memcmp(pretty, payload, 2 * depth));
+  ASSERT_LT(1, arena.size);
+
+  for (i = 0; i < arena.size; i++) {
+    free(arena.allocations[i]);
+  }
+
+  free(payload);
+  free(value);
+}
@@ -0,0 +1,257 @@
+/*
+   This is free and unencumbered software released into the public domain.
+
+   Anyone is free to copy, modify, publish, use, compile, sell, or
+   distribute this software, either in source code form or as a compiled
+   binary, for any purpose, commercial or non-commercial, and by any
+   means.
+
+   In jurisdictions that recognize copyright laws, the author or authors
+   of this software dedicate any and all copyright interest in the
+   software to the public domain. We make this dedication for the benefit
+   of the public at large and to the detriment of our heirs and
+   successors. We intend this dedication to be an overt act of
+   relinquishment in perpetuity of all present and future rights to this
+   software under copyright law.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+   EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+   MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+   IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+   OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+   ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+   OTHER DEALINGS IN THE SOFTWARE.
+
+   For more information, please refer to <http://unlicense.org/>
+*/
+
+/* Benchmarks for the writers. These are not run with the tests, as timings
+ * depend on the machine - build the json_benchmark target in release and run
+ * it, optionally with the names of the benchmarks to run. To compare against
+ * another version of json.h, build this file with that version's directory
+ * first on the include path. */
+
+#include "json.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCHMARK_RUNS 5
+
+static int benchmark_sink(void *user_data, const void *data, size_t size) {
+  /* touch the data so that writing it can't be skipped. */
+  *(size_t *)user_data += size + ((const unsigned char *)data)[0];
+  return 0;
+}
+
+/* a deterministic document of about 16MB, with a mix of the kinds of values
+ * the writers handle. */
+static char *benchmark_payload(size_t *payload_size) {
+  const size_t capacity = 16 * 1024 * 1024;
+  char *const payload = (char *)malloc(capacity);
+  size_t size = 0;
+  unsigned long i;
+
+  if (!payload) {
+    return 0;
+  }
+
+  payload[size++] = '[';
+
+  for (i = 0; size + 512 < capacity; i++) {
+    size += (size_t)sprintf(
+        payload + size,
+        "%s{\"id\" : %lu, \"name\" : \"user %lu\", \"email\" : "
+        "\"user.%lu@example.com\", \"score\" : %lu.%02lu, \"active\" : %s, "
+        "\"manager\" : null, \"tags\" : [\"a\", \"b\\n\", %lu, true], "
+        "\"address\" : {\"street\" : \"%lu Main St\", \"city\" : "
+        "\"Springfield\", \"zip\" : [%lu, %lu]}}",
+        (0 == i) ? "" : ", ", i, i, i, i % 1000, i % 100,
+        (0 == i % 3) ? "true" : "false", i * 7, i, i % 90000 + 10000, i % 10);
+  }
+
+  payload[size++] = ']';
+  *payload_size = size;
+
+  return payload;
+}
+
+static size_t benchmark_write_minified(const struct json_value_s *value) {
+  size_t size = 0;
+  free(json_write_minified(value, &size));
+  return size;
+}
+
+/* the single pass alternative to json_write_minified's size then write. */
+static size_t
+benchmark_write_minified_growable(const struct json_value_s *value) {
+  size_t size = 0;
+  free(json_write_minified_growable(value, 0, 0, &size));
+  return size;
+}
+
+static size_t benchmark_write_pretty(const struct json_value_s *value) {
+  size_t size = 0;
+  free(json_write_pretty(value, "  ", "\n", &size));
+  return size;
+}
+
+static size_t benchmark_write_minified_to(const struct json_value_s *value) {
+  size_t size = 0;
+  (void)json_write_minified_to(value, benchmark_sink, &size);
+  return size;
+}
+
+static size_t benchmark_write_pretty_to(const struct json_value_s *value) {
+  size_t size = 0;
+  (void)json_write_pretty_to(value, "  ", "\n", benchmark_sink, &size);
+  return size;
+}
+
+/* the records of the payload written one at a time, as a server answering
+ * requests would, into a reused buffer. */
+static size_t
+benchmark_write_minified_records(const struct json_value_s *value) {
+  const struct json_array_element_s *element;
+  char buffer[512];
+  size_t size = 0;
+
+  for (element = ((const struct json_array_s *)value->payload)->start;
+       element; element = element->next) {
+    size_t needed = 0;
+    (void)json_write_minified_into(element->value, buffer, sizeof(buffer),
+                                   &needed);
+    size += needed - 1;
+  }
+
+  return size;
+}
+
+/* the same records, but with only the values that differ between them filled
+ * into a template of the record. */
+static size_t benchmark_write_template(const struct json_value_s *value) {
+  const char skeleton[] =
+      "{\"id\" : ?, \"name\" : ?, \"email\" : ?, \"score\" : ?, "
+      "\"active\" : ?, \"manager\" : null, \"tags\" : [\"a\", \"b\\n\", ?, "
+      "true], \"address\" : {\"street\" : ?, \"city\" : \"Springfield\", "
+      "\"zip\" : ?}}";
+  struct json_template_s *const tmpl =
+      json_template_compile(skeleton, strlen(skeleton), 0, 0);
+  const struct json_array_element_s *element;
+  const struct json_value_s *values[8];
+  char buffer[512];
+  size_t size = 0;
+
+  if (!tmpl) {
+    return 0;
+  }
+
+  for (element = ((const struct json_array_s *)value->payload)->start;
+       element; element = element->next) {
+    const struct json_object_element_s *field =
+        json_value_as_object(element->value)->start;
+    struct json_object_element_s *address;
+    size_t needed = 0;
+    size_t i;
+
+    for (i = 0; i < 5; i++, field = field->next) {
+      values[i] = field->value;
+    }
+
+    field = field->next; /* manager. */
+    values[5] = json_value_as_array(field->value)->start->next->next->value;
+
+    address = json_value_as_object(field->next->value)->start;
+    values[6] = address->value;
+    values[7] = address->next->next->value;
+
+    (void)json_template_write_into(tmpl, values, buffer, sizeof(buffer),
+                                   &needed);
+    size += needed - 1;
+  }
+
+  free(tmpl);
+
+  return size;
+}
+
+struct benchmark_s {
+  const char *name;
+  size_t (*run)(const struct json_value_s *value);
+};
+
+static const struct benchmark_s benchmarks[] = {
+    {"write_minified", benchmark_write_minified},
+    {"write_minified_growable", benchmark_write_minified_growable},
+    {"write_pretty", benchmark_write_pretty},
+    {"write_minified_to", benchmark_write_minified_to},
+    {"write_pretty_to", benchmark_write_pretty_to},
+    {"write_minified_records", benchmark_write_minified_records},
+    {"write_template", benchmark_write_template}};
+
+static int benchmark_selected(int argc, char **argv, const char *name) {
+  int i;
+
+  if (argc < 2) {
+    return 1;
+  }
+
+  for (i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], name)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  size_t payload_size = 0;
+  char *const payload = benchmark_payload(&payload_size);
+  struct json_value_s *value;
+  size_t i;
+  int run;
+
+  if (!payload) {
+    return 1;
+  }
+
+  value = json_parse(payload, payload_size);
+
+  if (!value) {
+    free(payload);
+    return 1;
+  }
+
+  for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+    double best = 0;
+    size_t size = 0;
+
+    if (!benchmark_selected(argc, argv, benchmarks[i].name)) {
+      continue;
+    }
+
+    /* report the fastest of a few runs, which is the least disturbed. */
+    for (run = 0; run < BENCHMARK_RUNS; run++) {
+      const clock_t start = clock();
+      double seconds;
+
+      size = benchmarks[i].run(value);
+      seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+      if ((0 == run) || (seconds < best)) {
+        best = seconds;
+      }
+    }
+
+    printf("%-24s %8.2f ms %8.1f MB/s\n", benchmarks[i].name, best * 1000.0,
+           (best > 0) ? (double)size / (1024.0 * 1024.0) / best : 0.0);
+  }
+
+  free(value);
+  free(payload);
+
+  return 0;
+}
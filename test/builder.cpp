@@ -0,0 +1,267 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+UTEST(builder, object) {
+  struct json_builder_s *const builder = json_builder_create(0, 0);
+  ASSERT_TRUE(builder);
+
+  ASSERT_EQ(0, json_builder_begin_object(builder));
+  ASSERT_EQ(0, json_builder_name(builder, "id", 2));
+  ASSERT_EQ(0, json_builder_integer(builder, 42));
+  ASSERT_EQ(0, json_builder_name(builder, "name", 4));
+  ASSERT_EQ(0, json_builder_string(builder, "a \"quoted\"\nline", 15));
+  ASSERT_EQ(0, json_builder_name(builder, "tags", 4));
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_EQ(0, json_builder_boolean(builder, 1));
+  ASSERT_EQ(0, json_builder_boolean(builder, 0));
+  ASSERT_EQ(0, json_builder_null(builder));
+  ASSERT_EQ(0, json_builder_double(builder, 0.5));
+  ASSERT_EQ(0, json_builder_begin_object(builder));
+  ASSERT_EQ(0, json_builder_end(builder));
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_EQ(0, json_builder_end(builder));
+  ASSERT_EQ(0, json_builder_end(builder));
+  ASSERT_EQ(0, json_builder_end(builder));
+
+  struct json_value_s *const value = json_builder_finish(builder);
+  ASSERT_TRUE(value);
+
+  struct json_object_s *const object = json_value_as_object(value);
+  ASSERT_TRUE(object);
+  ASSERT_EQ(3, object->length);
+  ASSERT_STREQ("id", object->start->name->string);
+  ASSERT_EQ(2, object->start->name->string_size);
+
+  size_t size = 0;
+  void *const minified = json_write_minified(value, &size);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"id\":42,\"name\":\"a \\\"quoted\\\"\\nline\","
+               "\"tags\":[true,false,null,0.5,{},[]]}",
+               static_cast<char *>(minified));
+  free(minified);
+
+  // the built DOM can be extracted to outlive the builder.
+  struct json_value_s *const extracted = json_extract_value(value);
+  json_builder_destroy(builder);
+  ASSERT_TRUE(extracted);
+
+  void *const pretty = json_write_pretty(extracted, "", "", 0);
+  ASSERT_TRUE(pretty);
+  ASSERT_STREQ("{\"id\" : 42,\"name\" : \"a \\\"quoted\\\"\\nline\","
+               "\"tags\" : [true,false,null,0.5,{},[]]}",
+               static_cast<char *>(pretty));
+  free(pretty);
+  free(extracted);
+}
+
+UTEST(builder, numbers) {
+  struct json_builder_s *const builder = json_builder_create(0, 0);
+  ASSERT_TRUE(builder);
+
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_EQ(0, json_builder_integer(builder, 0));
+  ASSERT_EQ(0, json_builder_integer(builder, -7));
+  ASSERT_EQ(0, json_builder_integer(builder, INTMAX_MAX));
+  ASSERT_EQ(0, json_builder_integer(builder, INTMAX_MIN));
+  ASSERT_EQ(0, json_builder_double(builder, -1.25e300));
+  ASSERT_NE(0, json_builder_double(builder, HUGE_VAL));
+  ASSERT_FALSE(json_builder_finish(builder));
+
+  json_builder_destroy(builder);
+}
+
+UTEST(builder, many_values) {
+  // enough values to fill many chunks of the arena.
+  struct json_builder_s *const builder = json_builder_create(0, 0);
+  const size_t length = 10000;
+  size_t i;
+
+  ASSERT_TRUE(builder);
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+
+  for (i = 0; i < length; i++) {
+    ASSERT_EQ(0, json_builder_begin_array(builder));
+    ASSERT_EQ(0, json_builder_integer(builder, static_cast<json_intmax_t>(i)));
+    ASSERT_EQ(0, json_builder_end(builder));
+  }
+
+  // a string bigger than a chunk.
+  char *const big = static_cast<char *>(malloc(JSON_BUILDER_CHUNK_SIZE * 2));
+  memset(big, 'x', JSON_BUILDER_CHUNK_SIZE * 2);
+  ASSERT_EQ(0, json_builder_string(builder, big, JSON_BUILDER_CHUNK_SIZE * 2));
+  free(big);
+
+  ASSERT_EQ(0, json_builder_end(builder));
+
+  struct json_value_s *const value = json_builder_finish(builder);
+  ASSERT_TRUE(value);
+
+  struct json_array_s *const array = json_value_as_array(value);
+  ASSERT_TRUE(array);
+  ASSERT_EQ(length + 1, array->length);
+
+  struct json_array_element_s *element = array->start;
+
+  for (i = 0; i < length; i++, element = element->next) {
+    struct json_array_s *const inner = json_value_as_array(element->value);
+    ASSERT_TRUE(inner);
+    ASSERT_EQ(1, inner->length);
+    ASSERT_EQ(static_cast<size_t>(i),
+              strtoul(json_value_as_number(inner->start->value)->number, 0,
+                      10));
+  }
+
+  ASSERT_EQ(JSON_BUILDER_CHUNK_SIZE * 2,
+            json_value_as_string(element->value)->string_size);
+
+  json_builder_destroy(builder);
+}
+
+struct builder_arena_s {
+  char data[8192];
+  size_t used;
+};
+
+static void *builder_alloc(void *user_data, size_t size) {
+  struct builder_arena_s *const arena =
+      static_cast<struct builder_arena_s *>(user_data);
+  void *const result = arena->data + arena->used;
+
+  if (size > sizeof(arena->data) - arena->used) {
+    return 0;
+  }
+
+  arena->used += (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+  return result;
+}
+
+UTEST(builder, arena) {
+  struct builder_arena_s arena;
+  arena.used = 0;
+
+  struct json_builder_s *const builder = json_builder_create(builder_alloc,
+                                                             &arena);
+  ASSERT_TRUE(builder);
+  ASSERT_EQ(static_cast<size_t>(JSON_BUILDER_CHUNK_SIZE), arena.used);
+
+  ASSERT_EQ(0, json_builder_string(builder, "hello", 5));
+
+  struct json_value_s *const value = json_builder_finish(builder);
+  ASSERT_TRUE(value);
+  ASSERT_STREQ("hello", json_value_as_string(value)->string);
+
+  // a user arena is left alone.
+  json_builder_destroy(builder);
+  ASSERT_STREQ("hello", json_value_as_string(value)->string);
+}
+
+UTEST(builder, raw) {
+  struct json_builder_s *builder = json_builder_create(0, 0);
+  ASSERT_TRUE(builder);
+
+  const char fragment[] = "{\"cached\" : [1, 2]}";
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_EQ(0, json_builder_raw(builder, fragment, strlen(fragment)));
+  ASSERT_EQ(0, json_builder_raw(builder, " 3 ", 3));
+  ASSERT_EQ(0, json_builder_end(builder));
+
+  struct json_value_s *const value = json_builder_finish(builder);
+  ASSERT_TRUE(value);
+
+  // the fragment is copied into the builder's arena.
+  struct json_raw_s *const raw =
+      json_value_as_raw(json_value_as_array(value)->start->value);
+  ASSERT_TRUE(raw);
+  ASSERT_NE(static_cast<const char *>(fragment), raw->raw);
+  ASSERT_EQ(strlen(fragment), raw->raw_size);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("[{\"cached\" : [1, 2]}, 3 ]", static_cast<char *>(minified));
+  free(minified);
+  json_builder_destroy(builder);
+
+  // malformed fragments, or more than one value, are rejected.
+  builder = json_builder_create(0, 0);
+  ASSERT_NE(0, json_builder_raw(builder, "[1,", 3));
+  ASSERT_FALSE(json_builder_finish(builder));
+  json_builder_destroy(builder);
+
+  builder = json_builder_create(0, 0);
+  ASSERT_NE(0, json_builder_raw(builder, "1 2", 3));
+  json_builder_destroy(builder);
+}
+
+UTEST(builder, misuse) {
+  struct json_builder_s *builder = json_builder_create(0, 0);
+  ASSERT_TRUE(builder);
+
+  // a name outside of an object.
+  ASSERT_NE(0, json_builder_name(builder, "a", 1));
+  ASSERT_NE(0, json_builder_null(builder));
+  ASSERT_FALSE(json_builder_finish(builder));
+  json_builder_destroy(builder);
+
+  // a value in an object without a name.
+  builder = json_builder_create(0, 0);
+  ASSERT_EQ(0, json_builder_begin_object(builder));
+  ASSERT_NE(0, json_builder_null(builder));
+  json_builder_destroy(builder);
+
+  // a name without a value.
+  builder = json_builder_create(0, 0);
+  ASSERT_EQ(0, json_builder_begin_object(builder));
+  ASSERT_EQ(0, json_builder_name(builder, "a", 1));
+  ASSERT_NE(0, json_builder_end(builder));
+  json_builder_destroy(builder);
+
+  // two values at the root, and too many ends.
+  builder = json_builder_create(0, 0);
+  ASSERT_EQ(0, json_builder_null(builder));
+  ASSERT_NE(0, json_builder_null(builder));
+  json_builder_destroy(builder);
+
+  builder = json_builder_create(0, 0);
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_EQ(0, json_builder_end(builder));
+  ASSERT_NE(0, json_builder_end(builder));
+  json_builder_destroy(builder);
+
+  // an unfinished array, or nothing at all.
+  builder = json_builder_create(0, 0);
+  ASSERT_FALSE(json_builder_finish(builder));
+  ASSERT_EQ(0, json_builder_begin_array(builder));
+  ASSERT_FALSE(json_builder_finish(builder));
+  json_builder_destroy(builder);
+}
@@ -0,0 +1,202 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+UTEST(minify, pretty) {
+  const char payload[] = "{\n"
+                         "  \"a\" : [\n"
+                         "    1,\t-2.5e+3,\r\n"
+                         "    true, false, null\n"
+                         "  ],\n"
+                         "  \"b c\" : \" \\\" { , } \\\\\"\n"
+                         "}\n";
+  char out[sizeof(payload)];
+
+  const size_t size = json_minify(payload, strlen(payload), 0, out);
+  ASSERT_EQ(strlen("{\"a\":[1,-2.5e+3,true,false,null],\"b c\":\" \\\" { , } "
+                   "\\\\\"}"),
+            size);
+  ASSERT_EQ(0, memcmp("{\"a\":[1,-2.5e+3,true,false,null],\"b c\":\" \\\" { , "
+                      "} \\\\\"}",
+                      out, size));
+}
+
+UTEST(minify, malformed) {
+  const char payload[] = "{\"a\" : [1, 2}";
+  char out[sizeof(payload)];
+
+  ASSERT_EQ(0u, json_minify(payload, strlen(payload), 0, out));
+}
+
+UTEST(minify, unterminated) {
+  const char *const payloads[] = {"[1, 2", "{\"a\" : \"b", "[1] /* c"};
+  char out[16];
+  size_t i;
+
+  for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+    ASSERT_EQ(0u, json_minify(payloads[i], strlen(payloads[i]),
+                              json_parse_flags_allow_c_style_comments, out));
+  }
+}
+
+UTEST(minify, trailing) {
+  const char *const payloads[] = {"1 2", "[1] [2]", "{} }", "\"a\" : 1"};
+  char out[16];
+  size_t i;
+
+  for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+    ASSERT_EQ(0u, json_minify(payloads[i], strlen(payloads[i]), 0, out));
+  }
+}
+
+UTEST(minify, comments) {
+  const char payload[] = "// leading\n"
+                         "[1, /* two */ 2, \"/* kept */\" // trailing\n"
+                         "]";
+  char out[sizeof(payload)];
+
+  ASSERT_EQ(0u, json_minify(payload, strlen(payload), 0, out));
+
+  const size_t size = json_minify(payload, strlen(payload),
+                                  json_parse_flags_allow_c_style_comments, out);
+  ASSERT_EQ(strlen("[1,2,\"/* kept */\"]"), size);
+  ASSERT_EQ(0, memcmp("[1,2,\"/* kept */\"]", out, size));
+}
+
+UTEST(minify, simplified) {
+  const char payload[] = "a = 1 b : true\nc : 'x y'";
+  char out[sizeof(payload)];
+
+  const size_t flags = json_parse_flags_allow_simplified_json |
+                       json_parse_flags_allow_single_quoted_strings;
+
+  const size_t size = json_minify(payload, strlen(payload), flags, out);
+  ASSERT_EQ(strlen("a=1 b:true c:'x y'"), size);
+  ASSERT_EQ(0, memcmp("a=1 b:true c:'x y'", out, size));
+}
+
+UTEST(minify, in_place) {
+  char payload[] = "[ \"a long string that spans several words\" ,\n"
+                   "        { \"key\"   :   12345678901234567890 } ]";
+
+  const size_t size =
+      json_minify_in_place(payload, strlen(payload), json_parse_flags_default);
+  ASSERT_EQ(strlen("[\"a long string that spans several words\","
+                   "{\"key\":12345678901234567890}]"),
+            size);
+  ASSERT_EQ(0, memcmp("[\"a long string that spans several words\","
+                      "{\"key\":12345678901234567890}]",
+                      payload, size));
+}
+
+UTEST(minify, matches_write_minified) {
+  const char payload[] =
+      "{\"glossary\" : {\"title\" : \"example glossary\", "
+      "\"list\" : [1, 2.5, -3e7, true, false, null, {}, []], "
+      "\"escaped\" : \"tab\\there \\u00e9\"}}";
+  struct json_value_s *const value = json_parse(payload, strlen(payload));
+  ASSERT_TRUE(value);
+
+  size_t pretty_size = 0;
+  char *const pretty = static_cast<char *>(
+      json_write_pretty(value, "    ", "\r\n", &pretty_size));
+  ASSERT_TRUE(pretty);
+
+  size_t minified_size = 0;
+  char *const minified =
+      static_cast<char *>(json_write_minified(value, &minified_size));
+  ASSERT_TRUE(minified);
+
+  const size_t size = json_minify_in_place(pretty, pretty_size - 1, 0);
+  ASSERT_EQ(minified_size - 1, size);
+  ASSERT_EQ(0, memcmp(minified, pretty, size));
+
+  free(minified);
+  free(pretty);
+  free(value);
+}
+
+UTEST(minify, no_commas) {
+  const char *const payloads[] = {"{\"a\" : 0 \"b\" : 1}", "[3.5 [[]]]",
+                                  "[true {\"c\" : null} \"d\" 4]",
+                                  "[\"x\" \"y\" [] {}]"};
+  size_t i;
+
+  for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+    const size_t payload_size = strlen(payloads[i]);
+    char out[64];
+
+    const size_t size = json_minify(payloads[i], payload_size,
+                                    json_parse_flags_allow_no_commas, out);
+    ASSERT_LT(0u, size);
+    ASSERT_GE(payload_size, size);
+
+    struct json_value_s *const value = json_parse_ex(
+        out, size, json_parse_flags_allow_no_commas, json_null, json_null,
+        json_null);
+    ASSERT_TRUE(value);
+    free(value);
+  }
+}
+
+UTEST(minify, simplified_reparses) {
+  const char payload[] = "a = 1 b : [2.5 {c : \"d\"} true] e : 'f' g : [0x10 "
+                         "+3 Infinity] h : -1";
+  const size_t flags = json_parse_flags_allow_simplified_json |
+                       json_parse_flags_allow_single_quoted_strings |
+                       json_parse_flags_allow_hexadecimal_numbers |
+                       json_parse_flags_allow_leading_plus_sign |
+                       json_parse_flags_allow_inf_and_nan;
+  char out[sizeof(payload)];
+
+  const size_t size = json_minify(payload, strlen(payload), flags, out);
+  ASSERT_LT(0u, size);
+
+  struct json_value_s *const value =
+      json_parse_ex(out, size, flags, json_null, json_null, json_null);
+  ASSERT_TRUE(value);
+
+  struct json_value_s *const original = json_parse_ex(
+      payload, strlen(payload), flags, json_null, json_null, json_null);
+  ASSERT_TRUE(original);
+
+  char *const want =
+      static_cast<char *>(json_write_minified(original, json_null));
+  char *const got = static_cast<char *>(json_write_minified(value, json_null));
+  ASSERT_TRUE(want);
+  ASSERT_TRUE(got);
+  ASSERT_STREQ(want, got);
+
+  free(got);
+  free(want);
+  free(original);
+  free(value);
+}
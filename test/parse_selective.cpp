@@ -0,0 +1,345 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+UTEST(parse_selective, prune) {
+  const char payload[] = "{\"a\" : {\"b\" : 1, \"c\" : [1, 2, 3]}, \"d\" : "
+                         "\"x\", \"e\" : true}";
+  const char *const paths[] = {"/a/c/1", "/d"};
+  struct json_value_s *matches[2];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 2, matches);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"a\":{\"c\":[2]},\"d\":\"x\"}",
+               static_cast<const char *>(minified));
+  free(minified);
+
+  ASSERT_TRUE(matches[0]);
+  ASSERT_TRUE(json_value_as_number(matches[0]));
+  ASSERT_STREQ("2", json_value_as_number(matches[0])->number);
+
+  ASSERT_TRUE(matches[1]);
+  ASSERT_TRUE(json_value_as_string(matches[1]));
+  ASSERT_STREQ("x", json_value_as_string(matches[1])->string);
+
+  free(value);
+}
+
+UTEST(parse_selective, nested_in_match) {
+  const char payload[] =
+      "{\"a\" : {\"b\" : 1, \"c\" : [1, 2, 3]}, \"d\" : [\"x\"]}";
+  const char *const paths[] = {"/a", "/a/c/2", "/a/c/3"};
+  struct json_value_s *matches[3];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 3, matches);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"a\":{\"b\":1,\"c\":[1,2,3]}}",
+               static_cast<const char *>(minified));
+  free(minified);
+
+  ASSERT_TRUE(matches[0]);
+  ASSERT_TRUE(json_value_as_object(matches[0]));
+  ASSERT_EQ(2, json_value_as_object(matches[0])->length);
+
+  ASSERT_TRUE(matches[1]);
+  ASSERT_TRUE(json_value_as_number(matches[1]));
+  ASSERT_STREQ("3", json_value_as_number(matches[1])->number);
+
+  ASSERT_FALSE(matches[2]);
+
+  free(value);
+}
+
+UTEST(parse_selective, missing) {
+  const char payload[] = "{\"a\" : {\"b\" : 1}, \"c\" : [true]}";
+  const char *const paths[] = {"/z", "/a/b/c", "/c/1", "/c/01"};
+  struct json_value_s *matches[4];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 4, matches);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"a\":{},\"c\":[]}", static_cast<const char *>(minified));
+  free(minified);
+
+  ASSERT_FALSE(matches[0]);
+  ASSERT_FALSE(matches[1]);
+  ASSERT_FALSE(matches[2]);
+  ASSERT_FALSE(matches[3]);
+
+  free(value);
+}
+
+UTEST(parse_selective, escaped_tokens) {
+  const char payload[] = "{\"a/b\" : 1, \"m~n\" : 2, \"\\u00e9\\n\" : 3, "
+                         "\"\\ud83d\\ude00\" : 4, \"\" : 5}";
+  const char *const paths[] = {"/a~1b", "/m~0n", "/\xc3\xa9\n",
+                               "/\xf0\x9f\x98\x80", "/"};
+  struct json_value_s *matches[5];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 5, matches);
+  ASSERT_TRUE(value);
+  ASSERT_EQ(5, json_value_as_object(value)->length);
+
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(matches[i]);
+    ASSERT_TRUE(json_value_as_number(matches[i]));
+    ASSERT_EQ('1' + i, json_value_as_number(matches[i])->number[0]);
+  }
+
+  free(value);
+}
+
+UTEST(parse_selective, whole_document) {
+  const char payload[] = "[1, {\"a\" : null}]";
+  const char *const paths[] = {"", "/1/a"};
+  struct json_value_s *matches[2];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 2, matches);
+  ASSERT_TRUE(value);
+  ASSERT_EQ(value, matches[0]);
+  ASSERT_EQ(2, json_value_as_array(value)->length);
+
+  ASSERT_TRUE(matches[1]);
+  ASSERT_TRUE(json_value_is_null(matches[1]));
+
+  free(value);
+}
+
+UTEST(parse_selective, scalar_root) {
+  const char payload[] = "\"hello\"";
+  const char *const paths[] = {"/0"};
+  struct json_value_s *matches[1];
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), paths, 1, matches);
+  ASSERT_TRUE(value);
+  ASSERT_TRUE(json_value_as_string(value));
+  ASSERT_STREQ("hello", json_value_as_string(value)->string);
+  ASSERT_FALSE(matches[0]);
+  free(value);
+}
+
+UTEST(parse_selective, no_paths) {
+  const char payload[] = "{\"a\" : [1, 2, {\"b\" : \"]}\"}]}";
+  struct json_value_s *value =
+      json_parse_selective(payload, strlen(payload), 0, 0, 0);
+  ASSERT_TRUE(value);
+  ASSERT_TRUE(json_value_as_object(value));
+  ASSERT_EQ(0, json_value_as_object(value)->length);
+  free(value);
+}
+
+UTEST(parse_selective, invalid_pointer) {
+  const char payload[] = "{\"a\" : 1}";
+  const char *const paths[] = {"/a", "a"};
+  struct json_value_s *matches[2];
+  struct json_parse_result_s result;
+  struct json_value_s *value = json_parse_selective_ex(
+      payload, strlen(payload), paths, 2, matches, json_parse_flags_default, 0,
+      0, &result);
+  ASSERT_FALSE(value);
+  ASSERT_EQ(json_parse_error_invalid_pointer, result.error);
+  ASSERT_FALSE(matches[0]);
+  ASSERT_FALSE(matches[1]);
+
+  const char *const bad_escape[] = {"/a~2"};
+  value = json_parse_selective_ex(payload, strlen(payload), bad_escape, 1, 0,
+                                  json_parse_flags_default, 0, 0, &result);
+  ASSERT_FALSE(value);
+  ASSERT_EQ(json_parse_error_invalid_pointer, result.error);
+}
+
+UTEST(parse_selective, invalid_json) {
+  const char payload[] = "{\"a\" : 1, \"b\" : [}";
+  const char *const paths[] = {"/a"};
+  struct json_parse_result_s result;
+  struct json_value_s *value =
+      json_parse_selective_ex(payload, strlen(payload), paths, 1, 0,
+                              json_parse_flags_default, 0, 0, &result);
+  ASSERT_FALSE(value);
+  ASSERT_NE(json_parse_error_none, result.error);
+  ASSERT_NE(json_parse_error_invalid_pointer, result.error);
+}
+
+UTEST(parse_selective, invalid_along_path) {
+  // errors in the wanted values, or in the objects and arrays leading to them,
+  // are found without a separate validation pass over the whole input.
+  const char *const payloads[] = {
+      "{\"a\" : {\"b\" : tru}}", "{\"a\" : {\"b\" : 1 \"c\" : 2}}",
+      "{\"a\" {\"b\" : 1}}",     "{\"x\" : 1, \"a\" : [1, 2}",
+      "{\"a\" : {\"b\" : 1}} x", "{\"a\" : {\"b\" : 1}",
+      "{\"x\" : [1}, \"a\" : 1}"};
+  const char *const paths[] = {"/a/b"};
+  size_t i;
+
+  for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+    struct json_parse_result_s result;
+    struct json_value_s *value =
+        json_parse_selective_ex(payloads[i], strlen(payloads[i]), paths, 1, 0,
+                                json_parse_flags_default, 0, 0, &result);
+    ASSERT_FALSE(value);
+    ASSERT_NE(json_parse_error_none, result.error);
+  }
+}
+
+UTEST(parse_selective, json5) {
+  const char payload[] = "// comment\n"
+                         "{\n"
+                         "  skipped : [ 'a]', /* } */ 0x10, +.5, Infinity ],\n"
+                         "  kept : { 'inner' : NaN, other : \"}\" },\n"
+                         "  last : null,\n"
+                         "}\n";
+  const char *const paths[] = {"/kept/inner", "/last"};
+  struct json_value_s *matches[2];
+  struct json_value_s *value = json_parse_selective_ex(
+      payload, strlen(payload), paths, 2, matches, json_parse_flags_allow_json5,
+      0, 0, 0);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"kept\":{\"inner\":0},\"last\":null}",
+               static_cast<const char *>(minified));
+  free(minified);
+
+  ASSERT_TRUE(matches[0]);
+  ASSERT_TRUE(json_value_as_number(matches[0]));
+  ASSERT_TRUE(matches[1]);
+  ASSERT_TRUE(json_value_is_null(matches[1]));
+
+  free(value);
+}
+
+UTEST(parse_selective, global_object) {
+  const char payload[] = "a = 1\nb = [2, 3]\n";
+  const char *const paths[] = {"/b/1"};
+  struct json_value_s *matches[1];
+  struct json_value_s *value = json_parse_selective_ex(
+      payload, strlen(payload), paths, 1, matches,
+      json_parse_flags_allow_simplified_json, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"b\":[3]}", static_cast<const char *>(minified));
+  free(minified);
+
+  ASSERT_TRUE(matches[0]);
+  ASSERT_STREQ("3", json_value_as_number(matches[0])->number);
+
+  free(value);
+}
+
+UTEST(parse_selective, location_information) {
+  const char payload[] = "{\n  \"a\" : [1, 2],\n  \"b\" : {\"c\" : true}\n}";
+  const char *const paths[] = {"/b/c"};
+  struct json_value_s *matches[1];
+  struct json_value_s *full = json_parse_ex(
+      payload, strlen(payload), json_parse_flags_allow_location_information, 0,
+      0, 0);
+  ASSERT_TRUE(full);
+  struct json_value_s *value = json_parse_selective_ex(
+      payload, strlen(payload), paths, 1, matches,
+      json_parse_flags_allow_location_information, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  struct json_object_s *const object = json_value_as_object(value);
+  ASSERT_TRUE(object);
+  ASSERT_EQ(1, object->length);
+
+  struct json_object_element_s *const expected =
+      json_value_as_object(full)->start->next;
+
+  struct json_string_ex_s *const key =
+      reinterpret_cast<struct json_string_ex_s *>(object->start->name);
+  struct json_string_ex_s *const expected_key =
+      reinterpret_cast<struct json_string_ex_s *>(expected->name);
+  ASSERT_STREQ("b", key->string.string);
+  ASSERT_EQ(expected_key->offset, key->offset);
+  ASSERT_EQ(expected_key->line_no, key->line_no);
+  ASSERT_EQ(expected_key->row_no, key->row_no);
+
+  struct json_value_ex_s *const b =
+      reinterpret_cast<struct json_value_ex_s *>(object->start->value);
+  struct json_value_ex_s *const expected_b =
+      reinterpret_cast<struct json_value_ex_s *>(expected->value);
+  ASSERT_EQ(expected_b->offset, b->offset);
+  ASSERT_EQ(expected_b->line_no, b->line_no);
+  ASSERT_EQ(expected_b->row_no, b->row_no);
+
+  struct json_value_ex_s *const c =
+      reinterpret_cast<struct json_value_ex_s *>(matches[0]);
+  struct json_value_ex_s *const expected_c =
+      reinterpret_cast<struct json_value_ex_s *>(
+          json_value_as_object(expected->value)->start->value);
+  ASSERT_TRUE(json_value_is_true(&c->value));
+  ASSERT_EQ(expected_c->offset, c->offset);
+  ASSERT_EQ(expected_c->line_no, c->line_no);
+  ASSERT_EQ(expected_c->row_no, c->row_no);
+
+  free(full);
+  free(value);
+}
+
+struct selective_allocator_s {
+  size_t size;
+};
+
+static void *selective_alloc(void *user_data, size_t size) {
+  static_cast<struct selective_allocator_s *>(user_data)->size = size;
+  return malloc(size);
+}
+
+UTEST(parse_selective, allocator) {
+  const char payload[] = "{\"big\" : [\"lots\", \"of\", \"strings\", \"here\"], "
+                         "\"small\" : 1}";
+  const char *const paths[] = {"/small"};
+  struct selective_allocator_s full = {0};
+  struct selective_allocator_s selective = {0};
+
+  struct json_value_s *value = json_parse_ex(
+      payload, strlen(payload), json_parse_flags_default, selective_alloc,
+      &full, 0);
+  ASSERT_TRUE(value);
+  free(value);
+
+  value = json_parse_selective_ex(payload, strlen(payload), paths, 1, 0,
+                                  json_parse_flags_default, selective_alloc,
+                                  &selective, 0);
+  ASSERT_TRUE(value);
+  free(value);
+
+  ASSERT_LT(selective.size, full.size);
+}
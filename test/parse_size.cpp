@@ -0,0 +1,124 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+struct parse_size_allocator_s {
+  size_t size;
+};
+
+static void *parse_size_alloc(void *user_data, size_t size) {
+  static_cast<struct parse_size_allocator_s *>(user_data)->size = size;
+  return malloc(size);
+}
+
+UTEST(parse_size, matches_parse_ex) {
+  const char payload[] = "{\"foo\" : [1, \"two\", {\"three\" : null}]}";
+  struct parse_size_allocator_s allocator = {0};
+  size_t dom_size = 0;
+  size_t data_size = 0;
+
+  ASSERT_EQ(0, json_parse_size(payload, strlen(payload),
+                               json_parse_flags_default, &dom_size,
+                               &data_size, 0, 0));
+
+  struct json_value_s *const value =
+      json_parse_ex(payload, strlen(payload), json_parse_flags_default,
+                    parse_size_alloc, &allocator, 0);
+  ASSERT_TRUE(value);
+  ASSERT_EQ(dom_size + data_size, allocator.size);
+  free(value);
+}
+
+UTEST(parse_size, into_buffer) {
+  const char payload[] = "{\"foo\" : [1, \"two\", {\"three\" : null}]}";
+  struct json_parse_size_state_s state;
+  size_t dom_size = 0;
+  size_t data_size = 0;
+
+  ASSERT_EQ(0, json_parse_size(payload, strlen(payload),
+                               json_parse_flags_default, &dom_size,
+                               &data_size, &state, 0));
+  ASSERT_EQ(dom_size, state.dom_size);
+  ASSERT_EQ(data_size, state.data_size);
+
+  // a pool slab that's bigger than we need.
+  void *slab[64];
+  ASSERT_LE(dom_size + data_size, sizeof(slab));
+
+  struct json_value_s *const value = json_parse_into(slab, sizeof(slab), &state);
+  ASSERT_EQ(static_cast<void *>(value), static_cast<void *>(slab));
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ("{\"foo\":[1,\"two\",{\"three\":null}]}",
+               static_cast<const char *>(minified));
+  free(minified);
+}
+
+UTEST(parse_size, buffer_too_small) {
+  const char payload[] = "[true, false]";
+  struct json_parse_size_state_s state;
+  void *slab[16];
+
+  ASSERT_EQ(0, json_parse_size(payload, strlen(payload),
+                               json_parse_flags_default, 0, 0, &state, 0));
+  ASSERT_FALSE(json_parse_into(slab, state.dom_size + state.data_size - 1,
+                               &state));
+  ASSERT_FALSE(json_parse_into(0, sizeof(slab), &state));
+  ASSERT_FALSE(json_parse_into(slab, sizeof(slab), 0));
+}
+
+UTEST(parse_size, flags) {
+  const char payload[] = "a = 1, b = [true]";
+  struct json_parse_size_state_s state;
+  struct json_parse_result_s result;
+  void *slab[64];
+
+  ASSERT_NE(0, json_parse_size(payload, strlen(payload),
+                               json_parse_flags_default, 0, 0, &state,
+                               &result));
+  ASSERT_NE(json_parse_error_none, result.error);
+
+  ASSERT_EQ(0, json_parse_size(payload, strlen(payload),
+                               json_parse_flags_allow_simplified_json |
+                                   json_parse_flags_allow_location_information,
+                               0, 0, &state, &result));
+  ASSERT_EQ(json_parse_error_none, result.error);
+  ASSERT_LE(state.dom_size + state.data_size, sizeof(slab));
+
+  struct json_value_s *const value = json_parse_into(slab, sizeof(slab), &state);
+  ASSERT_TRUE(value);
+
+  struct json_object_s *const object = json_value_as_object(value);
+  ASSERT_TRUE(object);
+  ASSERT_EQ(2, object->length);
+
+  struct json_value_ex_s *const b =
+      reinterpret_cast<struct json_value_ex_s *>(object->start->next->value);
+  ASSERT_EQ(11, b->offset);
+}
@@ -0,0 +1,143 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+static int parse_tape_check(const char *payload, size_t flags) {
+  const size_t payload_size = strlen(payload);
+  struct json_value_s *const expected =
+      json_parse_ex(payload, payload_size, flags, 0, 0, 0);
+  void *const expected_minified = json_write_minified(expected, 0);
+  json_uint32_t tape[256];
+  size_t capacity;
+  int failed = 0;
+
+  if (!expected || !expected_minified) {
+    return 1;
+  }
+
+  // every tape capacity, from none at all to more than enough (some
+  // capacities can't hold the two entries of the last key, string or number).
+  for (capacity = 0; capacity <= 256; capacity++) {
+    struct json_parse_size_state_s state;
+    struct json_value_s *value;
+    void *minified;
+    size_t size;
+
+    if (json_parse_size_ex(payload, payload_size, flags, tape, capacity, 0, 0,
+                           &state, 0)) {
+      failed = 1;
+      break;
+    }
+
+    if (state.tape_size > capacity) {
+      failed = 1;
+      break;
+    }
+
+    size = state.dom_size + state.data_size;
+    value = static_cast<struct json_value_s *>(malloc(size));
+
+    if (json_parse_into(value, size, &state) != value) {
+      free(value);
+      failed = 1;
+      break;
+    }
+
+    minified = json_write_minified(value, 0);
+    free(value);
+
+    if (!minified || strcmp(static_cast<const char *>(minified),
+                            static_cast<const char *>(expected_minified))) {
+      free(minified);
+      failed = 1;
+      break;
+    }
+
+    free(minified);
+  }
+
+  free(expected_minified);
+  free(expected);
+  return failed;
+}
+
+UTEST(parse_tape, default) {
+  ASSERT_FALSE(parse_tape_check(
+      "{\n  \"a\" : [1, -2.5e3, \"plain\", \"esc\\\"aped\\u00e9\"],\n"
+      "  \"b\\n\" : {\"c\" : true, \"d\" : false, \"e\" : null},\n"
+      "  \"f\" : [[], {}, [[\"deep\"]]]\n}",
+      json_parse_flags_default));
+}
+
+UTEST(parse_tape, scalar) {
+  ASSERT_FALSE(parse_tape_check("  \"just a string\"  ",
+                                json_parse_flags_default));
+  ASSERT_FALSE(parse_tape_check("42", json_parse_flags_default));
+  ASSERT_FALSE(parse_tape_check("null", json_parse_flags_default));
+}
+
+UTEST(parse_tape, json5) {
+  ASSERT_FALSE(parse_tape_check(
+      "// comment\n{unquoted : 'single', \"quoted\" : +.5, hex : 0x1F,\n"
+      "  inf : -Infinity, nan : NaN, 'multi' : \"line\n string\",\n"
+      "  trailing : [1, 2, /* three */],}",
+      json_parse_flags_allow_json5));
+}
+
+UTEST(parse_tape, simplified) {
+  ASSERT_FALSE(parse_tape_check("a = 1 b = [true false] c = {d = \"e\"}",
+                                json_parse_flags_allow_simplified_json));
+  ASSERT_FALSE(parse_tape_check("{\"a\" : [1]}",
+                                json_parse_flags_allow_simplified_json));
+}
+
+UTEST(parse_tape, location_information) {
+  const char payload[] = "[\"a\", 1]";
+  json_uint32_t tape[16];
+  struct json_parse_size_state_s state;
+
+  ASSERT_EQ(0, json_parse_size_ex(payload, strlen(payload),
+                                  json_parse_flags_allow_location_information,
+                                  tape, 16, 0, 0, &state, 0));
+  ASSERT_EQ(0, state.tape_size);
+}
+
+UTEST(parse_tape, tape_size) {
+  const char payload[] = "{\"a\" : [1, \"b\"]}";
+  json_uint32_t tape[16];
+  struct json_parse_size_state_s state;
+
+  ASSERT_EQ(0, json_parse_size_ex(payload, strlen(payload),
+                                  json_parse_flags_default, tape, 16, 0, 0,
+                                  &state, 0));
+
+  // one entry each for the object and the array, and two each for the key and
+  // the two elements.
+  ASSERT_EQ(8, state.tape_size);
+  ASSERT_EQ(tape, state.tape);
+}
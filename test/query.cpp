@@ -0,0 +1,280 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+struct query {
+  struct json_value_s *root;
+  struct json_value_s *matches[16];
+  size_t size;
+};
+
+UTEST_F_SETUP(query) {
+  const char payload[] =
+      "{\"store\" : {\"book\" : [{\"title\" : \"a\", \"price\" : 8}, "
+      "{\"title\" : \"b\", \"price\" : 12}, {\"title\" : \"c\", \"price\" : "
+      "9}, {\"title\" : \"d\", \"price\" : 22}], \"bicycle\" : {\"price\" : "
+      "19}}, \"a/b\" : {\"m~n\" : true}, \"0\" : null}";
+  utest_fixture->root = json_parse(payload, strlen(payload));
+  ASSERT_TRUE(utest_fixture->root);
+  utest_fixture->size = 0;
+}
+
+UTEST_F_TEARDOWN(query) { free(utest_fixture->root); }
+
+static size_t query_run(struct query *fixture, const char *query) {
+  struct json_query_s *const compiled = json_query_compile(query, strlen(query));
+  size_t size;
+
+  if (!compiled) {
+    return static_cast<size_t>(-1);
+  }
+
+  size = json_query_evaluate(compiled, fixture->root, fixture->matches, 16);
+  free(compiled);
+  return size;
+}
+
+static const char *query_string(struct json_value_s *value) {
+  return json_value_as_string(value)->string;
+}
+
+static const char *query_number(struct json_value_s *value) {
+  return json_value_as_number(value)->number;
+}
+
+UTEST_F(query, pointer) {
+  ASSERT_EQ(1, query_run(utest_fixture, "/store/book/1/title"));
+  ASSERT_STREQ("b", query_string(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "/a~1b/m~0n"));
+  ASSERT_TRUE(json_value_is_true(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "/0"));
+  ASSERT_TRUE(json_value_is_null(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, ""));
+  ASSERT_EQ(utest_fixture->root, utest_fixture->matches[0]);
+
+  ASSERT_EQ(0, query_run(utest_fixture, "/store/book/4"));
+  ASSERT_EQ(0, query_run(utest_fixture, "/store/book/01"));
+  ASSERT_EQ(0, query_run(utest_fixture, "/store/missing"));
+}
+
+UTEST_F(query, child) {
+  ASSERT_EQ(1, query_run(utest_fixture, "$.store.bicycle.price"));
+  ASSERT_STREQ("19", query_number(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "$['a/b'][\"m~n\"]"));
+  ASSERT_TRUE(json_value_is_true(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "$"));
+  ASSERT_EQ(utest_fixture->root, utest_fixture->matches[0]);
+}
+
+UTEST_F(query, index) {
+  ASSERT_EQ(1, query_run(utest_fixture, "$.store.book[0].title"));
+  ASSERT_STREQ("a", query_string(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "$.store.book[-1].title"));
+  ASSERT_STREQ("d", query_string(utest_fixture->matches[0]));
+
+  ASSERT_EQ(0, query_run(utest_fixture, "$.store.book[4]"));
+  ASSERT_EQ(0, query_run(utest_fixture, "$.store.book[-5]"));
+}
+
+UTEST_F(query, wildcard) {
+  ASSERT_EQ(4, query_run(utest_fixture, "$.store.book[*].price"));
+  ASSERT_STREQ("8", query_number(utest_fixture->matches[0]));
+  ASSERT_STREQ("12", query_number(utest_fixture->matches[1]));
+  ASSERT_STREQ("9", query_number(utest_fixture->matches[2]));
+  ASSERT_STREQ("22", query_number(utest_fixture->matches[3]));
+
+  ASSERT_EQ(2, query_run(utest_fixture, "$.store.*"));
+}
+
+UTEST_F(query, slice) {
+  ASSERT_EQ(2, query_run(utest_fixture, "$.store.book[1:3].title"));
+  ASSERT_STREQ("b", query_string(utest_fixture->matches[0]));
+  ASSERT_STREQ("c", query_string(utest_fixture->matches[1]));
+
+  ASSERT_EQ(2, query_run(utest_fixture, "$.store.book[::2].title"));
+  ASSERT_STREQ("a", query_string(utest_fixture->matches[0]));
+  ASSERT_STREQ("c", query_string(utest_fixture->matches[1]));
+
+  ASSERT_EQ(2, query_run(utest_fixture, "$.store.book[-2:].title"));
+  ASSERT_STREQ("c", query_string(utest_fixture->matches[0]));
+  ASSERT_STREQ("d", query_string(utest_fixture->matches[1]));
+
+  ASSERT_EQ(3, query_run(utest_fixture, "$.store.book[:-1]"));
+  ASSERT_EQ(0, query_run(utest_fixture, "$.store.book[3:1]"));
+}
+
+UTEST_F(query, recursive_descent) {
+  ASSERT_EQ(5, query_run(utest_fixture, "$..price"));
+  ASSERT_STREQ("8", query_number(utest_fixture->matches[0]));
+  ASSERT_STREQ("22", query_number(utest_fixture->matches[3]));
+  ASSERT_STREQ("19", query_number(utest_fixture->matches[4]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "$..book[2].title"));
+  ASSERT_STREQ("c", query_string(utest_fixture->matches[0]));
+
+  ASSERT_EQ(1, query_run(utest_fixture, "$.store..[1]"));
+  ASSERT_TRUE(json_value_as_object(utest_fixture->matches[0]));
+}
+
+UTEST(query, document_order) {
+  const char payload[] = "{\"x\" : {\"a\" : 1}, \"a\" : [[2, [3]], 4]}";
+  struct json_value_s *const root = json_parse(payload, strlen(payload));
+  ASSERT_TRUE(root);
+
+  // matches nested under an earlier sibling come before later siblings.
+  struct json_query_s *compiled = json_query_compile("$..a", 4);
+  ASSERT_TRUE(compiled);
+
+  struct json_value_s *matches[5];
+  ASSERT_EQ(2, json_query_evaluate(compiled, root, matches, 5));
+  ASSERT_STREQ("1", json_value_as_number(matches[0])->number);
+  ASSERT_EQ(2, json_value_as_array(matches[1])->length);
+  free(compiled);
+
+  // and a value comes before anything nested inside it.
+  compiled = json_query_compile("$.a..*", 6);
+  ASSERT_TRUE(compiled);
+
+  ASSERT_EQ(5, json_query_evaluate(compiled, root, matches, 5));
+  ASSERT_EQ(2, json_value_as_array(matches[0])->length);
+  ASSERT_STREQ("2", json_value_as_number(matches[1])->number);
+  ASSERT_EQ(1, json_value_as_array(matches[2])->length);
+  ASSERT_STREQ("3", json_value_as_number(matches[3])->number);
+  ASSERT_STREQ("4", json_value_as_number(matches[4])->number);
+  free(compiled);
+
+  free(root);
+}
+
+UTEST(query, deep) {
+  const size_t depth = JSON_MAX_RECURSION;
+  char *const payload = static_cast<char *>(malloc(2 * depth + 1));
+  size_t i;
+
+  // the deepest DOM the parser allows.
+  memset(payload, '[', depth);
+  payload[depth] = '1';
+  memset(payload + depth + 1, ']', depth);
+  struct json_value_s *const root = json_parse(payload, 2 * depth + 1);
+  free(payload);
+  ASSERT_TRUE(root);
+
+  struct json_query_s *const compiled = json_query_compile("$..*", 4);
+  ASSERT_TRUE(compiled);
+  ASSERT_EQ(depth, json_query_evaluate(compiled, root, 0, 0));
+  free(root);
+
+  // a DOM built by hand that nests one level deeper is an error, rather
+  // than the C stack overflowing on even deeper ones.
+  struct json_value_s *const values = static_cast<struct json_value_s *>(
+      malloc((depth + 2) * sizeof(struct json_value_s)));
+  struct json_array_s *const arrays = static_cast<struct json_array_s *>(
+      malloc((depth + 1) * sizeof(struct json_array_s)));
+  struct json_array_element_s *const elements =
+      static_cast<struct json_array_element_s *>(
+          malloc((depth + 1) * sizeof(struct json_array_element_s)));
+
+  for (i = 0; i <= depth; i++) {
+    values[i].type = json_type_array;
+    values[i].payload = &arrays[i];
+    arrays[i].start = &elements[i];
+    arrays[i].length = 1;
+  }
+
+  values[depth + 1].type = json_type_null;
+  values[depth + 1].payload = 0;
+
+  for (i = 0; i <= depth; i++) {
+    elements[i].value = &values[i + 1];
+    elements[i].next = 0;
+  }
+
+  ASSERT_EQ(0, json_query_evaluate(compiled, values, 0, 0));
+
+  free(elements);
+  free(arrays);
+  free(values);
+  free(compiled);
+}
+
+UTEST_F(query, capacity) {
+  struct json_query_s *const compiled = json_query_compile("$..title", 8);
+  ASSERT_TRUE(compiled);
+
+  ASSERT_EQ(4, json_query_evaluate(compiled, utest_fixture->root, 0, 0));
+  ASSERT_EQ(4, json_query_evaluate(compiled, utest_fixture->root,
+                                   utest_fixture->matches, 2));
+  ASSERT_STREQ("a", query_string(utest_fixture->matches[0]));
+  ASSERT_STREQ("b", query_string(utest_fixture->matches[1]));
+
+  free(compiled);
+}
+
+UTEST(query, invalid) {
+  const char *const queries[] = {"store",  "/a~2", "/a~",     "$.",
+                                 "$..",    "$[",   "$[]",     "$['a'",
+                                 "$[1:2:0]", "$.[0]", "$[-]", "$a",
+                                 "$[99999999999999999999999]"};
+  size_t i;
+
+  for (i = 0; i < sizeof(queries) / sizeof(queries[0]); i++) {
+    ASSERT_FALSE(json_query_compile(queries[i], strlen(queries[i])));
+  }
+}
+
+static size_t query_allocated;
+
+static void *query_alloc(void *user_data, size_t size) {
+  *static_cast<size_t *>(user_data) = size;
+  return malloc(size);
+}
+
+UTEST(query, allocator) {
+  const char payload[] = "[[1, 2], [3, 4]]";
+  struct json_value_s *const root = json_parse(payload, strlen(payload));
+  ASSERT_TRUE(root);
+
+  struct json_query_s *const compiled =
+      json_query_compile_ex("$[*][1]", 7, query_alloc, &query_allocated);
+  ASSERT_TRUE(compiled);
+  ASSERT_NE(0, query_allocated);
+
+  struct json_value_s *matches[2];
+  ASSERT_EQ(2, json_query_evaluate(compiled, root, matches, 2));
+  ASSERT_STREQ("2", json_value_as_number(matches[0])->number);
+  ASSERT_STREQ("4", json_value_as_number(matches[1])->number);
+
+  free(compiled);
+  free(root);
+}
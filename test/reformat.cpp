@@ -0,0 +1,157 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char reformat_payload[] =
+    "{\"a\":[1,-2.5e+3,\"str\\\"ing\\n\",true,false,null,{},[]],\n"
+    "  \"b\" : { \"c\" : \"[{,:}]\" , \"d\" : [[[]], [{\"e\" : 0}]] } }";
+
+static int reformat_chunked(const char *src, size_t src_size,
+                            size_t chunk_size, const char *indent,
+                            const char *newline,
+                            struct write_sink_s *sink) {
+  struct json_reformat_s *const reformat =
+      json_reformat_create(indent, newline, write_sink, sink);
+  size_t offset;
+  int result = 0;
+
+  if (!reformat) {
+    return 1;
+  }
+
+  for (offset = 0; (0 == result) && (offset < src_size);
+       offset += chunk_size) {
+    const size_t size =
+        (src_size - offset < chunk_size) ? src_size - offset : chunk_size;
+    result = json_reformat_write(reformat, src + offset, size);
+  }
+
+  if (0 == result) {
+    result = json_reformat_finish(reformat);
+  }
+
+  json_reformat_destroy(reformat);
+
+  return result;
+}
+
+UTEST(reformat, matches_write_pretty) {
+  struct json_value_s *const value =
+      json_parse(reformat_payload, strlen(reformat_payload));
+  ASSERT_TRUE(value);
+
+  char *const expected =
+      static_cast<char *>(json_write_pretty(value, "\t", "\r\n", 0));
+  ASSERT_TRUE(expected);
+
+  size_t chunk_size;
+
+  for (chunk_size = 1; chunk_size <= strlen(reformat_payload);
+       chunk_size++) {
+    struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+    ASSERT_EQ(0, reformat_chunked(reformat_payload, strlen(reformat_payload),
+                                  chunk_size, "\t", "\r\n", &sink));
+    ASSERT_EQ(1u, sink.calls);
+    ASSERT_STREQ(expected, sink.data);
+
+    free(sink.data);
+  }
+
+  free(expected);
+  free(value);
+}
+
+UTEST(reformat, defaults) {
+  const char payload[] = "[1,{\"a\":null}]";
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_EQ(0, reformat_chunked(payload, strlen(payload), strlen(payload), 0,
+                                0, &sink));
+  ASSERT_STREQ("[\n"
+               "  1,\n"
+               "  {\n"
+               "    \"a\" : null\n"
+               "  }\n"
+               "]",
+               sink.data);
+
+  free(sink.data);
+}
+
+UTEST(reformat, scalar) {
+  const char payload[] = "  12345  ";
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_EQ(0, reformat_chunked(payload, strlen(payload), 3, 0, 0, &sink));
+  ASSERT_STREQ("12345", sink.data);
+
+  free(sink.data);
+}
+
+UTEST(reformat, long_string) {
+  // a string longer than the staging buffer goes through it in pieces.
+  const size_t length = 3 * JSON_WRITE_STAGING_SIZE;
+  char *const payload = static_cast<char *>(malloc(length + 4));
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  payload[0] = '[';
+  payload[1] = '"';
+  memset(payload + 2, 'x', length);
+  payload[length + 2] = '"';
+  payload[length + 3] = ']';
+
+  ASSERT_EQ(0, reformat_chunked(payload, length + 4, 1000, "", "", &sink));
+  ASSERT_EQ(length + 4, sink.size);
+  ASSERT_EQ(0, memcmp(payload, sink.data, length + 4));
+
+  free(sink.data);
+  free(payload);
+}
+
+UTEST(reformat, malformed) {
+  const char *const payloads[] = {
+      "",         "[1 2]",     "[1,]",       "{\"a\" 1}", "[}",
+      "{1 : 2}",  "\"abc",     "[",          "1 2",       "{\"a\" : 1,}",
+      "{\"a\"}",  "[1]]",      ",",          "[:]",       "{\"a\" : }",
+      "[\"a\":1]"};
+  size_t i;
+
+  for (i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++) {
+    struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+    EXPECT_NE(0, reformat_chunked(payloads[i], strlen(payloads[i]), 1, 0, 0,
+                                  &sink));
+
+    free(sink.data);
+  }
+}
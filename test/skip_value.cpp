@@ -0,0 +1,134 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+static size_t skip(const char *src, size_t offset, size_t flags) {
+  return json_skip_value(src, strlen(src), offset, flags);
+}
+
+UTEST(skip_value, scalars) {
+  ASSERT_EQ(4, skip("true", 0, json_parse_flags_default));
+  ASSERT_EQ(8, skip("  -1.5e3, 2", 0, json_parse_flags_default));
+  ASSERT_EQ(5, skip("[null, 42]", 1, json_parse_flags_default));
+  ASSERT_EQ(9, skip("[null, 42]", 6, json_parse_flags_default));
+  ASSERT_EQ(5, skip("\"a\\\"\"]", 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, containers) {
+  const char payload[] = "{\"a\" : [1, {\"b\" : \"]}\"}, [[], {}]], \"c\" : 2}";
+  ASSERT_EQ(strlen(payload), skip(payload, 0, json_parse_flags_default));
+
+  // the value of "a" ends just before the ', "c"'.
+  ASSERT_EQ(strchr(payload, 'c') - payload - 3,
+            skip(payload, 7, json_parse_flags_default));
+}
+
+UTEST(skip_value, long_strings) {
+  const char payload[] = "[\"a string that is long enough to span several "
+                         "words, with an \\\"escaped\\\" quote and \\\\\", "
+                         "\"[{\"] trailing";
+  ASSERT_EQ(strlen(payload) - strlen(" trailing"),
+            skip(payload, 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, comments) {
+  const char payload[] = "/* lead */ [1, // ]\n 2 /* ] */, '}']";
+  ASSERT_EQ(strlen(payload), skip(payload, 0, json_parse_flags_allow_json5));
+  ASSERT_EQ(0, skip(payload, 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, single_quotes) {
+  const char payload[] = "['a]', \"b'\"]";
+  ASSERT_EQ(strlen(payload),
+            skip(payload, 0, json_parse_flags_allow_single_quoted_strings));
+  ASSERT_EQ(4, skip(payload, 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, invalid) {
+  ASSERT_EQ(0, skip("", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("   ", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("[1, 2", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("{\"a\" : \"b}", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("]", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("[1 /* ]", 0, json_parse_flags_allow_c_style_comments));
+  ASSERT_EQ(0, skip("[1]", 3, json_parse_flags_default));
+  ASSERT_EQ(0, json_skip_value(0, 0, 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, mismatched) {
+  ASSERT_EQ(0, skip("[1}", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("{\"a\" : 1]", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("[{\"a\" : [1]]}", 0, json_parse_flags_default));
+  ASSERT_EQ(0, skip("[{]}", 0, json_parse_flags_default));
+}
+
+UTEST(skip_value, too_deep) {
+  char payload[2 * (JSON_MAX_RECURSION + 1)];
+  size_t i;
+
+  // as deep as the parser allows is fine, but no deeper.
+  for (i = 0; i < JSON_MAX_RECURSION; i++) {
+    payload[i] = '[';
+    payload[2 * JSON_MAX_RECURSION - 1 - i] = ']';
+  }
+  ASSERT_EQ(2 * JSON_MAX_RECURSION,
+            json_skip_value(payload, 2 * JSON_MAX_RECURSION, 0,
+                            json_parse_flags_default));
+
+  for (i = 0; i <= JSON_MAX_RECURSION; i++) {
+    payload[i] = '[';
+    payload[2 * JSON_MAX_RECURSION + 1 - i] = ']';
+  }
+  ASSERT_EQ(0, json_skip_value(payload, sizeof(payload), 0,
+                               json_parse_flags_default));
+}
+
+UTEST(skip_value, matches_parser) {
+  const char payload[] = "[{\"a\" : [true, false, null]}, \"x\\u0041y\", "
+                         "-0.5e-3, {}, [], [[[[[[[[[[1]]]]]]]]]]]";
+  struct json_value_s *const root = json_parse_ex(
+      payload, strlen(payload), json_parse_flags_allow_location_information,
+      0, 0, 0);
+  ASSERT_TRUE(root);
+
+  struct json_array_element_s *element = json_value_as_array(root)->start;
+  for (; element; element = element->next) {
+    const struct json_value_ex_s *const value =
+        reinterpret_cast<const struct json_value_ex_s *>(element->value);
+    const size_t end = skip(payload, value->offset, json_parse_flags_default);
+    ASSERT_NE(0, end);
+
+    // re-parsing exactly the skipped span must succeed.
+    struct json_value_s *const reparsed =
+        json_parse(payload + value->offset, end - value->offset);
+    ASSERT_TRUE(reparsed);
+    free(reparsed);
+  }
+
+  free(root);
+}
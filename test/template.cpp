@@ -0,0 +1,181 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+UTEST(template, fill) {
+  const char skeleton[] = "{\n"
+                          "  \"id\" : ?,\n"
+                          "  \"name\" : ?,\n"
+                          "  \"tags\" : [?, \"x y\"],\n"
+                          "  \"ok\" : true\n"
+                          "}\n";
+  const char want[] = "{\"id\":42,\"name\":\"a\\\"b\\n\",\"tags\":[[1,null],"
+                      "\"x y\"],\"ok\":true}";
+  struct json_number_s number = {"42", 2};
+  struct json_string_s string = {"a\"b\n", 4};
+  struct json_value_s id = {&number, json_type_number};
+  struct json_value_s name = {&string, json_type_string};
+  struct json_value_s *tags = json_parse("[1, null]", 9);
+  const struct json_value_s *values[3];
+  struct json_template_s *tmpl = json_template_compile(
+      skeleton, strlen(skeleton), json_null, json_null);
+  size_t size = 0;
+  void *out;
+
+  ASSERT_TRUE(tmpl);
+  ASSERT_TRUE(tags);
+  ASSERT_EQ(3u, json_template_placeholders(tmpl));
+
+  values[0] = &id;
+  values[1] = &name;
+  values[2] = tags;
+
+  out = json_template_write(tmpl, values, json_null, json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(want) + 1, size);
+  ASSERT_STREQ(want, (const char *)out);
+
+  free(out);
+  free(tags);
+  free(tmpl);
+}
+
+UTEST(template, matches_write_minified) {
+  const char skeleton[] = "[{\"a\" : ?, \"b\" : {\"c\" : [?, ?]}}, ?]";
+  const char payload[] =
+      "[{\"a\" : \"\\t\\\\\", \"b\" : {\"c\" : [-1.5e3, {}]}}, false]";
+  struct json_value_s *dom = json_parse(payload, strlen(payload));
+  struct json_template_s *tmpl = json_template_compile(
+      skeleton, strlen(skeleton), json_null, json_null);
+  const struct json_value_s *values[4];
+  struct json_array_s *root;
+  struct json_object_s *object;
+  struct json_array_s *c;
+  void *want;
+  void *out;
+
+  ASSERT_TRUE(dom);
+  ASSERT_TRUE(tmpl);
+  ASSERT_EQ(4u, json_template_placeholders(tmpl));
+
+  root = json_value_as_array(dom);
+  object = json_value_as_object(root->start->value);
+  c = json_value_as_array(
+      json_value_as_object(object->start->next->value)->start->value);
+
+  values[0] = object->start->value;
+  values[1] = c->start->value;
+  values[2] = c->start->next->value;
+  values[3] = root->start->next->value;
+
+  want = json_write_minified(dom, json_null);
+  out = json_template_write(tmpl, values, json_null, json_null, json_null);
+  ASSERT_TRUE(want);
+  ASSERT_TRUE(out);
+  ASSERT_STREQ((const char *)want, (const char *)out);
+
+  free(out);
+  free(want);
+  free(tmpl);
+  free(dom);
+}
+
+UTEST(template, no_placeholders) {
+  const char skeleton[] = "{ \"q?\" : \"?\", \"n\" : [ 1 , -2 ] }";
+  struct json_template_s *tmpl = json_template_compile(
+      skeleton, strlen(skeleton), json_null, json_null);
+  void *out;
+
+  ASSERT_TRUE(tmpl);
+  ASSERT_EQ(0u, json_template_placeholders(tmpl));
+
+  out = json_template_write(tmpl, json_null, json_null, json_null, json_null);
+  ASSERT_TRUE(out);
+  ASSERT_STREQ("{\"q?\":\"?\",\"n\":[1,-2]}", (const char *)out);
+
+  free(out);
+  free(tmpl);
+}
+
+UTEST(template, malformed) {
+  const char *const skeletons[] = {"{? : 1}", "[? 1]", "[1 ?]",  "[1 2]",
+                                   "[?1]",    "[??]",  "[tru?]", "[?e5]",
+                                   "[1,]",    "\"abc", "[?",     ""};
+  size_t i;
+
+  for (i = 0; i < sizeof(skeletons) / sizeof(skeletons[0]); i++) {
+    ASSERT_FALSE(json_template_compile(skeletons[i], strlen(skeletons[i]),
+                                       json_null, json_null));
+  }
+}
+
+UTEST(template, missing_value) {
+  const char skeleton[] = "[?, ?]";
+  struct json_template_s *tmpl = json_template_compile(
+      skeleton, strlen(skeleton), json_null, json_null);
+  const struct json_value_s *values[2];
+  struct json_value_s *value = json_parse("true", 4);
+
+  ASSERT_TRUE(tmpl);
+  ASSERT_TRUE(value);
+
+  values[0] = value;
+  values[1] = json_null;
+
+  ASSERT_FALSE(
+      json_template_write(tmpl, values, json_null, json_null, json_null));
+
+  free(value);
+  free(tmpl);
+}
+
+UTEST(template, into) {
+  const char skeleton[] = "{\"v\" : ?}";
+  struct json_template_s *tmpl = json_template_compile(
+      skeleton, strlen(skeleton), json_null, json_null);
+  struct json_value_s *value = json_parse("[true, \"x\"]", 11);
+  const struct json_value_s *values[1];
+  char buffer[64];
+  size_t needed = 0;
+
+  ASSERT_TRUE(tmpl);
+  ASSERT_TRUE(value);
+
+  values[0] = value;
+
+  ASSERT_NE(0, json_template_write_into(tmpl, values, buffer, 4, &needed));
+  ASSERT_EQ(strlen("{\"v\":[true,\"x\"]}") + 1, needed);
+
+  ASSERT_EQ(0, json_template_write_into(tmpl, values, buffer, needed, &needed));
+  ASSERT_STREQ("{\"v\":[true,\"x\"]}", buffer);
+
+  free(value);
+  free(tmpl);
+}
@@ -0,0 +1,141 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// transcoding should succeed exactly when parsing does, and give the same
+// output as writing the parsed DOM out minified.
+static const char *const transcode_payloads[] = {
+    "{\"a\" : [1, 2.5e-3, \"str\\\"ing\", true, false, null, {}, []]}",
+    "// leading comment\n"
+    "{unquoted : 'single \"quoted\"', $key_2 : +1, c : .5, d : 5.,\n"
+    "  e : 0xDEADbeef, f : -Infinity, g : NaN, /* block */ h : [1, 2,],\n"
+    "  i : {j : 'k',}, 'l' : 'multi\n"
+    "line\r\n',}",
+    "a = 1 b : [true false] c : {d : null}",
+    "",
+    "[1 2]",
+    "[1,]",
+    "[,1]",
+    "[1,,2]",
+    "{\"a\" : 1,}",
+    "{\"a\" 1}",
+    "{\"a\" : }",
+    "{a : 1}",
+    "['a']",
+    "[1}",
+    "{\"a\" : 1]",
+    "[}",
+    "1 2",
+    "[1] ]",
+    "\"unterminated",
+    "[01]",
+    "[1.]",
+    "[+1]",
+    "[.5]",
+    "[0x10]",
+    "[Infinity]",
+    "[truex]",
+    "[nul]",
+    "[1/*c*/]",
+    "{\"a\" : 1 \"b\" : 2}",
+    "a : 1",
+    "}"};
+
+UTEST(transcode, matches_parse_and_write_minified) {
+  const size_t flags[] = {json_parse_flags_default,
+                          json_parse_flags_allow_json5,
+                          json_parse_flags_allow_simplified_json,
+                          json_parse_flags_allow_simplified_json |
+                              json_parse_flags_allow_json5};
+  size_t i, k;
+
+  for (k = 0; k < sizeof(flags) / sizeof(flags[0]); k++) {
+    for (i = 0; i < sizeof(transcode_payloads) / sizeof(transcode_payloads[0]);
+         i++) {
+      const char *const payload = transcode_payloads[i];
+      struct json_parse_result_s parse_result;
+      struct json_parse_result_s transcode_result;
+      struct write_sink_s sink = {0, 0, 0, 0, 0};
+      struct json_value_s *const value = json_parse_ex(
+          payload, strlen(payload), flags[k], 0, 0, &parse_result);
+      const int error =
+          json_transcode_to(payload, strlen(payload), flags[k], write_sink,
+                            &sink, &transcode_result);
+
+      if (value) {
+        char *const expected =
+            static_cast<char *>(json_write_minified(value, 0));
+
+        EXPECT_EQ(0, error);
+        EXPECT_STREQ(expected, sink.data ? sink.data : "");
+
+        free(expected);
+      } else {
+        EXPECT_NE(0, error);
+        EXPECT_EQ(parse_result.error, transcode_result.error);
+        EXPECT_EQ(parse_result.error_offset, transcode_result.error_offset);
+      }
+
+      free(sink.data);
+      free(value);
+    }
+  }
+}
+
+UTEST(transcode, json5) {
+  const char payload[] = "{unquoted : 'a \"b\"', hex : 0x1F, plus : +1.,\n"
+                         "  list : [.5, 'a\"b',], // comment\n"
+                         "}";
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_EQ(0, json_transcode_to(payload, strlen(payload),
+                                 json_parse_flags_allow_json5, write_sink,
+                                 &sink, 0));
+  ASSERT_STREQ("{\"unquoted\":\"a \\\"b\\\"\",\"hex\":31,\"plus\":1.0,"
+               "\"list\":[0.5,\"a\\\"b\"]}",
+               sink.data);
+
+  free(sink.data);
+}
+
+UTEST(transcode, escapes) {
+  // escape sequences are already valid JSON, so they are copied as they are.
+  const char payload[] = "{'\\u00e9\\n' : \"\\ud83d\\ude00\\/\"}";
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_EQ(0, json_transcode_to(payload, strlen(payload),
+                                 json_parse_flags_allow_json5, write_sink,
+                                 &sink, 0));
+  ASSERT_STREQ("{\"\\u00e9\\n\":\"\\ud83d\\ude00\\/\"}", sink.data);
+
+  free(sink.data);
+}
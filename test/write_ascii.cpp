@@ -0,0 +1,208 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+UTEST(write_ascii, minified) {
+  const char payload[] = "{\"caf\xc3\xa9\" : [\"\xe2\x82\xac 5\", "
+                         "\"\xf0\x9f\x98\x80\\n\", \"plain\"]}";
+  const char want[] = "{\"caf\\u00e9\":[\"\\u20ac 5\",\"\\ud83d\\ude00\\n\","
+                      "\"plain\"]}";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  size_t size = 0;
+  void *out;
+
+  ASSERT_TRUE(value);
+
+  out = json_write_minified_flags(value, json_write_flags_ensure_ascii,
+                                  json_null, json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(want) + 1, size);
+  ASSERT_STREQ(want, static_cast<const char *>(out));
+
+  free(out);
+
+  /* without the flag, the utf-8 is written as is. */
+  out = json_write_minified(value, json_null);
+  ASSERT_TRUE(out);
+  ASSERT_STREQ("{\"caf\xc3\xa9\":[\"\xe2\x82\xac 5\",\"\xf0\x9f\x98\x80\\n\","
+               "\"plain\"]}",
+               static_cast<const char *>(out));
+
+  free(out);
+  free(value);
+}
+
+UTEST(write_ascii, pretty) {
+  const char payload[] = "{\"k\" : [\"\xc3\xa9\", 1]}";
+  const char want[] = "{\n"
+                      "  \"k\" : [\"\\u00e9\", 1]\n"
+                      "}";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  size_t size = 0;
+  void *out;
+
+  ASSERT_TRUE(value);
+
+  out = json_write_pretty_flags(value, "  ", "\n",
+                                json_write_flags_ensure_ascii |
+                                    json_write_flags_inline_scalar_arrays,
+                                json_null, json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(want) + 1, size);
+  ASSERT_STREQ(want, static_cast<const char *>(out));
+
+  free(out);
+  free(value);
+}
+
+UTEST(write_ascii, long_runs) {
+  /* enough ASCII either side of the non-ASCII to be copied a word at a time. */
+  const char payload[] = "[\"abcdefghijklmnopqrstuvwxyz \xce\xbb "
+                         "ABCDEFGHIJKLMNOPQRSTUVWXYZ\\t0123456789\"]";
+  const char want[] = "[\"abcdefghijklmnopqrstuvwxyz \\u03bb "
+                      "ABCDEFGHIJKLMNOPQRSTUVWXYZ\\t0123456789\"]";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  size_t size = 0;
+  void *out;
+
+  ASSERT_TRUE(value);
+
+  out = json_write_minified_flags(value, json_write_flags_ensure_ascii,
+                                  json_null, json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(want) + 1, size);
+  ASSERT_STREQ(want, static_cast<const char *>(out));
+
+  free(out);
+  free(value);
+}
+
+UTEST(write_ascii, round_trip) {
+  const char payload[] = "[\"\xc2\x80 \xdf\xbf \xe0\xa0\x80 \xef\xbf\xbf "
+                         "\xf0\x90\x80\x80 \xf4\x8f\xbf\xbf\"]";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  struct json_value_s *again;
+  struct json_string_s *before;
+  struct json_string_s *after;
+  size_t size = 0;
+  size_t i;
+  char *out;
+
+  ASSERT_TRUE(value);
+
+  out = static_cast<char *>(json_write_minified_flags(
+      value, json_write_flags_ensure_ascii, json_null, json_null, &size));
+  ASSERT_TRUE(out);
+
+  for (i = 0; i < size - 1; i++) {
+    ASSERT_GT(0x80, static_cast<unsigned char>(out[i]));
+  }
+
+  again = json_parse(out, size - 1);
+  ASSERT_TRUE(again);
+
+  before = json_value_as_string(json_value_as_array(value)->start->value);
+  after = json_value_as_string(json_value_as_array(again)->start->value);
+  ASSERT_EQ(before->string_size, after->string_size);
+  ASSERT_EQ(0, memcmp(before->string, after->string, before->string_size));
+
+  free(again);
+  free(out);
+  free(value);
+}
+
+UTEST(write_ascii, invalid_utf8) {
+  /* a byte never in utf-8, a stray continuation byte, sequences cut short,
+   * overlong encodings, a surrogate, and a code point beyond U+10FFFF. */
+  const char *const strings[] = {
+      "\xff",         "\x80",         "\xc3",
+      "\xe2\x82",     "a\xc3(",       "\xc0\xaf",
+      "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80"};
+  size_t i;
+
+  for (i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+    struct json_string_s string = {strings[i], strlen(strings[i])};
+    struct json_value_s value = {&string, json_type_string};
+
+    ASSERT_FALSE(json_write_minified_flags(&value,
+                                           json_write_flags_ensure_ascii,
+                                           json_null, json_null, json_null));
+  }
+}
+
+UTEST(write_ascii, raw) {
+  const char raw[] = "{\"caf\xc3\xa9\":[\"\\\"\xe2\x82\xac\",1]}";
+  const char want[] = "[{\"caf\\u00e9\":[\"\\\"\\u20ac\",1]}]";
+  const char pretty[] = "[\n"
+                        "  {\"caf\\u00e9\":[\"\\\"\\u20ac\",1]}\n"
+                        "]";
+  struct json_raw_s payload = {raw, strlen(raw)};
+  struct json_value_s element_value = {&payload, json_type_raw};
+  struct json_array_element_s element = {&element_value, json_null};
+  struct json_array_s array = {&element, 1};
+  struct json_value_s value = {&array, json_type_array};
+  size_t size = 0;
+  void *out;
+
+  out = json_write_minified_flags(&value, json_write_flags_ensure_ascii,
+                                  json_null, json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(want) + 1, size);
+  ASSERT_STREQ(want, static_cast<const char *>(out));
+
+  free(out);
+
+  out = json_write_pretty_flags(&value, "  ", "\n",
+                                json_write_flags_ensure_ascii, json_null,
+                                json_null, &size);
+  ASSERT_TRUE(out);
+  ASSERT_EQ(strlen(pretty) + 1, size);
+  ASSERT_STREQ(pretty, static_cast<const char *>(out));
+
+  free(out);
+}
+
+UTEST(write_ascii, raw_outside_string) {
+  /* non-ASCII outside of a string, and invalid utf-8 inside one. */
+  const char *const raws[] = {"[1,\xc3\xa9]", "\"\xc3\""};
+  size_t i;
+
+  for (i = 0; i < sizeof(raws) / sizeof(raws[0]); i++) {
+    struct json_raw_s raw = {raws[i], strlen(raws[i])};
+    struct json_value_s value = {&raw, json_type_raw};
+
+    ASSERT_FALSE(json_write_minified_flags(&value,
+                                           json_write_flags_ensure_ascii,
+                                           json_null, json_null, json_null));
+    ASSERT_FALSE(json_write_pretty_flags(&value, "  ", "\n",
+                                         json_write_flags_ensure_ascii,
+                                         json_null, json_null, json_null));
+  }
+}
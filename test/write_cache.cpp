@@ -0,0 +1,174 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+
+static const char write_cache_payload[] =
+    "{\"a\" : [1, +2, .5, 3., \"str\\\"ing\\n\", true, false, null, {}, []],"
+    " \"b\" : {\"c\" : \"\\u00e9\", \"d\" : [[[]], {\"e\" : [{}]}]},"
+    " \"Infinity\" : -Infinity, \"NaN\" : NaN, \"hex\" : 0xdeadbeef}";
+
+struct write_cache_arena_s {
+  char data[4096];
+  size_t used;
+  size_t calls;
+};
+
+static void *write_cache_alloc(void *user_data, size_t size) {
+  struct write_cache_arena_s *const arena =
+      static_cast<struct write_cache_arena_s *>(user_data);
+  void *const result = arena->data + arena->used;
+
+  if (size > sizeof(arena->data) - arena->used) {
+    return 0;
+  }
+
+  // keep every allocation pointer aligned.
+  arena->used += (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+  arena->calls++;
+
+  return result;
+}
+
+UTEST(write_cache, matches_uncached) {
+  struct json_value_s *const value =
+      json_parse_ex(write_cache_payload, strlen(write_cache_payload),
+                    json_parse_flags_allow_json5, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  struct json_write_cache_s *const cache = json_write_cache_create(value, 0, 0);
+  ASSERT_TRUE(cache);
+
+  size_t expected_size = 0;
+  size_t size = 0;
+  void *expected = json_write_minified(value, &expected_size);
+  void *written = json_write_minified_cached(cache, value, 0, 0, &size);
+  ASSERT_TRUE(expected);
+  ASSERT_TRUE(written);
+  ASSERT_EQ(expected_size, size);
+  ASSERT_STREQ(static_cast<char *>(expected), static_cast<char *>(written));
+  free(written);
+  free(expected);
+
+  const char *const indents[] = {0, "", "\t", "    "};
+  const char *const newlines[] = {0, "", "\r\n", "\n\n\n"};
+  size_t i;
+
+  for (i = 0; i < sizeof(indents) / sizeof(indents[0]); i++) {
+    expected = json_write_pretty(value, indents[i], newlines[i], &expected_size);
+    written = json_write_pretty_cached(cache, value, indents[i], newlines[i], 0,
+                                       0, &size);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(written);
+    ASSERT_EQ(expected_size, size);
+    ASSERT_STREQ(static_cast<char *>(expected), static_cast<char *>(written));
+    free(written);
+    free(expected);
+  }
+
+  // every subtree is in the cache too.
+  const struct json_object_element_s *element;
+
+  for (element = json_value_as_object(value)->start; 0 != element;
+       element = element->next) {
+    expected = json_write_pretty(element->value, "\t", 0, &expected_size);
+    written =
+        json_write_pretty_cached(cache, element->value, "\t", 0, 0, 0, &size);
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(written);
+    ASSERT_EQ(expected_size, size);
+    ASSERT_STREQ(static_cast<char *>(expected), static_cast<char *>(written));
+    free(written);
+    free(expected);
+  }
+
+  free(cache);
+  free(value);
+}
+
+UTEST(write_cache, arena) {
+  const char payload[] = "[{\"a\" : true}, [null, \"b\"]]";
+  struct json_value_s *const value = json_parse(payload, strlen(payload));
+  struct write_cache_arena_s arena;
+
+  ASSERT_TRUE(value);
+
+  arena.used = 0;
+  arena.calls = 0;
+
+  struct json_write_cache_s *const cache =
+      json_write_cache_create(value, write_cache_alloc, &arena);
+  ASSERT_TRUE(cache);
+  ASSERT_EQ(1u, arena.calls);
+
+  size_t size = 0;
+  void *const written = json_write_minified_cached(cache, value,
+                                                   write_cache_alloc, &arena,
+                                                   &size);
+  ASSERT_TRUE(written);
+  ASSERT_EQ(2u, arena.calls);
+  ASSERT_EQ(strlen("[{\"a\":true},[null,\"b\"]]") + 1, size);
+  ASSERT_STREQ("[{\"a\":true},[null,\"b\"]]", static_cast<char *>(written));
+
+  free(value);
+}
+
+UTEST(write_cache, uncached_value) {
+  const char payload[] = "[1, 2]";
+  struct json_value_s *const value = json_parse(payload, strlen(payload));
+  struct json_value_s other = {0, json_type_false};
+
+  ASSERT_TRUE(value);
+
+  struct json_write_cache_s *const cache = json_write_cache_create(value, 0, 0);
+  ASSERT_TRUE(cache);
+
+  // values the cache doesn't know about (or no cache at all) still work.
+  size_t size = 0;
+  void *written = json_write_pretty_cached(cache, &other, 0, 0, 0, 0, &size);
+  ASSERT_TRUE(written);
+  ASSERT_EQ(6u, size);
+  ASSERT_STREQ("false", static_cast<char *>(written));
+  free(written);
+
+  written = json_write_minified_cached(0, value, 0, 0, &size);
+  ASSERT_TRUE(written);
+  ASSERT_STREQ("[1,2]", static_cast<char *>(written));
+  free(written);
+
+  free(cache);
+  free(value);
+}
+
+UTEST(write_cache, invalid) {
+  struct json_value_s value = {0, 42};
+  ASSERT_FALSE(json_write_cache_create(&value, 0, 0));
+  ASSERT_FALSE(json_write_cache_create(0, 0, 0));
+  ASSERT_FALSE(json_write_minified_cached(0, 0, 0, 0, 0));
+}
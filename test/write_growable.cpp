@@ -0,0 +1,131 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+static const char write_growable_payload[] =
+    "{\"a\" : [1, +2, .5, 3., \"str\\\"ing\\n\", true, false, null, {}, []],"
+    " \"b\" : {\"c\" : \"\\u00e9\", \"d\" : [[[]]]}, \"Infinity\" : -Infinity,"
+    " \"NaN\" : NaN, \"hex\" : 0xdeadbeef}";
+
+UTEST(write_growable, matches_minified) {
+  struct json_value_s *const value = json_parse_ex(
+      write_growable_payload, strlen(write_growable_payload),
+      json_parse_flags_allow_json5, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  size_t expected_size = 0;
+  void *const expected = json_write_minified(value, &expected_size);
+  ASSERT_TRUE(expected);
+
+  size_t size = 0;
+  void *const minified = json_write_minified_growable(value, 0, 0, &size);
+  ASSERT_TRUE(minified);
+  ASSERT_EQ(expected_size, size);
+  ASSERT_STREQ(static_cast<char *>(expected), static_cast<char *>(minified));
+
+  free(minified);
+  free(expected);
+  free(value);
+}
+
+struct write_growable_allocator_s {
+  size_t calls;
+  size_t largest;
+  int fail;
+};
+
+static void *write_growable_realloc(void *user_data, void *ptr, size_t size) {
+  struct write_growable_allocator_s *const allocator =
+      static_cast<struct write_growable_allocator_s *>(user_data);
+
+  if (0 == size) {
+    free(ptr);
+    return 0;
+  }
+
+  if (allocator->fail) {
+    return 0;
+  }
+
+  allocator->calls++;
+
+  if (size > allocator->largest) {
+    allocator->largest = size;
+  }
+
+  return realloc(ptr, size);
+}
+
+UTEST(write_growable, allocator) {
+  // a long array so that the buffer has to grow many times.
+  const size_t length = 10000;
+  struct json_value_s *values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * length));
+  struct json_array_element_s *elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * length));
+  struct json_array_s array = {elements, length};
+  struct json_value_s value = {&array, json_type_array};
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    values[i].payload = 0;
+    values[i].type = json_type_null;
+    elements[i].value = &values[i];
+    elements[i].next = (i + 1 < length) ? &elements[i + 1] : 0;
+  }
+
+  struct write_growable_allocator_s allocator = {0, 0, 0};
+  size_t size = 0;
+  void *const minified = json_write_minified_growable(
+      &value, write_growable_realloc, &allocator, &size);
+  ASSERT_TRUE(minified);
+
+  // "[null,null,...,null]" and the null terminator.
+  ASSERT_EQ(length * 5 + 2, size);
+  ASSERT_EQ(size - 1, strlen(static_cast<char *>(minified)));
+  ASSERT_LE(size, allocator.largest);
+
+  // geometric growth needs only a logarithmic number of reallocations.
+  ASSERT_LT(allocator.calls, 16);
+
+  write_growable_realloc(&allocator, minified, 0);
+
+  allocator.fail = 1;
+  ASSERT_FALSE(json_write_minified_growable(&value, write_growable_realloc,
+                                            &allocator, &size));
+
+  free(elements);
+  free(values);
+}
+
+UTEST(write_growable, invalid) {
+  struct json_value_s value = {0, 42};
+  ASSERT_FALSE(json_write_minified_growable(&value, 0, 0, 0));
+  ASSERT_FALSE(json_write_minified_growable(0, 0, 0, 0));
+}
@@ -310,3 +310,161 @@ UTEST(write_minified, array_null) {
 
   free(minified);
 }
+
+UTEST(write_minified, string_escapes) {
+  // escapes at every position of strings either side of a word in length.
+  const char specials[] = {'"', '\\', '\b', '\f', '\n', '\r', '\t', '\x1f',
+                           ' ', '\x7f', '\xc3'};
+  const char *const escaped[] = {"\\\"", "\\\\", "\\b", "\\f", "\\n", "\\r",
+                                 "\\t",  "\x1f", " ",   "\x7f", "\xc3"};
+  size_t length, position, special;
+
+  for (length = 1; length < 20; length++) {
+    for (position = 0; position < length; position++) {
+      for (special = 0; special < sizeof(specials); special++) {
+        char chars[20];
+        char expected[32];
+        size_t size = 0;
+
+        memset(chars, 'a', length);
+        chars[position] = specials[special];
+
+        memset(expected, 0, sizeof(expected));
+        expected[0] = '"';
+        memset(expected + 1, 'a', position);
+        strcat(expected, escaped[special]);
+        memset(expected + strlen(expected), 'a', length - position - 1);
+        strcat(expected, "\"");
+
+        struct json_string_s string = {chars, length};
+        struct json_value_s value = {&string, json_type_string};
+        void *minified = json_write_minified(&value, &size);
+
+        ASSERT_TRUE(minified);
+        ASSERT_EQ(strlen(expected) + 1, size);
+        ASSERT_STREQ(expected, static_cast<char *>(minified));
+
+        free(minified);
+      }
+    }
+  }
+}
+
+UTEST(write_minified, into) {
+  struct json_value_s sub_value = {0, json_type_true};
+  struct json_array_element_s element = {&sub_value, 0};
+  struct json_array_s array = {&element, 1};
+  struct json_value_s value = {&array, json_type_array};
+  char buffer[8];
+  size_t needed = 0;
+
+  ASSERT_NE(0, json_write_minified_into(&value, buffer, 6, &needed));
+  ASSERT_EQ(7, needed);
+
+  ASSERT_EQ(0, json_write_minified_into(&value, buffer, sizeof(buffer),
+                                        &needed));
+  ASSERT_EQ(7, needed);
+  ASSERT_STREQ("[true]", buffer);
+
+  // just sizing the output.
+  ASSERT_NE(0, json_write_minified_into(&value, 0, 0, &needed));
+  ASSERT_EQ(7, needed);
+
+  sub_value.type = 42;
+  ASSERT_NE(0, json_write_minified_into(&value, buffer, sizeof(buffer),
+                                        &needed));
+  ASSERT_EQ(0, needed);
+}
+
+UTEST(write_minified, into_deep) {
+  const size_t depth = JSON_WRITE_STACK_SIZE;
+  char payload[2 * (JSON_WRITE_STACK_SIZE + 1) + 1];
+  char buffer[sizeof(payload) + 1];
+  size_t needed = 0;
+
+  // as deep as the stack on the C stack goes.
+  memset(payload, '[', depth);
+  payload[depth] = '1';
+  memset(payload + depth + 1, ']', depth);
+  struct json_value_s *value = json_parse(payload, 2 * depth + 1);
+  ASSERT_TRUE(value);
+
+  ASSERT_EQ(0, json_write_minified_into(value, buffer, sizeof(buffer),
+                                        &needed));
+  ASSERT_EQ(2 * depth + 2, needed);
+  free(value);
+
+  // one level deeper is an error, as the stack can't grow without allocating.
+  memset(payload, '[', depth + 1);
+  payload[depth + 1] = '1';
+  memset(payload + depth + 2, ']', depth + 1);
+  value = json_parse(payload, 2 * depth + 3);
+  ASSERT_TRUE(value);
+
+  ASSERT_NE(0, json_write_minified_into(value, buffer, sizeof(buffer),
+                                        &needed));
+  ASSERT_EQ(0, needed);
+  free(value);
+}
+
+UTEST(write_minified, deep) {
+  // values nested far deeper than the parser allows are written without
+  // recursing, alternating between arrays and objects.
+  const size_t depth = 100000;
+  struct json_value_s *const values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * (depth + 1)));
+  struct json_array_element_s *const array_elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * depth));
+  struct json_object_element_s *const object_elements =
+      static_cast<struct json_object_element_s *>(
+          malloc(sizeof(struct json_object_element_s) * depth));
+  struct json_array_s *const arrays = static_cast<struct json_array_s *>(
+      malloc(sizeof(struct json_array_s) * depth));
+  struct json_object_s *const objects = static_cast<struct json_object_s *>(
+      malloc(sizeof(struct json_object_s) * depth));
+  struct json_string_s name = {"a", 1};
+  size_t i;
+
+  for (i = 0; i < depth; i++) {
+    if (0 == i % 2) {
+      array_elements[i].value = &values[i + 1];
+      array_elements[i].next = 0;
+      arrays[i].start = &array_elements[i];
+      arrays[i].length = 1;
+      values[i].payload = &arrays[i];
+      values[i].type = json_type_array;
+    } else {
+      object_elements[i].name = &name;
+      object_elements[i].value = &values[i + 1];
+      object_elements[i].next = 0;
+      objects[i].start = &object_elements[i];
+      objects[i].length = 1;
+      values[i].payload = &objects[i];
+      values[i].type = json_type_object;
+    }
+  }
+
+  values[depth].payload = 0;
+  values[depth].type = json_type_true;
+
+  size_t size = 0;
+  char *const minified =
+      static_cast<char *>(json_write_minified(&values[0], &size));
+  ASSERT_TRUE(minified);
+  ASSERT_EQ(depth / 2 * 8 + 4 + 1, size);
+
+  for (i = 0; i < depth / 2; i++) {
+    ASSERT_EQ(0, memcmp(minified + i * 6, "[{\"a\":", 6));
+    ASSERT_EQ(0, memcmp(minified + depth / 2 * 6 + 4 + i * 2, "}]", 2));
+  }
+
+  ASSERT_EQ(0, memcmp(minified + depth / 2 * 6, "true", 4));
+
+  free(minified);
+  free(objects);
+  free(arrays);
+  free(object_elements);
+  free(array_elements);
+  free(values);
+}
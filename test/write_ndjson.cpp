@@ -0,0 +1,171 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+UTEST(write_ndjson, array) {
+  const char payload[] = "[{\"a\" : [1, 2]}, \"x\\ny\", 3, [], null]";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_TRUE(value);
+  ASSERT_EQ(0, json_write_ndjson_to(value, write_sink, &sink));
+  ASSERT_EQ(1u, sink.calls);
+  ASSERT_STREQ("{\"a\":[1,2]}\n\"x\\ny\"\n3\n[]\nnull\n", sink.data);
+
+  free(sink.data);
+  free(value);
+}
+
+UTEST(write_ndjson, empty_array) {
+  struct json_value_s *value = json_parse("[]", 2);
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_TRUE(value);
+  ASSERT_EQ(0, json_write_ndjson_to(value, write_sink, &sink));
+  ASSERT_EQ(0u, sink.calls);
+  ASSERT_EQ(0u, sink.size);
+
+  free(value);
+}
+
+UTEST(write_ndjson, not_array) {
+  struct json_value_s *value = json_parse("{\"a\" : 1}", 9);
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_TRUE(value);
+  ASSERT_NE(0, json_write_ndjson_to(value, write_sink, &sink));
+  ASSERT_NE(0, json_write_ndjson_to(json_null, write_sink, &sink));
+  ASSERT_NE(0, json_write_ndjson_to(value, json_null, &sink));
+  ASSERT_EQ(0u, sink.calls);
+
+  free(value);
+}
+
+UTEST(write_ndjson, values) {
+  struct json_value_s *a = json_parse("{ \"id\" : 1 }", 12);
+  struct json_value_s *b = json_parse("[true, false]", 13);
+  const struct json_value_s *values[3];
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  ASSERT_TRUE(a);
+  ASSERT_TRUE(b);
+
+  values[0] = a;
+  values[1] = b;
+  values[2] = a;
+
+  ASSERT_EQ(0,
+            json_write_ndjson_values_to(values, 3, write_sink, &sink));
+  ASSERT_STREQ("{\"id\":1}\n[true,false]\n{\"id\":1}\n", sink.data);
+
+  free(sink.data);
+
+  values[1] = json_null;
+  ASSERT_NE(0,
+            json_write_ndjson_values_to(values, 3, write_sink, &sink));
+
+  free(b);
+  free(a);
+}
+
+UTEST(write_ndjson, many_lines) {
+  const size_t count = 20000;
+  const char line[] = "{\"id\":12345,\"name\":\"record\"}\n";
+  const size_t line_size = strlen(line);
+  char *payload = static_cast<char *>(malloc(count * line_size + 2));
+  struct json_value_s *value;
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  size_t i;
+
+  ASSERT_TRUE(payload);
+
+  /* turn the lines into an array to parse. */
+  payload[0] = '[';
+  for (i = 0; i < count; i++) {
+    memcpy(payload + 1 + i * line_size, line, line_size);
+    payload[i * line_size + line_size] = ',';
+  }
+  payload[count * line_size] = ']';
+
+  value = json_parse(payload, count * line_size + 1);
+  ASSERT_TRUE(value);
+
+  ASSERT_EQ(0, json_write_ndjson_to(value, write_sink, &sink));
+  ASSERT_LT(1u, sink.calls);
+  ASSERT_GE(static_cast<size_t>(JSON_WRITE_STAGING_SIZE), sink.largest);
+  ASSERT_EQ(count * line_size, sink.size);
+
+  for (i = 0; i < count; i++) {
+    ASSERT_EQ(0, memcmp(line, sink.data + i * line_size, line_size));
+  }
+
+  free(sink.data);
+  free(value);
+  free(payload);
+}
+
+UTEST(write_ndjson, raw) {
+  const char outer[] = "[1,\n 2]";
+  const char inner[] = "{\r\n\"a\" : \"x\\ny\"\r\n}";
+  struct json_raw_s outer_raw = {outer, strlen(outer)};
+  struct json_raw_s inner_raw = {inner, strlen(inner)};
+  struct json_value_s outer_value = {&outer_raw, json_type_raw};
+  struct json_value_s inner_value = {&inner_raw, json_type_raw};
+  struct json_string_s name = {"r", 1};
+  struct json_object_element_s object_element = {&name, &inner_value,
+                                                 json_null};
+  struct json_object_s object = {&object_element, 1};
+  struct json_value_s object_value = {&object, json_type_object};
+  struct json_array_element_s second = {&object_value, json_null};
+  struct json_array_element_s first = {&outer_value, &second};
+  struct json_array_s array = {&first, 2};
+  struct json_value_s value = {&array, json_type_array};
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+
+  /* the line breaks in the raw values would otherwise split the lines. */
+  ASSERT_EQ(0, json_write_ndjson_to(&value, write_sink, &sink));
+  ASSERT_STREQ("[1,  2]\n{\"r\":{  \"a\" : \"x\\ny\"  }}\n", sink.data);
+
+  free(sink.data);
+}
+
+UTEST(write_ndjson, write_fails) {
+  const char payload[] = "[1, 2, 3]";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  struct write_sink_s sink = {0, 0, 0, 0, 1};
+
+  ASSERT_TRUE(value);
+  ASSERT_NE(0, json_write_ndjson_to(value, write_sink, &sink));
+  ASSERT_EQ(1u, sink.calls);
+
+  free(value);
+}
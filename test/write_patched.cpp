@@ -0,0 +1,149 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+
+struct write_patched_dirty_s {
+  const struct json_value_s *values[5];
+  size_t size;
+  size_t calls;
+};
+
+static int write_patched_is_dirty(void *user_data,
+                                  const struct json_value_s *value) {
+  struct write_patched_dirty_s *const dirty =
+      static_cast<struct write_patched_dirty_s *>(user_data);
+  size_t i;
+
+  dirty->calls++;
+
+  for (i = 0; i < dirty->size; i++) {
+    if (value == dirty->values[i]) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static const size_t write_patched_flags =
+    json_parse_flags_allow_location_information |
+    json_parse_flags_allow_json5;
+
+UTEST(write_patched, clean) {
+  const char payload[] = "  {\"a\" : [1, 2,   3], // a comment\n"
+                         " \"b\" : {\"c\" : 'x'}}  ";
+  struct json_value_s *const value = json_parse_ex(
+      payload, strlen(payload), write_patched_flags, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  // nothing changed, so the root is copied as is.
+  struct write_patched_dirty_s dirty = {{0, 0, 0, 0, 0}, 0, 0};
+  size_t size = 0;
+  char *const output = static_cast<char *>(
+      json_write_patched(value, payload, strlen(payload), write_patched_flags,
+                         write_patched_is_dirty, &dirty, &size));
+  ASSERT_TRUE(output);
+  ASSERT_STREQ("{\"a\" : [1, 2,   3], // a comment\n \"b\" : {\"c\" : 'x'}}",
+               output);
+  ASSERT_EQ(strlen(output) + 1, size);
+  ASSERT_EQ(1u, dirty.calls);
+
+  free(output);
+  free(value);
+}
+
+UTEST(write_patched, dirty) {
+  const char payload[] = "{\"a\" : [1, 2,   3], \"b\" : {\"c\" : 'x'},"
+                         " \"d\" : true, \"e\" : [ {\"f\" : null} ]}";
+  struct json_value_s *const value = json_parse_ex(
+      payload, strlen(payload), write_patched_flags, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  struct json_object_s *const object = json_value_as_object(value);
+  ASSERT_TRUE(object);
+
+  // change "d" to false, and "f" to a new string.
+  struct json_object_element_s *const d = object->start->next->next;
+  struct json_value_s *const e = d->next->value;
+  struct json_value_s *const f_object =
+      json_value_as_array(e)->start->value;
+  struct json_string_s string = {"new", 3};
+  struct json_value_s f = {&string, json_type_string};
+
+  d->value->type = json_type_false;
+  json_value_as_object(f_object)->start->value = &f;
+
+  // every changed or created value, and every value containing one, is dirty.
+  struct write_patched_dirty_s dirty = {{value, d->value, e, f_object, &f},
+                                        5, 0};
+  char *const output = static_cast<char *>(
+      json_write_patched(value, payload, strlen(payload), write_patched_flags,
+                         write_patched_is_dirty, &dirty, 0));
+  ASSERT_TRUE(output);
+  ASSERT_STREQ("{\"a\":[1, 2,   3],\"b\":{\"c\" : 'x'},\"d\":false,"
+               "\"e\":[{\"f\":\"new\"}]}",
+               output);
+
+  free(output);
+  free(value);
+}
+
+UTEST(write_patched, global_object) {
+  const char payload[] = "a = 1, b = [2,  3]";
+  const size_t flags = write_patched_flags |
+                       json_parse_flags_allow_global_object |
+                       json_parse_flags_allow_equals_in_object;
+  struct json_value_s *const value =
+      json_parse_ex(payload, strlen(payload), flags, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  // the root has no braces to copy, so it is written out afresh.
+  struct write_patched_dirty_s dirty = {{0, 0, 0, 0, 0}, 0, 0};
+  char *const output = static_cast<char *>(json_write_patched(
+      value, payload, strlen(payload), flags, write_patched_is_dirty, &dirty,
+      0));
+  ASSERT_TRUE(output);
+  ASSERT_STREQ("{\"a\":1,\"b\":[2,  3]}", output);
+
+  free(output);
+  free(value);
+}
+
+UTEST(write_patched, needs_location_information) {
+  const char payload[] = "[1]";
+  struct json_value_s *const value = json_parse(payload, strlen(payload));
+  ASSERT_TRUE(value);
+
+  struct write_patched_dirty_s dirty = {{0, 0, 0, 0, 0}, 0, 0};
+  ASSERT_FALSE(json_write_patched(value, payload, strlen(payload), 0,
+                                  write_patched_is_dirty, &dirty, 0));
+  ASSERT_EQ(0u, dirty.calls);
+
+  free(value);
+}
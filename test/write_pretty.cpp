@@ -319,3 +319,211 @@ UTEST(write_pretty, array_null) {
 
   free(pretty);
 }
+
+UTEST(write_pretty, into) {
+  struct json_value_s sub_value = {0, json_type_null};
+  struct json_array_element_s element = {&sub_value, 0};
+  struct json_array_s array = {&element, 1};
+  struct json_value_s value = {&array, json_type_array};
+  char buffer[16];
+  size_t needed = 0;
+
+  ASSERT_NE(0, json_write_pretty_into(&value, 0, 0, buffer, 4, &needed));
+  ASSERT_EQ(strlen("[\n  null\n]") + 1, needed);
+
+  ASSERT_EQ(0, json_write_pretty_into(&value, 0, 0, buffer, needed, 0));
+  ASSERT_STREQ("[\n"
+               "  null\n"
+               "]",
+               buffer);
+}
+
+UTEST(write_pretty, long_lines) {
+  // lines longer than JSON_WRITE_INDENT_SIZE are written in pieces, whether
+  // the indent fits in it many times, once, or not at all.
+  const size_t indent_sizes[] = {8, JSON_WRITE_INDENT_SIZE - 1,
+                                 JSON_WRITE_INDENT_SIZE + 1};
+  const size_t depth = 40;
+  const char payload[] =
+      "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[null]]]]]]]]]]]]]]]]]]]]]]]]]]]"
+      "]]]]]]]]]]]]]";
+  struct json_value_s *const value = json_parse(payload, strlen(payload));
+  size_t i;
+  size_t k;
+
+  ASSERT_TRUE(value);
+
+  for (i = 0; i < sizeof(indent_sizes) / sizeof(indent_sizes[0]); i++) {
+    char *const indent = static_cast<char *>(malloc(indent_sizes[i] + 1));
+    memset(indent, ' ', indent_sizes[i]);
+    indent[indent_sizes[i]] = '\0';
+
+    // one line per bracket and one for the null, each indented by its depth.
+    size_t expected_size = 2 * depth + 4 + 2 * depth * strlen("\n") + 1;
+
+    for (k = 0; k < depth; k++) {
+      expected_size += 2 * k * indent_sizes[i];
+    }
+
+    expected_size += depth * indent_sizes[i];
+
+    size_t needed = 0;
+    ASSERT_NE(0, json_write_pretty_into(value, indent, 0, 0, 0, &needed));
+    ASSERT_EQ(expected_size, needed);
+
+    char *const pretty = static_cast<char *>(malloc(needed));
+    ASSERT_EQ(0, json_write_pretty_into(value, indent, 0, pretty, needed, 0));
+
+    char *line = pretty;
+
+    for (k = 0; k <= 2 * depth; k++) {
+      const size_t line_depth = (k <= depth) ? k : 2 * depth - k;
+      const char *const token = (k < depth) ? "[" : (k == depth) ? "null" : "]";
+
+      if (0 != k) {
+        ASSERT_EQ('\n', *line++);
+      }
+
+      ASSERT_EQ(line_depth * indent_sizes[i], strspn(line, " "));
+      line += line_depth * indent_sizes[i];
+      ASSERT_EQ(0, strncmp(line, token, strlen(token)));
+      line += strlen(token);
+    }
+
+    ASSERT_EQ('\0', *line);
+
+    free(pretty);
+    free(indent);
+  }
+
+  free(value);
+}
+
+UTEST(write_pretty, deep) {
+  // values nested far deeper than the parser allows are written without
+  // recursing.
+  const size_t depth = 100000;
+  struct json_value_s *const values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * (depth + 1)));
+  struct json_array_element_s *const elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * depth));
+  struct json_array_s *const arrays = static_cast<struct json_array_s *>(
+      malloc(sizeof(struct json_array_s) * depth));
+  size_t i;
+
+  for (i = 0; i < depth; i++) {
+    elements[i].value = &values[i + 1];
+    elements[i].next = 0;
+    arrays[i].start = &elements[i];
+    arrays[i].length = 1;
+    values[i].payload = &arrays[i];
+    values[i].type = json_type_array;
+  }
+
+  values[depth].payload = 0;
+  values[depth].type = json_type_null;
+
+  // each level opens with "[\n" and closes with "\n]" (without an indent, or
+  // the output would be gigabytes).
+  size_t size = 0;
+  char *const pretty =
+      static_cast<char *>(json_write_pretty(&values[0], "", "\n", &size));
+  ASSERT_TRUE(pretty);
+  ASSERT_EQ(4 * depth + 4 + 1, size);
+
+  for (i = 0; i < depth; i++) {
+    ASSERT_EQ(0, memcmp(pretty + i * 2, "[\n", 2));
+    ASSERT_EQ(0, memcmp(pretty + depth * 2 + 4 + i * 2, "\n]", 2));
+  }
+
+  ASSERT_EQ(0, memcmp(pretty + depth * 2, "null", 4));
+
+  free(pretty);
+  free(arrays);
+  free(elements);
+  free(values);
+}
+
+UTEST(write_pretty, inline_scalar_arrays) {
+  const char payload[] = "{\"a\" : [1, \"b\", true, null], \"c\" : [[2], [], "
+                         "{\"d\" : [false]}]}";
+  struct json_value_s *value = json_parse(payload, strlen(payload));
+  size_t size = 0;
+  void *pretty;
+
+  ASSERT_TRUE(value);
+
+  pretty = json_write_pretty_flags(value, 0, 0,
+                                   json_write_flags_inline_scalar_arrays, 0, 0,
+                                   &size);
+
+  ASSERT_TRUE(pretty);
+  ASSERT_EQ(strlen(static_cast<char *>(pretty)) + 1, size);
+  ASSERT_STREQ("{\n"
+               "  \"a\" : [1, \"b\", true, null],\n"
+               "  \"c\" : [\n"
+               "    [2],\n"
+               "    [],\n"
+               "    {\n"
+               "      \"d\" : [false]\n"
+               "    }\n"
+               "  ]\n"
+               "}",
+               static_cast<char *>(pretty));
+
+  free(pretty);
+  free(value);
+}
+
+UTEST(write_pretty, wide_indent) {
+  // enough nesting that the indentation no longer fits on the C stack.
+  const size_t depth = 100;
+  char payload[2 * depth + 1];
+  char expected[2 * depth + 1 + 2 * 2 * depth + 4 * depth * depth + 1];
+  char *write = expected;
+  size_t i, k;
+
+  for (i = 0; i < depth; i++) {
+    payload[i] = '[';
+    payload[depth + 1 + i] = ']';
+
+    memcpy(write, "[\r\n", 3);
+    write += 3;
+
+    for (k = 0; k <= i; k++) {
+      memcpy(write, "\t\t\t\t", 4);
+      write += 4;
+    }
+  }
+
+  payload[depth] = '0';
+  *write++ = '0';
+
+  for (i = depth; i-- > 0;) {
+    memcpy(write, "\r\n", 2);
+    write += 2;
+
+    for (k = 0; k < i; k++) {
+      memcpy(write, "\t\t\t\t", 4);
+      write += 4;
+    }
+
+    *write++ = ']';
+  }
+
+  *write = '\0';
+
+  struct json_value_s *value = json_parse(payload, sizeof(payload));
+  ASSERT_TRUE(value);
+
+  size_t size = 0;
+  void *pretty = json_write_pretty(value, "\t\t\t\t", "\r\n", &size);
+
+  ASSERT_TRUE(pretty);
+  ASSERT_EQ(strlen(expected) + 1, size);
+  ASSERT_STREQ(expected, static_cast<char *>(pretty));
+
+  free(pretty);
+  free(value);
+}
@@ -0,0 +1,146 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <stdlib.h>
+
+struct write_raw_fixture {
+  struct json_raw_s raw;
+  struct json_value_s raw_value;
+  struct json_string_s name;
+  struct json_object_element_s element;
+  struct json_object_s object;
+  struct json_value_s value;
+};
+
+UTEST_F_SETUP(write_raw_fixture) {
+  static const char fragment[] = "[1, {\"b\":null}]";
+
+  utest_fixture->raw.raw = fragment;
+  utest_fixture->raw.raw_size = strlen(fragment);
+  utest_fixture->raw_value.payload = &utest_fixture->raw;
+  utest_fixture->raw_value.type = json_type_raw;
+  utest_fixture->name.string = "a";
+  utest_fixture->name.string_size = 1;
+  utest_fixture->element.name = &utest_fixture->name;
+  utest_fixture->element.value = &utest_fixture->raw_value;
+  utest_fixture->element.next = 0;
+  utest_fixture->object.start = &utest_fixture->element;
+  utest_fixture->object.length = 1;
+  utest_fixture->value.payload = &utest_fixture->object;
+  utest_fixture->value.type = json_type_object;
+
+  ASSERT_EQ(&utest_fixture->raw, json_value_as_raw(&utest_fixture->raw_value));
+  ASSERT_FALSE(json_value_as_raw(&utest_fixture->value));
+}
+
+UTEST_F_TEARDOWN(write_raw_fixture) { (void)utest_fixture; }
+
+static const char write_raw_minified[] = "{\"a\":[1, {\"b\":null}]}";
+static const char write_raw_pretty[] = "{\n  \"a\" : [1, {\"b\":null}]\n}";
+
+UTEST_F(write_raw_fixture, minified) {
+  size_t size = 0;
+  void *const minified = json_write_minified(&utest_fixture->value, &size);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ(write_raw_minified, static_cast<char *>(minified));
+  ASSERT_EQ(sizeof(write_raw_minified), size);
+  free(minified);
+
+  void *const growable =
+      json_write_minified_growable(&utest_fixture->value, 0, 0, 0);
+  ASSERT_TRUE(growable);
+  ASSERT_STREQ(write_raw_minified, static_cast<char *>(growable));
+  free(growable);
+
+  char buffer[64];
+  size_t needed = 0;
+  ASSERT_EQ(0, json_write_minified_into(&utest_fixture->value, buffer,
+                                        sizeof(buffer), &needed));
+  ASSERT_STREQ(write_raw_minified, buffer);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0,
+            json_write_minified_to(&utest_fixture->value, write_sink, &sink));
+  ASSERT_STREQ(write_raw_minified, sink.data);
+  free(sink.data);
+}
+
+UTEST_F(write_raw_fixture, pretty) {
+  // the raw JSON text is copied as is, rather than being made pretty.
+  size_t size = 0;
+  void *const pretty = json_write_pretty(&utest_fixture->value, 0, 0, &size);
+  ASSERT_TRUE(pretty);
+  ASSERT_STREQ(write_raw_pretty, static_cast<char *>(pretty));
+  ASSERT_EQ(sizeof(write_raw_pretty), size);
+  free(pretty);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_pretty_to(&utest_fixture->value, 0, 0, write_sink,
+                                    &sink));
+  ASSERT_STREQ(write_raw_pretty, sink.data);
+  free(sink.data);
+}
+
+UTEST_F(write_raw_fixture, cached) {
+  struct json_write_cache_s *const cache =
+      json_write_cache_create(&utest_fixture->value, 0, 0);
+  ASSERT_TRUE(cache);
+
+  void *const minified =
+      json_write_minified_cached(cache, &utest_fixture->value, 0, 0, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ(write_raw_minified, static_cast<char *>(minified));
+  free(minified);
+
+  void *const pretty =
+      json_write_pretty_cached(cache, &utest_fixture->value, 0, 0, 0, 0, 0);
+  ASSERT_TRUE(pretty);
+  ASSERT_STREQ(write_raw_pretty, static_cast<char *>(pretty));
+  free(pretty);
+
+  free(cache);
+}
+
+UTEST_F(write_raw_fixture, extract) {
+  struct json_value_s *const extracted =
+      json_extract_value(&utest_fixture->value);
+  ASSERT_TRUE(extracted);
+
+  struct json_raw_s *const raw = json_value_as_raw(
+      json_value_as_object(extracted)->start->value);
+  ASSERT_TRUE(raw);
+  ASSERT_NE(utest_fixture->raw.raw, raw->raw);
+
+  void *const minified = json_write_minified(extracted, 0);
+  ASSERT_TRUE(minified);
+  ASSERT_STREQ(write_raw_minified, static_cast<char *>(minified));
+  free(minified);
+
+  free(extracted);
+}
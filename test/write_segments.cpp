@@ -0,0 +1,238 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+
+struct write_segments_sink_s {
+  char *data;
+  size_t size;
+  size_t calls;
+  size_t segments;
+  size_t most_segments;
+  size_t fail_after;
+  const char *start;
+  const char *end;
+  size_t referenced;
+};
+
+static int write_segments_sink(void *user_data,
+                               const struct json_write_segment_s *segments,
+                               size_t count) {
+  struct write_segments_sink_s *const sink =
+      static_cast<struct write_segments_sink_s *>(user_data);
+  size_t i;
+
+  if (sink->calls++ == sink->fail_after) {
+    return 1;
+  }
+
+  if (count > sink->most_segments) {
+    sink->most_segments = count;
+  }
+
+  for (i = 0; i < count; i++) {
+    const char *const data = static_cast<const char *>(segments[i].data);
+    const size_t size = segments[i].size;
+
+    if ((sink->start <= data) && (data + size <= sink->end)) {
+      // the segment points straight into the DOM.
+      sink->referenced += size;
+    }
+
+    sink->data =
+        static_cast<char *>(realloc(sink->data, sink->size + size + 1));
+    memcpy(sink->data + sink->size, data, size);
+    sink->size += size;
+    sink->data[sink->size] = '\0';
+    sink->segments++;
+  }
+
+  return 0;
+}
+
+static struct write_segments_sink_s write_segments_sink_init(const char *start,
+                                                             size_t size) {
+  struct write_segments_sink_s sink = {
+      0, 0, 0, 0, 0, ~static_cast<size_t>(0), start, start + size, 0};
+  return sink;
+}
+
+UTEST(write_segments, small) {
+  const char payload[] = "{\"a\" : [1, +2, .5, \"str\\\"ing\\n\", true, null],"
+                         " \"b\" : {\"c\" : \"\\u00e9\", \"d\" : [[[]]]}}";
+  struct json_value_s *const value = json_parse_ex(
+      payload, strlen(payload), json_parse_flags_allow_json5, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  void *const minified = json_write_minified(value, 0);
+  ASSERT_TRUE(minified);
+
+  // short strings are staged, so everything comes out in a single segment.
+  struct write_segments_sink_s sink = write_segments_sink_init(0, 0);
+  ASSERT_EQ(0, json_write_minified_segments(value, write_segments_sink, &sink));
+  ASSERT_EQ(1u, sink.calls);
+  ASSERT_EQ(1u, sink.segments);
+  ASSERT_STREQ(static_cast<char *>(minified), sink.data);
+
+  void *const pretty = json_write_pretty(value, "\t", "\r\n", 0);
+  ASSERT_TRUE(pretty);
+
+  struct write_segments_sink_s pretty_sink = write_segments_sink_init(0, 0);
+  ASSERT_EQ(0, json_write_pretty_segments(value, "\t", "\r\n",
+                                          write_segments_sink, &pretty_sink));
+  ASSERT_STREQ(static_cast<char *>(pretty), pretty_sink.data);
+
+  free(pretty_sink.data);
+  free(pretty);
+  free(sink.data);
+  free(minified);
+  free(value);
+}
+
+UTEST(write_segments, references_strings) {
+  // long runs that need no escaping are pointed at rather than copied.
+  const size_t length = JSON_WRITE_SEGMENT_REFERENCE_SIZE * 4;
+  char *const chars = static_cast<char *>(malloc(length));
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    chars[i] = static_cast<char>('a' + i % 26);
+  }
+
+  // an escape in the middle splits the string into two runs, and a short run
+  // at the end is copied.
+  chars[length / 2] = '"';
+  chars[length - 3] = '\n';
+
+  struct json_string_s string = {chars, length};
+  struct json_value_s string_value = {&string, json_type_string};
+  struct json_object_element_s element = {&string, &string_value, 0};
+  struct json_object_s object = {&element, 1};
+  struct json_value_s value = {&object, json_type_object};
+
+  void *const expected = json_write_minified(&value, 0);
+  ASSERT_TRUE(expected);
+
+  struct write_segments_sink_s sink = write_segments_sink_init(chars, length);
+  ASSERT_EQ(0,
+            json_write_minified_segments(&value, write_segments_sink, &sink));
+  ASSERT_STREQ(static_cast<char *>(expected), sink.data);
+  ASSERT_EQ(2 * (length - 4), sink.referenced);
+
+  free(sink.data);
+  free(expected);
+
+  void *const pretty = json_write_pretty(&value, 0, 0, 0);
+  ASSERT_TRUE(pretty);
+
+  struct write_segments_sink_s pretty_sink =
+      write_segments_sink_init(chars, length);
+  ASSERT_EQ(0, json_write_pretty_segments(&value, 0, 0, write_segments_sink,
+                                          &pretty_sink));
+  ASSERT_STREQ(static_cast<char *>(pretty), pretty_sink.data);
+  ASSERT_EQ(2 * (length - 4), pretty_sink.referenced);
+
+  free(pretty_sink.data);
+  free(pretty);
+  free(chars);
+}
+
+UTEST(write_segments, many_segments) {
+  // more strings than fit in the segments are handed on in batches, and
+  // numbers too big to stage are pointed at.
+  const size_t length = JSON_WRITE_SEGMENTS_SIZE * 3;
+  const size_t string_size = JSON_WRITE_SEGMENT_REFERENCE_SIZE;
+  const size_t number_size = JSON_WRITE_STAGING_SIZE + 1;
+  char *const chars = static_cast<char *>(malloc(string_size));
+  char *const digits = static_cast<char *>(malloc(number_size));
+  struct json_value_s *const values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * (length + 1)));
+  struct json_array_element_s *const elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * (length + 1)));
+  struct json_string_s string = {chars, string_size};
+  struct json_number_s number = {digits, number_size};
+  struct json_array_s array = {elements, length + 1};
+  struct json_value_s value = {&array, json_type_array};
+  size_t i;
+
+  memset(chars, 'x', string_size);
+  memset(digits, '7', number_size);
+
+  for (i = 0; i < length; i++) {
+    values[i].payload = &string;
+    values[i].type = json_type_string;
+    elements[i].value = &values[i];
+    elements[i].next = &elements[i + 1];
+  }
+
+  values[length].payload = &number;
+  values[length].type = json_type_number;
+  elements[length].value = &values[length];
+  elements[length].next = 0;
+
+  size_t expected_size = 0;
+  void *const expected = json_write_minified(&value, &expected_size);
+  ASSERT_TRUE(expected);
+
+  struct write_segments_sink_s sink =
+      write_segments_sink_init(chars, string_size);
+  ASSERT_EQ(0,
+            json_write_minified_segments(&value, write_segments_sink, &sink));
+  ASSERT_EQ(expected_size - 1, sink.size);
+  ASSERT_STREQ(static_cast<char *>(expected), sink.data);
+  ASSERT_EQ(length * string_size, sink.referenced);
+  ASSERT_LT(1u, sink.calls);
+  ASSERT_EQ(static_cast<size_t>(JSON_WRITE_SEGMENTS_SIZE), sink.most_segments);
+
+  free(sink.data);
+  free(expected);
+
+  // a failing write stops the writer.
+  struct write_segments_sink_s failing = write_segments_sink_init(0, 0);
+  failing.fail_after = 1;
+  ASSERT_NE(0, json_write_minified_segments(&value, write_segments_sink,
+                                            &failing));
+  ASSERT_EQ(2u, failing.calls);
+
+  free(failing.data);
+  free(elements);
+  free(values);
+  free(digits);
+  free(chars);
+}
+
+UTEST(write_segments, bad_arguments) {
+  struct json_value_s value = {0, json_type_null};
+  struct write_segments_sink_s sink = write_segments_sink_init(0, 0);
+
+  ASSERT_NE(0, json_write_minified_segments(0, write_segments_sink, &sink));
+  ASSERT_NE(0, json_write_minified_segments(&value, 0, &sink));
+  ASSERT_NE(0, json_write_pretty_segments(0, 0, 0, write_segments_sink, &sink));
+  ASSERT_EQ(0u, sink.calls);
+}
@@ -0,0 +1,66 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#ifndef SHEREDOM_JSON_TEST_WRITE_SINK_H_INCLUDED
+#define SHEREDOM_JSON_TEST_WRITE_SINK_H_INCLUDED
+
+#include <stdlib.h>
+#include <string.h>
+
+// a write_func_ptr that gathers everything written to it into a null
+// terminated string in data (which the test frees).
+struct write_sink_s {
+  char *data;
+  size_t size;
+
+  // the number of calls made, and the most bytes any one call wrote.
+  size_t calls;
+  size_t largest;
+
+  // the call (counting from 1) that fails, or 0 if none do.
+  size_t fail_at;
+};
+
+static int write_sink(void *user_data, const void *data, size_t size) {
+  struct write_sink_s *const sink =
+      static_cast<struct write_sink_s *>(user_data);
+
+  if (++sink->calls == sink->fail_at) {
+    return 1;
+  }
+
+  if (size > sink->largest) {
+    sink->largest = size;
+  }
+
+  sink->data = static_cast<char *>(realloc(sink->data, sink->size + size + 1));
+  memcpy(sink->data + sink->size, data, size);
+  sink->size += size;
+  sink->data[sink->size] = '\0';
+
+  return 0;
+}
+
+#endif
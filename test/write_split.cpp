@@ -0,0 +1,121 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+
+#include <stdlib.h>
+
+static const char *const write_split_payloads[] = {
+    "[1, \"two\", {\"three\" : [3]}, [], null, true, false, 0.5, \"\\n\"]",
+    "{\"a\" : 1, \"b\" : [2, 3], \"c\" : {\"d\" : \"e\"}, \"f\" : null}",
+    "[]",
+    "{}",
+    "[[1, 2, 3]]",
+    "\"just a string\"",
+    "42"};
+
+UTEST(write_split, matches_minified) {
+  size_t payload;
+
+  for (payload = 0;
+       payload < sizeof(write_split_payloads) / sizeof(write_split_payloads[0]);
+       payload++) {
+    const char *const json = write_split_payloads[payload];
+    struct json_value_s *const value = json_parse(json, strlen(json));
+    ASSERT_TRUE(value);
+
+    size_t expected_size = 0;
+    void *const expected = json_write_minified(value, &expected_size);
+    ASSERT_TRUE(expected);
+
+    size_t capacity;
+
+    for (capacity = 1; capacity < 12; capacity++) {
+      struct json_write_slice_s slices[12];
+      const size_t slices_size =
+          json_write_minified_split(value, slices, capacity);
+      size_t i;
+
+      ASSERT_LT(0u, slices_size);
+      ASSERT_LE(slices_size, capacity);
+
+      for (i = 0; i < slices_size; i++) {
+        ASSERT_EQ(0, json_write_minified_slice_size(value, &slices[i]));
+      }
+
+      const size_t size = json_write_minified_slice_offsets(slices, slices_size);
+      ASSERT_EQ(expected_size, size);
+
+      char *const buffer = static_cast<char *>(malloc(size));
+
+      // the slices can be written in any order.
+      for (i = slices_size; 0 < i; i--) {
+        ASSERT_EQ(0, json_write_minified_slice(value, &slices[i - 1], buffer));
+      }
+
+      ASSERT_STREQ(static_cast<char *>(expected), buffer);
+      free(buffer);
+    }
+
+    free(expected);
+    free(value);
+  }
+}
+
+UTEST(write_split, even_slices) {
+  const char json[] = "[0, 1, 2, 3, 4, 5, 6, 7, 8, 9]";
+  struct json_value_s *const value = json_parse(json, strlen(json));
+  struct json_write_slice_s slices[4];
+
+  ASSERT_TRUE(value);
+  ASSERT_EQ(4u, json_write_minified_split(value, slices, 4));
+
+  // 10 elements split as evenly as possible.
+  ASSERT_EQ(0u, slices[0].index);
+  ASSERT_EQ(2u, slices[0].length);
+  ASSERT_EQ(2u, slices[1].index);
+  ASSERT_EQ(3u, slices[1].length);
+  ASSERT_EQ(5u, slices[2].index);
+  ASSERT_EQ(2u, slices[2].length);
+  ASSERT_EQ(7u, slices[3].index);
+  ASSERT_EQ(3u, slices[3].length);
+
+  free(value);
+}
+
+UTEST(write_split, invalid) {
+  struct json_value_s bad = {0, 42};
+  struct json_array_element_s element = {&bad, 0};
+  struct json_array_s array = {&element, 1};
+  struct json_value_s value = {&array, json_type_array};
+  struct json_write_slice_s slices[2];
+
+  ASSERT_EQ(0u, json_write_minified_split(&value, slices, 0));
+  ASSERT_EQ(0u, json_write_minified_split(0, slices, 2));
+  ASSERT_EQ(1u, json_write_minified_split(&value, slices, 2));
+  ASSERT_NE(0, json_write_minified_slice_size(&value, &slices[0]));
+}
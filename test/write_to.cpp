@@ -0,0 +1,363 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+static const char write_to_payload[] =
+    "{\"a\" : [1, +2, .5, 3., \"str\\\"ing\\n\", true, false, null, {}, []],"
+    " \"b\" : {\"c\" : \"\\u00e9\", \"d\" : [[[]]]}, \"Infinity\" : -Infinity,"
+    " \"NaN\" : NaN, \"hex\" : 0xdeadbeef}";
+
+UTEST(write_to, minified) {
+  struct json_value_s *const value =
+      json_parse_ex(write_to_payload, strlen(write_to_payload),
+                    json_parse_flags_allow_json5, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  size_t expected_size = 0;
+  void *const expected = json_write_minified(value, &expected_size);
+  ASSERT_TRUE(expected);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_minified_to(value, write_sink, &sink));
+  ASSERT_EQ(1u, sink.calls);
+  ASSERT_EQ(expected_size - 1, sink.size);
+  ASSERT_STREQ(static_cast<char *>(expected), sink.data);
+
+  free(sink.data);
+  free(expected);
+  free(value);
+}
+
+UTEST(write_to, pretty) {
+  struct json_value_s *const value =
+      json_parse_ex(write_to_payload, strlen(write_to_payload),
+                    json_parse_flags_allow_json5, 0, 0, 0);
+  ASSERT_TRUE(value);
+
+  size_t expected_size = 0;
+  void *const expected = json_write_pretty(value, "\t", "\r\n", &expected_size);
+  ASSERT_TRUE(expected);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_pretty_to(value, "\t", "\r\n", write_sink, &sink));
+  ASSERT_EQ(expected_size - 1, sink.size);
+  ASSERT_STREQ(static_cast<char *>(expected), sink.data);
+
+  free(sink.data);
+  free(expected);
+
+  // the defaults match json_write_pretty's too.
+  void *const defaulted = json_write_pretty(value, 0, 0, 0);
+  ASSERT_TRUE(defaulted);
+
+  struct write_sink_s defaulted_sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_pretty_to(value, 0, 0, write_sink, &defaulted_sink));
+  ASSERT_STREQ(static_cast<char *>(defaulted), defaulted_sink.data);
+
+  free(defaulted_sink.data);
+  free(defaulted);
+  free(value);
+}
+
+UTEST(write_to, larger_than_staging) {
+  // strings and numbers bigger than the staging buffer are written in pieces.
+  const size_t length = JSON_WRITE_STAGING_SIZE * 3 + 7;
+  char *const chars = static_cast<char *>(malloc(length));
+  char *const digits = static_cast<char *>(malloc(length));
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    chars[i] = (0 == i % 5) ? '\n' : 'x';
+    digits[i] = '1';
+  }
+
+  digits[0] = '-';
+  digits[1] = '.';
+
+  struct json_string_s string = {chars, length};
+  struct json_number_s number = {digits, length};
+  struct json_value_s string_value = {&string, json_type_string};
+  struct json_value_s number_value = {&number, json_type_number};
+  struct json_array_element_s second = {&number_value, 0};
+  struct json_array_element_s first = {&string_value, &second};
+  struct json_array_s array = {&first, 2};
+  struct json_value_s value = {&array, json_type_array};
+
+  size_t expected_size = 0;
+  void *const expected = json_write_minified(&value, &expected_size);
+  ASSERT_TRUE(expected);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_minified_to(&value, write_sink, &sink));
+  ASSERT_EQ(expected_size - 1, sink.size);
+  ASSERT_STREQ(static_cast<char *>(expected), sink.data);
+  ASSERT_LT(1u, sink.calls);
+
+  free(sink.data);
+  free(expected);
+
+  // and a trailing decimal point still gets its '0'.
+  digits[0] = '+';
+  digits[1] = '1';
+  digits[length - 1] = '.';
+
+  void *const trailing = json_write_minified(&number_value, 0);
+  ASSERT_TRUE(trailing);
+
+  struct write_sink_s trailing_sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0,
+            json_write_minified_to(&number_value, write_sink, &trailing_sink));
+  ASSERT_STREQ(static_cast<char *>(trailing), trailing_sink.data);
+
+  free(trailing_sink.data);
+  free(trailing);
+  free(digits);
+  free(chars);
+}
+
+UTEST(write_to, constant_staging) {
+  // a long array is written through the staging buffer in many small writes.
+  const size_t length = JSON_WRITE_STAGING_SIZE;
+  struct json_value_s *values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * length));
+  struct json_array_element_s *elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * length));
+  struct json_array_s array = {elements, length};
+  struct json_value_s value = {&array, json_type_array};
+  size_t i;
+
+  for (i = 0; i < length; i++) {
+    values[i].payload = 0;
+    values[i].type = json_type_false;
+    elements[i].value = &values[i];
+    elements[i].next = (i + 1 < length) ? &elements[i + 1] : 0;
+  }
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_pretty_to(&value, 0, 0, write_sink, &sink));
+  ASSERT_LT(5u, sink.calls);
+  ASSERT_LE(sink.largest, static_cast<size_t>(JSON_WRITE_STAGING_SIZE));
+
+  // "[\n  false,\n  false,\n ... false\n]".
+  ASSERT_EQ(length * 9 + 2, sink.size);
+
+  free(sink.data);
+
+  // a failing write stops the writer.
+  struct write_sink_s failing = {0, 0, 0, 0, 3};
+  ASSERT_NE(0, json_write_minified_to(&value, write_sink, &failing));
+  ASSERT_EQ(3u, failing.calls);
+
+  free(failing.data);
+  free(elements);
+  free(values);
+}
+
+UTEST(write_to, file) {
+  const char json[] = "{\"a\" : [1, true, \"x\"]}";
+  struct json_value_s *const parsed = json_parse(json, strlen(json));
+  FILE *const file = tmpfile();
+  char contents[256] = {0};
+
+  ASSERT_TRUE(parsed);
+  ASSERT_TRUE(file);
+
+  ASSERT_EQ(0, json_write_minified_to(parsed, json_write_file_callback, file));
+  rewind(file);
+  ASSERT_EQ(strlen("{\"a\":[1,true,\"x\"]}"),
+            fread(contents, 1, sizeof(contents) - 1, file));
+  ASSERT_STREQ("{\"a\":[1,true,\"x\"]}", contents);
+
+  fclose(file);
+  free(parsed);
+}
+
+#if !defined(_WIN32)
+UTEST(write_to, fd) {
+  const char json[] = "[null, {\"b\" : false}]";
+  struct json_value_s *const value = json_parse(json, strlen(json));
+  int fds[2];
+  char contents[256] = {0};
+
+  ASSERT_TRUE(value);
+  ASSERT_EQ(0, pipe(fds));
+
+  ASSERT_EQ(0, json_write_minified_to(value, json_write_fd_callback, &fds[1]));
+  close(fds[1]);
+
+  ASSERT_EQ(static_cast<ssize_t>(strlen("[null,{\"b\":false}]")),
+            read(fds[0], contents, sizeof(contents) - 1));
+  ASSERT_STREQ("[null,{\"b\":false}]", contents);
+
+  close(fds[0]);
+  free(value);
+}
+#endif
+
+UTEST(write_to, invalid) {
+  struct json_value_s value = {0, 42};
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_NE(0, json_write_minified_to(&value, write_sink, &sink));
+  ASSERT_NE(0, json_write_pretty_to(&value, 0, 0, write_sink, &sink));
+  ASSERT_NE(0, json_write_minified_to(0, write_sink, &sink));
+  ASSERT_NE(0, json_write_minified_to(&value, 0, 0));
+  free(sink.data);
+}
+
+static int write_to_segments_sink(void *user_data,
+                                  const struct json_write_segment_s *segments,
+                                  size_t size) {
+  size_t i;
+
+  for (i = 0; i < size; i++) {
+    if (write_sink(user_data, segments[i].data, segments[i].size)) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+UTEST(write_to, deep) {
+  // values nested far deeper than the parser allows are streamed without
+  // recursing, alternating between arrays and objects.
+  const size_t depth = 200000;
+  struct json_value_s *const values = static_cast<struct json_value_s *>(
+      malloc(sizeof(struct json_value_s) * (depth + 1)));
+  struct json_array_element_s *const array_elements =
+      static_cast<struct json_array_element_s *>(
+          malloc(sizeof(struct json_array_element_s) * depth));
+  struct json_object_element_s *const object_elements =
+      static_cast<struct json_object_element_s *>(
+          malloc(sizeof(struct json_object_element_s) * depth));
+  struct json_array_s *const arrays = static_cast<struct json_array_s *>(
+      malloc(sizeof(struct json_array_s) * depth));
+  struct json_object_s *const objects = static_cast<struct json_object_s *>(
+      malloc(sizeof(struct json_object_s) * depth));
+  struct json_string_s name = {"a", 1};
+  struct json_array_element_s line = {&values[0], 0};
+  struct json_array_s lines = {&line, 1};
+  struct json_value_s root = {&lines, json_type_array};
+  size_t i;
+
+  for (i = 0; i < depth; i++) {
+    if (0 == i % 2) {
+      array_elements[i].value = &values[i + 1];
+      array_elements[i].next = 0;
+      arrays[i].start = &array_elements[i];
+      arrays[i].length = 1;
+      values[i].payload = &arrays[i];
+      values[i].type = json_type_array;
+    } else {
+      object_elements[i].name = &name;
+      object_elements[i].value = &values[i + 1];
+      object_elements[i].next = 0;
+      objects[i].start = &object_elements[i];
+      objects[i].length = 1;
+      values[i].payload = &objects[i];
+      values[i].type = json_type_object;
+    }
+  }
+
+  values[depth].payload = 0;
+  values[depth].type = json_type_true;
+
+  size_t minified_size = 0;
+  char *const minified =
+      static_cast<char *>(json_write_minified(&values[0], &minified_size));
+  ASSERT_TRUE(minified);
+
+  // an empty indent keeps the pretty output from growing with depth squared.
+  size_t pretty_size = 0;
+  char *const pretty = static_cast<char *>(
+      json_write_pretty(&values[0], "", "\n", &pretty_size));
+  ASSERT_TRUE(pretty);
+
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_minified_to(&values[0], write_sink, &sink));
+  ASSERT_EQ(minified_size - 1, sink.size);
+  ASSERT_EQ(0, memcmp(minified, sink.data, sink.size));
+  free(sink.data);
+
+  struct write_sink_s pretty_sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_pretty_to(&values[0], "", "\n", write_sink,
+                                    &pretty_sink));
+  ASSERT_EQ(pretty_size - 1, pretty_sink.size);
+  ASSERT_EQ(0, memcmp(pretty, pretty_sink.data, pretty_sink.size));
+  free(pretty_sink.data);
+
+  struct write_sink_s segments_sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_minified_segments(
+                   &values[0], write_to_segments_sink, &segments_sink));
+  ASSERT_EQ(minified_size - 1, segments_sink.size);
+  ASSERT_EQ(0, memcmp(minified, segments_sink.data, segments_sink.size));
+  free(segments_sink.data);
+
+  struct write_sink_s ndjson_sink = {0, 0, 0, 0, 0};
+  ASSERT_EQ(0, json_write_ndjson_to(&root, write_sink, &ndjson_sink));
+  ASSERT_EQ(minified_size, ndjson_sink.size);
+  ASSERT_EQ(0, memcmp(minified, ndjson_sink.data, minified_size - 1));
+  free(ndjson_sink.data);
+
+  size_t growable_size = 0;
+  char *const growable = static_cast<char *>(
+      json_write_minified_growable(&values[0], 0, 0, &growable_size));
+  ASSERT_TRUE(growable);
+  ASSERT_EQ(minified_size, growable_size);
+  ASSERT_STREQ(minified, growable);
+  free(growable);
+
+  struct json_write_cache_s *const cache =
+      json_write_cache_create(&values[0], 0, 0);
+  ASSERT_TRUE(cache);
+  size_t cached_size = 0;
+  char *const cached = static_cast<char *>(json_write_pretty_cached(
+      cache, &values[0], "", "\n", 0, 0, &cached_size));
+  ASSERT_TRUE(cached);
+  ASSERT_EQ(pretty_size, cached_size);
+  ASSERT_STREQ(pretty, cached);
+  free(cached);
+  free(cache);
+
+  free(pretty);
+  free(minified);
+  free(objects);
+  free(arrays);
+  free(object_elements);
+  free(array_elements);
+  free(values);
+}
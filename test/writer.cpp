@@ -0,0 +1,240 @@
+// This is free and unencumbered software released into the public domain.
+//
+// Anyone is free to copy, modify, publish, use, compile, sell, or
+// distribute this software, either in source code form or as a compiled
+// binary, for any purpose, commercial or non-commercial, and by any
+// means.
+//
+// In jurisdictions that recognize copyright laws, the author or authors
+// of this software dedicate any and all copyright interest in the
+// software to the public domain. We make this dedication for the benefit
+// of the public at large and to the detriment of our heirs and
+// successors. We intend this dedication to be an overt act of
+// relinquishment in perpetuity of all present and future rights to this
+// software under copyright law.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+// For more information, please refer to <http://unlicense.org/>
+
+#include "utest.h"
+
+#include "json.h"
+#include "write_sink.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int writer_write_document(struct json_writer_s *writer, int raw) {
+  return json_writer_begin_object(writer) ||
+         json_writer_name(writer, "id", 2) ||
+         json_writer_integer(writer, -42) ||
+         json_writer_name(writer, "name", 4) ||
+         json_writer_string(writer, "tab\there", 8) ||
+         json_writer_name(writer, "list", 4) ||
+         json_writer_begin_array(writer) || json_writer_boolean(writer, 1) ||
+         json_writer_boolean(writer, 0) || json_writer_null(writer) ||
+         json_writer_double(writer, 0.25) ||
+         json_writer_begin_object(writer) || json_writer_end(writer) ||
+         json_writer_begin_array(writer) || json_writer_end(writer) ||
+         json_writer_begin_array(writer) ||
+         (raw ? json_writer_raw(writer, "{\"x\":[1]}", 9)
+              : (json_writer_begin_object(writer) ||
+                 json_writer_name(writer, "x", 1) ||
+                 json_writer_begin_array(writer) ||
+                 json_writer_integer(writer, 1) || json_writer_end(writer) ||
+                 json_writer_end(writer))) ||
+         json_writer_end(writer) ||
+         json_writer_end(writer) || json_writer_end(writer) ||
+         json_writer_finish(writer);
+}
+
+static const char writer_document[] =
+    "{\"id\":-42,\"name\":\"tab\\there\",\"list\":[true,false,null,0.25,{},[],"
+    "[{\"x\":[1]}]]}";
+
+UTEST(writer, minified) {
+  struct json_writer_s *const writer = json_writer_create(0, 0, 0, 0);
+  ASSERT_TRUE(writer);
+
+  ASSERT_EQ(0, writer_write_document(writer, 1));
+
+  size_t size = 0;
+  const char *const output = json_writer_get_output(writer, &size);
+  ASSERT_TRUE(output);
+  ASSERT_EQ(strlen(writer_document), size);
+  ASSERT_STREQ(writer_document, output);
+
+  json_writer_destroy(writer);
+}
+
+UTEST(writer, pretty) {
+  struct json_value_s *const value =
+      json_parse(writer_document, strlen(writer_document));
+  ASSERT_TRUE(value);
+
+  const char *const indents[] = {0, "\t", ""};
+  const char *const newlines[] = {"\n", 0, "\r\n"};
+  size_t i;
+
+  for (i = 0; i < sizeof(indents) / sizeof(indents[0]); i++) {
+    struct json_writer_s *const writer =
+        json_writer_create(indents[i], newlines[i], 0, 0);
+    ASSERT_TRUE(writer);
+
+    // raw values are written as is, so aren't made pretty.
+    ASSERT_EQ(0, writer_write_document(writer, 0));
+
+    void *const expected = json_write_pretty(value, indents[i], newlines[i], 0);
+    ASSERT_TRUE(expected);
+    ASSERT_STREQ(static_cast<char *>(expected),
+                 json_writer_get_output(writer, 0));
+
+    free(expected);
+    json_writer_destroy(writer);
+  }
+
+  free(value);
+}
+
+UTEST(writer, sink) {
+  struct write_sink_s sink = {0, 0, 0, 0, 0};
+  struct json_writer_s *const writer =
+      json_writer_create(0, 0, write_sink, &sink);
+  const size_t length = JSON_WRITE_STAGING_SIZE;
+  size_t i;
+
+  ASSERT_TRUE(writer);
+  ASSERT_EQ(0, json_writer_begin_array(writer));
+
+  for (i = 0; i < length; i++) {
+    ASSERT_EQ(0, json_writer_integer(writer, 7));
+  }
+
+  ASSERT_EQ(0, json_writer_end(writer));
+  ASSERT_EQ(0, json_writer_finish(writer));
+
+  // the output went to the sink, not a buffer.
+  ASSERT_FALSE(json_writer_get_output(writer, 0));
+  ASSERT_LT(1u, sink.calls);
+  ASSERT_EQ(length * 2 + 1, sink.size);
+  ASSERT_EQ('[', sink.data[0]);
+  ASSERT_EQ(']', sink.data[sink.size - 1]);
+
+  free(sink.data);
+  json_writer_destroy(writer);
+}
+
+UTEST(writer, reset) {
+  struct json_writer_s *const writer = json_writer_create(0, 0, 0, 0);
+  ASSERT_TRUE(writer);
+
+  ASSERT_EQ(0, json_writer_string(writer, "first", 5));
+  ASSERT_EQ(0, json_writer_finish(writer));
+  ASSERT_STREQ("\"first\"", json_writer_get_output(writer, 0));
+
+  // a second value at the root is an error, until the writer is reset.
+  ASSERT_NE(0, json_writer_null(writer));
+  ASSERT_FALSE(json_writer_get_output(writer, 0));
+
+  json_writer_reset(writer);
+  ASSERT_EQ(0, json_writer_begin_array(writer));
+  ASSERT_EQ(0, json_writer_end(writer));
+  ASSERT_EQ(0, json_writer_finish(writer));
+  ASSERT_STREQ("[]", json_writer_get_output(writer, 0));
+
+  json_writer_destroy(writer);
+}
+
+UTEST(writer, misuse) {
+  struct json_writer_s *const writer = json_writer_create(0, 0, 0, 0);
+  ASSERT_TRUE(writer);
+
+  // a name outside of an object.
+  ASSERT_NE(0, json_writer_name(writer, "a", 1));
+  json_writer_reset(writer);
+
+  // a value in an object without a name.
+  ASSERT_EQ(0, json_writer_begin_object(writer));
+  ASSERT_NE(0, json_writer_integer(writer, 1));
+  json_writer_reset(writer);
+
+  // two names in a row, and a name without a value.
+  ASSERT_EQ(0, json_writer_begin_object(writer));
+  ASSERT_EQ(0, json_writer_name(writer, "a", 1));
+  ASSERT_NE(0, json_writer_name(writer, "b", 1));
+  json_writer_reset(writer);
+
+  ASSERT_EQ(0, json_writer_begin_object(writer));
+  ASSERT_EQ(0, json_writer_name(writer, "a", 1));
+  ASSERT_NE(0, json_writer_end(writer));
+  json_writer_reset(writer);
+
+  // too many ends, a non-finite double, or an unfinished array.
+  ASSERT_NE(0, json_writer_end(writer));
+  json_writer_reset(writer);
+
+  ASSERT_NE(0, json_writer_double(writer, HUGE_VAL));
+  json_writer_reset(writer);
+
+  ASSERT_NE(0, json_writer_finish(writer));
+  ASSERT_EQ(0, json_writer_begin_array(writer));
+  ASSERT_NE(0, json_writer_finish(writer));
+  ASSERT_FALSE(json_writer_get_output(writer, 0));
+
+  json_writer_destroy(writer);
+}
+
+UTEST(writer, numbers) {
+  struct json_writer_s *const writer = json_writer_create(0, 0, 0, 0);
+  ASSERT_TRUE(writer);
+
+  // doubles get the shortest digits that read back as the same double.
+  const double doubles[] = {0.1,     -0.0,   1.0,     123.0,   1e21,
+                            1.5e-7,  5e-324, 1e-6,    3.14159, -2.5e300,
+                            1.7976931348623157e308, 9007199254740993.0};
+  const char *const expected[] = {"0.1",     "-0",       "1",
+                                  "123",     "1e+21",    "1.5e-7",
+                                  "5e-324",  "0.000001", "3.14159",
+                                  "-2.5e+300", "1.7976931348623157e+308",
+                                  "9007199254740992"};
+  size_t i;
+
+  for (i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+    json_writer_reset(writer);
+    ASSERT_EQ(0, json_writer_double(writer, doubles[i]));
+    ASSERT_STREQ(expected[i], json_writer_get_output(writer, 0));
+  }
+
+  // and any double reads back the same.
+  for (i = 0; i < 10000; i++) {
+    const double value = (static_cast<double>(i) - 5000.0) / 7.0 *
+                         pow(10.0, static_cast<double>(i % 600) - 300.0);
+    json_writer_reset(writer);
+    ASSERT_EQ(0, json_writer_double(writer, value));
+    ASSERT_EQ(value, strtod(json_writer_get_output(writer, 0), 0));
+  }
+
+  json_writer_reset(writer);
+  ASSERT_EQ(0, json_writer_begin_array(writer));
+  ASSERT_EQ(0, json_writer_integer(writer, 0));
+  ASSERT_EQ(0, json_writer_integer(writer, 9));
+  ASSERT_EQ(0, json_writer_integer(writer, -10));
+  ASSERT_EQ(0, json_writer_integer(writer, 1234567));
+  ASSERT_EQ(0, json_writer_integer(writer, INTMAX_MIN));
+  ASSERT_EQ(0, json_writer_end(writer));
+
+  char buffer[64];
+  sprintf(buffer, "[0,9,-10,1234567,%jd]", static_cast<intmax_t>(INTMAX_MIN));
+  ASSERT_STREQ(buffer, json_writer_get_output(writer, 0));
+
+  json_writer_destroy(writer);
+}